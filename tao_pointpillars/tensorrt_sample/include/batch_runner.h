@@ -0,0 +1,87 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef BATCH_RUNNER_H_
+#define BATCH_RUNNER_H_
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include "detector.h"
+#include "file_prefetcher.h"
+
+struct BatchConfig {
+    // files loaded ahead of inference, and raw results queued for the writer
+    unsigned int read_ahead = 4;
+    float nms_thresh = 0.01f;
+    int pre_nms_top_n = 4096;
+    // results are written to <output_dir>/<input stem>.txt
+    std::string output_dir = ".";
+    // when every input is a .bin file, read them with a FilePrefetcher and
+    // infer straight from its buffers
+    bool prefetch = false;
+    PrefetchBackend prefetch_backend = PrefetchBackend::kAuto;
+};
+
+enum BatchStatus {
+    kBatchOk = 0,
+    kBatchLoadFailed = -1,
+    kBatchInferFailed = -2,
+    kBatchWriteFailed = -3,
+};
+
+struct BatchResult {
+    int status = kBatchLoadFailed;
+    unsigned int num_points = 0;
+    size_t num_boxes = 0;
+    std::string output;
+};
+
+struct BatchStats {
+    double load_wait_ms = 0.0;      // inference waiting for the loader
+    double infer_ms = 0.0;
+    double post_ms = 0.0;           // NMS and writing, on the writer thread
+    double total_ms = 0.0;
+    // backend of the prefetcher, kAuto when PointLoader read the files
+    PrefetchBackend prefetch = PrefetchBackend::kAuto;
+};
+
+// Runs a detector over a list of point cloud files in three overlapping
+// stages: a loader thread reads files ahead into point buffers that are
+// reused, the calling thread runs inference, and a writer thread runs NMS
+// and writes the results. Buffers are allocated once per runner, or once
+// per run by the prefetcher.
+class BatchRunner {
+  private:
+    Detector &detector_;
+    BatchConfig config_;
+    std::vector<std::vector<float>> buffers_;
+    BatchStats stats_;
+
+  public:
+    BatchRunner(Detector &detector, const BatchConfig &config);
+    // Processes files in order; results[i] belongs to files[i]. Returns the
+    // number of files that failed.
+    size_t run(const std::vector<std::string> &files, std::vector<BatchResult> &results);
+    const BatchStats &stats() const { return stats_; }
+};
+
+// <output_dir>/<stem of input>.txt, the name pointpillars gives a result.
+std::string batch_output_name(const std::string &output_dir, const std::string &input);
+
+#endif
@@ -0,0 +1,81 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef BOX_COMPARE_H_
+#define BOX_COMPARE_H_
+
+#include <stddef.h>
+#include <vector>
+#include "postprocess.h"
+
+// Comparison of two detection results of one frame, e.g. a golden output
+// and the output of a changed build.
+//
+// Boxes at the same position in both lists with identical fields are paired
+// directly. The remaining boxes are matched greedily by rotated BEV IoU (best
+// pair first), with candidates pruned by center distance against the boxes'
+// circumcircles. A matched pair is within tolerance when every field error is.
+
+struct BoxTolerance {
+    // pairs with a lower IoU are not matched
+    float min_iou = 0.5f;
+    // absolute errors: center x y z (m), size w l h (m), yaw (rad), score
+    float center = 1e-3f;
+    float size = 1e-3f;
+    float yaw = 1e-3f;
+    float score = 1e-4f;
+    // only boxes of the same class are matched
+    bool class_aware = true;
+};
+
+enum BoxField { kFieldCenter, kFieldSize, kFieldYaw, kFieldScore, kNumBoxFields };
+
+struct FrameDiff {
+    size_t ref_boxes = 0;
+    size_t test_boxes = 0;
+    size_t matched = 0;
+    size_t identical = 0;           // matched pairs with equal fields
+    size_t missing = 0;             // reference boxes without a match
+    size_t extra = 0;               // test boxes without a match
+    size_t out_of_tolerance = 0;    // matched pairs with a field error above tolerance
+    float min_iou = 1.0f;           // lowest IoU of a matched pair
+    float max_error[kNumBoxFields] = {0.0f, 0.0f, 0.0f, 0.0f};
+
+    bool equal() const { return missing == 0 && extra == 0 && out_of_tolerance == 0; }
+    // accumulates the counts and worst errors of other
+    void add(const FrameDiff &other);
+};
+
+// Scratch of compare_boxes, reusable across calls.
+struct BoxCompareScratch {
+    std::vector<int> ref_left;
+    std::vector<int> test_left;
+    std::vector<char> ref_matched;
+    std::vector<char> test_matched;
+    struct Pair {
+        float iou;
+        int ref;
+        int test;
+    };
+    std::vector<Pair> pairs;
+};
+
+void compare_boxes(const std::vector<Bndbox> &ref, const std::vector<Bndbox> &test,
+                   const BoxTolerance &tolerance, FrameDiff &diff, BoxCompareScratch &scratch);
+
+#endif
@@ -0,0 +1,145 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef BOX_DECODER_H_
+#define BOX_DECODER_H_
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "postprocess.h"
+
+// One class of anchors: its size at zero rotation and the height of its
+// bottom face. Every feature map cell has one anchor per class and rotation.
+struct AnchorClass {
+    float size[3];      // length (x), width (y), height (z)
+    float bottom_z;
+};
+
+// Anchor setup of the heads; the defaults are those of the KITTI model.
+struct BoxDecoderConfig {
+    // point range x_min, y_min, z_min, x_max, y_max, z_max
+    float range[6] = {0.0f, -39.68f, -3.0f, 69.12f, 39.68f, 1.0f};
+    // feature map size of the heads
+    int grid_x = 216;
+    int grid_y = 248;
+    std::vector<AnchorClass> classes{
+        {{3.9f, 1.6f, 1.56f}, -1.78f},
+        {{0.8f, 0.6f, 1.73f}, -0.6f},
+        {{1.76f, 0.6f, 1.73f}, -0.6f},
+    };
+    std::vector<float> rotations{0.0f, 1.57f};
+    // anchors at cell centers instead of spanning the range edge to edge
+    bool align_center = false;
+    // candidates below this sigmoid score are dropped before any box math
+    float score_thresh = 0.1f;
+    // direction classifier: the heading is folded into one period of
+    // 2 pi / num_dir_bins and the predicted bin picks the period
+    float dir_offset = 0.78539f;
+    float dir_limit_offset = 0.0f;
+    int num_dir_bins = 2;
+    // threads of one decode() call, over feature map rows; <= 0 uses the
+    // hardware concurrency. Callers decoding on several threads at once
+    // should split the cores between them, as PointPillar does per context.
+    int num_threads = 0;
+};
+
+class BoxDecoder;
+
+// Per-call buffers of BoxDecoder::decode, reusable across calls, and the
+// helper threads that decode the other row ranges while the calling thread
+// decodes the first. One per thread calling decode. The helpers are started
+// by the first decode and wait for the next call, so later calls start no
+// threads and allocate nothing.
+struct BoxDecoderScratch {
+    std::vector<std::vector<Bndbox>> parts;
+
+    BoxDecoderScratch() = default;
+    BoxDecoderScratch(const BoxDecoderScratch &) = delete;
+    BoxDecoderScratch &operator=(const BoxDecoderScratch &) = delete;
+    ~BoxDecoderScratch();
+
+  private:
+    friend class BoxDecoder;
+    // the call the helpers are working on
+    const BoxDecoder *decoder_ = nullptr;
+    const float *cls_ = nullptr, *box_ = nullptr, *dir_ = nullptr;
+    int num_threads_ = 1;
+
+    std::vector<std::thread> helpers_;
+    std::mutex mutex_;
+    std::condition_variable start_cv_, done_cv_;
+    unsigned long long generation_ = 0;
+    int pending_ = 0;
+    bool stop_ = false;
+
+    void helperLoop(int t, unsigned long long seen);
+};
+
+// Turns the raw heads of an engine exported without the decode plugin into
+// Bndbox candidates, the same boxes the plugin would write to box_output.
+// The heads are NHWC float tensors over the grid_y x grid_x feature map with
+// A = classes * rotations anchors per cell, class major:
+//   cls  [grid_y][grid_x][A][num_classes]   logits
+//   box  [grid_y][grid_x][A][7]             dx, dy, dz, dl, dw, dh, drot
+//   dir  [grid_y][grid_x][A][num_dir_bins]  logits
+// Anchor positions and shapes are computed once by the constructor. The
+// score threshold is compared with the logits, so cells without a candidate
+// cost a compare per logit; feature map rows are split over threads.
+// decode() is const and may run on several threads with separate scratch.
+class BoxDecoder {
+  private:
+    struct Anchor {
+        float l, w, h, z, rot, diagonal;
+        int id;
+    };
+    BoxDecoderConfig config_;
+    std::vector<Anchor> anchors_;       // the A anchors of a cell
+    std::vector<float> xs_, ys_;        // anchor centers of the columns and rows
+    int num_classes_;
+    float logit_thresh_;
+
+    void decodeRows(const float *cls, const float *box, const float *dir,
+                    int row_begin, int row_end, std::vector<Bndbox> &out) const;
+    // decodes the t-th of scratch.num_threads_ row ranges into scratch.parts[t]
+    void decodePart(BoxDecoderScratch &scratch, int t) const;
+
+    friend struct BoxDecoderScratch;
+
+  public:
+    explicit BoxDecoder(const BoxDecoderConfig &config = BoxDecoderConfig());
+
+    const BoxDecoderConfig &config() const { return config_; }
+    int anchorsPerCell() const { return anchors_.size(); }
+    // channels of the three heads
+    int clsChannels() const { return anchors_.size() * num_classes_; }
+    int boxChannels() const { return anchors_.size() * 7; }
+    int dirChannels() const { return anchors_.size() * config_.num_dir_bins; }
+    // most candidates one frame can give
+    size_t maxCandidates() const { return (size_t)config_.grid_x * config_.grid_y * anchors_.size(); }
+
+    // Appends the candidates at or above the score threshold to boxes, in
+    // feature map order. With top_k > 0 only the top_k highest scoring are
+    // appended (in no particular order), which is all nms_cpu with
+    // pre_nms_top_n = top_k would look at. Returns the number appended.
+    int decode(const float *cls, const float *box, const float *dir,
+               std::vector<Bndbox> &boxes, BoxDecoderScratch &scratch, int top_k = 0) const;
+};
+
+#endif
@@ -0,0 +1,46 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+
+#ifndef BOX_IO_H_
+#define BOX_IO_H_
+
+#include <string>
+#include <vector>
+#include "postprocess.h"
+
+// Reads a SaveBoxPred (9 columns) or tracked (12 columns) result file.
+// track_ids receives the track column, -1 for untracked files. buffer is
+// scratch reused across calls and holds the file contents on return.
+int load_box_pred(const std::string &path, std::vector<Bndbox> &boxes, std::vector<int> &track_ids,
+                  std::string &buffer);
+// Reads the whole file into buffer.
+int read_text_file(const std::string &path, std::string &buffer);
+// load_box_pred of text already in memory; path is only used in messages.
+int parse_box_pred(const std::string &text, const std::string &path, std::vector<Bndbox> &boxes,
+                   std::vector<int> &track_ids);
+// Writes boxes in SaveBoxPred format.
+int save_box_pred(const std::vector<Bndbox> &boxes, const std::string &path);
+
+// Raw (pre-NMS) boxes of a frame, as cached by --cache-raw: the magic
+// "PPBOXES1", a uint32 box count, then 9 floats per box in SaveBoxPred
+// column order. Exact, unlike the text format.
+int save_box_raw(const std::vector<Bndbox> &boxes, const std::string &path);
+int load_box_raw(const std::string &path, std::vector<Bndbox> &boxes);
+
+#endif
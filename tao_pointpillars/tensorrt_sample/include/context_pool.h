@@ -0,0 +1,126 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef CONTEXT_POOL_H_
+#define CONTEXT_POOL_H_
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Fixed set of per-request contexts (execution state, buffers, streams) that
+// threads check out for one request at a time. acquire() blocks until a
+// context is free; the returned lease gives it back when it goes out of scope.
+template <typename T>
+class ContextPool {
+  private:
+    std::vector<std::unique_ptr<T>> contexts_;
+    std::vector<T *> free_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    unsigned long long acquires_ = 0;
+    unsigned long long waits_ = 0;
+
+    void release(T *context)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            free_.push_back(context);
+        }
+        cv_.notify_one();
+    }
+
+  public:
+    class Lease {
+      private:
+        ContextPool *pool_ = nullptr;
+        T *context_ = nullptr;
+
+      public:
+        Lease() {}
+        Lease(ContextPool *pool, T *context) : pool_(pool), context_(context) {}
+        Lease(Lease &&other) : pool_(other.pool_), context_(other.context_) { other.context_ = nullptr; }
+        Lease &operator=(Lease &&other)
+        {
+            if (this != &other) {
+                reset();
+                pool_ = other.pool_;
+                context_ = other.context_;
+                other.context_ = nullptr;
+            }
+            return *this;
+        }
+        Lease(const Lease &) = delete;
+        Lease &operator=(const Lease &) = delete;
+        ~Lease() { reset(); }
+
+        void reset()
+        {
+            if (context_) {
+                pool_->release(context_);
+                context_ = nullptr;
+            }
+        }
+        T *get() const { return context_; }
+        T *operator->() const { return context_; }
+        T &operator*() const { return *context_; }
+    };
+
+    ContextPool() {}
+    ContextPool(const ContextPool &) = delete;
+    ContextPool &operator=(const ContextPool &) = delete;
+
+    // Contexts are added once, before the pool is shared between threads.
+    void add(std::unique_ptr<T> context)
+    {
+        free_.push_back(context.get());
+        contexts_.push_back(std::move(context));
+    }
+
+    Lease acquire()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        acquires_++;
+        if (free_.empty()) {
+            waits_++;
+            cv_.wait(lock, [this] { return !free_.empty(); });
+        }
+        T *context = free_.back();
+        free_.pop_back();
+        return Lease(this, context);
+    }
+
+    size_t size() const { return contexts_.size(); }
+    // every context, for setup and teardown while no lease is out
+    T &at(size_t index) { return *contexts_[index]; }
+
+    // checkouts so far, and how many of them had to wait for a free context
+    unsigned long long acquires()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return acquires_;
+    }
+    unsigned long long waits()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return waits_;
+    }
+};
+
+#endif
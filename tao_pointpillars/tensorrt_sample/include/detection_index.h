@@ -0,0 +1,139 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef DETECTION_INDEX_H_
+#define DETECTION_INDEX_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <limits>
+#include <string>
+#include <vector>
+#include "postprocess.h"
+
+// Spatio-temporal index over stored detections.
+//
+// Detections of many frames are kept in one columnar file: one array per
+// field (x, y, z, w, l, h, rt, score, class, frame, track id) plus a frame
+// table with timestamps and source names. Records are grouped into cells
+// keyed by (time bucket, BEV grid cell, class) and each cell is a contiguous
+// run of every column. A query visits only the cells whose time bucket, grid
+// cell and class can match and skips cells whose best score is below the
+// cutoff; records of the visited cells are then tested exactly. Region tests
+// use the box center. The file is mapped read-only, so opening an index does
+// not read it.
+
+struct DetectionQuery {
+    // inclusive time range in seconds
+    double t_begin = -std::numeric_limits<double>::infinity();
+    double t_end = std::numeric_limits<double>::infinity();
+    enum Region { kAll, kCircle, kBox };
+    Region region = kAll;
+    // kCircle: center and radius in meters
+    float x = 0.0f;
+    float y = 0.0f;
+    float radius = 0.0f;
+    // kBox: x_min, y_min, x_max, y_max
+    float box[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    // bit i set: class id i matches
+    uint64_t class_mask = ~0ull;
+    float min_score = 0.0f;
+};
+
+struct DetectionQueryStats {
+    size_t buckets = 0;     // time buckets visited
+    size_t cells = 0;       // cells whose records were scanned
+    size_t scanned = 0;     // records tested
+    size_t hits = 0;
+};
+
+// Builds an index file. Frames may be added in any order.
+class DetectionIndexWriter {
+  private:
+    struct Record {
+        float values[8];    // x y z w l h rt score
+        int32_t track;
+        uint32_t frame;
+        uint16_t cls;
+    };
+    double bucket_seconds_;
+    float cell_size_;
+    std::vector<double> times_;
+    std::vector<std::string> names_;
+    std::vector<Record> records_;
+
+  public:
+    DetectionIndexWriter(double bucket_seconds, float cell_size);
+    // Boxes of one frame taken at timestamp (seconds). track_ids, when given,
+    // holds one id per box (-1 untracked). pose (row-major 4x4 world-from-
+    // sensor) moves the boxes into world coordinates. Returns -1 for class
+    // ids outside 0..63.
+    int addFrame(const std::string &name, double timestamp, const std::vector<Bndbox> &boxes,
+                 const int *track_ids = nullptr, const float *pose = nullptr);
+    size_t numFrames() const { return times_.size(); }
+    size_t numRecords() const { return records_.size(); }
+    int write(const std::string &path) const;
+};
+
+struct DetectionIndexHeader;
+struct DetectionIndexCell;
+
+class DetectionIndex {
+  private:
+    void *mem_ = nullptr;
+    size_t bytes_ = 0;
+    const DetectionIndexHeader *header_ = nullptr;
+    const DetectionIndexCell *cells_ = nullptr;
+    const double *frame_times_ = nullptr;
+    const uint32_t *name_offsets_ = nullptr;
+    const char *names_ = nullptr;
+    const float *columns_[8];
+    const uint32_t *frames_ = nullptr;
+    const int32_t *tracks_ = nullptr;
+    const uint16_t *classes_ = nullptr;
+
+    // tests the records of one cell
+    void scanCell(const DetectionIndexCell &cell, const DetectionQuery &query,
+                  std::vector<uint32_t> &records, DetectionQueryStats &stats) const;
+
+  public:
+    explicit DetectionIndex(const std::string &path);
+    ~DetectionIndex(void);
+    DetectionIndex(const DetectionIndex &) = delete;
+    DetectionIndex &operator=(const DetectionIndex &) = delete;
+    bool isOpen() const { return header_ != nullptr; }
+
+    size_t numRecords() const;
+    size_t numFrames() const;
+    size_t numCells() const;
+    double bucketSeconds() const;
+    float cellSize() const;
+
+    // Appends the matching record numbers to records, grouped by cell and in
+    // time order within a cell. Returns the number appended.
+    size_t query(const DetectionQuery &query, std::vector<uint32_t> &records,
+                 DetectionQueryStats *stats = nullptr) const;
+
+    Bndbox box(uint32_t record) const;
+    int32_t trackId(uint32_t record) const { return tracks_[record]; }
+    uint32_t frame(uint32_t record) const { return frames_[record]; }
+    double frameTime(uint32_t frame) const { return frame_times_[frame]; }
+    const char *frameName(uint32_t frame) const { return names_ + name_offsets_[frame]; }
+};
+
+#endif
@@ -0,0 +1,137 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef DETECTION_SERVER_H_
+#define DETECTION_SERVER_H_
+
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "detector.h"
+#include "point_io.h"
+#include "point_ring.h"
+
+// Wire format of the detection daemon over a Unix stream socket, in host
+// byte order. A client sends a ServeRequest followed by name_len bytes of
+// file path or ring name and gets a ServeReply followed by num_boxes Bndbox
+// records. One request is in flight per connection; open more connections
+// for concurrency.
+enum ServeSource : uint32_t {
+    kServeFile = 0,     // name is a point cloud file PointLoader can read
+    kServeRing = 1,     // name is a point ring, seq a frame (0 = newest)
+};
+
+enum ServeStatus : int32_t {
+    kServeOk = 0,
+    kServeBadRequest = -1,
+    kServeLoadFailed = -2,
+    kServeFrameGone = -3,       // ring frame not published or overwritten
+    kServeShutdown = -4,
+};
+
+struct ServeRequest {
+    char magic[4];              // "PPRQ"
+    uint32_t id;                // echoed in the reply
+    uint32_t source;            // ServeSource
+    float nms_iou_thresh;       // finite
+    int32_t pre_nms_top_n;      // > 0, else kServeBadRequest
+    uint32_t name_len;
+    uint64_t seq;
+};
+
+struct ServeReply {
+    char magic[4];              // "PPRP"
+    uint32_t id;
+    int32_t status;             // ServeStatus
+    uint32_t num_boxes;
+    uint64_t seq;               // ring frame that was inferred
+    float queue_ms;             // waiting for the inference thread
+    float infer_ms;             // load, inference and NMS
+    uint32_t coalesced;         // requests answered by the same inference
+    uint32_t reserved;
+};
+
+// Keeps one detector resident and serves clients from a single inference
+// thread. Requests wait in a FIFO queue; when a request is picked, every
+// queued request for the same input (same file, or same ring frame, newest
+// included) is taken with it and answered from one inference, with NMS run
+// once per distinct parameter set.
+class DetectionServer {
+  private:
+    struct Job;
+
+    Detector &detector_;
+    std::string socket_path_;
+    int listen_fd_ = -1;
+    std::atomic<bool> stop_{false};
+
+    std::mutex mutex_;
+    std::condition_variable queue_cv_;
+    std::condition_variable done_cv_;
+    std::deque<Job *> queue_;
+    std::vector<int> client_fds_;
+    unsigned int active_clients_ = 0;
+
+    // inference thread state
+    PointLoader loader_;
+    std::vector<float> points_;
+    std::vector<Bndbox> raw_;
+    std::map<std::string, std::unique_ptr<PointRingReader>> rings_;
+
+    std::atomic<unsigned long long> requests_{0};
+    std::atomic<unsigned long long> inferences_{0};
+
+    void serveClient(int fd);
+    void worker();
+    void process(std::vector<Job *> &group);
+    PointRingReader *ring(const std::string &name);
+
+  public:
+    DetectionServer(Detector &detector, const std::string &socket_path);
+    ~DetectionServer(void);
+    bool isOpen() const { return listen_fd_ >= 0; }
+    // Accept and serve clients until stop().
+    int run();
+    // Safe to call from a signal handler.
+    void stop() { stop_ = true; }
+    unsigned long long requests() const { return requests_; }
+    unsigned long long inferences() const { return inferences_; }
+};
+
+class DetectionClient {
+  private:
+    int fd_ = -1;
+    uint32_t next_id_ = 1;
+
+  public:
+    explicit DetectionClient(const std::string &socket_path);
+    ~DetectionClient(void);
+    bool isOpen() const { return fd_ >= 0; }
+    // Blocking round trip. Returns reply->status, or kServeShutdown when the
+    // connection is lost.
+    int request(ServeSource source, const std::string &name, uint64_t seq, float nms_iou_thresh,
+                int pre_nms_top_n, ServeReply *reply, std::vector<Bndbox> &boxes);
+};
+
+#endif
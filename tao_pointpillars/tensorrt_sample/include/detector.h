@@ -0,0 +1,99 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef DETECTOR_H_
+#define DETECTOR_H_
+
+#include <stdint.h>
+#include <memory>
+#include <random>
+#include <vector>
+#include "postprocess.h"
+#include "context_pool.h"
+
+// Inference stage behind the serving layers: a point cloud in host memory in,
+// raw (pre-NMS) boxes out. Implementations are not thread safe unless noted;
+// callers own one detector per inference thread or share a DetectorPool.
+class Detector {
+  public:
+    virtual ~Detector(void) {}
+    virtual unsigned int pointSize() = 0;
+    virtual unsigned int maxPoints() = 0;
+    // Append the raw boxes of num_points points (pointSize() floats each).
+    virtual int infer(const float *points, unsigned int num_points, std::vector<Bndbox> &boxes) = 0;
+};
+
+// CPU stand-in for the engine, so servers and schedulers can be run and
+// tested without a GPU. Every BEV cell of cell_size meters holding at least
+// min_points points becomes a box around those points, on two grids offset by
+// half a cell so that NMS has overlapping candidates to remove. Each call
+// takes at least latency_ms plus normally distributed jitter of
+// latency_jitter_ms standard deviation (from a fixed seed), which makes it a
+// simulated-latency backend for schedulers. Boxes come out in the order
+// their cells are first seen.
+class StubDetector : public Detector {
+  private:
+    struct Cell {
+        uint64_t key;
+        unsigned int count;
+        float min[3], max[3];
+    };
+    // open-addressing cell table and the slots in use, reused across calls:
+    // it only grows, so steady-state calls do not allocate
+    std::vector<Cell> cells_;
+    std::vector<uint32_t> used_;
+    Cell &cell(uint64_t key);
+    void grow();
+
+    unsigned int point_size_;
+    unsigned int max_points_;
+    float latency_ms_;
+    float latency_jitter_ms_;
+    std::mt19937 rng_;
+    float cell_size_;
+    unsigned int min_points_;
+
+  public:
+    StubDetector(unsigned int point_size = 4, unsigned int max_points = 204800, float latency_ms = 0.0f,
+                 float latency_jitter_ms = 0.0f, float cell_size = 4.0f, unsigned int min_points = 20);
+    unsigned int pointSize() override { return point_size_; }
+    unsigned int maxPoints() override { return max_points_; }
+    int infer(const float *points, unsigned int num_points, std::vector<Bndbox> &boxes) override;
+};
+
+// Thread-safe detector over a pool of per-request detectors, e.g. one stub
+// per context or PointPillarDetectors sharing one engine. Every call checks
+// out a free detector for its duration, so up to size() calls run at once.
+class DetectorPool : public Detector {
+  private:
+    ContextPool<Detector> pool_;
+    unsigned int point_size_;
+    unsigned int max_points_;
+
+  public:
+    // detectors must agree on pointSize() and maxPoints()
+    explicit DetectorPool(std::vector<std::unique_ptr<Detector>> detectors);
+    unsigned int pointSize() override { return point_size_; }
+    unsigned int maxPoints() override { return max_points_; }
+    int infer(const float *points, unsigned int num_points, std::vector<Bndbox> &boxes) override;
+    size_t size() const { return pool_.size(); }
+    unsigned long long acquires() { return pool_.acquires(); }
+    unsigned long long waits() { return pool_.waits(); }
+};
+
+#endif
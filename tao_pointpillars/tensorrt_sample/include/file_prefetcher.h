@@ -0,0 +1,75 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef FILE_PREFETCHER_H_
+#define FILE_PREFETCHER_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Reads a list of files ahead of their use with a fixed number of reads in
+// flight, into a fixed set of page-aligned buffers that are reused for the
+// whole list, and hands the files out in list order.
+//
+// The io_uring backend issues the reads from the consumer thread itself:
+// the buffers are registered with the ring once and read with READ_FIXED,
+// so the kernel does not map them per request. Where io_uring is not
+// available (old kernel, seccomp) a pool of threads doing pread takes over.
+// Files larger than a buffer are cut at the buffer size.
+
+enum class PrefetchBackend { kAuto, kIoUring, kThreads };
+
+PrefetchBackend parse_prefetch_backend(const char *name);
+const char *prefetch_backend_name(PrefetchBackend backend);
+
+struct PrefetchedFile {
+    size_t index = 0;           // position in the file list
+    const uint8_t *data = nullptr;
+    size_t size = 0;            // bytes read
+    int error = 0;              // errno of a failed open or read
+    unsigned int buffer = 0;    // buffer to release
+};
+
+class PrefetchReader;
+
+class FilePrefetcher {
+  private:
+    std::unique_ptr<PrefetchReader> reader_;
+
+  public:
+    // depth buffers of at least buffer_bytes each.
+    FilePrefetcher(const std::vector<std::string> &files, unsigned int depth, size_t buffer_bytes,
+                   PrefetchBackend backend = PrefetchBackend::kAuto);
+    ~FilePrefetcher(void);
+    // kIoUring or kThreads, whichever is in use
+    PrefetchBackend backend() const;
+    // Waits for the next file of the list. Returns false after the last one
+    // or when every buffer is held by the caller. The data stays valid until
+    // the buffer is released.
+    bool next(PrefetchedFile &file);
+    // Returns a buffer; its next read starts right away.
+    void release(unsigned int buffer);
+    // Files issued but not yet handed out.
+    size_t pending() const;
+    unsigned int depth() const;
+};
+
+#endif
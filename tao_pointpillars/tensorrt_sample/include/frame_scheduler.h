@@ -0,0 +1,86 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef FRAME_SCHEDULER_H_
+#define FRAME_SCHEDULER_H_
+
+#include <stdint.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include "latency_histogram.h"
+
+// Hands frames from a sensor thread to the inference thread.
+//   kFifo    every frame is inferred in arrival order, except that with a
+//            deadline, pending frames older than it are dropped whenever a
+//            newer frame is waiting.
+//   kLatest  only the newest pending frame is kept; a new frame supersedes
+//            the one waiting, so latency stays bounded when inference is
+//            slower than the sensor.
+// The newest frame is always inferred, even when it is already stale, so the
+// consumer never starves; its lateness shows up as a deadline miss. Frames
+// are identified by a sequence number and a capture time on the steady clock;
+// the points themselves stay with the caller.
+enum class SchedulePolicy { kFifo, kLatest };
+
+struct ScheduledFrame {
+    uint64_t seq = 0;
+    int64_t capture_ns = 0;     // std::chrono::steady_clock
+};
+
+class FrameScheduler {
+  private:
+    SchedulePolicy policy_;
+    float deadline_ms_;
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<ScheduledFrame> pending_;
+    bool closed_ = false;
+
+    uint64_t pushed_ = 0;
+    uint64_t inferred_ = 0;
+    uint64_t superseded_ = 0;   // replaced by a newer frame (kLatest)
+    uint64_t expired_ = 0;      // older than the deadline while a newer one waited
+    uint64_t misses_ = 0;       // finished after capture + deadline
+    LatencyHistogram age_;      // capture to inference start
+    LatencyHistogram latency_;  // capture to completion
+
+  public:
+    // deadline_ms <= 0 disables dropping by age and miss counting.
+    FrameScheduler(SchedulePolicy policy, float deadline_ms);
+    // Sensor side; never blocks.
+    void push(const ScheduledFrame &frame);
+    // No more frames: pop() returns false once the queue is drained.
+    void close();
+    // Next frame to infer. Waits up to timeout_ms (negative: forever).
+    bool pop(ScheduledFrame *frame, int timeout_ms = -1);
+    // Inference of frame finished (or its result was discarded: counted = false).
+    void complete(const ScheduledFrame &frame, bool counted = true);
+
+    uint64_t pushed() const;
+    uint64_t inferred() const;
+    uint64_t dropped() const;
+    uint64_t misses() const;
+    void printStats() const;
+};
+
+int64_t steady_now_ns();
+// "fifo" or "latest"
+SchedulePolicy parse_schedule_policy(const char *name);
+
+#endif
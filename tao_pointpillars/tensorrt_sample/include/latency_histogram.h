@@ -0,0 +1,47 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LATENCY_HISTOGRAM_H_
+#define LATENCY_HISTOGRAM_H_
+
+#include <stdint.h>
+#include <vector>
+
+// Fixed-bin histogram of durations in milliseconds, cheap enough to update
+// per frame and exact to one bin for percentiles. Values past max_ms land in
+// the last bin; max() still reports them exactly.
+class LatencyHistogram {
+  private:
+    float bin_ms_;
+    std::vector<uint32_t> bins_;
+    uint64_t count_ = 0;
+    double sum_ = 0.0;
+    float max_ = 0.0f;
+
+  public:
+    explicit LatencyHistogram(float max_ms = 2000.0f, float bin_ms = 0.1f);
+    void add(float ms);
+    void clear();
+    uint64_t count() const { return count_; }
+    float mean() const { return count_ ? sum_ / count_ : 0.0f; }
+    float max() const { return max_; }
+    // Upper edge of the bin holding the p-th percentile, p in [0, 100].
+    float percentile(double p) const;
+};
+
+#endif
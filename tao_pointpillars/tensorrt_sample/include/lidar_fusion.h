@@ -0,0 +1,112 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIDAR_FUSION_H_
+#define LIDAR_FUSION_H_
+
+#include <stdint.h>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "point_io.h"
+
+struct LidarSensor {
+    std::string name;
+    float extrinsic[16];    // vehicle-from-sensor, see point_transform.h
+};
+
+struct FusionConfig {
+    // drop points inside the vehicle body, in the vehicle frame:
+    // x_min, y_min, z_min, x_max, y_max, z_max
+    bool exclude_body = false;
+    float body_box[6] = {-1.0f, -1.0f, -2.0f, 4.0f, 1.0f, 0.5f};
+};
+
+// Merges the sweeps of several LiDARs taken at one timestamp into a single
+// cloud in the vehicle frame, written straight into the caller's buffer
+// (e.g. the managed inference buffer). Sweeps hold x, y, z, intensity per
+// point in any format PointLoader reads. Every sensor has its own worker
+// thread: it reads its sweep into its slice of the buffer, transforms it in
+// place with the SIMD transform_points, and compacts out the body points.
+// Slices left with gaps by the body filter are moved together at the end;
+// there are no other copies. Channels after the 4th (e.g. time lag) are
+// written as 0.
+class LidarFusion {
+  private:
+    enum class Phase { kCount, kLoad };
+
+    struct SensorJob {
+        std::string path;
+        PointLoader loader;
+        int status = 0;
+        unsigned int count = 0;     // points in the sweep
+        unsigned int offset = 0;    // first point of the slice in dst
+        unsigned int capacity = 0;  // points the slice takes
+        unsigned int loaded = 0;
+        unsigned int kept = 0;      // after the body filter
+    };
+
+    std::vector<LidarSensor> sensors_;
+    FusionConfig config_;
+    std::vector<SensorJob> jobs_;
+    std::vector<std::thread> workers_;
+
+    std::mutex mutex_;
+    std::condition_variable work_cv_, done_cv_;
+    uint64_t generation_ = 0;
+    unsigned int pending_ = 0;
+    bool stop_ = false;
+    Phase phase_ = Phase::kCount;
+    float *dst_ = nullptr;
+    unsigned int point_size_ = 4;
+
+    unsigned int dropped_ = 0;
+    unsigned int excluded_ = 0;
+
+    void worker(size_t sensor);
+    void runPhase(Phase phase);
+    void loadSweep(SensorJob &job, const LidarSensor &sensor);
+
+  public:
+    LidarFusion(const std::vector<LidarSensor> &sensors, const FusionConfig &config);
+    ~LidarFusion();
+
+    // paths[i] is the sweep of sensor i; an empty path skips the sensor.
+    // Writes up to max_points points of point_size (>= 4) floats to dst.
+    // Returns the number of sensors whose sweep could not be read; the
+    // others are fused regardless.
+    int fuse(const std::vector<std::string> &paths, float *dst, unsigned int max_points,
+             unsigned int point_size, unsigned int *num_points);
+
+    size_t numSensors() const { return sensors_.size(); }
+    const LidarSensor &sensor(size_t i) const { return sensors_[i]; }
+    // of the last fuse(): points of sensor i in the fused cloud
+    unsigned int sensorPoints(size_t i) const { return jobs_[i].kept; }
+    // points cut because the buffer was full
+    unsigned int droppedPoints() const { return dropped_; }
+    // points inside the body box
+    unsigned int excludedPoints() const { return excluded_; }
+};
+
+// Rig file: one sensor per line, in the order of the sweep paths:
+//   <name> <3x4 vehicle-from-sensor extrinsic, row-major>
+int load_lidar_rig(const std::string &rig_file, std::vector<LidarSensor> &sensors);
+
+#endif
@@ -0,0 +1,88 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef NMS_BUDGET_H_
+#define NMS_BUDGET_H_
+
+#include <stddef.h>
+#include <vector>
+#include "postprocess.h"
+
+struct TopNControllerConfig {
+    // bounds of the effective pre-NMS top-N
+    int min_top_n = 256;
+    int max_top_n = 4096;
+    // per-frame postprocess (sort + NMS) budget
+    float budget_ms = 2.0f;
+    // top-N is sized for this fraction of the budget, leaving room for noise
+    float target_fraction = 0.8f;
+    // at most this factor of growth per frame; over-budget frames shrink at once
+    float max_growth = 1.25f;
+    // weight of the newest frame in the cost estimate
+    float smoothing = 0.3f;
+};
+
+struct TopNControllerStats {
+    unsigned long long frames = 0;
+    unsigned long long over_budget = 0;     // frames whose NMS took longer than the budget
+    unsigned long long increases = 0;
+    unsigned long long decreases = 0;
+    unsigned long long truncated_frames = 0;
+    // candidates within max_top_n that the reduced top-N left out
+    unsigned long long truncated_candidates = 0;
+    double last_ms = 0.0;
+    double max_ms = 0.0;
+};
+
+// Picks the pre-NMS top-N of each frame so that NMS stays under a time
+// budget. The cost of a frame is modelled as k * n^2 for n candidates
+// looked at; k is estimated from the measured frames (an over-budget frame
+// raises it at once, cheaper frames lower it gradually), and the next top-N
+// is the n whose predicted cost fits the budget, within the configured
+// bounds. Not thread-safe; use one controller per stream of frames.
+class TopNController {
+  private:
+    TopNControllerConfig config_;
+    TopNControllerStats stats_;
+    int top_n_;
+    int previous_top_n_;
+    double cost_ = 0.0;     // k, ms per candidate^2
+    size_t last_truncated_ = 0;
+    std::vector<int> suppressed_;
+
+  public:
+    explicit TopNController(const TopNControllerConfig &config);
+
+    // effective top-N for the next frame
+    int topN() const { return top_n_; }
+    // Records the NMS time of a frame that had num_candidates raw boxes and
+    // ran with topN(), then picks the top-N of the next frame.
+    void update(double nms_ms, size_t num_candidates);
+    // nms_cpu_inplace at topN(), timed, followed by update().
+    int nms(std::vector<Bndbox> &boxes, float nms_thresh, std::vector<Bndbox> &nms_pred);
+
+    // top-N of the frame before the last update(); differs from topN() when
+    // that update adjusted it
+    int previousTopN() const { return previous_top_n_; }
+    // candidates the last frame lost to the reduced top-N
+    size_t lastTruncated() const { return last_truncated_; }
+    const TopNControllerStats &stats() const { return stats_; }
+    const TopNControllerConfig &config() const { return config_; }
+};
+
+#endif
@@ -0,0 +1,62 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef NMS_SWEEP_H_
+#define NMS_SWEEP_H_
+
+#include <stddef.h>
+#include <vector>
+#include "postprocess.h"
+
+// NMS of one frame at many settings. prepare() sorts the raw boxes by score
+// as nms_cpu does, keeping equal scores in input order, and computes the rotated IoU of every overlapping pair among
+// the first max_top_n, once; run() is then greedy suppression over that
+// pair list, linear in the boxes and pairs. Pairs are found with an x-sorted
+// sweep over the boxes' circumcircles, so boxes that cannot overlap are never
+// compared.
+//
+// A score cutoff and top_n both select a prefix of the sorted boxes, so
+// run(t, n, s) keeps what nms_cpu keeps for the boxes with score >= s,
+// pre_nms_top_n = n and threshold t. nms_cpu may order equal scores
+// differently, so where they overlap the two can keep different boxes.
+class NmsSweepFrame {
+  private:
+    std::vector<Bndbox> sorted_;
+    // pairs (i, j > i) with IoU > 0, grouped by i in CSR form, j ascending
+    std::vector<size_t> pair_begin_;
+    std::vector<int> pair_j_;
+    std::vector<float> pair_iou_;
+    std::vector<int> order_;
+    std::vector<float> radius_;
+    std::vector<char> suppressed_;
+    struct Pair {
+        int i, j;
+        float iou;
+    };
+    std::vector<Pair> pairs_;
+
+  public:
+    void prepare(const std::vector<Bndbox> &boxes, int max_top_n);
+    // Appends the kept boxes to kept in score order; returns how many.
+    int run(float nms_thresh, int top_n, float score_cutoff, std::vector<Bndbox> &kept);
+
+    size_t numBoxes() const { return sorted_.size(); }
+    size_t numPairs() const { return pair_j_.size(); }
+};
+
+#endif
@@ -0,0 +1,96 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef POINT_CODEC_H_
+#define POINT_CODEC_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+// Point cloud codec for archival and replay (.ppc files).
+//
+// Every channel (x, y, z, intensity) is either quantized with a fixed step
+// (bounded error of step / 2) or, with a step of 0, kept losslessly as its
+// float bit pattern. Points are split into rings at azimuth wrap-arounds and
+// delta coded against the previous point of the same ring; the first point of
+// a ring is predicted from the first point of the ring above. Zigzagged
+// residuals below 255 are coded as one byte token, larger ones escape to
+// byte planes; every plane is entropy coded with a static order-0 rANS coder
+// (four interleaved states).
+//
+// A .ppc file is a 16-byte file header followed by self-contained frames, so
+// an archive can be appended to and decoded as a stream.
+
+struct PointCodecOptions {
+    // quantization step of x, y, z, intensity; 0 keeps the channel lossless
+    float step[4] = {0.001f, 0.001f, 0.001f, 0.0f};
+};
+
+// Encode num_points points (x, y, z, intensity first, point_size floats each)
+// as one frame appended to out. Returns the number of bytes appended.
+size_t encode_frame(const float *points, unsigned int num_points, unsigned int point_size,
+                    const PointCodecOptions &options, std::vector<uint8_t> &out);
+
+// Decode one frame from data (size bytes). Writes up to max_points points of
+// point_size floats to dst (extra channels zeroed) and returns the size of the
+// frame in bytes, or 0 when the frame is malformed. Only the points written
+// are decoded, so memory use is bounded by max_points, whatever the header says.
+size_t decode_frame(const uint8_t *data, size_t size, float *dst, unsigned int max_points,
+                    unsigned int point_size, unsigned int *num_points);
+
+// Number of points of the frame at data, 0 when malformed.
+unsigned int frame_points(const uint8_t *data, size_t size);
+
+// Append-only writer of a .ppc archive.
+class PointCodecWriter {
+  private:
+    FILE *file_ = nullptr;
+    PointCodecOptions options_;
+    std::vector<uint8_t> buffer_;
+
+  public:
+    PointCodecWriter(const std::string &path, const PointCodecOptions &options);
+    ~PointCodecWriter(void);
+    bool isOpen() const { return file_ != nullptr; }
+    // Returns the compressed size of the frame, 0 on error.
+    size_t write(const float *points, unsigned int num_points, unsigned int point_size);
+};
+
+// Streaming reader of a .ppc archive: frames are read and decoded one at a
+// time into caller-owned memory, with a single reusable read buffer.
+class PointCodecReader {
+  private:
+    FILE *file_ = nullptr;
+    std::vector<uint8_t> buffer_;
+    bool peeked_ = false;
+    unsigned int frame_bytes_ = 0;
+    int readFrame();
+
+  public:
+    explicit PointCodecReader(const std::string &path);
+    ~PointCodecReader(void);
+    bool isOpen() const { return file_ != nullptr; }
+    // Points in the next frame, without consuming it. Returns -1 at the end.
+    int peekPoints(unsigned int *num_points);
+    // Decode the next frame. Returns -1 at the end of the archive or on error.
+    int next(float *dst, unsigned int max_points, unsigned int point_size, unsigned int *num_points);
+};
+
+#endif
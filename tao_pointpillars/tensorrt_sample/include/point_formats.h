@@ -0,0 +1,83 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef POINT_FORMATS_H_
+#define POINT_FORMATS_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+// Streaming readers for point cloud files written by other tools:
+//   .pcd  PCL point cloud, DATA binary
+//   .ply  binary_little_endian, points in the "vertex" element
+//   .las  ASPRS LAS 1.0 - 1.4, uncompressed, point formats 0 - 10
+// The header is parsed once at open time and the x, y, z and intensity fields
+// are resolved to a copy routine specialized for their types, which converts
+// chunks of records straight into the model's point layout. Intensity is kept
+// as is for float fields and normalized to [0, 1] for integer fields; LAS
+// coordinates have the file's scale and offset applied.
+
+enum class FieldType { kNone, kInt8, kUint8, kInt16, kUint16, kInt32, kUint32, kFloat32, kFloat64 };
+
+// Location of x, y, z, intensity inside one source record;
+// value = raw * scale + bias.
+struct FieldLayout {
+    unsigned int stride = 0;
+    FieldType type[4] = {FieldType::kNone, FieldType::kNone, FieldType::kNone, FieldType::kNone};
+    unsigned int offset[4] = {0, 0, 0, 0};
+    double scale[4] = {1, 1, 1, 1};
+    double bias[4] = {0, 0, 0, 0};
+};
+
+typedef void (*PointCopyFn)(const uint8_t *src, unsigned int num_points, const FieldLayout &layout,
+                            float *dst, unsigned int point_size);
+
+// Pick the copy routine for a layout; falls back to a per-field converter for
+// mixed type combinations.
+PointCopyFn select_point_copy(const FieldLayout &layout);
+
+class PointFileReader {
+  private:
+    FILE *file_ = nullptr;
+    FieldLayout layout_;
+    PointCopyFn copy_ = nullptr;
+    bool raw_xyzi_ = false;     // records are float32 x, y, z, intensity already
+    unsigned int num_points_ = 0;
+    unsigned int remaining_ = 0;
+    std::vector<uint8_t> chunk_;
+
+    int openPcd(const std::string &path);
+    int openPly(const std::string &path);
+    int openLas(const std::string &path);
+
+  public:
+    explicit PointFileReader(const std::string &path);
+    ~PointFileReader(void);
+    bool isOpen() const { return file_ != nullptr; }
+    // Points stored in the file.
+    unsigned int numPoints() const { return num_points_; }
+    // Read the next points, up to max_points; num_points is 0 at the end.
+    int read(float *dst, unsigned int max_points, unsigned int point_size, unsigned int *num_points);
+};
+
+// True for the extensions handled by PointFileReader.
+bool is_point_file(const std::string &path);
+
+#endif
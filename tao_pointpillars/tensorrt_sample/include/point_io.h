@@ -0,0 +1,48 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef POINT_IO_H_
+#define POINT_IO_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Loads point cloud files straight into a caller-owned buffer in the model's
+// point layout (point_size floats per point, x, y, z, intensity first).
+// Supported files, chosen by extension:
+//   .bin  raw float32 with point_size values per point (KITTI layout)
+//   .ppq  quantized int16 xyz + uint8 intensity, see point_quant.h
+//   .ppc  point codec archive, first frame only, see point_codec.h
+//   .pcd, .ply, .las  converted on the fly, see point_formats.h
+// Scratch memory is kept between calls, so reuse one loader per thread.
+class PointLoader {
+  private:
+    std::vector<uint8_t> scratch_;
+
+  public:
+    // Number of points stored in the file.
+    int count(const std::string &path, unsigned int point_size, unsigned int *num_points);
+    // Load up to max_points points into dst; the rest of the file is ignored.
+    int load(const std::string &path, float *dst, unsigned int max_points,
+             unsigned int point_size, unsigned int *num_points);
+};
+
+bool has_extension(const std::string &path, const char *ext);
+
+#endif
@@ -0,0 +1,65 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef POINT_ORDER_H_
+#define POINT_ORDER_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+enum class MortonMode {
+    kNone,
+    k2D,    // x, y with 16 bits each
+    k3D,    // x, y with 11 bits, z with 10 bits
+};
+
+// Reorders points along a Morton (Z-order) curve over a BEV/voxel grid, so
+// that points close in space are close in memory. Keys are sorted with an LSD
+// radix sort whose histogram and scatter phases run on num_threads threads;
+// byte positions on which all keys agree are skipped.
+// Scratch buffers grow to the largest cloud seen and are reused.
+class MortonSorter {
+  private:
+    MortonMode mode_;
+    float range_[6];
+    bool auto_range_;
+    float cell_size_;
+    int num_threads_;
+    std::vector<uint32_t> keys_, keys_tmp_;
+    std::vector<uint32_t> index_, index_tmp_;
+    std::vector<float> scratch_;
+
+    void computeKeys(const float *points, unsigned int num_points, unsigned int point_size);
+    void radixSort(unsigned int num_points);
+
+  public:
+    // range: x_min, y_min, z_min, x_max, y_max, z_max; points outside are clamped
+    // to the border cells. With a null range the grid starts at the minimum corner
+    // of every cloud. num_threads <= 0 uses the hardware concurrency.
+    MortonSorter(MortonMode mode, const float *range, float cell_size, int num_threads = 0);
+
+    // Writes the reordered points to dst; src and dst may be the same buffer.
+    void sort(const float *src, float *dst, unsigned int num_points, unsigned int point_size);
+    // Permutation of the last sort(): dst point i was src point order()[i].
+    const std::vector<uint32_t> &order() const { return index_; }
+};
+
+MortonMode parse_morton_mode(const std::string &name);
+
+#endif
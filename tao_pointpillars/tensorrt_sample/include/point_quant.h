@@ -0,0 +1,59 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef POINT_QUANT_H_
+#define POINT_QUANT_H_
+
+#include <stdint.h>
+#include <vector>
+
+// Compact point cloud file (.ppq), 7 bytes per point instead of 16:
+//   PointQuantHeader
+//   int16_t x[num_points], y[num_points], z[num_points]
+//   uint8_t intensity[num_points]
+// with value = offset + scale * quantized for every channel.
+struct PointQuantHeader {
+    char magic[4];            // "PPQ1"
+    uint32_t num_points;
+    float scale[4];           // x, y, z, intensity
+    float offset[4];
+    uint32_t reserved[6];
+};
+
+static_assert(sizeof(PointQuantHeader) == 64, "PointQuantHeader must stay 64 bytes");
+
+// Size in bytes of a .ppq file with num_points points.
+size_t quantized_size(unsigned int num_points);
+
+// Quantize points (x, y, z, intensity first, point_size floats per point) with
+// per-frame scale and offset into the .ppq layout. The worst-case error per
+// channel is scale / 2 and is reported in max_error when not null.
+void quantize_points(
+  const float *points, unsigned int num_points, unsigned int point_size,
+  std::vector<uint8_t> &out, float *max_error = nullptr
+);
+
+// Check the header of a .ppq image of `size` bytes. Returns 0 when valid.
+int check_quantized(const uint8_t *data, size_t size);
+
+// Dequantize the first max_points points of a .ppq image into float points of
+// point_size channels (x, y, z, intensity, the rest zeroed).
+// Returns the number of points written.
+unsigned int dequantize_points(const uint8_t *data, float *dst, unsigned int max_points, unsigned int point_size);
+
+#endif
@@ -0,0 +1,104 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef POINT_RING_H_
+#define POINT_RING_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+// Ring of fixed-size point cloud slots in POSIX shared memory, written by a
+// sensor driver process and read in place by the inference process.
+//
+// One producer, any number of readers, no locks. Frame k (k >= 1) goes to
+// slot (k - 1) % num_slots. Each slot carries a sequence word that is 2k - 1
+// while frame k is being written and 2k once it is published, and the ring
+// header holds the sequence number of the newest published frame. A reader
+// takes the newest frame, uses its points in place and then checks that the
+// slot sequence did not move; if the producer lapped the ring in the
+// meantime the frame is reported as overwritten and its results must be
+// discarded. The producer never waits for readers.
+//
+// Slots are page aligned, so the whole mapping can be registered with CUDA
+// and each slot bound directly as the engine's point input.
+
+struct PointRingHeader;
+struct PointRingSlot;
+
+struct PointRingFrame {
+    uint64_t seq = 0;           // frame sequence number, 0 when none
+    const float *points = nullptr;
+    unsigned int num_points = 0;
+    uint64_t timestamp_ns = 0;
+    const PointRingSlot *slot = nullptr;
+};
+
+class PointRingWriter {
+  private:
+    std::string name_;
+    PointRingHeader *header_ = nullptr;
+    size_t bytes_ = 0;
+    uint64_t writing_ = 0;
+
+  public:
+    // Create (or replace) the ring /name with num_slots slots of max_points
+    // points of point_size floats.
+    PointRingWriter(const std::string &name, unsigned int num_slots, unsigned int max_points,
+                    unsigned int point_size);
+    // Marks the ring closed and removes its name; mapped readers keep working.
+    ~PointRingWriter(void);
+    bool isOpen() const { return header_ != nullptr; }
+    unsigned int maxPoints() const;
+    unsigned int pointSize() const;
+    // Slot for the next frame, to be filled in place (max_points points).
+    float *beginWrite();
+    // Publish the frame started by beginWrite. Returns its sequence number.
+    uint64_t commit(unsigned int num_points, uint64_t timestamp_ns);
+};
+
+class PointRingReader {
+  private:
+    PointRingHeader *header_ = nullptr;
+    size_t bytes_ = 0;
+
+  public:
+    explicit PointRingReader(const std::string &name);
+    ~PointRingReader(void);
+    bool isOpen() const { return header_ != nullptr; }
+    unsigned int numSlots() const;
+    unsigned int maxPoints() const;
+    unsigned int pointSize() const;
+    // Mapping of the whole ring, for cudaHostRegister.
+    void *base() const { return header_; }
+    size_t mappedBytes() const { return bytes_; }
+    // True once the producer has shut down and no newer frame than seq exists.
+    bool closed(uint64_t seq) const;
+    // Newest published frame with a sequence number above after_seq. Waits up
+    // to timeout_ms (negative: forever). Returns -1 on timeout or when the
+    // producer closed the ring.
+    int acquire(uint64_t after_seq, int timeout_ms, PointRingFrame *frame);
+    // Frame seq if its slot still holds it, the newest frame for seq 0.
+    // Does not wait; returns -1 when the frame is not (or no longer) there.
+    int frame(uint64_t seq, PointRingFrame *frame);
+    // Call when done with the frame's points: false if the producer
+    // overwrote the slot while it was in use.
+    bool release(const PointRingFrame &frame) const;
+};
+
+#endif
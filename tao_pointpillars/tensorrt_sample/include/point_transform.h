@@ -0,0 +1,49 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef POINT_TRANSFORM_H_
+#define POINT_TRANSFORM_H_
+
+// 4x4 homogeneous transforms are stored row-major as float[16]:
+//   | r00 r01 r02 tx |
+//   | r10 r11 r12 ty |
+//   | r20 r21 r22 tz |
+//   |  0   0   0   1 |
+
+void pose_identity(float *out);
+// out = a * b
+void pose_multiply(const float *a, const float *b, float *out);
+// inverse of a rigid transform (rotation + translation)
+void pose_inverse_rigid(const float *pose, float *out);
+
+// Apply T to the (x, y, z) of every point and copy the intensity through.
+// Both layouts need at least 4 channels (x, y, z, intensity); channels after
+// the 4th are left untouched in dst. Points are processed in order, and each
+// point is read in full before it is written. So src and dst may overlap when
+// writing a point never reaches the points after it in src:
+//   dst + i * dst_stride + 4 <= src + (i + 1) * src_stride   for every i,
+// e.g. aliasing with equal strides, or widening in place from packed points
+// at the end of a buffer (LidarFusion). Every implementation must keep that.
+void transform_points(
+  const float *src, unsigned int src_stride,
+  float *dst, unsigned int dst_stride,
+  unsigned int num_points,
+  const float *T
+);
+
+#endif
@@ -0,0 +1,172 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef POINT_TYPES_H_
+#define POINT_TYPES_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <string>
+
+// Point layouts fixed at compile time. The kernels below are templates on
+// the point type, instantiated once per format in point_types.cpp;
+// point_kernels() picks the instantiation for a format at startup and hands
+// it out as a table of functions. The fp32 formats load through PointLoader
+// and transform with the SIMD transform_points() of point_transform.h. The
+// Half formats are converted in cache-sized blocks, with F16C on x86 CPUs
+// that have it (checked once) and NEON on aarch64.
+//
+// Channels are x, y, z, intensity and, for the T formats, the time lag of
+// the multi-sweep models. The Half formats store every channel as IEEE
+// binary16, which halves the memory of a cloud.
+
+struct PointXYZI {
+    float x, y, z, intensity;
+};
+
+struct PointXYZIT {
+    float x, y, z, intensity, t;
+};
+
+struct PointXYZIHalf {
+    uint16_t x, y, z, intensity;
+};
+
+struct PointXYZITHalf {
+    uint16_t x, y, z, intensity, t;
+};
+
+// IEEE binary16 conversions, round to nearest even. These are the scalar
+// reference; the kernels convert whole blocks with the CPU's instructions.
+inline uint16_t float_to_half(float f)
+{
+    uint32_t x;
+    memcpy(&x, &f, sizeof(x));
+    uint32_t sign = (x >> 16) & 0x8000;
+    uint32_t abs = x & 0x7fffffff;
+    // subnormal halves: adding 0.5 lets the FPU round the mantissa into place
+    float a;
+    memcpy(&a, &abs, sizeof(a));
+    a += 0.5f;
+    uint32_t sub;
+    memcpy(&sub, &a, sizeof(sub));
+    sub -= 0x3f000000;
+    // normal halves: rebias the exponent and round the dropped 13 bits to even
+    uint32_t norm = (abs + 0xc8000fff + ((abs >> 13) & 1)) >> 13;
+    // too large for a half, infinity or NaN
+    uint32_t big = abs > 0x7f800000 ? 0x7e00 : 0x7c00;
+    uint32_t h = abs >= 0x47800000 ? big : abs < 0x38800000 ? sub : norm;
+    return sign | h;
+}
+
+inline float half_to_float(uint16_t h)
+{
+    uint32_t bits = (uint32_t)(h & 0x7fff) << 13;
+    uint32_t exp = bits & 0x0f800000;
+    bits += 0x38000000;
+    // infinity and NaN keep an all-ones exponent
+    bits += exp == 0x0f800000 ? 0x38000000 : 0;
+    float f;
+    memcpy(&f, &bits, sizeof(f));
+    // subnormal halves: renormalize through the FPU
+    float sub;
+    uint32_t sub_bits = bits + 0x00800000;
+    memcpy(&sub, &sub_bits, sizeof(sub));
+    sub -= 6.103515625e-05f;
+    f = exp == 0 ? sub : f;
+    uint32_t out;
+    memcpy(&out, &f, sizeof(out));
+    out |= (uint32_t)(h & 0x8000) << 16;
+    memcpy(&f, &out, sizeof(f));
+    return f;
+}
+
+// Channel type and count of a layout. Every layout is kChannels packed
+// values of Channel, so a run of points is a run of channels.
+template <typename P>
+struct PointTraits;
+
+template <>
+struct PointTraits<PointXYZI> {
+    typedef float Channel;
+    static const unsigned int kChannels = 4;
+};
+
+template <>
+struct PointTraits<PointXYZIT> {
+    typedef float Channel;
+    static const unsigned int kChannels = 5;
+};
+
+template <>
+struct PointTraits<PointXYZIHalf> {
+    typedef uint16_t Channel;
+    static const unsigned int kChannels = 4;
+};
+
+template <>
+struct PointTraits<PointXYZITHalf> {
+    typedef uint16_t Channel;
+    static const unsigned int kChannels = 5;
+};
+
+// Up to max_points points of a raw float32 file with file_channels values
+// per point (a KITTI .bin has 4). Missing channels are 0, extra ones are
+// dropped. Returns the number of points, -1 when the file can't be read.
+template <typename P>
+int load_points(const std::string &path, unsigned int file_channels, P *dst, unsigned int max_points);
+
+// Points inside range = {x_min, y_min, z_min, x_max, y_max, z_max}
+// (min <= v < max), compacted into dst in order. dst may be src.
+template <typename P>
+unsigned int crop_points(const P *src, unsigned int num_points, const float *range, P *dst);
+
+// Rigid transform T (row-major 4x4) of x, y, z; other channels are copied.
+// dst may be src.
+template <typename P>
+void transform_points(const P *src, unsigned int num_points, const float *T, P *dst);
+
+// Float points of dst_channels values each, e.g. the inference buffer.
+// Channels the format lacks are 0.
+template <typename P>
+void expand_points(const P *src, unsigned int num_points, float *dst, unsigned int dst_channels);
+
+enum class PointFormat { kXYZI, kXYZIT, kXYZIHalf, kXYZITHalf };
+
+// "xyzi", "xyzit", "xyzi16" or "xyzit16"; returns false for other names.
+bool parse_point_format(const char *name, PointFormat *format);
+const char *point_format_name(PointFormat format);
+// fp32 format with the given channel count (4 or 5)
+PointFormat point_format_for_channels(unsigned int channels);
+
+// The kernels of one format behind untyped pointers. Resolve the table
+// once; every call then runs the fixed-layout instantiation.
+struct PointKernels {
+    PointFormat format;
+    unsigned int point_bytes;
+    unsigned int channels;
+    int (*load)(const std::string &path, unsigned int file_channels, void *dst, unsigned int max_points);
+    unsigned int (*crop)(const void *src, unsigned int num_points, const float *range, void *dst);
+    void (*transform)(const void *src, unsigned int num_points, const float *T, void *dst);
+    void (*expand)(const void *src, unsigned int num_points, float *dst, unsigned int dst_channels);
+};
+
+const PointKernels &point_kernels(PointFormat format);
+
+#endif
@@ -19,14 +19,21 @@
 #define POINTPILLAR_H_
 
 #include <memory>
+#include <string>
+#include <vector>
 #include "cuda_runtime.h"
 #include "NvInfer.h"
 #include "NvOnnxConfig.h"
 #include "NvOnnxParser.h"
 #include "NvInferRuntime.h"
 #include "postprocess.h"
+#include "box_decoder.h"
+#include "context_pool.h"
 
+// per-stage timings on stdout; the library builds with it set to 0
+#ifndef PERFORMANCE_LOG
 #define PERFORMANCE_LOG 1
+#endif
 
 // Logger for TensorRT
 class Logger : public nvinfer1::ILogger {
@@ -40,59 +47,138 @@ class Logger : public nvinfer1::ILogger {
     }
 };
 
+// The engine, shared by all contexts and immutable once loaded. Execution
+// contexts are created from it, one per concurrent request.
 class TRT {
   private:
-    cudaEvent_t start, stop;
-
-    float elapsedTime = 0.0f;
     Logger gLogger_;
-    nvinfer1::IExecutionContext *context = nullptr;
     nvinfer1::ICudaEngine *engine = nullptr;
 
-    cudaStream_t stream_;
   public:
     TRT(
       std::string modelFile,
       std::string engineFile,
-      cudaStream_t stream,
       const std::string& data_type
     );
     ~TRT(void);
+    // false when neither the cache nor the model gave an engine
+    bool isLoaded() const { return engine != nullptr; }
 
-    int doinfer(void**buffers, bool do_profile);
+    nvinfer1::IExecutionContext *createContext();
+    // Enqueue one inference of context on stream; input_consumed is signalled
+    // once the input buffers may be reused.
+    int doinfer(nvinfer1::IExecutionContext *context, void**buffers, cudaStream_t stream,
+                cudaEvent_t input_consumed, bool do_profile);
     nvinfer1::Dims get_binding_shape(int index);
+    int getNbBindings();
+    // index of the named binding, -1 when the engine has none of that name
+    int getBindingIndex(const char *name);
     int getPointSize();
+    int getMaxPoints();
 };
 
-class PointPillar {
-  private:
-    cudaEvent_t start, stop;
-    float elapsedTime = 0.0f;
-    cudaStream_t stream_;
-    //output of TRT
-    std::shared_ptr<TRT> trt_;
-    //output of TRT
+// Everything one inference call writes: execution context, stream, events,
+// device input and output buffers, host copies of the outputs and the raw box
+// scratch vector.
+struct PointPillarContext {
+    nvinfer1::IExecutionContext *context = nullptr;
+    cudaStream_t stream = NULL;
+    bool own_stream = false;
+    cudaEvent_t start, stop, input_consumed;
+    float *points_dev = nullptr;
+    unsigned int *points_num_dev = nullptr;
     float *box_output = nullptr;
     int *box_num = nullptr;
-    unsigned int box_size;
+    float *box_output_host = nullptr;
+    int *box_num_host = nullptr;
+    // raw cls, box and dir heads, device and host, for engines without the
+    // decode plugin
+    float *heads[3] = {nullptr, nullptr, nullptr};
+    float *heads_host[3] = {nullptr, nullptr, nullptr};
+    BoxDecoderScratch decode_scratch;
     std::vector<Bndbox> res;
+};
+
+// PointPillar is safe to call from several threads: the engine is shared and
+// every call checks out one of num_contexts contexts for its duration (calls
+// wait while all are busy). The first context runs on the stream passed to
+// the constructor, the others on streams of their own.
+class PointPillar {
+  private:
+    std::shared_ptr<TRT> trt_;
+    ContextPool<PointPillarContext> contexts_;
+    unsigned int point_size_ = 0;
+    unsigned int max_points_ = 0;
+    unsigned int max_boxes_ = 0;
+    bool loaded_ = false;
+    unsigned int num_contexts_ = 1;
+    // set for engines that output the raw heads instead of decoded boxes
+    std::unique_ptr<BoxDecoder> decoder_;
+    int head_bindings_[3];
+    size_t head_sizes_[3];
+
+    int infer(
+      PointPillarContext &ctx,
+      void*points_data,
+      unsigned int* points_size,
+      std::vector<Bndbox> &boxes,
+      bool do_profile,
+      int top_k = 0
+    );
 
   public:
     PointPillar(
       std::string modelFile,
       std::string engineFile,
       cudaStream_t stream,
-      const std::string& data_type
+      const std::string& data_type,
+      unsigned int num_contexts = 1
     );
     ~PointPillar(void);
+    // false when the engine, its decoder or a context failed to load; the
+    // reason was printed and the object must not be used for inference
+    bool isLoaded() const { return loaded_; }
     int getPointSize();
+    int getMaxPoints();
+    // capacity of the engine's box output, the most raw boxes one call returns
+    unsigned int getMaxBoxes() const { return max_boxes_; }
+    // true when the engine outputs raw cls, box and dir heads, which are
+    // decoded on the CPU by a BoxDecoder
+    bool rawHeads() const { return decoder_ != nullptr; }
+    // Anchor setup of the CPU decoder; the feature map size is taken from the
+    // engine. Call before the first inference. Returns -1 when the heads of
+    // the engine don't have the channels this setup needs. With num_threads
+    // <= 0 each context decodes on its share of the hardware threads.
+    int setDecoderConfig(const BoxDecoderConfig &config);
+    unsigned int numContexts() const { return contexts_.size(); }
+    // context checkouts, and how many had to wait for a free context
+    unsigned long long contextAcquires() { return contexts_.acquires(); }
+    unsigned long long contextWaits() { return contexts_.waits(); }
+    // Raw engine boxes before NMS, appended to boxes. points_data and
+    // points_size must be device accessible; as they may have been written on
+    // any stream, the device is synchronized first. Threads sharing one
+    // PointPillar should prefer inferHost(), which only waits on its context.
+    int infer(
+      void*points_data,
+      unsigned int* points_size,
+      std::vector<Bndbox> &boxes,
+      bool do_profile
+    );
+    // Same, for points in host memory: they are copied into the checked out
+    // context's device input buffer. num_points is clipped to getMaxPoints().
+    int inferHost(
+      const float *points,
+      unsigned int num_points,
+      std::vector<Bndbox> &boxes,
+      bool do_profile
+    );
     int doinfer(
       void*points_data,
       unsigned int* points_size,
       std::vector<Bndbox> &nms_pred,
       float nms_iou_thresh,
       int pre_nms_top_n,
-      std::vector<std::string>& class_names,
+      const std::vector<std::string>& class_names,
       bool do_profile
     );
 };
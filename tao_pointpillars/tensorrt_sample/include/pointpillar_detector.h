@@ -0,0 +1,50 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef POINTPILLAR_DETECTOR_H_
+#define POINTPILLAR_DETECTOR_H_
+
+#include <memory>
+#include <string>
+#include "detector.h"
+#include "pointpillar.h"
+
+// Detector backed by the TensorRT engine. Points are copied into the device
+// input buffer of a PointPillar context and inferred on that context's
+// stream. Several detectors may share one PointPillar, e.g. one per sensor
+// thread; each call then checks out one of its contexts.
+class PointPillarDetector : public Detector {
+  private:
+    cudaStream_t stream_ = NULL;
+    std::shared_ptr<PointPillar> pointpillar_;
+    unsigned int point_size_;
+    unsigned int max_points_;
+
+  public:
+    PointPillarDetector(const std::string &model_file, const std::string &engine_file,
+                        const std::string &data_type);
+    explicit PointPillarDetector(std::shared_ptr<PointPillar> pointpillar);
+    ~PointPillarDetector(void);
+    // false when the engine failed to load; see PointPillar::isLoaded()
+    bool isLoaded() const { return pointpillar_->isLoaded(); }
+    unsigned int pointSize() override { return point_size_; }
+    unsigned int maxPoints() override { return max_points_; }
+    int infer(const float *points, unsigned int num_points, std::vector<Bndbox> &boxes) override;
+};
+
+#endif
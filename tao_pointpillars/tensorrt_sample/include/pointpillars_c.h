@@ -0,0 +1,123 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+ * C interface of libpointpillars, for embedding the detector in-process.
+ * All functions are thread safe; up to pp_config.num_contexts pp_infer()
+ * calls run concurrently and further calls wait for a free context. Memory
+ * is allocated in pp_create() only: pp_infer() writes into the caller's
+ * arrays and reuses per-context scratch.
+ */
+
+#ifndef POINTPILLARS_C_H_
+#define POINTPILLARS_C_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(__GNUC__)
+#define PP_API __attribute__((visibility("default")))
+#else
+#define PP_API
+#endif
+
+#define PP_ABI_VERSION 1
+
+/* return codes; negative values are errors */
+#define PP_OK 0
+#define PP_TRUNCATED 1              /* more boxes than max_boxes, the best were kept */
+#define PP_ERROR_INVALID_ARGUMENT -1
+#define PP_ERROR_INIT -2
+#define PP_ERROR_INFER -3
+
+typedef struct pp_detector pp_detector;
+
+/* one detection, same layout as the 9 floats of SaveBoxPred (id as int32) */
+typedef struct pp_box {
+    float x, y, z;
+    float w, l, h;
+    float rt;
+    int32_t id;
+    float score;
+} pp_box;
+
+typedef struct pp_config {
+    size_t struct_size;         /* sizeof(pp_config), set by pp_config_init; fields
+                                   past it take their defaults */
+    const char *model_path;     /* ONNX model, used when engine_path has no cache yet */
+    const char *engine_path;    /* serialized TensorRT engine */
+    const char *data_type;      /* "fp32" or "fp16" */
+    float nms_iou_thresh;
+    int32_t pre_nms_top_n;
+    uint32_t num_contexts;      /* concurrent pp_infer() calls */
+    int32_t use_stub;           /* CPU stand-in detector instead of the engine */
+    float stub_latency_ms;
+} pp_config;
+
+typedef struct pp_stats {
+    uint64_t frames;            /* successful pp_infer() calls */
+    uint64_t boxes;             /* boxes returned in total */
+    uint64_t truncated_frames;  /* frames that returned PP_TRUNCATED */
+    uint64_t clipped_points;    /* points over the engine capacity, ignored */
+    uint64_t context_waits;     /* calls that waited for a free context */
+    double last_ms;             /* pp_infer() wall time */
+    double mean_ms;
+    double max_ms;
+} pp_stats;
+
+/* Fills config with defaults: fp32, IoU 0.01, top-N 4096, one context. */
+PP_API void pp_config_init(pp_config *config);
+
+/* Loads the engine (or the stub) and allocates all contexts; NULL on failure. */
+PP_API pp_detector *pp_create(const pp_config *config);
+
+/*
+ * pp_create() that says why it failed: PP_ERROR_INVALID_ARGUMENT for a bad
+ * config, PP_ERROR_INIT when the engine or a context can't be loaded.
+ * *detector is set on PP_OK and NULL otherwise.
+ */
+PP_API int pp_create_ex(const pp_config *config, pp_detector **detector);
+
+/* Floats per point and maximum points per call of the loaded model. */
+PP_API uint32_t pp_point_size(const pp_detector *detector);
+PP_API uint32_t pp_max_points(const pp_detector *detector);
+
+/*
+ * Detects objects in num_points points of pp_point_size() floats each and
+ * writes up to max_boxes boxes, best score first, to boxes. *num_boxes
+ * receives the number written. Points past pp_max_points() are ignored.
+ */
+PP_API int pp_infer(pp_detector *detector, const float *points, uint32_t num_points,
+                    pp_box *boxes, uint32_t max_boxes, uint32_t *num_boxes);
+
+PP_API int pp_get_stats(pp_detector *detector, pp_stats *stats);
+
+PP_API void pp_destroy(pp_detector *detector);
+
+/* Short description of a return code. */
+PP_API const char *pp_status_string(int status);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
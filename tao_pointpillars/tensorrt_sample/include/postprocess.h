@@ -18,6 +18,7 @@
 #ifndef POSTPROCESS_H_
 #define POSTPROCESS_H_
 
+#include <stddef.h>
 #include <vector>
 
 struct Bndbox {
@@ -35,7 +36,57 @@ struct Bndbox {
         : x(x_), y(y_), z(z_), w(w_), l(l_), h(h_), rt(rt_), id(id_), score(score_) {}
 };
 
+// iou_count, when given, is incremented by the number of exact IoUs computed.
 int nms_cpu(std::vector<Bndbox> bndboxes, const float nms_thresh,
-            std::vector<Bndbox> &nms_pred, const int pre_nms_top_n);
+            std::vector<Bndbox> &nms_pred, const int pre_nms_top_n,
+            size_t *iou_count = nullptr);
+
+// nms_cpu without per-call allocations: bndboxes is sorted in place and
+// suppressed is the caller's flag scratch. With both vectors and nms_pred
+// reused (nms_pred reserved for pre_nms_top_n boxes) nothing is allocated.
+int nms_cpu_inplace(std::vector<Bndbox> &bndboxes, const float nms_thresh,
+                    std::vector<Bndbox> &nms_pred, const int pre_nms_top_n,
+                    std::vector<int> &suppressed, size_t *iou_count = nullptr);
+
+// Scratch of nms_cpu_rows, reusable across calls.
+struct NmsScratch {
+    std::vector<int> order;
+    std::vector<Bndbox> sorted;
+    std::vector<int> suppressed;
+};
+
+// nms_cpu over boxes that stay in the caller's memory: row i of rows holds
+// x, y, z, w, l, h, rt, class id, score (the SaveBoxPred columns) at
+// rows + i * row_stride. keep receives the indices of the kept rows in score
+// order. Row indices are sorted with the same comparator as nms_cpu sorts
+// boxes, so the result matches nms_cpu, ties included.
+int nms_cpu_rows(const float *rows, size_t num_rows, size_t row_stride, const float nms_thresh,
+                 const int pre_nms_top_n, std::vector<int> &keep, NmsScratch &scratch);
+
+// Bndbox from a row of SaveBoxPred columns.
+inline Bndbox bndbox_from_row(const float *row)
+{
+    Bndbox box;
+    box.x = row[0];
+    box.y = row[1];
+    box.z = row[2];
+    box.w = row[3];
+    box.l = row[4];
+    box.h = row[5];
+    box.rt = row[6];
+    box.id = (int)row[7];
+    box.score = row[8];
+    return box;
+}
+
+// Rotated BEV IoU of two boxes, the overlap measure used by nms_cpu.
+float box_iou_bev(const Bndbox &box_a, const Bndbox &box_b);
+
+// NMS for large box sets spread over a wide area: kept boxes are indexed in a
+// uniform BEV grid of cell_size meters, so every box is only compared with the
+// kept boxes around it. For nms_thresh > 0 this keeps the same boxes as
+// nms_cpu without a top-N limit.
+int nms_cpu_spatial(std::vector<Bndbox> bndboxes, const float nms_thresh,
+                    std::vector<Bndbox> &nms_pred, const float cell_size);
 
 #endif
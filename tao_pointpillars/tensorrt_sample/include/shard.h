@@ -0,0 +1,80 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef SHARD_H_
+#define SHARD_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+// Splitting an offline inference job over independent processes. Every shard
+// reads the same file list and computes the same partition, so no
+// coordinator is needed; each one writes a manifest of what it processed and
+// the manifests of all shards are merged afterwards.
+
+struct ShardFile {
+    std::string path;
+    uint64_t bytes = 0;
+};
+
+// One path per line, optionally followed by its size in bytes. Sizes missing
+// from the list are read with stat, so large jobs should list them.
+int load_file_list(const std::string &list_file, std::vector<ShardFile> &files);
+
+// Size-balanced partition, deterministic for a given list: files are taken
+// largest first (ties in list order) and each goes to the shard with the
+// fewest bytes so far (ties to the lowest shard). shard_of[i] is the shard
+// of files[i].
+void partition_shards(const std::vector<ShardFile> &files, unsigned int num_shards,
+                      std::vector<unsigned int> &shard_of);
+
+// Results are named <stem>.txt in one output directory (batch_output_name),
+// so inputs with the same stem in different directories would overwrite each
+// other. Reports every such input after the first and returns their number;
+// a job with duplicates must not run.
+size_t find_duplicate_stems(const std::vector<ShardFile> &files);
+
+// Identifies a list and shard count; the manifests of one job agree on it.
+uint64_t shard_fingerprint(const std::vector<ShardFile> &files, unsigned int num_shards);
+
+struct ShardEntry {
+    size_t index = 0;       // position in the file list
+    int status = 0;         // BatchStatus
+    uint64_t bytes = 0;
+    unsigned int num_points = 0;
+    size_t num_boxes = 0;
+    std::string input;
+    std::string output;     // empty when nothing was written
+};
+
+struct ShardManifest {
+    unsigned int shard = 0;
+    unsigned int num_shards = 1;
+    uint64_t fingerprint = 0;
+    size_t list_size = 0;
+    std::vector<ShardEntry> entries;
+};
+
+// Written to a temporary name and renamed, so a manifest only exists once
+// its shard has finished.
+int write_shard_manifest(const std::string &path, const ShardManifest &manifest);
+int read_shard_manifest(const std::string &path, ShardManifest &manifest);
+
+#endif
@@ -0,0 +1,87 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef STREAMING_NMS_H_
+#define STREAMING_NMS_H_
+
+#include <stddef.h>
+#include <chrono>
+#include <functional>
+#include <vector>
+#include "postprocess.h"
+
+struct StreamingNmsResult {
+    size_t emitted = 0;     // kept boxes handed out
+    size_t examined = 0;    // candidates looked at, kept or suppressed
+    // stopped by the result limit, the deadline or the consumer while
+    // candidates were left, so more boxes may have been kept
+    bool truncated = false;
+};
+
+// Greedy NMS that hands out the kept boxes in score order as soon as each is
+// final. A candidate is final once it has been checked against every kept
+// box of higher score, so instead of sorting all candidates and suppressing
+// forward, candidates come off a heap one at a time and are compared with
+// the boxes kept so far. The first box is out after O(n) heap construction,
+// and the consumer can stop after any box.
+//
+// Candidates of equal score are taken in input order, so a stream run to
+// the end keeps the boxes of greedy NMS over the candidates stable-sorted by
+// score. With distinct scores that is what nms_cpu keeps for the same
+// threshold and pre_nms_top_n. With tied scores, which fp16 engines produce
+// often, nms_cpu's unstable std::sort may order the ties differently, and
+// it can then keep a different set of boxes. Pairs whose circumcircles
+// don't meet are not compared; their IoU is 0. Buffers are kept across
+// frames.
+class StreamingNms {
+  public:
+    typedef std::chrono::steady_clock Clock;
+    // called for every kept box with its rank among the kept boxes; returning
+    // false stops the stream
+    typedef std::function<bool(const Bndbox &box, size_t rank)> Callback;
+
+  private:
+    const std::vector<Bndbox> *boxes_ = nullptr;
+    float nms_thresh_ = 0.0f;
+    size_t remaining_ = 0;      // candidates of the top-N not yet popped
+    std::vector<int> heap_;
+    std::vector<Bndbox> kept_;
+    std::vector<float> kept_radius_;
+    StreamingNmsResult result_;
+
+  public:
+    // Starts a stream over boxes, which must stay unchanged until it ends.
+    void begin(const std::vector<Bndbox> &boxes, float nms_thresh, int pre_nms_top_n);
+    // Next kept box; false when the candidates are exhausted.
+    bool next(Bndbox *box);
+    // Ends the stream early; counts as truncated when candidates are left.
+    void stop();
+    bool done() const { return remaining_ == 0; }
+    const StreamingNmsResult &result() const { return result_; }
+    // kept boxes so far, in score order
+    const std::vector<Bndbox> &kept() const { return kept_; }
+
+    // Whole stream with a callback: stops after max_results kept boxes
+    // (0 = no limit), at the deadline, or when the callback returns false.
+    // The deadline is checked before every candidate.
+    StreamingNmsResult run(const std::vector<Bndbox> &boxes, float nms_thresh, int pre_nms_top_n,
+                           const Callback &callback, size_t max_results = 0,
+                           Clock::time_point deadline = Clock::time_point::max());
+};
+
+#endif
@@ -0,0 +1,64 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef SWEEP_ACCUMULATOR_H_
+#define SWEEP_ACCUMULATOR_H_
+
+#include <vector>
+
+// Keeps the last N LiDAR sweeps (x, y, z, intensity) together with their
+// world-from-lidar poses and merges them into the frame of the newest sweep.
+// All storage is allocated once in the constructor; slots are recycled.
+class SweepAccumulator {
+  private:
+    struct Sweep {
+      unsigned int num_points = 0;
+      double timestamp = 0.0;
+      float pose[16];
+      float inv_pose[16];
+    };
+    unsigned int max_sweeps_;
+    unsigned int max_points_;
+    std::vector<float> storage_;
+    std::vector<Sweep> sweeps_;
+    unsigned int head_ = 0;     // slot of the newest committed sweep
+    unsigned int count_ = 0;    // committed sweeps in the ring
+
+    float *slot(unsigned int index) { return storage_.data() + (size_t)index * max_points_ * 4; }
+
+  public:
+    SweepAccumulator(unsigned int max_sweeps, unsigned int max_points_per_sweep);
+
+    unsigned int maxPointsPerSweep() const { return max_points_; }
+    unsigned int numSweeps() const { return count_; }
+
+    // Buffer for the next sweep, room for maxPointsPerSweep() points of 4 floats.
+    // Fill it and call commitSweep(); the oldest sweep is dropped when the ring is full.
+    float *beginSweep();
+    void commitSweep(unsigned int num_points, const float *pose, double timestamp);
+    void reset();
+
+    // Writes the accumulated cloud to dst in the model's point layout: the newest
+    // sweep first, then older sweeps moved into its frame. When point_size > 4 the
+    // 5th channel holds the time lag (seconds) to the newest sweep and the rest is
+    // zeroed. Older sweeps are cut off once max_points is reached.
+    // Returns the number of points written.
+    unsigned int fill(float *dst, unsigned int max_points, unsigned int point_size) const;
+};
+
+#endif
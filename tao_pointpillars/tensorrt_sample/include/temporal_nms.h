@@ -0,0 +1,90 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef TEMPORAL_NMS_H_
+#define TEMPORAL_NMS_H_
+
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+#include "postprocess.h"
+
+struct TemporalNmsConfig {
+    // a candidate is linked to the nearest projected previous survivor of the
+    // same class whose BEV center is within this distance (m)
+    float match_distance = 1.0f;
+    // also run nms_cpu on every frame and count frames whose output differs
+    bool verify = false;
+};
+
+struct TemporalNmsStats {
+    size_t candidates = 0;      // boxes after the top-N cut
+    size_t kept = 0;
+    size_t linked = 0;          // candidates linked to a previous survivor
+    size_t seeded = 0;          // suppressed by the kept box of their link
+    size_t exact_ious = 0;      // rotated IoUs computed
+    size_t bound_skips = 0;     // pairs suppressed by the IoU lower bound alone
+    size_t distance_skips = 0;  // pairs rejected by the circumradius test
+    size_t reference_ious = 0;  // rotated IoUs nms_cpu needed (verify only)
+    size_t mismatches = 0;      // frames whose output differs from nms_cpu (verify only)
+
+    size_t avoided() const { return bound_skips + distance_skips; }
+    void add(const TemporalNmsStats &other);
+};
+
+// NMS warm-started from the previous frame. The survivors of the previous
+// frame are moved into the current sensor frame by the ego motion, and every
+// candidate is linked to the survivor it continues. A candidate is first
+// tested against the kept box that already continues the same survivor, where
+// a cheap lower bound on the rotated IoU usually proves suppression without
+// the exact polygon clipping; the remaining kept boxes are only clipped when
+// their circumcircles meet. The suppression test is order independent, so
+// the output is the same as nms_cpu for nms_thresh > 0.
+class TemporalNms {
+  private:
+    TemporalNmsConfig config_;
+    std::vector<Bndbox> previous_;
+    bool has_previous_ = false;
+    TemporalNmsStats stats_;
+
+    // per-frame scratch, reused
+    std::vector<Bndbox> projected_;
+    std::unordered_map<uint64_t, std::vector<uint32_t>> grid_;
+    std::vector<int> owner_;
+    std::vector<float> kept_radius_;
+    std::vector<Bndbox> reference_;
+
+    int link(const Bndbox &box) const;
+
+  public:
+    explicit TemporalNms(const TemporalNmsConfig &config = TemporalNmsConfig());
+    // Same contract as nms_cpu. motion, when given, is the current-from-
+    // previous sensor transform (row-major 4x4); without it the sensor is
+    // assumed static. Kept boxes are appended to nms_pred.
+    int run(std::vector<Bndbox> bndboxes, float nms_thresh, std::vector<Bndbox> &nms_pred,
+            int pre_nms_top_n, const float *motion = nullptr);
+    const TemporalNmsStats &lastStats() const { return stats_; }
+    // forget the previous frame, e.g. after a gap in the sequence
+    void reset();
+};
+
+// Lower bound of the rotated BEV IoU of two boxes, 0 when the headings differ
+// by more than about 30 degrees. Never exceeds box_iou_bev beyond rounding.
+float box_iou_bev_lower_bound(const Bndbox &box_a, const Bndbox &box_b);
+
+#endif
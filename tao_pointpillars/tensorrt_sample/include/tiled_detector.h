@@ -0,0 +1,111 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef TILED_DETECTOR_H_
+#define TILED_DETECTOR_H_
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "pointpillar.h"
+
+struct TileConfig {
+    // BEV point range of the model, which is the area one tile covers:
+    // x_min, y_min, x_max, y_max
+    float range[4] = {0.0f, -39.68f, 69.12f, 39.68f};
+    // overlap between neighbouring tiles in meters
+    float overlap = 10.0f;
+    // grid cell of the cross-tile NMS merge in meters
+    float merge_cell = 8.0f;
+};
+
+// Returns 0 when the tiles have a positive size, 0 <= overlap < width and
+// height, and merge_cell > 0; otherwise prints what is wrong and returns -1.
+int check_tile_config(const TileConfig &config);
+
+// Runs PointPillar over clouds far larger than the model's point range or
+// point capacity. Points are bucketed into overlapping BEV tiles in one pass,
+// every non-empty tile is inferred in the model's frame (the next tile is
+// staged meanwhile on a helper thread that lives as long as the detector),
+// boxes are moved back to global coordinates and duplicates at tile borders
+// are merged by a grid indexed NMS.
+class TiledDetector {
+  private:
+    struct Tile {
+      float origin_x, origin_y;
+      // true when the tile has a neighbour on that side: x-, x+, y-, y+
+      bool inner[4];
+      std::vector<float> points;
+    };
+
+    PointPillar &pointpillar_;
+    cudaStream_t stream_;
+    TileConfig config_;
+    unsigned int point_size_;
+    unsigned int max_points_;
+
+    std::vector<Tile> tiles_;
+    std::vector<int> active_;
+    float *staging_[2] = {nullptr, nullptr};
+    unsigned int *staging_num_ = nullptr;
+    float *points_dev_ = nullptr;
+    unsigned int *points_num_dev_ = nullptr;
+    std::vector<Bndbox> tile_pred_;
+    std::vector<Bndbox> candidates_;
+    unsigned long long dropped_points_ = 0;
+    bool valid_;
+
+    // the staging thread and the tile it is asked to stage next
+    std::thread stager_;
+    std::mutex stage_mutex_;
+    std::condition_variable stage_cv_;
+    const Tile *stage_tile_ = nullptr;
+    int stage_slot_ = 0;
+    bool stop_ = false;
+
+    void bucket(const float *points, unsigned int num_points);
+    void stage(int slot, const Tile &tile);
+    void stageLoop();
+    void startStage(int slot, const Tile &tile);
+    void waitStage();
+
+  public:
+    // an invalid config (see check_tile_config) is reported here and makes
+    // detect() return -1
+    TiledDetector(PointPillar &pointpillar, cudaStream_t stream, const TileConfig &config);
+    ~TiledDetector(void);
+
+    int detect(
+      const float *points,
+      unsigned int num_points,
+      std::vector<Bndbox> &nms_pred,
+      float nms_iou_thresh,
+      int pre_nms_top_n,
+      const std::vector<std::string>& class_names,
+      bool do_profile
+    );
+
+    unsigned int numTiles() const { return active_.size(); }
+    // points of the last detect() cut off because a tile held more than the
+    // model's capacity
+    unsigned long long droppedPoints() const { return dropped_points_; }
+};
+
+#endif
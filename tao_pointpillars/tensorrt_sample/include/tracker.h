@@ -0,0 +1,116 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef TRACKER_H_
+#define TRACKER_H_
+
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+#include "postprocess.h"
+
+struct TrackerConfig {
+    // association gate: BEV center distance in meters, also the grid cell
+    float max_distance = 2.0f;
+    // tracks seen once have no velocity yet; their gate grows by max_speed * dt
+    float max_speed = 30.0f;
+    // > 0 associates by rotated BEV IoU (cost 1 - IoU, pairs below it gated
+    // out) instead of center distance; candidates are still grid pruned
+    float min_iou = 0.0f;
+    // a track is dropped after this many frames without a detection
+    int max_misses = 3;
+    // detections are only associated with tracks of the same class
+    bool class_aware = true;
+    // white-noise acceleration (m/s^2)^2 and position measurement noise m^2
+    float process_noise = 4.0f;
+    float measurement_noise = 0.05f;
+    // smoothing of z, size and heading, 1 = take the detection as is
+    float shape_alpha = 0.3f;
+};
+
+struct TrackedBox {
+    Bndbox box;                 // the detection, in the frame it was given in
+    uint32_t track_id;
+    float vx, vy;               // track velocity in the same frame, m/s
+    int hits;                   // frames the track has been detected in
+};
+
+// Multi-object tracker over successive NMS outputs. Tracks follow a constant
+// velocity Kalman filter on the BEV center (x and y are independent filters
+// of position and velocity), while z, size and heading are smoothed. Each
+// frame the tracks are predicted to the frame time, detection/track pairs
+// within the gate are found through uniform grids over the predicted centers
+// (cell = gate, so only the 3x3 neighbourhood is visited), the candidate
+// graph is split into connected components and every component is solved as
+// a linear assignment (Hungarian, shortest augmenting path). Unmatched detections start new tracks with new IDs.
+class Tracker {
+  private:
+    struct Track {
+        uint32_t id;
+        Bndbox box;             // smoothed, in the tracking frame
+        float x[2], v[2];       // per-axis position and velocity
+        float p[2][3];          // per-axis covariance: pp, pv, vv
+        int hits;
+        int misses;
+    };
+    struct Candidate {
+        uint32_t track, det;
+        float cost;
+    };
+
+    TrackerConfig config_;
+    std::vector<Track> tracks_;
+    uint32_t next_id_ = 1;
+    double last_time_ = 0.0;
+    bool has_time_ = false;
+
+    // per-frame scratch, reused
+    std::vector<Bndbox> dets_;
+    // confirmed tracks, and tracks seen once (larger gate and cell)
+    std::unordered_map<uint64_t, std::vector<uint32_t>> grid_[2];
+    std::vector<std::pair<uint32_t, uint32_t>> order_;
+    std::vector<const Candidate *> edges_;
+    std::vector<Candidate> candidates_;
+    std::vector<uint32_t> parent_;
+    std::vector<int> det_track_;
+    std::vector<int> track_det_;
+    std::vector<uint32_t> comp_tracks_, comp_dets_;
+    std::vector<double> cost_;
+    std::vector<int> assignment_;
+
+    void predict(float dt);
+    void associate(float dt);
+    void solveComponent(const std::vector<const Candidate *> &edges);
+
+  public:
+    explicit Tracker(const TrackerConfig &config = TrackerConfig());
+    // Track one frame of detections taken at time (seconds). pose, when given,
+    // is the sensor-to-world transform (row-major 4x4) of the frame: tracking
+    // then runs in world coordinates so ego motion does not look like object
+    // motion, and the velocities are rotated back into the sensor frame.
+    void update(const std::vector<Bndbox> &detections, double time, std::vector<TrackedBox> &out,
+                const float *pose = nullptr);
+    size_t numTracks() const { return tracks_.size(); }
+    void reset();
+};
+
+// Solve min-cost assignment of a rows x cols cost matrix (row-major, rows <=
+// cols). assignment[r] receives the column of row r.
+void solve_assignment(const double *cost, int rows, int cols, std::vector<int> &assignment);
+
+#endif
@@ -0,0 +1,243 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Python bindings of the postprocess kernels. Boxes are any C-contiguous
+// float32 buffer of shape (N, 9) holding the SaveBoxPred columns x, y, z, w,
+// l, h, rt, class id, score -- e.g. a NumPy array -- and are read in place
+// through the buffer protocol. The GIL is released while the kernels run.
+// Results are returned as memoryviews, which np.asarray() wraps without a copy.
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "postprocess.h"
+
+namespace {
+
+// Holds a (N, 9) float32 view of a Python object for the duration of a call.
+class BoxBuffer {
+  private:
+    Py_buffer view_;
+    bool held_ = false;
+
+  public:
+    BoxBuffer() {}
+    BoxBuffer(const BoxBuffer &) = delete;
+    BoxBuffer &operator=(const BoxBuffer &) = delete;
+    ~BoxBuffer()
+    {
+        if (held_) {
+            PyBuffer_Release(&view_);
+        }
+    }
+
+    bool acquire(PyObject *obj, const char *name)
+    {
+        if (PyObject_GetBuffer(obj, &view_, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) != 0) {
+            PyErr_Format(PyExc_TypeError, "%s: expected a C-contiguous float32 buffer of shape (N, 9)", name);
+            return false;
+        }
+        held_ = true;
+        const char *given = view_.format ? view_.format : "B";
+        const char *format = given;
+        if (format[0] == '<' || format[0] == '=' || format[0] == '@') {
+            format++;
+        }
+        if (strcmp(format, "f") != 0 || view_.itemsize != 4) {
+            PyErr_Format(PyExc_TypeError, "%s: expected float32 data, got format '%s'", name, given);
+            return false;
+        }
+        if (view_.ndim != 2 || view_.shape[1] != 9) {
+            PyErr_Format(PyExc_ValueError, "%s: expected shape (N, 9)", name);
+            return false;
+        }
+        return true;
+    }
+
+    const float *rows() const { return (const float *)view_.buf; }
+    size_t size() const { return (size_t)view_.shape[0]; }
+};
+
+// memoryview of the given format and shape over a new bytearray holding data
+PyObject *to_memoryview(const void *data, size_t bytes, const char *format, Py_ssize_t rows,
+                        Py_ssize_t cols)
+{
+    PyObject *storage = PyByteArray_FromStringAndSize((const char *)data, (Py_ssize_t)bytes);
+    if (!storage) {
+        return nullptr;
+    }
+    PyObject *raw = PyMemoryView_FromObject(storage);
+    Py_DECREF(storage);
+    if (!raw) {
+        return nullptr;
+    }
+    PyObject *view = cols < 0 ? PyObject_CallMethod(raw, "cast", "s(n)", format, rows)
+                              : PyObject_CallMethod(raw, "cast", "s(nn)", format, rows, cols);
+    Py_DECREF(raw);
+    return view;
+}
+
+PyObject *keep_to_memoryview(const std::vector<int> &keep)
+{
+    std::vector<long long> indices(keep.begin(), keep.end());
+    return to_memoryview(indices.data(), indices.size() * sizeof(long long), "q", (Py_ssize_t)indices.size(), -1);
+}
+
+PyObject *py_iou_bev(PyObject *, PyObject *args)
+{
+    PyObject *a_obj, *b_obj;
+    if (!PyArg_ParseTuple(args, "OO:iou_bev", &a_obj, &b_obj)) {
+        return nullptr;
+    }
+    BoxBuffer a, b;
+    if (!a.acquire(a_obj, "a") || !b.acquire(b_obj, "b")) {
+        return nullptr;
+    }
+    size_t n = a.size(), m = b.size();
+    std::vector<float> iou(n * m);
+    Py_BEGIN_ALLOW_THREADS
+    std::vector<Bndbox> boxes_b(m);
+    for (size_t j = 0; j < m; j++) {
+        boxes_b[j] = bndbox_from_row(b.rows() + j * 9);
+    }
+    for (size_t i = 0; i < n; i++) {
+        Bndbox box_a = bndbox_from_row(a.rows() + i * 9);
+        for (size_t j = 0; j < m; j++) {
+            iou[i * m + j] = box_iou_bev(box_a, boxes_b[j]);
+        }
+    }
+    Py_END_ALLOW_THREADS
+    return to_memoryview(iou.data(), iou.size() * sizeof(float), "f", (Py_ssize_t)n, (Py_ssize_t)m);
+}
+
+PyObject *py_nms(PyObject *, PyObject *args, PyObject *kwargs)
+{
+    static const char *keywords[] = {"boxes", "iou_thresh", "pre_nms_top_n", nullptr};
+    PyObject *boxes_obj;
+    float iou_thresh;
+    int pre_nms_top_n = 4096;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "Of|i:nms", (char **)keywords, &boxes_obj, &iou_thresh,
+                                     &pre_nms_top_n)) {
+        return nullptr;
+    }
+    BoxBuffer boxes;
+    if (!boxes.acquire(boxes_obj, "boxes")) {
+        return nullptr;
+    }
+    std::vector<int> keep;
+    Py_BEGIN_ALLOW_THREADS
+    NmsScratch scratch;
+    nms_cpu_rows(boxes.rows(), boxes.size(), 9, iou_thresh, pre_nms_top_n, keep, scratch);
+    Py_END_ALLOW_THREADS
+    return keep_to_memoryview(keep);
+}
+
+PyObject *py_nms_batch(PyObject *, PyObject *args, PyObject *kwargs)
+{
+    static const char *keywords[] = {"frames", "iou_thresh", "pre_nms_top_n", "num_threads", nullptr};
+    PyObject *frames_obj;
+    float iou_thresh;
+    int pre_nms_top_n = 4096;
+    int num_threads = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "Of|ii:nms_batch", (char **)keywords, &frames_obj,
+                                     &iou_thresh, &pre_nms_top_n, &num_threads)) {
+        return nullptr;
+    }
+    PyObject *seq = PySequence_Fast(frames_obj, "frames: expected a sequence of (N, 9) float32 buffers");
+    if (!seq) {
+        return nullptr;
+    }
+    Py_ssize_t num_frames = PySequence_Fast_GET_SIZE(seq);
+    std::vector<BoxBuffer> frames(num_frames);
+    for (Py_ssize_t f = 0; f < num_frames; f++) {
+        if (!frames[f].acquire(PySequence_Fast_GET_ITEM(seq, f), "frames[i]")) {
+            Py_DECREF(seq);
+            return nullptr;
+        }
+    }
+
+    std::vector<std::vector<int>> keep(num_frames);
+    Py_BEGIN_ALLOW_THREADS
+    if (num_threads <= 0) {
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    num_threads = (int)std::min<Py_ssize_t>(num_threads, std::max<Py_ssize_t>(num_frames, 1));
+    std::atomic<Py_ssize_t> next{0};
+    auto worker = [&] {
+        NmsScratch scratch;
+        for (Py_ssize_t f; (f = next++) < num_frames;) {
+            nms_cpu_rows(frames[f].rows(), frames[f].size(), 9, iou_thresh, pre_nms_top_n, keep[f], scratch);
+        }
+    };
+    std::vector<std::thread> threads;
+    for (int t = 1; t < num_threads; t++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    Py_END_ALLOW_THREADS
+    Py_DECREF(seq);
+
+    PyObject *result = PyList_New(num_frames);
+    if (!result) {
+        return nullptr;
+    }
+    for (Py_ssize_t f = 0; f < num_frames; f++) {
+        PyObject *view = keep_to_memoryview(keep[f]);
+        if (!view) {
+            Py_DECREF(result);
+            return nullptr;
+        }
+        PyList_SET_ITEM(result, f, view);
+    }
+    return result;
+}
+
+PyMethodDef methods[] = {
+    {"iou_bev", (PyCFunction)py_iou_bev, METH_VARARGS,
+     "iou_bev(a, b) -> (N, M) float32 memoryview of the rotated BEV IoU of every row of a with every row of b."},
+    {"nms", (PyCFunction)(void (*)(void))py_nms, METH_VARARGS | METH_KEYWORDS,
+     "nms(boxes, iou_thresh, pre_nms_top_n=4096) -> int64 memoryview of the kept row indices, best score "
+     "first. Same result as nms_cpu."},
+    {"nms_batch", (PyCFunction)(void (*)(void))py_nms_batch, METH_VARARGS | METH_KEYWORDS,
+     "nms_batch(frames, iou_thresh, pre_nms_top_n=4096, num_threads=0) -> list with nms() of every frame, "
+     "computed in parallel (0 threads: one per core)."},
+    {nullptr, nullptr, 0, nullptr}
+};
+
+PyModuleDef module = {
+    PyModuleDef_HEAD_INIT,
+    "pointpillars_postprocess",
+    "Rotated BEV IoU and NMS of the PointPillars sample on (N, 9) float32 box buffers.",
+    -1,
+    methods,
+    nullptr, nullptr, nullptr, nullptr
+};
+
+} // namespace
+
+PyMODINIT_FUNC PyInit_pointpillars_postprocess(void)
+{
+    return PyModule_Create(&module);
+}
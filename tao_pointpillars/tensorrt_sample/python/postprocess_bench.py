@@ -0,0 +1,80 @@
+# SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+# Checks and times the pointpillars_postprocess extension on synthetic frames
+# of clustered boxes:
+#   python3 postprocess_bench.py [frames] [boxes_per_frame]
+# Works with NumPy arrays as well as plain buffers; NumPy is not required.
+
+import array
+import math
+import random
+import sys
+import threading
+import time
+
+import pointpillars_postprocess as pp
+
+
+def make_frame(rng, num_boxes):
+    values = array.array("f")
+    for i in range(num_boxes):
+        cx, cy = (i // 8) * 7.0 % 70.0, (i // 8) * 3.0 % 40.0
+        values.extend([cx + rng.gauss(0, 0.3), cy + rng.gauss(0, 0.3), -1.0,
+                       1.8, 4.5, 1.6, rng.uniform(-math.pi, math.pi) * 0.05, i % 3, rng.random()])
+    # zero-copy 2-D view, like a NumPy (N, 9) float32 array
+    return memoryview(values).cast("B").cast("f", (num_boxes, 9))
+
+
+def main():
+    num_frames = int(sys.argv[1]) if len(sys.argv) > 1 else 50
+    num_boxes = int(sys.argv[2]) if len(sys.argv) > 2 else 1000
+    rng = random.Random(5)
+    frames = [make_frame(rng, num_boxes) for _ in range(num_frames)]
+
+    start = time.perf_counter()
+    single = [pp.nms(frame, 0.01) for frame in frames]
+    single_s = time.perf_counter() - start
+    start = time.perf_counter()
+    batched = pp.nms_batch(frames, 0.01)
+    batch_s = time.perf_counter() - start
+    same = all(a.tolist() == b.tolist() for a, b in zip(single, batched))
+    kept = sum(len(k) for k in batched) / num_frames
+    print("%d frames x %d boxes, %.1f kept per frame" % (num_frames, num_boxes, kept))
+    print("nms:       %.3f ms/frame" % (1e3 * single_s / num_frames))
+    print("nms_batch: %.3f ms/frame, same result: %s" % (1e3 * batch_s / num_frames, same))
+
+    # the GIL is released while the kernels run
+    ticks = [0]
+    done = threading.Event()
+
+    def spin():
+        while not done.is_set():
+            ticks[0] += 1
+
+    spinner = threading.Thread(target=spin)
+    spinner.start()
+    pp.nms_batch(frames, 0.01, num_threads=1)
+    done.set()
+    spinner.join()
+    print("python thread iterations during nms_batch: %d" % ticks[0])
+
+    iou = pp.iou_bev(frames[0], frames[0])
+    print("iou_bev shape %s, diagonal %.3f" % (iou.shape, iou[0, 0]))
+    return 0 if same else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
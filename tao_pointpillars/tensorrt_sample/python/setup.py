@@ -0,0 +1,40 @@
+# SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+# Builds the pointpillars_postprocess extension in place:
+#   python3 setup.py build_ext --inplace
+
+import os
+from setuptools import Extension, setup
+
+here = os.path.dirname(os.path.abspath(__file__))
+root = os.path.dirname(here)
+
+setup(
+    name="pointpillars_postprocess",
+    version="1.0",
+    ext_modules=[
+        Extension(
+            "pointpillars_postprocess",
+            sources=[
+                os.path.relpath(os.path.join(here, "pointpillars_postprocess.cpp")),
+                os.path.relpath(os.path.join(root, "src", "postprocess.cpp")),
+            ],
+            include_dirs=[os.path.join(root, "include")],
+            define_macros=[("POINTPILLARS_CPU_ONLY", None)],
+            extra_compile_args=["-std=c++11", "-O2"],
+        )
+    ],
+)
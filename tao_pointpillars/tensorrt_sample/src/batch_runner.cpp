@@ -0,0 +1,243 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "batch_runner.h"
+#include "box_io.h"
+#include "point_io.h"
+
+namespace {
+
+template <typename T>
+class BlockingQueue {
+  private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<T> items_;
+
+  public:
+    void push(T item)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        items_.push_back(std::move(item));
+        cv_.notify_one();
+    }
+    T pop()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [&] { return !items_.empty(); });
+        T item = std::move(items_.front());
+        items_.pop_front();
+        return item;
+    }
+    bool tryPop(T &item)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (items_.empty()) {
+            return false;
+        }
+        item = std::move(items_.front());
+        items_.pop_front();
+        return true;
+    }
+};
+
+const size_t kEnd = (size_t)-1;
+
+struct Loaded {
+    size_t index;
+    size_t buffer;
+    int status;
+    unsigned int num_points;
+    const float *points;
+};
+
+struct RawBoxes {
+    size_t index;
+    std::vector<Bndbox> boxes;
+};
+
+double elapsed_ms(std::chrono::steady_clock::time_point since)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+}
+
+} // namespace
+
+std::string batch_output_name(const std::string &output_dir, const std::string &input)
+{
+    std::string name = input.substr(input.find_last_of('/') + 1);
+    name = name.substr(0, name.find_last_of('.')) + ".txt";
+    if (output_dir.empty()) {
+        return name;
+    }
+    return output_dir.back() == '/' ? output_dir + name : output_dir + "/" + name;
+}
+
+BatchRunner::BatchRunner(Detector &detector, const BatchConfig &config)
+    : detector_(detector), config_(config)
+{
+    config_.read_ahead = std::max(1u, config_.read_ahead);
+}
+
+size_t BatchRunner::run(const std::vector<std::string> &files, std::vector<BatchResult> &results)
+{
+    auto start = std::chrono::steady_clock::now();
+    stats_ = BatchStats();
+    results.assign(files.size(), BatchResult());
+    const unsigned int point_size = detector_.pointSize();
+    const unsigned int max_points = detector_.maxPoints();
+
+    // one buffer being inferred plus the ones loaded ahead
+    const size_t num_buffers = config_.read_ahead + 1;
+    bool prefetch = config_.prefetch;
+    for (size_t i = 0; prefetch && i < files.size(); i++) {
+        prefetch = has_extension(files[i], ".bin");
+    }
+    std::unique_ptr<FilePrefetcher> prefetcher;
+    if (prefetch) {
+        prefetcher.reset(new FilePrefetcher(files, num_buffers, (size_t)max_points * point_size * sizeof(float),
+                                            config_.prefetch_backend));
+        stats_.prefetch = prefetcher->backend();
+    } else if (buffers_.size() != num_buffers) {
+        buffers_.resize(num_buffers);
+        for (auto &buffer : buffers_) {
+            buffer.resize((size_t)max_points * point_size);
+        }
+    }
+
+    // buffers come back here once inference is done with them
+    BlockingQueue<size_t> free_buffers;
+    BlockingQueue<Loaded> loaded;
+    BlockingQueue<RawBoxes> raw_queue, spare_raw;
+    for (size_t b = 0; b < num_buffers; b++) {
+        if (!prefetch) {
+            free_buffers.push(b);
+        }
+        spare_raw.push(RawBoxes());
+    }
+
+    std::thread loader([&] {
+        if (prefetcher) {
+            // files arrive in list order; a buffer goes back to the
+            // prefetcher, which starts its next read, as soon as it is free
+            for (size_t delivered = 0; delivered < files.size();) {
+                size_t b;
+                while (free_buffers.tryPop(b)) {
+                    prefetcher->release(b);
+                }
+                if (prefetcher->pending() == 0) {
+                    prefetcher->release(free_buffers.pop());
+                    continue;
+                }
+                PrefetchedFile file;
+                prefetcher->next(file);
+                Loaded item;
+                item.index = file.index;
+                item.buffer = file.buffer;
+                item.status = file.error ? kBatchLoadFailed : kBatchOk;
+                item.num_points = file.size / (point_size * sizeof(float));
+                item.points = (const float *)file.data;
+                loaded.push(item);
+                delivered++;
+            }
+        } else {
+            PointLoader point_loader;
+            for (size_t i = 0; i < files.size(); i++) {
+                Loaded item;
+                item.index = i;
+                item.buffer = free_buffers.pop();
+                item.num_points = 0;
+                item.points = buffers_[item.buffer].data();
+                item.status = point_loader.load(files[i], buffers_[item.buffer].data(), max_points, point_size,
+                                                &item.num_points) == 0 ? kBatchOk : kBatchLoadFailed;
+                loaded.push(item);
+            }
+        }
+        loaded.push(Loaded{kEnd, 0, 0, 0, nullptr});
+    });
+
+    std::thread writer([&] {
+        std::vector<Bndbox> nms_pred;
+        std::vector<int> suppressed;
+        nms_pred.reserve(config_.pre_nms_top_n);
+        while (true) {
+            RawBoxes raw = raw_queue.pop();
+            if (raw.index == kEnd) {
+                break;
+            }
+            auto t0 = std::chrono::steady_clock::now();
+            BatchResult &result = results[raw.index];
+            nms_pred.clear();
+            nms_cpu_inplace(raw.boxes, config_.nms_thresh, nms_pred, config_.pre_nms_top_n, suppressed);
+            result.output = batch_output_name(config_.output_dir, files[raw.index]);
+            result.num_boxes = nms_pred.size();
+            result.status = save_box_pred(nms_pred, result.output) == 0 ? kBatchOk : kBatchWriteFailed;
+            stats_.post_ms += elapsed_ms(t0);
+            raw.boxes.clear();
+            spare_raw.push(std::move(raw));
+        }
+    });
+
+    while (true) {
+        auto t0 = std::chrono::steady_clock::now();
+        Loaded item = loaded.pop();
+        stats_.load_wait_ms += elapsed_ms(t0);
+        if (item.index == kEnd) {
+            break;
+        }
+        BatchResult &result = results[item.index];
+        result.status = item.status;
+        result.num_points = item.num_points;
+        if (item.status != kBatchOk) {
+            free_buffers.push(item.buffer);
+            continue;
+        }
+        RawBoxes raw = spare_raw.pop();
+        raw.index = item.index;
+        t0 = std::chrono::steady_clock::now();
+        int ret = detector_.infer(item.points, item.num_points, raw.boxes);
+        stats_.infer_ms += elapsed_ms(t0);
+        free_buffers.push(item.buffer);
+        if (ret != 0) {
+            result.status = kBatchInferFailed;
+            raw.boxes.clear();
+            spare_raw.push(std::move(raw));
+            continue;
+        }
+        raw_queue.push(std::move(raw));
+    }
+    RawBoxes end;
+    end.index = kEnd;
+    raw_queue.push(std::move(end));
+    loader.join();
+    writer.join();
+    stats_.total_ms = elapsed_ms(start);
+
+    size_t failed = 0;
+    for (const auto &result : results) {
+        failed += result.status != kBatchOk;
+    }
+    return failed;
+}
@@ -0,0 +1,155 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include "box_compare.h"
+
+namespace {
+
+inline float yaw_error(float a, float b)
+{
+    float d = fmodf(fabsf(a - b), 2 * M_PI);
+    return std::min(d, (float)(2 * M_PI) - d);
+}
+
+inline bool same_fields(const Bndbox &a, const Bndbox &b)
+{
+    return a.x == b.x && a.y == b.y && a.z == b.z && a.w == b.w && a.l == b.l && a.h == b.h &&
+           a.rt == b.rt && a.id == b.id && a.score == b.score;
+}
+
+} // namespace
+
+void FrameDiff::add(const FrameDiff &other)
+{
+    ref_boxes += other.ref_boxes;
+    test_boxes += other.test_boxes;
+    matched += other.matched;
+    identical += other.identical;
+    missing += other.missing;
+    extra += other.extra;
+    out_of_tolerance += other.out_of_tolerance;
+    min_iou = std::min(min_iou, other.min_iou);
+    for (int f = 0; f < kNumBoxFields; f++) {
+        max_error[f] = std::max(max_error[f], other.max_error[f]);
+    }
+}
+
+void compare_boxes(const std::vector<Bndbox> &ref, const std::vector<Bndbox> &test,
+                   const BoxTolerance &tolerance, FrameDiff &diff, BoxCompareScratch &scratch)
+{
+    diff = FrameDiff();
+    diff.ref_boxes = ref.size();
+    diff.test_boxes = test.size();
+
+    // unchanged outputs keep their order: pair equal boxes by position
+    std::vector<int> &ref_left = scratch.ref_left;
+    std::vector<int> &test_left = scratch.test_left;
+    ref_left.clear();
+    test_left.clear();
+    size_t common = std::min(ref.size(), test.size());
+    for (size_t i = 0; i < common; i++) {
+        if (same_fields(ref[i], test[i])) {
+            diff.identical++;
+        } else {
+            ref_left.push_back(i);
+            test_left.push_back(i);
+        }
+    }
+    for (size_t i = common; i < ref.size(); i++) {
+        ref_left.push_back(i);
+    }
+    for (size_t i = common; i < test.size(); i++) {
+        test_left.push_back(i);
+    }
+    diff.matched = diff.identical;
+    if (ref_left.empty() || test_left.empty()) {
+        diff.missing = ref_left.size();
+        diff.extra = test_left.size();
+        return;
+    }
+
+    // candidate pairs: test boxes sorted by x, searched within the largest
+    // possible center distance of overlapping boxes
+    std::sort(test_left.begin(), test_left.end(), [&](int a, int b) { return test[a].x < test[b].x; });
+    float test_reach = 0.0f;
+    for (int j : test_left) {
+        test_reach = std::max(test_reach, 0.5f * hypotf(test[j].w, test[j].l));
+    }
+    std::vector<BoxCompareScratch::Pair> &pairs = scratch.pairs;
+    pairs.clear();
+    for (int i : ref_left) {
+        const Bndbox &a = ref[i];
+        float ra = 0.5f * hypotf(a.w, a.l);
+        auto first = std::lower_bound(test_left.begin(), test_left.end(), a.x - ra - test_reach,
+                                      [&](int j, float x) { return test[j].x < x; });
+        for (auto it = first; it != test_left.end() && test[*it].x <= a.x + ra + test_reach; ++it) {
+            const Bndbox &b = test[*it];
+            if (tolerance.class_aware && a.id != b.id) {
+                continue;
+            }
+            float reach = ra + 0.5f * hypotf(b.w, b.l);
+            float dx = a.x - b.x, dy = a.y - b.y;
+            if (dx * dx + dy * dy >= reach * reach) {
+                continue;
+            }
+            float iou = same_fields(a, b) ? 1.0f : box_iou_bev(a, b);
+            if (iou >= tolerance.min_iou && iou > 0.0f) {
+                pairs.push_back({iou, i, *it});
+            }
+        }
+    }
+    std::sort(pairs.begin(), pairs.end(), [](const BoxCompareScratch::Pair &p, const BoxCompareScratch::Pair &q) {
+        if (p.iou != q.iou) return p.iou > q.iou;
+        if (p.ref != q.ref) return p.ref < q.ref;
+        return p.test < q.test;
+    });
+
+    // greedy assignment, best IoU first
+    std::vector<char> &ref_matched = scratch.ref_matched;
+    std::vector<char> &test_matched = scratch.test_matched;
+    ref_matched.assign(ref.size(), 0);
+    test_matched.assign(test.size(), 0);
+    size_t new_matches = 0;
+    for (const auto &p : pairs) {
+        if (ref_matched[p.ref] || test_matched[p.test]) {
+            continue;
+        }
+        ref_matched[p.ref] = test_matched[p.test] = 1;
+        new_matches++;
+        const Bndbox &a = ref[p.ref], &b = test[p.test];
+        float err[kNumBoxFields];
+        err[kFieldCenter] = std::max(std::max(fabsf(a.x - b.x), fabsf(a.y - b.y)), fabsf(a.z - b.z));
+        err[kFieldSize] = std::max(std::max(fabsf(a.w - b.w), fabsf(a.l - b.l)), fabsf(a.h - b.h));
+        err[kFieldYaw] = yaw_error(a.rt, b.rt);
+        err[kFieldScore] = fabsf(a.score - b.score);
+        const float limit[kNumBoxFields] = {tolerance.center, tolerance.size, tolerance.yaw, tolerance.score};
+        bool within = a.id == b.id;
+        for (int f = 0; f < kNumBoxFields; f++) {
+            diff.max_error[f] = std::max(diff.max_error[f], err[f]);
+            within = within && err[f] <= limit[f];
+        }
+        diff.out_of_tolerance += !within;
+        diff.min_iou = std::min(diff.min_iou, p.iou);
+    }
+    diff.matched += new_matches;
+    diff.missing = ref_left.size() - new_matches;
+    diff.extra = test_left.size() - new_matches;
+}
@@ -0,0 +1,230 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <math.h>
+#include <algorithm>
+#include <iostream>
+#include <thread>
+#include "box_decoder.h"
+
+BoxDecoder::BoxDecoder(const BoxDecoderConfig &config)
+    : config_(config), num_classes_(config.classes.size())
+{
+    if (config_.num_threads <= 0) {
+        config_.num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    config_.num_threads = std::min(config_.num_threads, std::max(config_.grid_y, 1));
+    config_.num_dir_bins = std::max(config_.num_dir_bins, 1);
+
+    // cell anchor centers, as the anchor generator of the training code lays them out
+    const float *r = config_.range;
+    for (int axis = 0; axis < 2; axis++) {
+        int cells = axis == 0 ? config_.grid_x : config_.grid_y;
+        float lo = r[axis], hi = r[axis + 3];
+        float stride, offset;
+        if (config_.align_center) {
+            stride = (hi - lo) / cells;
+            offset = stride / 2;
+        } else {
+            stride = cells > 1 ? (hi - lo) / (cells - 1) : 0.0f;
+            offset = 0.0f;
+        }
+        std::vector<float> &centers = axis == 0 ? xs_ : ys_;
+        centers.resize(std::max(cells, 0));
+        for (int i = 0; i < cells; i++) {
+            centers[i] = lo + offset + i * stride;
+        }
+    }
+    for (int c = 0; c < num_classes_; c++) {
+        const AnchorClass &ac = config_.classes[c];
+        for (float rot : config_.rotations) {
+            Anchor a;
+            a.l = ac.size[0];
+            a.w = ac.size[1];
+            a.h = ac.size[2];
+            a.z = ac.bottom_z + ac.size[2] / 2;
+            a.rot = rot;
+            a.diagonal = sqrtf(a.l * a.l + a.w * a.w);
+            a.id = c;
+            anchors_.push_back(a);
+        }
+    }
+
+    // sigmoid(logit) >= score_thresh  <=>  logit >= logit(score_thresh)
+    float t = config_.score_thresh;
+    if (t <= 0.0f) {
+        logit_thresh_ = -INFINITY;
+    } else if (t >= 1.0f) {
+        logit_thresh_ = INFINITY;
+    } else {
+        logit_thresh_ = logf(t / (1.0f - t));
+    }
+}
+
+void BoxDecoder::decodeRows(const float *cls, const float *box, const float *dir,
+                            int row_begin, int row_end, std::vector<Bndbox> &out) const
+{
+    const int num_anchors = anchors_.size();
+    const int num_classes = num_classes_;
+    const int num_bins = config_.num_dir_bins;
+    const int cls_channels = num_anchors * num_classes;
+    const float thresh = logit_thresh_;
+    const float period = 2.0f * (float)M_PI / num_bins;
+    const float dir_offset = config_.dir_offset;
+    const float dir_limit_offset = config_.dir_limit_offset;
+
+    for (int y = row_begin; y < row_end; y++) {
+        for (int x = 0; x < config_.grid_x; x++) {
+            size_t cell = (size_t)y * config_.grid_x + x;
+            const float *c = cls + cell * cls_channels;
+            // almost every cell is background: test all its logits without
+            // branching and only look at anchors of cells with a hit
+            int hit = 0;
+            for (int k = 0; k < cls_channels; k++) {
+                hit |= c[k] >= thresh;
+            }
+            if (!hit) {
+                continue;
+            }
+            for (int a = 0; a < num_anchors; a++) {
+                const float *ca = c + a * num_classes;
+                int label = 0;
+                float best = ca[0];
+                for (int k = 1; k < num_classes; k++) {
+                    if (ca[k] > best) {
+                        best = ca[k];
+                        label = k;
+                    }
+                }
+                if (!(best >= thresh)) {
+                    continue;
+                }
+                const Anchor &an = anchors_[a];
+                size_t index = cell * num_anchors + a;
+                const float *b = box + index * 7;
+                const float *d = dir + index * num_bins;
+                int dir_label = 0;
+                for (int k = 1; k < num_bins; k++) {
+                    if (d[k] > d[dir_label]) {
+                        dir_label = k;
+                    }
+                }
+                float rot = b[6] + an.rot - dir_offset;
+                rot -= floorf(rot / period + dir_limit_offset) * period;
+                rot += dir_offset + period * dir_label;
+                out.emplace_back(
+                    b[0] * an.diagonal + xs_[x],
+                    b[1] * an.diagonal + ys_[y],
+                    b[2] * an.h + an.z,
+                    expf(b[3]) * an.l,
+                    expf(b[4]) * an.w,
+                    expf(b[5]) * an.h,
+                    rot,
+                    label,
+                    1.0f / (1.0f + expf(-best)));
+            }
+        }
+    }
+}
+
+BoxDecoderScratch::~BoxDecoderScratch()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    start_cv_.notify_all();
+    for (std::thread &helper : helpers_) {
+        helper.join();
+    }
+}
+
+// Helper t waits for a call after the one numbered seen, decodes its row
+// range if the call uses that many threads, and reports back.
+void BoxDecoderScratch::helperLoop(int t, unsigned long long seen)
+{
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            start_cv_.wait(lock, [&] { return stop_ || generation_ != seen; });
+            if (stop_) {
+                return;
+            }
+            seen = generation_;
+        }
+        if (t < num_threads_) {
+            decoder_->decodePart(*this, t);
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            pending_--;
+        }
+        done_cv_.notify_one();
+    }
+}
+
+void BoxDecoder::decodePart(BoxDecoderScratch &scratch, int t) const
+{
+    const int rows = config_.grid_y;
+    const int chunk = (rows + scratch.num_threads_ - 1) / scratch.num_threads_;
+    int begin = std::min(rows, t * chunk), end = std::min(rows, (t + 1) * chunk);
+    scratch.parts[t].clear();
+    decodeRows(scratch.cls_, scratch.box_, scratch.dir_, begin, end, scratch.parts[t]);
+}
+
+int BoxDecoder::decode(const float *cls, const float *box, const float *dir,
+                       std::vector<Bndbox> &boxes, BoxDecoderScratch &scratch, int top_k) const
+{
+    const int num_threads = config_.num_threads;
+    scratch.parts.resize(num_threads);
+    scratch.decoder_ = this;
+    scratch.cls_ = cls;
+    scratch.box_ = box;
+    scratch.dir_ = dir;
+    scratch.num_threads_ = num_threads;
+    const bool helped = num_threads > 1;
+    if (helped) {
+        while ((int)scratch.helpers_.size() < num_threads - 1) {
+            scratch.helpers_.emplace_back(&BoxDecoderScratch::helperLoop, &scratch,
+                                          (int)scratch.helpers_.size() + 1, scratch.generation_);
+        }
+        {
+            std::lock_guard<std::mutex> lock(scratch.mutex_);
+            scratch.pending_ = scratch.helpers_.size();
+            scratch.generation_++;
+        }
+        scratch.start_cv_.notify_all();
+    }
+    decodePart(scratch, 0);
+    if (helped) {
+        std::unique_lock<std::mutex> lock(scratch.mutex_);
+        scratch.done_cv_.wait(lock, [&] { return scratch.pending_ == 0; });
+    }
+
+    // parts are in row order, so the output does not depend on the thread count
+    size_t first = boxes.size();
+    for (const std::vector<Bndbox> &part : scratch.parts) {
+        boxes.insert(boxes.end(), part.begin(), part.end());
+    }
+    if (top_k > 0 && boxes.size() - first > (size_t)top_k) {
+        std::nth_element(boxes.begin() + first, boxes.begin() + first + top_k, boxes.end(),
+                         [](const Bndbox &a, const Bndbox &b) { return a.score > b.score; });
+        boxes.resize(first + top_k);
+    }
+    return boxes.size() - first;
+}
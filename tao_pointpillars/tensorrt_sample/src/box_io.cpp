@@ -0,0 +1,161 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <iostream>
+#include "box_io.h"
+
+int read_text_file(const std::string &path, std::string &buffer)
+{
+    buffer.clear();
+    FILE *fp = fopen(path.c_str(), "rb");
+    if (!fp) {
+        std::cerr << "Can't open " << path << std::endl;
+        return -1;
+    }
+    char chunk[65536];
+    size_t got;
+    while ((got = fread(chunk, 1, sizeof(chunk), fp)) > 0) {
+        buffer.append(chunk, got);
+    }
+    fclose(fp);
+    return 0;
+}
+
+int load_box_pred(const std::string &path, std::vector<Bndbox> &boxes, std::vector<int> &track_ids,
+                  std::string &buffer)
+{
+    boxes.clear();
+    track_ids.clear();
+    if (read_text_file(path, buffer) != 0) {
+        return -1;
+    }
+    return parse_box_pred(buffer, path, boxes, track_ids);
+}
+
+int parse_box_pred(const std::string &text, const std::string &path, std::vector<Bndbox> &boxes,
+                   std::vector<int> &track_ids)
+{
+    boxes.clear();
+    track_ids.clear();
+    // strtof stops at the end of the string, so the parse never leaves text
+    const char *p = text.c_str();
+    const char *end = p + text.size();
+    int line = 1;
+    while (p < end) {
+        float v[12];
+        int n = 0;
+        while (p < end && *p != '\n') {
+            if (*p == ' ' || *p == '\t' || *p == '\r') {
+                p++;
+                continue;
+            }
+            char *next;
+            float value = strtof(p, &next);
+            if (next == p || n == 12) {
+                std::cerr << "Bad detection line " << line << " in " << path << std::endl;
+                return -1;
+            }
+            v[n++] = value;
+            p = next;
+        }
+        if (n != 0 && n != 9 && n != 12) {
+            std::cerr << "Bad detection line " << line << " in " << path << std::endl;
+            return -1;
+        }
+        if (n != 0) {
+            boxes.push_back(bndbox_from_row(v));
+            track_ids.push_back(n == 12 ? (int)v[9] : -1);
+        }
+        p++;
+        line++;
+    }
+    return 0;
+}
+
+int save_box_pred(const std::vector<Bndbox> &boxes, const std::string &path)
+{
+    FILE *fp = fopen(path.c_str(), "w");
+    if (!fp) {
+        std::cerr << "Output file cannot be opened: " << path << std::endl;
+        return -1;
+    }
+    // same text as SaveBoxPred's default stream formatting
+    for (const auto &box : boxes) {
+        fprintf(fp, "%g %g %g %g %g %g %g %d %g \n", box.x, box.y, box.z, box.w, box.l, box.h,
+                box.rt, box.id, box.score);
+    }
+    return fclose(fp) == 0 ? 0 : -1;
+}
+
+static const char kRawMagic[8] = {'P', 'P', 'B', 'O', 'X', 'E', 'S', '1'};
+
+int save_box_raw(const std::vector<Bndbox> &boxes, const std::string &path)
+{
+    FILE *fp = fopen(path.c_str(), "wb");
+    if (!fp) {
+        std::cerr << "Output file cannot be opened: " << path << std::endl;
+        return -1;
+    }
+    uint32_t count = boxes.size();
+    bool ok = fwrite(kRawMagic, sizeof(kRawMagic), 1, fp) == 1 && fwrite(&count, sizeof(count), 1, fp) == 1;
+    for (size_t i = 0; ok && i < boxes.size(); i++) {
+        const Bndbox &b = boxes[i];
+        float row[9] = {b.x, b.y, b.z, b.w, b.l, b.h, b.rt, (float)b.id, b.score};
+        ok = fwrite(row, sizeof(row), 1, fp) == 1;
+    }
+    if (fclose(fp) != 0 || !ok) {
+        std::cerr << "Can't write " << path << std::endl;
+        return -1;
+    }
+    return 0;
+}
+
+int load_box_raw(const std::string &path, std::vector<Bndbox> &boxes)
+{
+    boxes.clear();
+    FILE *fp = fopen(path.c_str(), "rb");
+    if (!fp) {
+        std::cerr << "Can't open " << path << std::endl;
+        return -1;
+    }
+    char magic[8];
+    uint32_t count = 0;
+    if (fread(magic, sizeof(magic), 1, fp) != 1 || memcmp(magic, kRawMagic, sizeof(magic)) != 0 ||
+        fread(&count, sizeof(count), 1, fp) != 1) {
+        std::cerr << "Not a raw box file: " << path << std::endl;
+        fclose(fp);
+        return -1;
+    }
+    boxes.reserve(count);
+    for (uint32_t i = 0; i < count; i++) {
+        float row[9];
+        if (fread(row, sizeof(row), 1, fp) != 1) {
+            std::cerr << "Truncated raw box file: " << path << std::endl;
+            fclose(fp);
+            return -1;
+        }
+        boxes.push_back(bndbox_from_row(row));
+    }
+    fclose(fp);
+    return 0;
+}
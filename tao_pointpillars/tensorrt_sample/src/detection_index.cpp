@@ -0,0 +1,477 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <iostream>
+#include "detection_index.h"
+
+namespace {
+
+const char kIndexMagic[8] = {'P', 'P', 'D', 'I', 'D', 'X', '1', '\0'};
+
+enum Section {
+    kFrameTimes,
+    kNameOffsets,
+    kNames,
+    kCells,
+    kColumnX,               // 8 float columns: x y z w l h rt score
+    kColumnFrame = kColumnX + 8,
+    kColumnTrack,
+    kColumnClass,
+    kNumSections
+};
+
+inline size_t align8(size_t v)
+{
+    return (v + 7) & ~(size_t)7;
+}
+
+inline int32_t cell_of(double v, float cell)
+{
+    double c = floor(v / cell);
+    c = std::max(c, (double)INT32_MIN);
+    c = std::min(c, (double)INT32_MAX);
+    return (int32_t)c;
+}
+
+} // namespace
+
+struct DetectionIndexHeader {
+    char magic[8];
+    uint32_t num_frames;
+    uint32_t names_bytes;
+    uint64_t num_records;
+    uint64_t num_cells;
+    double t0;              // start of bucket 0
+    double bucket_seconds;
+    float cell_size;
+    uint32_t reserved;
+    uint64_t offsets[kNumSections];
+};
+
+struct DetectionIndexCell {
+    uint32_t bucket;
+    int32_t cx;
+    int32_t cy;
+    uint16_t cls;
+    uint16_t reserved;
+    uint32_t begin;         // first record
+    uint32_t count;
+    float max_score;
+};
+
+namespace {
+
+inline bool cell_less(const DetectionIndexCell &c, uint32_t bucket, int32_t cx, int32_t cy)
+{
+    if (c.bucket != bucket) return c.bucket < bucket;
+    if (c.cx != cx) return c.cx < cx;
+    return c.cy < cy;
+}
+
+} // namespace
+
+DetectionIndexWriter::DetectionIndexWriter(double bucket_seconds, float cell_size)
+    : bucket_seconds_(bucket_seconds > 0 ? bucket_seconds : 1.0),
+      cell_size_(cell_size > 0 ? cell_size : 1.0f)
+{
+}
+
+int DetectionIndexWriter::addFrame(const std::string &name, double timestamp,
+                                   const std::vector<Bndbox> &boxes, const int *track_ids,
+                                   const float *pose)
+{
+    float yaw = pose ? atan2f(pose[4], pose[0]) : 0.0f;
+    uint32_t frame = times_.size();
+    for (size_t i = 0; i < boxes.size(); i++) {
+        const Bndbox &b = boxes[i];
+        if (b.id < 0 || b.id > 63) {
+            std::cerr << "Class id " << b.id << " out of range in " << name << std::endl;
+            return -1;
+        }
+        Record r;
+        r.values[0] = b.x;
+        r.values[1] = b.y;
+        r.values[2] = b.z;
+        if (pose) {
+            r.values[0] = pose[0] * b.x + pose[1] * b.y + pose[2] * b.z + pose[3];
+            r.values[1] = pose[4] * b.x + pose[5] * b.y + pose[6] * b.z + pose[7];
+            r.values[2] = pose[8] * b.x + pose[9] * b.y + pose[10] * b.z + pose[11];
+        }
+        r.values[3] = b.w;
+        r.values[4] = b.l;
+        r.values[5] = b.h;
+        r.values[6] = b.rt + yaw;
+        r.values[7] = b.score;
+        r.track = track_ids ? track_ids[i] : -1;
+        r.frame = frame;
+        r.cls = b.id;
+        records_.push_back(r);
+    }
+    times_.push_back(timestamp);
+    names_.push_back(name);
+    return 0;
+}
+
+int DetectionIndexWriter::write(const std::string &path) const
+{
+    if (records_.size() > UINT32_MAX) {
+        std::cerr << "Too many records for one index: " << records_.size() << std::endl;
+        return -1;
+    }
+    DetectionIndexHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, kIndexMagic, sizeof(kIndexMagic));
+    header.num_frames = times_.size();
+    header.num_records = records_.size();
+    header.bucket_seconds = bucket_seconds_;
+    header.cell_size = cell_size_;
+    header.t0 = times_.empty() ? 0.0 : *std::min_element(times_.begin(), times_.end());
+
+    // cell key of every record, then records ordered by cell and time
+    size_t n = records_.size();
+    std::vector<DetectionIndexCell> keys(n);
+    for (size_t i = 0; i < n; i++) {
+        const Record &r = records_[i];
+        DetectionIndexCell &k = keys[i];
+        k.bucket = (uint32_t)std::min(floor((times_[r.frame] - header.t0) / bucket_seconds_),
+                                      (double)UINT32_MAX);
+        k.cx = cell_of(r.values[0], cell_size_);
+        k.cy = cell_of(r.values[1], cell_size_);
+        k.cls = r.cls;
+    }
+    std::vector<uint32_t> order(n);
+    for (size_t i = 0; i < n; i++) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        const DetectionIndexCell &ka = keys[a], &kb = keys[b];
+        if (ka.bucket != kb.bucket) return ka.bucket < kb.bucket;
+        if (ka.cx != kb.cx) return ka.cx < kb.cx;
+        if (ka.cy != kb.cy) return ka.cy < kb.cy;
+        if (ka.cls != kb.cls) return ka.cls < kb.cls;
+        double ta = times_[records_[a].frame], tb = times_[records_[b].frame];
+        if (ta != tb) return ta < tb;
+        return a < b;
+    });
+
+    std::vector<DetectionIndexCell> cells;
+    for (size_t i = 0; i < n; i++) {
+        const DetectionIndexCell &k = keys[order[i]];
+        float score = records_[order[i]].values[7];
+        if (cells.empty() || cells.back().bucket != k.bucket || cells.back().cx != k.cx ||
+            cells.back().cy != k.cy || cells.back().cls != k.cls) {
+            DetectionIndexCell c = k;
+            c.reserved = 0;
+            c.begin = i;
+            c.count = 0;
+            c.max_score = score;
+            cells.push_back(c);
+        }
+        cells.back().count++;
+        cells.back().max_score = std::max(cells.back().max_score, score);
+    }
+    header.num_cells = cells.size();
+
+    std::vector<uint32_t> name_offsets(times_.size());
+    std::string names;
+    for (size_t f = 0; f < names_.size(); f++) {
+        name_offsets[f] = names.size();
+        names.append(names_[f].c_str(), names_[f].size() + 1);
+    }
+    header.names_bytes = names.size();
+
+    size_t sizes[kNumSections];
+    sizes[kFrameTimes] = times_.size() * sizeof(double);
+    sizes[kNameOffsets] = name_offsets.size() * sizeof(uint32_t);
+    sizes[kNames] = names.size();
+    sizes[kCells] = cells.size() * sizeof(DetectionIndexCell);
+    for (int c = 0; c < 8; c++) {
+        sizes[kColumnX + c] = n * sizeof(float);
+    }
+    sizes[kColumnFrame] = n * sizeof(uint32_t);
+    sizes[kColumnTrack] = n * sizeof(int32_t);
+    sizes[kColumnClass] = n * sizeof(uint16_t);
+    size_t offset = align8(sizeof(header));
+    for (int s = 0; s < kNumSections; s++) {
+        header.offsets[s] = offset;
+        offset = align8(offset + sizes[s]);
+    }
+
+    FILE *fp = fopen(path.c_str(), "wb");
+    if (!fp) {
+        std::cerr << "Can't create index " << path << ": " << strerror(errno) << std::endl;
+        return -1;
+    }
+    std::vector<char> column(n * sizeof(float));
+    bool ok = true;
+    auto put = [&](int section, const void *data) {
+        static const char zeros[8] = {0};
+        size_t pos = ftell(fp);
+        ok = ok && fwrite(zeros, 1, header.offsets[section] - pos, fp) == header.offsets[section] - pos;
+        ok = ok && (sizes[section] == 0 || fwrite(data, 1, sizes[section], fp) == sizes[section]);
+    };
+    ok = fwrite(&header, sizeof(header), 1, fp) == 1;
+    put(kFrameTimes, times_.data());
+    put(kNameOffsets, name_offsets.data());
+    put(kNames, names.data());
+    put(kCells, cells.data());
+    for (int c = 0; c < 8; c++) {
+        float *dst = (float *)column.data();
+        for (size_t i = 0; i < n; i++) {
+            dst[i] = records_[order[i]].values[c];
+        }
+        put(kColumnX + c, dst);
+    }
+    uint32_t *frames = (uint32_t *)column.data();
+    for (size_t i = 0; i < n; i++) {
+        frames[i] = records_[order[i]].frame;
+    }
+    put(kColumnFrame, frames);
+    int32_t *tracks = (int32_t *)column.data();
+    for (size_t i = 0; i < n; i++) {
+        tracks[i] = records_[order[i]].track;
+    }
+    put(kColumnTrack, tracks);
+    uint16_t *classes = (uint16_t *)column.data();
+    for (size_t i = 0; i < n; i++) {
+        classes[i] = records_[order[i]].cls;
+    }
+    put(kColumnClass, classes);
+    ok = fclose(fp) == 0 && ok;
+    if (!ok) {
+        std::cerr << "Can't write index " << path << std::endl;
+        return -1;
+    }
+    return 0;
+}
+
+DetectionIndex::DetectionIndex(const std::string &path)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Can't open index " << path << ": " << strerror(errno) << std::endl;
+        return;
+    }
+    struct stat st;
+    void *mem = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(DetectionIndexHeader)) {
+        bytes_ = st.st_size;
+        mem = mmap(nullptr, bytes_, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (mem == MAP_FAILED) {
+        std::cerr << "Not a detection index: " << path << std::endl;
+        return;
+    }
+    const DetectionIndexHeader *h = (const DetectionIndexHeader *)mem;
+    uint64_t n = h->num_records;
+    bool valid = memcmp(h->magic, kIndexMagic, sizeof(kIndexMagic)) == 0 && n <= UINT32_MAX;
+    uint64_t sizes[kNumSections];
+    sizes[kFrameTimes] = (uint64_t)h->num_frames * sizeof(double);
+    sizes[kNameOffsets] = (uint64_t)h->num_frames * sizeof(uint32_t);
+    sizes[kNames] = h->names_bytes;
+    sizes[kCells] = h->num_cells * sizeof(DetectionIndexCell);
+    for (int c = 0; c < 8; c++) {
+        sizes[kColumnX + c] = n * sizeof(float);
+    }
+    sizes[kColumnFrame] = n * sizeof(uint32_t);
+    sizes[kColumnTrack] = n * sizeof(int32_t);
+    sizes[kColumnClass] = n * sizeof(uint16_t);
+    for (int s = 0; valid && s < kNumSections; s++) {
+        valid = h->offsets[s] % 8 == 0 && h->offsets[s] <= bytes_ && sizes[s] <= bytes_ - h->offsets[s];
+    }
+    valid = valid && (h->names_bytes == 0 || ((const char *)mem)[h->offsets[kNames] + h->names_bytes - 1] == 0);
+    if (!valid) {
+        std::cerr << "Not a detection index: " << path << std::endl;
+        munmap(mem, bytes_);
+        return;
+    }
+    const char *base = (const char *)mem;
+    mem_ = mem;
+    header_ = h;
+    frame_times_ = (const double *)(base + h->offsets[kFrameTimes]);
+    name_offsets_ = (const uint32_t *)(base + h->offsets[kNameOffsets]);
+    names_ = base + h->offsets[kNames];
+    cells_ = (const DetectionIndexCell *)(base + h->offsets[kCells]);
+    for (int c = 0; c < 8; c++) {
+        columns_[c] = (const float *)(base + h->offsets[kColumnX + c]);
+    }
+    frames_ = (const uint32_t *)(base + h->offsets[kColumnFrame]);
+    tracks_ = (const int32_t *)(base + h->offsets[kColumnTrack]);
+    classes_ = (const uint16_t *)(base + h->offsets[kColumnClass]);
+}
+
+DetectionIndex::~DetectionIndex(void)
+{
+    if (mem_) {
+        munmap(mem_, bytes_);
+    }
+}
+
+size_t DetectionIndex::numRecords() const
+{
+    return header_->num_records;
+}
+
+size_t DetectionIndex::numFrames() const
+{
+    return header_->num_frames;
+}
+
+size_t DetectionIndex::numCells() const
+{
+    return header_->num_cells;
+}
+
+double DetectionIndex::bucketSeconds() const
+{
+    return header_->bucket_seconds;
+}
+
+float DetectionIndex::cellSize() const
+{
+    return header_->cell_size;
+}
+
+Bndbox DetectionIndex::box(uint32_t record) const
+{
+    return Bndbox(columns_[0][record], columns_[1][record], columns_[2][record],
+                  columns_[4][record], columns_[3][record], columns_[5][record],
+                  columns_[6][record], classes_[record], columns_[7][record]);
+}
+
+void DetectionIndex::scanCell(const DetectionIndexCell &cell, const DetectionQuery &query,
+                              std::vector<uint32_t> &records, DetectionQueryStats &stats) const
+{
+    const float *xs = columns_[0];
+    const float *ys = columns_[1];
+    const float *scores = columns_[7];
+    float r2 = query.radius * query.radius;
+    uint32_t end = cell.begin + cell.count;
+    stats.cells++;
+    for (uint32_t r = cell.begin; r < end; r++) {
+        stats.scanned++;
+        double t = frame_times_[frames_[r]];
+        if (t < query.t_begin) {
+            continue;
+        }
+        if (t > query.t_end) {
+            break;  // records of a cell are in time order
+        }
+        if (scores[r] < query.min_score) {
+            continue;
+        }
+        if (query.region == DetectionQuery::kCircle) {
+            float dx = xs[r] - query.x, dy = ys[r] - query.y;
+            if (dx * dx + dy * dy > r2) {
+                continue;
+            }
+        } else if (query.region == DetectionQuery::kBox) {
+            if (xs[r] < query.box[0] || ys[r] < query.box[1] || xs[r] > query.box[2] || ys[r] > query.box[3]) {
+                continue;
+            }
+        }
+        records.push_back(r);
+    }
+}
+
+size_t DetectionIndex::query(const DetectionQuery &query, std::vector<uint32_t> &records,
+                             DetectionQueryStats *stats) const
+{
+    DetectionQueryStats local;
+    size_t first = records.size();
+    const DetectionIndexCell *cells_end = cells_ + header_->num_cells;
+    double bs = header_->bucket_seconds;
+    float cell = header_->cell_size;
+    if (query.t_end < header_->t0 || query.t_end < query.t_begin || header_->num_cells == 0) {
+        if (stats) *stats = local;
+        return 0;
+    }
+    uint32_t b_lo = query.t_begin <= header_->t0 ? 0 :
+                    (uint32_t)std::min(floor((query.t_begin - header_->t0) / bs), (double)UINT32_MAX);
+    uint32_t b_hi = (uint32_t)std::min(floor((query.t_end - header_->t0) / bs), (double)UINT32_MAX);
+
+    // BEV extent of the region in meters and grid cells
+    float x_min = query.box[0], y_min = query.box[1], x_max = query.box[2], y_max = query.box[3];
+    if (query.region == DetectionQuery::kCircle) {
+        x_min = query.x - query.radius;
+        y_min = query.y - query.radius;
+        x_max = query.x + query.radius;
+        y_max = query.y + query.radius;
+    }
+    int32_t cx_lo = cell_of(x_min, cell), cx_hi = cell_of(x_max, cell);
+    int32_t cy_lo = cell_of(y_min, cell), cy_hi = cell_of(y_max, cell);
+    auto visit = [&](const DetectionIndexCell &c) {
+        if (!(query.class_mask >> c.cls & 1) || c.max_score < query.min_score) {
+            return;
+        }
+        if (query.region == DetectionQuery::kCircle) {
+            // distance from the center to the cell rectangle
+            float dx = std::max(std::max(c.cx * cell - query.x, query.x - (c.cx + 1) * cell), 0.0f);
+            float dy = std::max(std::max(c.cy * cell - query.y, query.y - (c.cy + 1) * cell), 0.0f);
+            if (dx * dx + dy * dy > query.radius * query.radius) {
+                return;
+            }
+        }
+        scanCell(c, query, records, local);
+    };
+
+    const DetectionIndexCell *it = std::lower_bound(cells_, cells_end, b_lo,
+        [](const DetectionIndexCell &c, uint32_t b) { return c.bucket < b; });
+    while (it != cells_end && it->bucket <= b_hi) {
+        uint32_t bucket = it->bucket;
+        const DetectionIndexCell *bucket_end = std::upper_bound(it, cells_end, bucket,
+            [](uint32_t b, const DetectionIndexCell &c) { return b < c.bucket; });
+        local.buckets++;
+        uint64_t columns = (uint64_t)((int64_t)cx_hi - cx_lo + 1);
+        if (query.region == DetectionQuery::kAll) {
+            for (const DetectionIndexCell *c = it; c != bucket_end; c++) {
+                visit(*c);
+            }
+        } else if (columns * 16 >= (uint64_t)(bucket_end - it)) {
+            // region wider than the bucket is sparse: filter its cells
+            for (const DetectionIndexCell *c = it; c != bucket_end; c++) {
+                if (c->cx >= cx_lo && c->cx <= cx_hi && c->cy >= cy_lo && c->cy <= cy_hi) {
+                    visit(*c);
+                }
+            }
+        } else {
+            // one binary search per grid column of the region
+            for (int64_t cx = cx_lo; cx <= cx_hi; cx++) {
+                const DetectionIndexCell *c = std::lower_bound(it, bucket_end, (int32_t)cx,
+                    [&](const DetectionIndexCell &a, int32_t x) { return cell_less(a, bucket, x, cy_lo); });
+                for (; c != bucket_end && c->cx == cx && c->cy <= cy_hi; c++) {
+                    visit(*c);
+                }
+            }
+        }
+        it = bucket_end;
+    }
+    local.hits = records.size() - first;
+    if (stats) *stats = local;
+    return local.hits;
+}
@@ -0,0 +1,385 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <thread>
+#include "detection_server.h"
+
+static_assert(sizeof(Bndbox) == 9 * sizeof(float), "boxes are sent as raw Bndbox records");
+
+namespace {
+
+const uint32_t kMaxNameLen = 4096;
+
+typedef std::chrono::steady_clock Clock;
+
+bool read_full(int fd, void *data, size_t size)
+{
+    char *p = (char *)data;
+    while (size) {
+        ssize_t n = recv(fd, p, size, 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        size -= n;
+    }
+    return true;
+}
+
+bool write_full(int fd, const void *data, size_t size)
+{
+    const char *p = (const char *)data;
+    while (size) {
+        ssize_t n = send(fd, p, size, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        size -= n;
+    }
+    return true;
+}
+
+bool make_address(const std::string &path, sockaddr_un *addr)
+{
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr->sun_path)) {
+        std::cerr << "Socket path too long: " << path << std::endl;
+        return false;
+    }
+    memcpy(addr->sun_path, path.c_str(), path.size());
+    return true;
+}
+
+float elapsed_ms(Clock::time_point from, Clock::time_point to)
+{
+    return std::chrono::duration<float, std::milli>(to - from).count();
+}
+
+} // namespace
+
+struct DetectionServer::Job {
+    ServeRequest request;
+    std::string name;
+    Clock::time_point enqueued;
+    ServeReply reply;
+    std::vector<Bndbox> boxes;
+    bool done = false;
+
+    bool sameInput(const Job &other) const
+    {
+        return request.source == other.request.source && name == other.name &&
+               (request.source == kServeFile || request.seq == other.request.seq);
+    }
+};
+
+DetectionServer::DetectionServer(Detector &detector, const std::string &socket_path)
+    : detector_(detector), socket_path_(socket_path)
+{
+    sockaddr_un addr;
+    if (!make_address(socket_path, &addr)) {
+        return;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        std::cerr << "Can't create socket: " << strerror(errno) << std::endl;
+        return;
+    }
+    unlink(socket_path.c_str());
+    if (bind(fd, (sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, 64) != 0) {
+        std::cerr << "Can't listen on " << socket_path << ": " << strerror(errno) << std::endl;
+        close(fd);
+        return;
+    }
+    listen_fd_ = fd;
+    points_.resize((size_t)detector_.maxPoints() * detector_.pointSize());
+}
+
+DetectionServer::~DetectionServer(void)
+{
+    if (listen_fd_ >= 0) {
+        close(listen_fd_);
+        unlink(socket_path_.c_str());
+    }
+}
+
+int DetectionServer::run()
+{
+    if (listen_fd_ < 0) {
+        return -1;
+    }
+    std::thread inference(&DetectionServer::worker, this);
+    while (!stop_) {
+        pollfd pfd = {listen_fd_, POLLIN, 0};
+        if (poll(&pfd, 1, 200) <= 0) {
+            continue;
+        }
+        int fd = accept(listen_fd_, nullptr, nullptr);
+        if (fd < 0) {
+            continue;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        client_fds_.push_back(fd);
+        active_clients_++;
+        std::thread(&DetectionServer::serveClient, this, fd).detach();
+    }
+
+    // wake up the clients blocked in recv and wait for them to leave
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (int fd : client_fds_) {
+        shutdown(fd, SHUT_RDWR);
+    }
+    queue_cv_.notify_all();
+    done_cv_.wait(lock, [this] { return active_clients_ == 0; });
+    lock.unlock();
+    inference.join();
+    return 0;
+}
+
+void DetectionServer::serveClient(int fd)
+{
+    Job job;
+    while (!stop_) {
+        if (!read_full(fd, &job.request, sizeof(job.request))) {
+            break;
+        }
+        memset(&job.reply, 0, sizeof(job.reply));
+        memcpy(job.reply.magic, "PPRP", 4);
+        job.reply.id = job.request.id;
+        job.boxes.clear();
+        uint32_t name_len = job.request.name_len;
+        if (memcmp(job.request.magic, "PPRQ", 4) != 0 || name_len > kMaxNameLen ||
+            (job.request.source != kServeFile && job.request.source != kServeRing)) {
+            job.reply.status = kServeBadRequest;
+            write_full(fd, &job.reply, sizeof(job.reply));
+            break;
+        }
+        job.name.resize(name_len);
+        if (name_len && !read_full(fd, &job.name[0], name_len)) {
+            break;
+        }
+        // the framing is intact, so a bad NMS setting only fails this request
+        if (job.request.pre_nms_top_n <= 0 || !std::isfinite(job.request.nms_iou_thresh)) {
+            job.reply.status = kServeBadRequest;
+            if (!write_full(fd, &job.reply, sizeof(job.reply))) {
+                break;
+            }
+            continue;
+        }
+
+        job.enqueued = Clock::now();
+        job.done = false;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (stop_) {
+                break;
+            }
+            queue_.push_back(&job);
+            requests_++;
+            queue_cv_.notify_one();
+            done_cv_.wait(lock, [&job] { return job.done; });
+        }
+        job.reply.num_boxes = job.boxes.size();
+        if (!write_full(fd, &job.reply, sizeof(job.reply)) ||
+            !write_full(fd, job.boxes.data(), job.boxes.size() * sizeof(Bndbox))) {
+            break;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    close(fd);
+    client_fds_.erase(std::find(client_fds_.begin(), client_fds_.end(), fd));
+    active_clients_--;
+    done_cv_.notify_all();
+}
+
+void DetectionServer::worker()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    std::vector<Job *> group;
+    while (true) {
+        queue_cv_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+        if (stop_) {
+            break;
+        }
+        // take the oldest request and every queued one for the same input
+        group.assign(1, queue_.front());
+        queue_.pop_front();
+        for (auto it = queue_.begin(); it != queue_.end();) {
+            if ((*it)->sameInput(*group[0])) {
+                group.push_back(*it);
+                it = queue_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        lock.unlock();
+        process(group);
+        lock.lock();
+        for (Job *job : group) {
+            job->done = true;
+        }
+        done_cv_.notify_all();
+    }
+    for (Job *job : queue_) {
+        job->reply.status = kServeShutdown;
+        job->done = true;
+    }
+    queue_.clear();
+    done_cv_.notify_all();
+}
+
+PointRingReader *DetectionServer::ring(const std::string &name)
+{
+    std::unique_ptr<PointRingReader> &reader = rings_[name];
+    // the producer may have restarted with a new ring under the same name
+    if (!reader || !reader->isOpen() || reader->closed(UINT64_MAX)) {
+        reader.reset(new PointRingReader(name));
+    }
+    if (!reader->isOpen() || reader->pointSize() != detector_.pointSize()) {
+        return nullptr;
+    }
+    return reader.get();
+}
+
+void DetectionServer::process(std::vector<Job *> &group)
+{
+    Clock::time_point start = Clock::now();
+    const Job &first = *group[0];
+    const float *points = points_.data();
+    unsigned int num_points = 0;
+    int32_t status = kServeOk;
+    PointRingReader *reader = nullptr;
+    PointRingFrame frame;
+
+    if (first.request.source == kServeFile) {
+        if (loader_.load(first.name, points_.data(), detector_.maxPoints(), detector_.pointSize(), &num_points) != 0) {
+            status = kServeLoadFailed;
+        }
+    } else {
+        reader = ring(first.name);
+        if (!reader) {
+            status = kServeLoadFailed;
+        } else if (reader->frame(first.request.seq, &frame) != 0) {
+            status = kServeFrameGone;
+        } else {
+            // inferred in place from the ring slot
+            points = frame.points;
+            num_points = std::min(frame.num_points, detector_.maxPoints());
+        }
+    }
+
+    raw_.clear();
+    if (status == kServeOk) {
+        detector_.infer(points, num_points, raw_);
+        inferences_++;
+        if (reader && !reader->release(frame)) {
+            status = kServeFrameGone;
+        }
+    }
+
+    // NMS once per distinct parameter set
+    for (size_t i = 0; i < group.size(); i++) {
+        Job &job = *group[i];
+        job.reply.status = status;
+        job.reply.seq = frame.seq;
+        job.reply.coalesced = group.size();
+        job.reply.queue_ms = elapsed_ms(job.enqueued, start);
+        if (status != kServeOk) {
+            continue;
+        }
+        size_t same = 0;
+        while (same < i && (group[same]->request.nms_iou_thresh != job.request.nms_iou_thresh ||
+                            group[same]->request.pre_nms_top_n != job.request.pre_nms_top_n)) {
+            same++;
+        }
+        if (same < i) {
+            job.boxes = group[same]->boxes;
+        } else {
+            nms_cpu(raw_, job.request.nms_iou_thresh, job.boxes, job.request.pre_nms_top_n);
+        }
+    }
+    Clock::time_point end = Clock::now();
+    for (Job *job : group) {
+        job->reply.infer_ms = elapsed_ms(start, end);
+    }
+}
+
+DetectionClient::DetectionClient(const std::string &socket_path)
+{
+    sockaddr_un addr;
+    if (!make_address(socket_path, &addr)) {
+        return;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (sockaddr *)&addr, sizeof(addr)) != 0) {
+        std::cerr << "Can't connect to " << socket_path << ": " << strerror(errno) << std::endl;
+        if (fd >= 0) {
+            close(fd);
+        }
+        return;
+    }
+    fd_ = fd;
+}
+
+DetectionClient::~DetectionClient(void)
+{
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+}
+
+int DetectionClient::request(ServeSource source, const std::string &name, uint64_t seq, float nms_iou_thresh,
+                             int pre_nms_top_n, ServeReply *reply, std::vector<Bndbox> &boxes)
+{
+    ServeRequest request;
+    memset(&request, 0, sizeof(request));
+    memcpy(request.magic, "PPRQ", 4);
+    request.id = next_id_++;
+    request.source = source;
+    request.nms_iou_thresh = nms_iou_thresh;
+    request.pre_nms_top_n = pre_nms_top_n;
+    request.name_len = name.size();
+    request.seq = seq;
+    if (fd_ < 0 || !write_full(fd_, &request, sizeof(request)) || !write_full(fd_, name.data(), name.size()) ||
+        !read_full(fd_, reply, sizeof(*reply)) || memcmp(reply->magic, "PPRP", 4) != 0) {
+        return kServeShutdown;
+    }
+    boxes.resize(reply->num_boxes);
+    if (!read_full(fd_, boxes.data(), boxes.size() * sizeof(Bndbox))) {
+        return kServeShutdown;
+    }
+    return reply->status;
+}
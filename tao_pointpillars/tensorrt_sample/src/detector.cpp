@@ -0,0 +1,143 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <math.h>
+#include <stdint.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include "detector.h"
+
+namespace {
+
+inline size_t cell_hash(uint64_t key)
+{
+    key *= 0x9E3779B97F4A7C15ull;
+    return (size_t)(key ^ (key >> 32));
+}
+
+} // namespace
+
+StubDetector::StubDetector(unsigned int point_size, unsigned int max_points, float latency_ms,
+                           float latency_jitter_ms, float cell_size, unsigned int min_points)
+    : point_size_(point_size), max_points_(max_points), latency_ms_(latency_ms),
+      latency_jitter_ms_(latency_jitter_ms), rng_(12345), cell_size_(cell_size), min_points_(min_points)
+{
+}
+
+StubDetector::Cell &StubDetector::cell(uint64_t key)
+{
+    if ((used_.size() + 1) * 2 > cells_.size()) {
+        grow();
+    }
+    size_t mask = cells_.size() - 1;
+    for (size_t i = cell_hash(key) & mask;; i = (i + 1) & mask) {
+        Cell &c = cells_[i];
+        if (c.count == 0) {
+            c.key = key;
+            used_.push_back((uint32_t)i);
+            return c;
+        }
+        if (c.key == key) {
+            return c;
+        }
+    }
+}
+
+void StubDetector::grow()
+{
+    std::vector<Cell> old;
+    old.swap(cells_);
+    Cell empty;
+    empty.key = 0;
+    empty.count = 0;
+    for (int c = 0; c < 3; c++) {
+        empty.min[c] = INFINITY;
+        empty.max[c] = -INFINITY;
+    }
+    cells_.assign(std::max<size_t>(old.size() * 2, 4096), empty);
+    std::vector<uint32_t> used;
+    used.swap(used_);
+    used_.reserve(cells_.size() / 2);
+    for (uint32_t i : used) {
+        Cell &moved = cell(old[i].key);
+        moved = old[i];
+    }
+}
+
+int StubDetector::infer(const float *points, unsigned int num_points, std::vector<Bndbox> &boxes)
+{
+    float latency_ms = latency_ms_;
+    if (latency_jitter_ms_ > 0) {
+        std::normal_distribution<float> jitter(0.0f, latency_jitter_ms_);
+        latency_ms = std::max(0.0f, latency_ms + jitter(rng_));
+    }
+    auto deadline = std::chrono::steady_clock::now() +
+                    std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                        std::chrono::duration<float, std::milli>(latency_ms));
+    num_points = std::min(num_points, max_points_);
+    for (int grid = 0; grid < 2; grid++) {
+        float shift = grid * cell_size_ * 0.5f;
+        for (unsigned int i = 0; i < num_points; i++) {
+            const float *p = points + (size_t)i * point_size_;
+            int32_t cx = (int32_t)floorf((p[0] + shift) / cell_size_);
+            int32_t cy = (int32_t)floorf((p[1] + shift) / cell_size_);
+            Cell &c = cell((uint64_t)(uint32_t)cx << 32 | (uint32_t)cy);
+            c.count++;
+            for (int k = 0; k < 3; k++) {
+                c.min[k] = std::min(c.min[k], p[k]);
+                c.max[k] = std::max(c.max[k], p[k]);
+            }
+        }
+        for (uint32_t slot : used_) {
+            Cell &c = cells_[slot];
+            if (c.count >= min_points_) {
+                float score = std::min(1.0f, c.count / 200.0f);
+                boxes.push_back(Bndbox(
+                    0.5f * (c.min[0] + c.max[0]), 0.5f * (c.min[1] + c.max[1]),
+                    0.5f * (c.min[2] + c.max[2]),
+                    std::max(c.max[0] - c.min[0], 0.1f), std::max(c.max[1] - c.min[1], 0.1f),
+                    std::max(c.max[2] - c.min[2], 0.1f), 0.0f, 0, score));
+            }
+            // back to empty for the next pass
+            c.count = 0;
+            for (int k = 0; k < 3; k++) {
+                c.min[k] = INFINITY;
+                c.max[k] = -INFINITY;
+            }
+        }
+        used_.clear();
+    }
+    std::this_thread::sleep_until(deadline);
+    return 0;
+}
+
+DetectorPool::DetectorPool(std::vector<std::unique_ptr<Detector>> detectors)
+    : point_size_(detectors.empty() ? 0 : detectors[0]->pointSize()),
+      max_points_(detectors.empty() ? 0 : detectors[0]->maxPoints())
+{
+    for (auto &detector : detectors) {
+        pool_.add(std::move(detector));
+    }
+}
+
+int DetectorPool::infer(const float *points, unsigned int num_points, std::vector<Bndbox> &boxes)
+{
+    ContextPool<Detector>::Lease detector = pool_.acquire();
+    return detector->infer(points, num_points, boxes);
+}
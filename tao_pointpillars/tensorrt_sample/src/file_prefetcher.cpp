@@ -0,0 +1,535 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <new>
+#include <thread>
+#include "file_prefetcher.h"
+
+#if defined(__has_include)
+#if __has_include(<linux/io_uring.h>) && defined(__NR_io_uring_setup)
+#include <linux/io_uring.h>
+#define PREFETCH_HAVE_IO_URING 1
+#endif
+#endif
+
+PrefetchBackend parse_prefetch_backend(const char *name)
+{
+    std::string s(name);
+    if (s == "uring" || s == "io_uring") return PrefetchBackend::kIoUring;
+    if (s == "threads") return PrefetchBackend::kThreads;
+    if (s != "auto") {
+        std::cerr << "Unknown prefetch backend " << s << ", using auto" << std::endl;
+    }
+    return PrefetchBackend::kAuto;
+}
+
+const char *prefetch_backend_name(PrefetchBackend backend)
+{
+    switch (backend) {
+        case PrefetchBackend::kIoUring: return "io_uring";
+        case PrefetchBackend::kThreads: return "threads";
+        default: return "auto";
+    }
+}
+
+// Buffers, per-buffer read state and the in-order bookkeeping shared by
+// both backends. Only the consumer thread touches issued_ and free_.
+class PrefetchReader {
+  protected:
+    struct Request {
+        size_t index = 0;
+        int fd = -1;
+        size_t size = 0;        // bytes to read
+        size_t done = 0;
+        int error = 0;
+        bool ready = false;
+    };
+    std::vector<std::string> files_;
+    size_t buffer_bytes_;
+    std::vector<uint8_t *> buffers_;
+    std::vector<Request> requests_;
+    std::deque<unsigned int> issued_;
+    std::vector<unsigned int> free_;
+    size_t next_issue_ = 0;
+
+    // Opens the next file for buffer b. Returns false when the request is
+    // already complete (error or empty file).
+    bool open(unsigned int b)
+    {
+        Request &r = requests_[b];
+        r = Request();
+        r.index = next_issue_++;
+        issued_.push_back(b);
+        r.fd = ::open(files_[r.index].c_str(), O_RDONLY | O_CLOEXEC);
+        struct stat st;
+        if (r.fd < 0 || fstat(r.fd, &st) != 0) {
+            finish(r, errno);
+            return false;
+        }
+        r.size = std::min((size_t)st.st_size, buffer_bytes_);
+        if (r.size == 0) {
+            finish(r, 0);
+            return false;
+        }
+        return true;
+    }
+    void finish(Request &r, int error)
+    {
+        if (r.fd >= 0) {
+            close(r.fd);
+            r.fd = -1;
+        }
+        r.error = error;
+        r.ready = true;
+    }
+    void fill(PrefetchedFile &file, unsigned int b) const
+    {
+        const Request &r = requests_[b];
+        file.index = r.index;
+        file.data = buffers_[b];
+        file.size = r.error ? 0 : r.done;
+        file.error = r.error;
+        file.buffer = b;
+    }
+
+  public:
+    PrefetchReader(const std::vector<std::string> &files, unsigned int depth, size_t buffer_bytes)
+        : files_(files), buffer_bytes_((buffer_bytes + 4095) & ~(size_t)4095)
+    {
+        depth = std::max(1u, depth);
+        buffers_.resize(depth, nullptr);
+        requests_.resize(depth);
+        for (unsigned int b = 0; b < depth; b++) {
+            void *mem = nullptr;
+            if (posix_memalign(&mem, 4096, std::max(buffer_bytes_, (size_t)4096)) != 0) {
+                throw std::bad_alloc();
+            }
+            buffers_[b] = (uint8_t *)mem;
+            free_.push_back(depth - 1 - b);
+        }
+    }
+    virtual ~PrefetchReader(void)
+    {
+        for (uint8_t *buffer : buffers_) {
+            free(buffer);
+        }
+    }
+    virtual bool start() = 0;
+    virtual PrefetchBackend backend() const = 0;
+    virtual bool next(PrefetchedFile &file) = 0;
+    virtual void release(unsigned int buffer) = 0;
+    size_t pending() const { return issued_.size(); }
+    unsigned int depth() const { return buffers_.size(); }
+};
+
+namespace {
+
+// pread workers; the consumer thread only hands out work and waits.
+class ThreadReader : public PrefetchReader {
+  private:
+    std::mutex mutex_;
+    std::condition_variable work_cv_, done_cv_;
+    std::deque<unsigned int> work_;
+    std::vector<std::thread> threads_;
+    bool stop_ = false;
+
+    void worker()
+    {
+        while (true) {
+            unsigned int b;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                work_cv_.wait(lock, [&] { return stop_ || !work_.empty(); });
+                if (stop_) {
+                    return;
+                }
+                b = work_.front();
+                work_.pop_front();
+            }
+            Request &r = requests_[b];
+            int error = 0;
+            while (r.done < r.size) {
+                ssize_t got = pread(r.fd, buffers_[b] + r.done, r.size - r.done, r.done);
+                if (got < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (got <= 0) {
+                    error = got < 0 ? errno : 0;
+                    break;
+                }
+                r.done += got;
+            }
+            std::lock_guard<std::mutex> lock(mutex_);
+            finish(r, error);
+            done_cv_.notify_all();
+        }
+    }
+
+    void issue()
+    {
+        while (!free_.empty() && next_issue_ < files_.size()) {
+            unsigned int b = free_.back();
+            free_.pop_back();
+            // workers do not touch a buffer until it is queued
+            if (open(b)) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                work_.push_back(b);
+                work_cv_.notify_one();
+            }
+        }
+    }
+
+  public:
+    ThreadReader(const std::vector<std::string> &files, unsigned int depth, size_t buffer_bytes)
+        : PrefetchReader(files, depth, buffer_bytes)
+    {
+    }
+    ~ThreadReader(void)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+            work_cv_.notify_all();
+        }
+        for (auto &t : threads_) {
+            t.join();
+        }
+        for (auto &r : requests_) {
+            if (r.fd >= 0) {
+                close(r.fd);
+            }
+        }
+    }
+    bool start() override
+    {
+        for (unsigned int t = 0; t < depth(); t++) {
+            threads_.emplace_back(&ThreadReader::worker, this);
+        }
+        issue();
+        return true;
+    }
+    PrefetchBackend backend() const override { return PrefetchBackend::kThreads; }
+    bool next(PrefetchedFile &file) override
+    {
+        issue();
+        if (issued_.empty()) {
+            return false;
+        }
+        unsigned int b = issued_.front();
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_cv_.wait(lock, [&] { return requests_[b].ready; });
+        issued_.pop_front();
+        fill(file, b);
+        return true;
+    }
+    void release(unsigned int buffer) override
+    {
+        free_.push_back(buffer);
+        issue();
+    }
+};
+
+#ifdef PREFETCH_HAVE_IO_URING
+
+inline unsigned int load_acquire(const unsigned int *p)
+{
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+inline void store_release(unsigned int *p, unsigned int v)
+{
+    __atomic_store_n(p, v, __ATOMIC_RELEASE);
+}
+
+// io_uring through the raw system calls; everything runs on the consumer
+// thread, which submits reads and reaps completions while it waits.
+class UringReader : public PrefetchReader {
+  private:
+    int ring_fd_ = -1;
+    void *sq_ptr_ = MAP_FAILED;
+    void *cq_ptr_ = MAP_FAILED;
+    size_t sq_bytes_ = 0, cq_bytes_ = 0;
+    io_uring_sqe *sqes_ = (io_uring_sqe *)MAP_FAILED;
+    size_t sqes_bytes_ = 0;
+    unsigned int *sq_tail_, *sq_mask_, *sq_array_;
+    unsigned int *cq_head_, *cq_tail_, *cq_mask_;
+    io_uring_cqe *cqes_;
+    bool fixed_ = false;        // buffers registered
+    unsigned int to_submit_ = 0;
+
+    int enter(unsigned int to_submit, unsigned int min_complete, unsigned int flags)
+    {
+        int ret;
+        do {
+            ret = syscall(__NR_io_uring_enter, ring_fd_, to_submit, min_complete, flags, nullptr, 0);
+        } while (ret < 0 && errno == EINTR);
+        return ret;
+    }
+
+    void queueRead(unsigned int b)
+    {
+        Request &r = requests_[b];
+        unsigned int tail = *sq_tail_;
+        unsigned int idx = tail & *sq_mask_;
+        io_uring_sqe *sqe = &sqes_[idx];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = fixed_ ? IORING_OP_READ_FIXED : IORING_OP_READ;
+        sqe->fd = r.fd;
+        sqe->off = r.done;
+        sqe->addr = (uint64_t)(uintptr_t)(buffers_[b] + r.done);
+        sqe->len = r.size - r.done;
+        sqe->buf_index = fixed_ ? b : 0;
+        sqe->user_data = b;
+        sq_array_[idx] = idx;
+        store_release(sq_tail_, tail + 1);
+        to_submit_++;
+    }
+
+    void submit(unsigned int min_complete)
+    {
+        unsigned int flags = min_complete ? IORING_ENTER_GETEVENTS : 0;
+        if (to_submit_ == 0 && min_complete == 0) {
+            return;
+        }
+        int ret = enter(to_submit_, min_complete, flags);
+        if (ret < 0) {
+            std::cerr << "io_uring_enter: " << strerror(errno) << std::endl;
+            // fail everything in flight rather than waiting forever
+            for (auto &r : requests_) {
+                if (!r.ready && r.fd >= 0) {
+                    finish(r, errno);
+                }
+            }
+        }
+        to_submit_ = 0;
+    }
+
+    void reap()
+    {
+        unsigned int head = *cq_head_;
+        unsigned int tail = load_acquire(cq_tail_);
+        for (; head != tail; head++) {
+            const io_uring_cqe &cqe = cqes_[head & *cq_mask_];
+            Request &r = requests_[cqe.user_data];
+            if (r.ready) {
+                continue;
+            }
+            if (cqe.res < 0) {
+                finish(r, -cqe.res);
+            } else if (cqe.res == 0) {
+                finish(r, 0);   // the file shrank: keep what was read
+            } else {
+                r.done += cqe.res;
+                if (r.done < r.size) {
+                    queueRead(cqe.user_data);   // short read
+                } else {
+                    finish(r, 0);
+                }
+            }
+        }
+        store_release(cq_head_, head);
+    }
+
+    void issue()
+    {
+        while (!free_.empty() && next_issue_ < files_.size()) {
+            unsigned int b = free_.back();
+            free_.pop_back();
+            if (open(b)) {
+                queueRead(b);
+            }
+        }
+        submit(0);
+    }
+
+  public:
+    UringReader(const std::vector<std::string> &files, unsigned int depth, size_t buffer_bytes)
+        : PrefetchReader(files, depth, buffer_bytes)
+    {
+    }
+    ~UringReader(void)
+    {
+        // drain reads still in flight before the buffers go away
+        while (ring_fd_ >= 0) {
+            bool busy = false;
+            for (auto &r : requests_) {
+                busy = busy || (!r.ready && r.fd >= 0 && r.done < r.size);
+            }
+            if (!busy || enter(to_submit_, 1, IORING_ENTER_GETEVENTS) < 0) {
+                break;
+            }
+            to_submit_ = 0;
+            reap();
+        }
+        for (auto &r : requests_) {
+            if (r.fd >= 0) {
+                close(r.fd);
+            }
+        }
+        if (sqes_ != MAP_FAILED) munmap(sqes_, sqes_bytes_);
+        if (cq_ptr_ != MAP_FAILED && cq_ptr_ != sq_ptr_) munmap(cq_ptr_, cq_bytes_);
+        if (sq_ptr_ != MAP_FAILED) munmap(sq_ptr_, sq_bytes_);
+        if (ring_fd_ >= 0) close(ring_fd_);
+    }
+
+    bool start() override
+    {
+        io_uring_params p;
+        memset(&p, 0, sizeof(p));
+        ring_fd_ = syscall(__NR_io_uring_setup, depth(), &p);
+        if (ring_fd_ < 0) {
+            return false;
+        }
+        sq_bytes_ = p.sq_off.array + p.sq_entries * sizeof(unsigned int);
+        cq_bytes_ = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+        bool single = p.features & IORING_FEAT_SINGLE_MMAP;
+        if (single) {
+            sq_bytes_ = cq_bytes_ = std::max(sq_bytes_, cq_bytes_);
+        }
+        sq_ptr_ = mmap(nullptr, sq_bytes_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_,
+                       IORING_OFF_SQ_RING);
+        if (sq_ptr_ == MAP_FAILED) {
+            return false;
+        }
+        cq_ptr_ = single ? sq_ptr_ : mmap(nullptr, cq_bytes_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                          ring_fd_, IORING_OFF_CQ_RING);
+        sqes_bytes_ = p.sq_entries * sizeof(io_uring_sqe);
+        sqes_ = (io_uring_sqe *)mmap(nullptr, sqes_bytes_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                     ring_fd_, IORING_OFF_SQES);
+        if (cq_ptr_ == MAP_FAILED || sqes_ == MAP_FAILED) {
+            return false;
+        }
+        uint8_t *sq = (uint8_t *)sq_ptr_, *cq = (uint8_t *)cq_ptr_;
+        sq_tail_ = (unsigned int *)(sq + p.sq_off.tail);
+        sq_mask_ = (unsigned int *)(sq + p.sq_off.ring_mask);
+        sq_array_ = (unsigned int *)(sq + p.sq_off.array);
+        cq_head_ = (unsigned int *)(cq + p.cq_off.head);
+        cq_tail_ = (unsigned int *)(cq + p.cq_off.tail);
+        cq_mask_ = (unsigned int *)(cq + p.cq_off.ring_mask);
+        cqes_ = (io_uring_cqe *)(cq + p.cq_off.cqes);
+
+        // registration pins the buffers; without it (memlock limit) plain
+        // reads into the same buffers still work
+        std::vector<iovec> iov(depth());
+        for (unsigned int b = 0; b < depth(); b++) {
+            iov[b].iov_base = buffers_[b];
+            iov[b].iov_len = buffer_bytes_;
+        }
+        fixed_ = syscall(__NR_io_uring_register, ring_fd_, IORING_REGISTER_BUFFERS, iov.data(), depth()) == 0;
+        if (!fixed_) {
+            std::cerr << "io_uring buffer registration failed (" << strerror(errno)
+                      << "), reading without fixed buffers" << std::endl;
+        }
+        issue();
+        return true;
+    }
+    PrefetchBackend backend() const override { return PrefetchBackend::kIoUring; }
+    bool next(PrefetchedFile &file) override
+    {
+        issue();
+        if (issued_.empty()) {
+            return false;
+        }
+        unsigned int b = issued_.front();
+        reap();
+        while (!requests_[b].ready) {
+            submit(1);
+            reap();
+        }
+        issued_.pop_front();
+        fill(file, b);
+        return true;
+    }
+    void release(unsigned int buffer) override
+    {
+        free_.push_back(buffer);
+        issue();
+    }
+};
+
+#endif
+
+} // namespace
+
+FilePrefetcher::FilePrefetcher(const std::vector<std::string> &files, unsigned int depth, size_t buffer_bytes,
+                               PrefetchBackend backend)
+{
+#ifdef PREFETCH_HAVE_IO_URING
+    if (backend != PrefetchBackend::kThreads) {
+        reader_.reset(new UringReader(files, depth, buffer_bytes));
+        if (!reader_->start()) {
+            if (backend == PrefetchBackend::kIoUring) {
+                int error = errno;
+                std::cerr << "io_uring unavailable (" << strerror(error) << "), using threads" << std::endl;
+            }
+            reader_.reset();
+        }
+    }
+#else
+    if (backend == PrefetchBackend::kIoUring) {
+        std::cerr << "Built without io_uring, using threads" << std::endl;
+    }
+#endif
+    if (!reader_) {
+        reader_.reset(new ThreadReader(files, depth, buffer_bytes));
+        reader_->start();
+    }
+}
+
+FilePrefetcher::~FilePrefetcher(void)
+{
+}
+
+PrefetchBackend FilePrefetcher::backend() const
+{
+    return reader_->backend();
+}
+
+bool FilePrefetcher::next(PrefetchedFile &file)
+{
+    return reader_->next(file);
+}
+
+void FilePrefetcher::release(unsigned int buffer)
+{
+    reader_->release(buffer);
+}
+
+size_t FilePrefetcher::pending() const
+{
+    return reader_->pending();
+}
+
+unsigned int FilePrefetcher::depth() const
+{
+    return reader_->depth();
+}
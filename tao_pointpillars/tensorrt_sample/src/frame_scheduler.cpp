@@ -0,0 +1,142 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <string.h>
+#include <chrono>
+#include <iostream>
+#include "frame_scheduler.h"
+
+int64_t steady_now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+SchedulePolicy parse_schedule_policy(const char *name)
+{
+    if (strcmp(name, "fifo") == 0) {
+        return SchedulePolicy::kFifo;
+    }
+    if (strcmp(name, "latest") != 0) {
+        std::cerr << "Unknown schedule policy " << name << ", using latest" << std::endl;
+    }
+    return SchedulePolicy::kLatest;
+}
+
+FrameScheduler::FrameScheduler(SchedulePolicy policy, float deadline_ms)
+    : policy_(policy), deadline_ms_(deadline_ms)
+{
+}
+
+void FrameScheduler::push(const ScheduledFrame &frame)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    pushed_++;
+    if (policy_ == SchedulePolicy::kLatest) {
+        superseded_ += pending_.size();
+        pending_.clear();
+    }
+    pending_.push_back(frame);
+    cv_.notify_one();
+}
+
+void FrameScheduler::close()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    closed_ = true;
+    cv_.notify_all();
+}
+
+bool FrameScheduler::pop(ScheduledFrame *frame, int timeout_ms)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto ready = [this] { return closed_ || !pending_.empty(); };
+    if (timeout_ms < 0) {
+        cv_.wait(lock, ready);
+    } else if (!cv_.wait_for(lock, std::chrono::milliseconds(timeout_ms), ready)) {
+        return false;
+    }
+    if (pending_.empty()) {
+        return false;
+    }
+    int64_t now = steady_now_ns();
+    if (deadline_ms_ > 0) {
+        int64_t deadline_ns = (int64_t)(deadline_ms_ * 1e6);
+        while (pending_.size() > 1 && now - pending_.front().capture_ns > deadline_ns) {
+            pending_.pop_front();
+            expired_++;
+        }
+    }
+    *frame = pending_.front();
+    pending_.pop_front();
+    inferred_++;
+    age_.add((now - frame->capture_ns) * 1e-6f);
+    return true;
+}
+
+void FrameScheduler::complete(const ScheduledFrame &frame, bool counted)
+{
+    if (!counted) {
+        return;
+    }
+    float latency_ms = (steady_now_ns() - frame.capture_ns) * 1e-6f;
+    std::lock_guard<std::mutex> lock(mutex_);
+    latency_.add(latency_ms);
+    if (deadline_ms_ > 0 && latency_ms > deadline_ms_) {
+        misses_++;
+    }
+}
+
+uint64_t FrameScheduler::pushed() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return pushed_;
+}
+
+uint64_t FrameScheduler::inferred() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return inferred_;
+}
+
+uint64_t FrameScheduler::dropped() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return superseded_ + expired_;
+}
+
+uint64_t FrameScheduler::misses() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return misses_;
+}
+
+void FrameScheduler::printStats() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::cout << "Scheduler (" << (policy_ == SchedulePolicy::kFifo ? "fifo" : "latest")
+              << ", deadline " << deadline_ms_ << " ms): " << pushed_ << " frames, "
+              << inferred_ << " inferred, " << superseded_ << " superseded, " << expired_
+              << " expired, " << misses_ << " deadline misses" << std::endl;
+    std::cout << "  age at start ms: mean " << age_.mean() << ", p50 " << age_.percentile(50)
+              << ", p99 " << age_.percentile(99) << ", p99.9 " << age_.percentile(99.9)
+              << ", max " << age_.max() << std::endl;
+    std::cout << "  latency ms:      mean " << latency_.mean() << ", p50 " << latency_.percentile(50)
+              << ", p99 " << latency_.percentile(99) << ", p99.9 " << latency_.percentile(99.9)
+              << ", max " << latency_.max() << std::endl;
+}
@@ -0,0 +1,61 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <math.h>
+#include <algorithm>
+#include "latency_histogram.h"
+
+LatencyHistogram::LatencyHistogram(float max_ms, float bin_ms)
+    : bin_ms_(bin_ms), bins_((size_t)ceilf(max_ms / bin_ms) + 1, 0)
+{
+}
+
+void LatencyHistogram::add(float ms)
+{
+    ms = std::max(ms, 0.0f);
+    size_t bin = std::min((size_t)(ms / bin_ms_), bins_.size() - 1);
+    bins_[bin]++;
+    count_++;
+    sum_ += ms;
+    max_ = std::max(max_, ms);
+}
+
+void LatencyHistogram::clear()
+{
+    std::fill(bins_.begin(), bins_.end(), 0);
+    count_ = 0;
+    sum_ = 0.0;
+    max_ = 0.0f;
+}
+
+float LatencyHistogram::percentile(double p) const
+{
+    if (!count_) {
+        return 0.0f;
+    }
+    uint64_t rank = (uint64_t)ceil(p / 100.0 * count_);
+    rank = std::max<uint64_t>(rank, 1);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < bins_.size(); i++) {
+        seen += bins_[i];
+        if (seen >= rank) {
+            return i + 1 == bins_.size() ? max_ : std::min((i + 1) * bin_ms_, max_);
+        }
+    }
+    return max_;
+}
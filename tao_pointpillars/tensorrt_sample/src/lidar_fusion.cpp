@@ -0,0 +1,215 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <string.h>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+#include "point_transform.h"
+#include "lidar_fusion.h"
+
+int load_lidar_rig(const std::string &rig_file, std::vector<LidarSensor> &sensors)
+{
+    std::ifstream ifs(rig_file);
+    if (!ifs.is_open()) {
+        std::cout << "Can't open files: " << rig_file << std::endl;
+        return -1;
+    }
+    std::string line;
+    while (std::getline(ifs, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        std::istringstream iss(line);
+        LidarSensor s;
+        iss >> s.name;
+        for (int i = 0; i < 12; i++) {
+            iss >> s.extrinsic[i];
+        }
+        if (iss.fail()) {
+            std::cerr << "Bad rig line: " << line << std::endl;
+            return -1;
+        }
+        s.extrinsic[12] = s.extrinsic[13] = s.extrinsic[14] = 0.0f;
+        s.extrinsic[15] = 1.0f;
+        sensors.push_back(s);
+    }
+    if (sensors.empty()) {
+        std::cerr << "No sensors in rig file: " << rig_file << std::endl;
+        return -1;
+    }
+    return 0;
+}
+
+LidarFusion::LidarFusion(const std::vector<LidarSensor> &sensors, const FusionConfig &config)
+    : sensors_(sensors), config_(config), jobs_(sensors.size())
+{
+    for (size_t i = 0; i < sensors_.size(); i++) {
+        workers_.emplace_back(&LidarFusion::worker, this, i);
+    }
+}
+
+LidarFusion::~LidarFusion()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+        work_cv_.notify_all();
+    }
+    for (auto &t : workers_) {
+        t.join();
+    }
+}
+
+void LidarFusion::worker(size_t sensor)
+{
+    uint64_t seen = 0;
+    for (;;) {
+        Phase phase;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            work_cv_.wait(lock, [&] { return stop_ || generation_ != seen; });
+            if (stop_) {
+                return;
+            }
+            seen = generation_;
+            phase = phase_;
+        }
+        SensorJob &job = jobs_[sensor];
+        if (phase == Phase::kCount) {
+            job.count = 0;
+            job.status = job.path.empty() ? 0 : job.loader.count(job.path, 4, &job.count);
+        } else {
+            loadSweep(job, sensors_[sensor]);
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (--pending_ == 0) {
+                done_cv_.notify_all();
+            }
+        }
+    }
+}
+
+void LidarFusion::runPhase(Phase phase)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    phase_ = phase;
+    pending_ = workers_.size();
+    generation_++;
+    work_cv_.notify_all();
+    done_cv_.wait(lock, [&] { return pending_ == 0; });
+}
+
+void LidarFusion::loadSweep(SensorJob &job, const LidarSensor &sensor)
+{
+    job.loaded = job.kept = 0;
+    if (job.status != 0 || job.capacity == 0) {
+        return;
+    }
+    const unsigned int ps = point_size_;
+    float *slice = dst_ + (size_t)job.offset * ps;
+    // The sweep is read packed (4 floats a point) into the end of the slice
+    // and widened forward while transforming: point i is written to
+    // slice[i * ps], which never reaches the unread points after it, the
+    // overlap transform_points allows.
+    float *packed = slice + (size_t)job.capacity * (ps - 4);
+    unsigned int n = 0;
+    if (job.loader.load(job.path, packed, job.capacity, 4, &n) != 0) {
+        job.status = -1;
+        return;
+    }
+    job.loaded = n;
+    transform_points(packed, 4, slice, ps, n, sensor.extrinsic);
+
+    if (!config_.exclude_body && ps == 4) {
+        job.kept = n;
+        return;
+    }
+    const float *box = config_.body_box;
+    const bool exclude = config_.exclude_body;
+    unsigned int kept = 0;
+    for (unsigned int i = 0; i < n; i++) {
+        const float *p = slice + (size_t)i * ps;
+        if (exclude && p[0] >= box[0] && p[0] <= box[3] && p[1] >= box[1] && p[1] <= box[4] &&
+            p[2] >= box[2] && p[2] <= box[5]) {
+            continue;
+        }
+        float *q = slice + (size_t)kept * ps;
+        if (q != p) {
+            memcpy(q, p, 4 * sizeof(float));
+        }
+        for (unsigned int c = 4; c < ps; c++) {
+            q[c] = 0.0f;
+        }
+        kept++;
+    }
+    job.kept = kept;
+}
+
+int LidarFusion::fuse(const std::vector<std::string> &paths, float *dst, unsigned int max_points,
+                      unsigned int point_size, unsigned int *num_points)
+{
+    *num_points = 0;
+    if (paths.size() != sensors_.size()) {
+        std::cerr << "Fusion needs " << sensors_.size() << " sweeps, got " << paths.size() << std::endl;
+        return sensors_.size();
+    }
+    if (point_size < 4) {
+        std::cerr << "Fusion needs at least 4 values per point, got " << point_size << std::endl;
+        return sensors_.size();
+    }
+    for (size_t i = 0; i < jobs_.size(); i++) {
+        jobs_[i].path = paths[i];
+    }
+    runPhase(Phase::kCount);
+
+    // slices in sensor order; sensors past max_points are cut
+    unsigned int offset = 0;
+    dropped_ = 0;
+    for (auto &job : jobs_) {
+        job.offset = offset;
+        job.capacity = job.status == 0 ? std::min(job.count, max_points - offset) : 0;
+        dropped_ += job.status == 0 ? job.count - job.capacity : 0;
+        offset += job.capacity;
+    }
+    dst_ = dst;
+    point_size_ = point_size;
+    runPhase(Phase::kLoad);
+
+    int failed = 0;
+    unsigned int total = 0;
+    excluded_ = 0;
+    for (size_t i = 0; i < jobs_.size(); i++) {
+        SensorJob &job = jobs_[i];
+        if (job.status != 0) {
+            std::cerr << "Sweep of " << sensors_[i].name << " not read: " << job.path << std::endl;
+            failed++;
+            continue;
+        }
+        excluded_ += job.loaded - job.kept;
+        if (job.offset != total && job.kept) {
+            memmove(dst + (size_t)total * point_size, dst + (size_t)job.offset * point_size,
+                    (size_t)job.kept * point_size * sizeof(float));
+        }
+        total += job.kept;
+    }
+    *num_points = total;
+    return failed;
+}
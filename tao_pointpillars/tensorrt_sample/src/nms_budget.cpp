@@ -0,0 +1,86 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include "nms_budget.h"
+
+TopNController::TopNController(const TopNControllerConfig &config) : config_(config)
+{
+    config_.min_top_n = std::max(config_.min_top_n, 1);
+    config_.max_top_n = std::max(config_.max_top_n, config_.min_top_n);
+    top_n_ = previous_top_n_ = config_.max_top_n;
+}
+
+void TopNController::update(double nms_ms, size_t num_candidates)
+{
+    stats_.frames++;
+    stats_.last_ms = nms_ms;
+    stats_.max_ms = std::max(stats_.max_ms, nms_ms);
+    if (nms_ms > config_.budget_ms) {
+        stats_.over_budget++;
+    }
+    size_t wanted = std::min(num_candidates, (size_t)config_.max_top_n);
+    last_truncated_ = wanted > (size_t)top_n_ ? wanted - top_n_ : 0;
+    if (last_truncated_) {
+        stats_.truncated_frames++;
+        stats_.truncated_candidates += last_truncated_;
+    }
+    previous_top_n_ = top_n_;
+
+    // small frames say little about the quadratic term
+    double n = std::min(num_candidates, (size_t)top_n_);
+    if (n >= 32) {
+        double sample = nms_ms / (n * n);
+        if (cost_ == 0.0 || nms_ms > config_.budget_ms) {
+            cost_ = std::max(cost_, sample);
+        } else {
+            cost_ += config_.smoothing * (sample - cost_);
+        }
+    }
+    if (cost_ <= 0.0) {
+        return;
+    }
+    double target = sqrt(config_.budget_ms * config_.target_fraction / cost_);
+    target = std::min(target, (double)top_n_ * config_.max_growth);
+    int next = (int)std::max((double)config_.min_top_n, std::min((double)config_.max_top_n, target));
+    // only a reduction that matters or growth the candidates asked for
+    if (next < top_n_ && next > top_n_ * 0.95) {
+        next = top_n_;
+    }
+    if (next > top_n_ && num_candidates <= (size_t)top_n_) {
+        next = top_n_;
+    }
+    if (next > top_n_) {
+        stats_.increases++;
+    } else if (next < top_n_) {
+        stats_.decreases++;
+    }
+    top_n_ = next;
+}
+
+int TopNController::nms(std::vector<Bndbox> &boxes, float nms_thresh, std::vector<Bndbox> &nms_pred)
+{
+    size_t num_candidates = boxes.size();
+    auto t0 = std::chrono::steady_clock::now();
+    int ret = nms_cpu_inplace(boxes, nms_thresh, nms_pred, top_n_, suppressed_);
+    auto t1 = std::chrono::steady_clock::now();
+    update(std::chrono::duration<double, std::milli>(t1 - t0).count(), num_candidates);
+    return ret;
+}
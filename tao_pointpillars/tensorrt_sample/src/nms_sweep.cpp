@@ -0,0 +1,117 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <math.h>
+#include <algorithm>
+#include "nms_sweep.h"
+
+void NmsSweepFrame::prepare(const std::vector<Bndbox> &boxes, int max_top_n)
+{
+    // nms_cpu's order, with equal scores kept in input order
+    sorted_ = boxes;
+    std::stable_sort(sorted_.begin(), sorted_.end(),
+                     [](const Bndbox &boxes1, const Bndbox &boxes2) { return boxes1.score > boxes2.score; });
+    size_t n = std::min(sorted_.size(), (size_t)std::max(max_top_n, 0));
+    sorted_.resize(n);
+
+    // circumcircles, a little larger so that rounding can't lose a pair
+    radius_.resize(n);
+    float max_radius = 0.0f;
+    for (size_t i = 0; i < n; i++) {
+        radius_[i] = 0.5f * sqrtf(sorted_[i].l * sorted_[i].l + sorted_[i].w * sorted_[i].w) + 1e-3f;
+        max_radius = std::max(max_radius, radius_[i]);
+    }
+    order_.resize(n);
+    for (size_t i = 0; i < n; i++) {
+        order_[i] = i;
+    }
+    std::sort(order_.begin(), order_.end(), [this](int a, int b) { return sorted_[a].x < sorted_[b].x; });
+
+    pairs_.clear();
+    for (size_t a = 0; a < n; a++) {
+        const Bndbox &box_a = sorted_[order_[a]];
+        float ra = radius_[order_[a]];
+        for (size_t b = a + 1; b < n; b++) {
+            const Bndbox &box_b = sorted_[order_[b]];
+            float reach = ra + max_radius;
+            if (box_b.x - box_a.x > reach) {
+                break;
+            }
+            float r = ra + radius_[order_[b]];
+            float dx = box_b.x - box_a.x, dy = box_b.y - box_a.y;
+            if (dx * dx + dy * dy > r * r) {
+                continue;
+            }
+            // in nms_cpu's argument order, the higher scoring box first
+            int i = std::min(order_[a], order_[b]), j = std::max(order_[a], order_[b]);
+            float iou = box_iou_bev(sorted_[i], sorted_[j]);
+            if (iou > 0.0f) {
+                Pair pair = {i, j, iou};
+                pairs_.push_back(pair);
+            }
+        }
+    }
+    std::sort(pairs_.begin(), pairs_.end(),
+              [](const Pair &p, const Pair &q) { return p.i != q.i ? p.i < q.i : p.j < q.j; });
+    pair_begin_.assign(n + 1, 0);
+    pair_j_.resize(pairs_.size());
+    pair_iou_.resize(pairs_.size());
+    for (size_t k = 0; k < pairs_.size(); k++) {
+        pair_begin_[pairs_[k].i + 1]++;
+        pair_j_[k] = pairs_[k].j;
+        pair_iou_[k] = pairs_[k].iou;
+    }
+    for (size_t i = 0; i < n; i++) {
+        pair_begin_[i + 1] += pair_begin_[i];
+    }
+}
+
+int NmsSweepFrame::run(float nms_thresh, int top_n, float score_cutoff, std::vector<Bndbox> &kept)
+{
+    size_t n = std::min(sorted_.size(), (size_t)std::max(top_n, 0));
+    // boxes are sorted, so the cutoff ends the prefix
+    n = std::lower_bound(sorted_.begin(), sorted_.begin() + n, score_cutoff,
+                         [](const Bndbox &box, float s) { return box.score >= s; }) - sorted_.begin();
+    if (n == 0) {
+        return 0;
+    }
+    if (nms_thresh <= 0.0f) {
+        // every IoU, 0 included, reaches the threshold: the first box suppresses all
+        kept.push_back(sorted_[0]);
+        return 1;
+    }
+    suppressed_.assign(n, 0);
+    int count = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (suppressed_[i]) {
+            continue;
+        }
+        kept.push_back(sorted_[i]);
+        count++;
+        for (size_t k = pair_begin_[i]; k < pair_begin_[i + 1]; k++) {
+            size_t j = pair_j_[k];
+            if (j >= n) {
+                break;
+            }
+            if (pair_iou_[k] >= nms_thresh) {
+                suppressed_[j] = 1;
+            }
+        }
+    }
+    return count;
+}
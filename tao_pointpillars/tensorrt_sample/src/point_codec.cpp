@@ -0,0 +1,616 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <string.h>
+#include <sys/stat.h>
+#include <math.h>
+#include <iostream>
+#include <algorithm>
+#include "point_codec.h"
+
+namespace {
+
+const uint32_t kProbBits = 12;
+const uint32_t kProbScale = 1u << kProbBits;
+const uint32_t kRansL = 1u << 23;      // lower bound of the normalized state
+const int kStates = 4;                  // interleaved rANS states
+
+struct FrameHeader {
+    char magic[4];          // "PPCF"
+    uint32_t frame_bytes;   // including this header
+    uint32_t num_points;
+    uint32_t num_rings;
+    float step[4];
+};
+
+enum PlaneMode : uint8_t {
+    kPlaneConstant = 0,
+    kPlaneRans = 1,
+};
+
+template <typename T>
+inline void put(std::vector<uint8_t> &out, T v)
+{
+    size_t pos = out.size();
+    out.resize(pos + sizeof(T));
+    memcpy(&out[pos], &v, sizeof(T));
+}
+
+template <typename T>
+inline bool get(const uint8_t *&ptr, const uint8_t *end, T &v)
+{
+    if ((size_t)(end - ptr) < sizeof(T)) {
+        return false;
+    }
+    memcpy(&v, ptr, sizeof(T));
+    ptr += sizeof(T);
+    return true;
+}
+
+inline uint32_t zigzag(uint32_t r) { return (r << 1) ^ (uint32_t)((int32_t)r >> 31); }
+inline uint32_t unzigzag(uint32_t z) { return (z >> 1) ^ (0u - (z & 1)); }
+
+inline uint32_t to_code(float v, float step)
+{
+    if (step == 0.0f) {
+        uint32_t bits;
+        memcpy(&bits, &v, sizeof(bits));
+        return bits;
+    }
+    return (uint32_t)(int32_t)lrintf(v / step);
+}
+
+// Scale symbol counts to frequencies summing to kProbScale, keeping every
+// present symbol at a frequency of at least 1.
+void normalize_freqs(const uint32_t *counts, uint32_t total, uint32_t *freqs)
+{
+    uint32_t sum = 0;
+    for (int s = 0; s < 256; s++) {
+        freqs[s] = counts[s] == 0 ? 0 : std::max<uint32_t>(1, (uint64_t)counts[s] * kProbScale / total);
+        sum += freqs[s];
+    }
+    while (sum != kProbScale) {
+        int best = -1;
+        for (int s = 0; s < 256; s++) {
+            if (freqs[s] > (sum > kProbScale ? 1u : 0u) && (best < 0 || freqs[s] > freqs[best])) {
+                best = s;
+            }
+        }
+        if (sum > kProbScale) {
+            freqs[best]--;
+            sum--;
+        } else {
+            freqs[best]++;
+            sum++;
+        }
+    }
+}
+
+inline void rans_put(uint32_t &x, uint8_t *&ptr, uint32_t start, uint32_t freq)
+{
+    uint32_t x_max = ((kRansL >> kProbBits) << 8) * freq;
+    while (x >= x_max) {
+        *--ptr = (uint8_t)(x & 0xff);
+        x >>= 8;
+    }
+    x = ((x / freq) << kProbBits) + (x % freq) + start;
+}
+
+// Decode one symbol and refill the state with up to two bytes, branch free.
+// The caller guarantees that two bytes are readable at in.
+inline uint8_t rans_get(uint32_t &x, const uint8_t *&in, const uint8_t *lut, const uint32_t *fs)
+{
+    uint32_t slot = x & (kProbScale - 1);
+    uint32_t f = fs[slot];
+    x = (f >> 16) * (x >> kProbBits) + slot - (f & 0xffff);
+    uint32_t need = x < kRansL;
+    x = need ? (x << 8) | in[0] : x;
+    in += need;
+    need = x < kRansL;
+    x = need ? (x << 8) | in[0] : x;
+    in += need;
+    return lut[slot];
+}
+
+inline void rans_flush(uint32_t x, uint8_t *&ptr)
+{
+    ptr -= 4;
+    memcpy(ptr, &x, 4);
+}
+
+void encode_plane(const uint8_t *symbols, unsigned int n, std::vector<uint8_t> &out,
+                  std::vector<uint8_t> &scratch)
+{
+    uint32_t counts[256] = {0};
+    for (unsigned int i = 0; i < n; i++) {
+        counts[symbols[i]]++;
+    }
+    int used = 0, last = 0;
+    for (int s = 0; s < 256; s++) {
+        if (counts[s]) {
+            used++;
+            last = s;
+        }
+    }
+    if (used <= 1) {
+        put<uint8_t>(out, kPlaneConstant);
+        put<uint8_t>(out, (uint8_t)last);
+        return;
+    }
+
+    uint32_t freqs[256], starts[256];
+    normalize_freqs(counts, n, freqs);
+    uint32_t acc = 0;
+    for (int s = 0; s < 256; s++) {
+        starts[s] = acc;
+        acc += freqs[s];
+    }
+
+    // rANS emits bytes backwards, at most 2 per symbol. Symbol i goes to state
+    // i % kStates; the encoder walks backwards so the decoder can walk forwards.
+    scratch.resize((size_t)n * 2 + 4 * kStates);
+    uint8_t *end = scratch.data() + scratch.size();
+    uint8_t *ptr = end;
+    uint32_t x[kStates];
+    for (int k = 0; k < kStates; k++) {
+        x[k] = kRansL;
+    }
+    for (unsigned int i = n; i-- > 0;) {
+        uint8_t s = symbols[i];
+        rans_put(x[i % kStates], ptr, starts[s], freqs[s]);
+    }
+    for (int k = kStates; k-- > 0;) {
+        rans_flush(x[k], ptr);
+    }
+
+    put<uint8_t>(out, kPlaneRans);
+    put<uint16_t>(out, (uint16_t)used);
+    for (int s = 0; s < 256; s++) {
+        if (freqs[s]) {
+            put<uint8_t>(out, (uint8_t)s);
+            put<uint16_t>(out, (uint16_t)freqs[s]);
+        }
+    }
+    put<uint32_t>(out, (uint32_t)(end - ptr));
+    out.insert(out.end(), ptr, end);
+}
+
+// Decodes the first count of the n symbols of a plane; ptr moves past the
+// whole plane.
+bool decode_plane(const uint8_t *&ptr, const uint8_t *end, uint8_t *symbols, unsigned int n,
+                  unsigned int count)
+{
+    uint8_t mode;
+    if (!get(ptr, end, mode)) {
+        return false;
+    }
+    if (mode == kPlaneConstant) {
+        uint8_t s;
+        if (!get(ptr, end, s)) {
+            return false;
+        }
+        memset(symbols, s, count);
+        return true;
+    }
+
+    uint16_t used;
+    if (mode != kPlaneRans || !get(ptr, end, used)) {
+        return false;
+    }
+    // per slot: the symbol, and its frequency and start packed as freq << 16 | start
+    uint8_t lut[kProbScale];
+    uint32_t fs[kProbScale];
+    uint32_t acc = 0;
+    for (int k = 0; k < used; k++) {
+        uint8_t s;
+        uint16_t f;
+        if (!get(ptr, end, s) || !get(ptr, end, f) || f == 0 || acc + f > kProbScale) {
+            return false;
+        }
+        memset(lut + acc, s, f);
+        for (uint32_t slot = acc; slot < acc + f; slot++) {
+            fs[slot] = (uint32_t)f << 16 | acc;
+        }
+        acc += f;
+    }
+    uint32_t bytes;
+    if (acc != kProbScale || !get(ptr, end, bytes) || (size_t)(end - ptr) < bytes || bytes < 4 * kStates) {
+        return false;
+    }
+    const uint8_t *in = ptr;
+    const uint8_t *in_end = ptr + bytes;
+    ptr += bytes;
+
+    uint32_t x[kStates];
+    for (int k = 0; k < kStates; k++) {
+        memcpy(&x[k], in, 4);
+        in += 4;
+    }
+    unsigned int i = 0;
+    // Every state takes at most two bytes per symbol, so while 2 * kStates bytes
+    // are left the renormalization runs without bounds checks or branches.
+    // The states live in locals so they stay in registers.
+    uint32_t x0 = x[0], x1 = x[1], x2 = x[2], x3 = x[3];
+    count = std::min(count, n);
+    for (; i + kStates <= count && in_end - in >= 2 * kStates; i += kStates) {
+        symbols[i] = rans_get(x0, in, lut, fs);
+        symbols[i + 1] = rans_get(x1, in, lut, fs);
+        symbols[i + 2] = rans_get(x2, in, lut, fs);
+        symbols[i + 3] = rans_get(x3, in, lut, fs);
+    }
+    x[0] = x0, x[1] = x1, x[2] = x2, x[3] = x3;
+    const uint32_t mask = kProbScale - 1;
+    for (; i < count; i++) {
+        uint32_t &xk = x[i % kStates];
+        uint32_t slot = xk & mask;
+        uint32_t f = fs[slot];
+        symbols[i] = lut[slot];
+        xk = (f >> 16) * (xk >> kProbBits) + slot - (f & 0xffff);
+        while (xk < kRansL && in < in_end) {
+            xk = (xk << 8) | *in++;
+        }
+    }
+    return true;
+}
+
+// Residuals of one channel: a token plane holding min(z, 255) for every point,
+// then the escaped values (z - 255 where z >= 255) split into 4 byte planes.
+// Most residuals fit in the token, so the wide planes only cover the few
+// escapes instead of every point.
+void encode_residuals(const uint32_t *z, unsigned int n, std::vector<uint8_t> &out,
+                      std::vector<uint8_t> &plane, std::vector<uint8_t> &scratch)
+{
+    plane.resize(n);
+    std::vector<uint32_t> escapes;
+    for (unsigned int i = 0; i < n; i++) {
+        if (z[i] >= 255) {
+            plane[i] = 255;
+            escapes.push_back(z[i] - 255);
+        } else {
+            plane[i] = (uint8_t)z[i];
+        }
+    }
+    encode_plane(plane.data(), n, out, scratch);
+
+    const unsigned int m = escapes.size();
+    put<uint32_t>(out, m);
+    if (m == 0) {
+        return;
+    }
+    plane.resize(m);
+    for (int b = 0; b < 4; b++) {
+        for (unsigned int k = 0; k < m; k++) {
+            plane[k] = (uint8_t)(escapes[k] >> (8 * b));
+        }
+        encode_plane(plane.data(), m, out, scratch);
+    }
+}
+
+// Decodes the residuals of the first count of n points; the escapes of those
+// points are a prefix of the escape planes, so scratch is bounded by count.
+bool decode_residuals(const uint8_t *&ptr, const uint8_t *end, uint32_t *z, unsigned int n,
+                      unsigned int count, std::vector<uint8_t> &planes)
+{
+    planes.resize(count);
+    if (!decode_plane(ptr, end, planes.data(), n, count)) {
+        return false;
+    }
+    uint32_t m;
+    if (!get(ptr, end, m) || m > n) {
+        return false;
+    }
+    const unsigned int mc = std::min(m, count);
+    // every escape plane gets one zero byte of padding, read by the
+    // branch-free merge below at k == mc
+    const size_t stride = (size_t)mc + 1;
+    planes.resize((size_t)count + 4 * stride);
+    uint8_t *tokens = planes.data();
+    uint8_t *e0 = tokens + count, *e1 = e0 + stride, *e2 = e1 + stride, *e3 = e2 + stride;
+    e0[mc] = e1[mc] = e2[mc] = e3[mc] = 0;
+    if (m > 0) {
+        for (int b = 0; b < 4; b++) {
+            if (!decode_plane(ptr, end, e0 + (size_t)b * stride, m, mc)) {
+                return false;
+            }
+        }
+    }
+    // Escapes are frequent in lossless channels and placed at random, so the
+    // merge has no branch on them: an escape adds its wide value and moves k.
+    unsigned int k = 0;
+    for (unsigned int i = 0; i < count; i++) {
+        uint32_t t = tokens[i];
+        uint32_t escape = 0u - (uint32_t)(t == 255);
+        uint32_t wide = e0[k] | (uint32_t)e1[k] << 8 | (uint32_t)e2[k] << 16 | (uint32_t)e3[k] << 24;
+        z[i] = t + (wide & escape);
+        k += escape & 1;
+        if (k > mc) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Ring starts: a new ring begins where the azimuth jumps by more than pi.
+void find_rings(const float *points, unsigned int n, unsigned int point_size, std::vector<uint32_t> &lengths)
+{
+    lengths.clear();
+    if (n == 0) {
+        return;
+    }
+    uint32_t start = 0;
+    float prev = atan2f(points[1], points[0]);
+    for (unsigned int i = 1; i < n; i++) {
+        const float *p = points + (size_t)i * point_size;
+        float az = atan2f(p[1], p[0]);
+        if (fabsf(az - prev) > (float)M_PI) {
+            lengths.push_back(i - start);
+            start = i;
+        }
+        prev = az;
+    }
+    lengths.push_back(n - start);
+}
+
+}  // namespace
+
+size_t encode_frame(const float *points, unsigned int num_points, unsigned int point_size,
+                    const PointCodecOptions &options, std::vector<uint8_t> &out)
+{
+    const size_t begin = out.size();
+    std::vector<uint32_t> rings;
+    find_rings(points, num_points, point_size, rings);
+
+    FrameHeader header;
+    memcpy(header.magic, "PPCF", 4);
+    header.frame_bytes = 0;
+    header.num_points = num_points;
+    header.num_rings = rings.size();
+    memcpy(header.step, options.step, sizeof(header.step));
+    out.resize(begin + sizeof(header));
+    for (uint32_t len : rings) {
+        put<uint32_t>(out, len);
+    }
+
+    std::vector<uint32_t> codes(num_points);
+    std::vector<uint8_t> plane, scratch;
+    for (int c = 0; c < 4; c++) {
+        for (unsigned int i = 0; i < num_points; i++) {
+            codes[i] = to_code(points[(size_t)i * point_size + c], options.step[c]);
+        }
+        // residuals, walking backwards so that predictions still see the original codes
+        unsigned int ring_end = num_points;
+        for (size_t r = rings.size(); r-- > 0;) {
+            unsigned int ring_start = ring_end - rings[r];
+            for (unsigned int i = ring_end; i-- > ring_start + 1;) {
+                codes[i] = zigzag(codes[i] - codes[i - 1]);
+            }
+            uint32_t pred = r > 0 ? codes[ring_start - rings[r - 1]] : 0;
+            codes[ring_start] = zigzag(codes[ring_start] - pred);
+            ring_end = ring_start;
+        }
+        encode_residuals(codes.data(), num_points, out, plane, scratch);
+    }
+
+    header.frame_bytes = out.size() - begin;
+    memcpy(&out[begin], &header, sizeof(header));
+    return header.frame_bytes;
+}
+
+unsigned int frame_points(const uint8_t *data, size_t size)
+{
+    FrameHeader header;
+    if (size < sizeof(header)) {
+        return 0;
+    }
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, "PPCF", 4) != 0 || header.frame_bytes < sizeof(header) || header.frame_bytes > size) {
+        return 0;
+    }
+    return header.num_points;
+}
+
+size_t decode_frame(const uint8_t *data, size_t size, float *dst, unsigned int max_points,
+                    unsigned int point_size, unsigned int *num_points)
+{
+    FrameHeader header;
+    if (size < sizeof(header)) {
+        return 0;
+    }
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, "PPCF", 4) != 0 || header.frame_bytes < sizeof(header) || header.frame_bytes > size ||
+        point_size < 4) {
+        return 0;
+    }
+    const uint8_t *ptr = data + sizeof(header);
+    const uint8_t *end = data + header.frame_bytes;
+    const unsigned int n = header.num_points;
+
+    static thread_local std::vector<uint32_t> rings;
+    static thread_local std::vector<uint32_t> codes;
+    static thread_local std::vector<uint8_t> planes;
+    // Header counts are checked before they size anything: every ring length
+    // takes 4 bytes of the frame, and the scratch below holds only the points
+    // written to dst, so a corrupt count can't make it allocate more.
+    if (header.num_rings > (size_t)(end - ptr) / sizeof(uint32_t)) {
+        return 0;
+    }
+    rings.resize(header.num_rings);
+    uint64_t total = 0;
+    for (uint32_t r = 0; r < header.num_rings; r++) {
+        if (!get(ptr, end, rings[r])) {
+            return 0;
+        }
+        total += rings[r];
+    }
+    if (total != n) {
+        return 0;
+    }
+    // points only depend on points before them, so decoding stops at out_points
+    const unsigned int out_points = std::min(n, max_points);
+    codes.resize(out_points);
+    uint32_t *z = codes.data();
+
+    for (int c = 0; c < 4; c++) {
+        if (!decode_residuals(ptr, end, z, n, out_points, planes)) {
+            return 0;
+        }
+        // undo the ring-wise delta coding in place
+        unsigned int ring_start = 0, prev_start = 0;
+        for (uint32_t r = 0; r < header.num_rings && ring_start < out_points; r++) {
+            unsigned int ring_end = std::min(ring_start + rings[r], out_points);
+            if (ring_end == ring_start) {
+                continue;
+            }
+            uint32_t v = unzigzag(z[ring_start]) + (r > 0 ? z[prev_start] : 0);
+            z[ring_start] = v;
+            for (unsigned int i = ring_start + 1; i < ring_end; i++) {
+                v += unzigzag(z[i]);
+                z[i] = v;
+            }
+            prev_start = ring_start;
+            ring_start = ring_end;
+        }
+        const float step = header.step[c];
+        float *out = dst + c;
+        if (step == 0.0f) {
+            for (unsigned int i = 0; i < out_points; i++) {
+                memcpy(out + (size_t)i * point_size, z + i, sizeof(float));
+            }
+        } else {
+            for (unsigned int i = 0; i < out_points; i++) {
+                out[(size_t)i * point_size] = (float)(int32_t)z[i] * step;
+            }
+        }
+    }
+    if (point_size > 4) {
+        for (unsigned int i = 0; i < out_points; i++) {
+            memset(dst + (size_t)i * point_size + 4, 0, (point_size - 4) * sizeof(float));
+        }
+    }
+    *num_points = out_points;
+    return header.frame_bytes;
+}
+
+static const char kFileMagic[4] = {'P', 'P', 'C', '1'};
+static const uint32_t kFileHeaderBytes = 16;
+
+PointCodecWriter::PointCodecWriter(const std::string &path, const PointCodecOptions &options)
+  : options_(options)
+{
+    file_ = fopen(path.c_str(), "wb");
+    if (!file_) {
+        std::cerr << "Output file cannot be opened: " << path << std::endl;
+        return;
+    }
+    uint8_t header[kFileHeaderBytes] = {0};
+    memcpy(header, kFileMagic, 4);
+    header[4] = 1;    // version
+    fwrite(header, 1, sizeof(header), file_);
+}
+
+PointCodecWriter::~PointCodecWriter(void)
+{
+    if (file_) {
+        fclose(file_);
+    }
+}
+
+size_t PointCodecWriter::write(const float *points, unsigned int num_points, unsigned int point_size)
+{
+    if (!file_) {
+        return 0;
+    }
+    buffer_.clear();
+    size_t bytes = encode_frame(points, num_points, point_size, options_, buffer_);
+    if (fwrite(buffer_.data(), 1, bytes, file_) != bytes) {
+        return 0;
+    }
+    return bytes;
+}
+
+PointCodecReader::PointCodecReader(const std::string &path)
+{
+    file_ = fopen(path.c_str(), "rb");
+    if (!file_) {
+        std::cout << "Can't open files: " << path << std::endl;
+        return;
+    }
+    uint8_t header[kFileHeaderBytes];
+    if (fread(header, 1, sizeof(header), file_) != sizeof(header) || memcmp(header, kFileMagic, 4) != 0) {
+        std::cerr << "Not a point codec archive: " << path << std::endl;
+        fclose(file_);
+        file_ = nullptr;
+    }
+}
+
+PointCodecReader::~PointCodecReader(void)
+{
+    if (file_) {
+        fclose(file_);
+    }
+}
+
+int PointCodecReader::readFrame()
+{
+    if (peeked_) {
+        return 0;
+    }
+    FrameHeader header;
+    if (!file_ || fread(&header, 1, sizeof(header), file_) != sizeof(header) ||
+        memcmp(header.magic, "PPCF", 4) != 0 || header.frame_bytes < sizeof(header)) {
+        return -1;
+    }
+    // a truncated or corrupt archive must not size the buffer past its end
+    struct stat st;
+    long pos = ftell(file_);
+    if (fstat(fileno(file_), &st) != 0 || pos < 0 ||
+        header.frame_bytes - sizeof(header) > (uint64_t)(st.st_size - pos)) {
+        return -1;
+    }
+    buffer_.resize(header.frame_bytes);
+    memcpy(buffer_.data(), &header, sizeof(header));
+    size_t rest = header.frame_bytes - sizeof(header);
+    if (fread(buffer_.data() + sizeof(header), 1, rest, file_) != rest) {
+        return -1;
+    }
+    frame_bytes_ = header.frame_bytes;
+    peeked_ = true;
+    return 0;
+}
+
+int PointCodecReader::peekPoints(unsigned int *num_points)
+{
+    if (readFrame() != 0) {
+        return -1;
+    }
+    *num_points = frame_points(buffer_.data(), frame_bytes_);
+    return 0;
+}
+
+int PointCodecReader::next(float *dst, unsigned int max_points, unsigned int point_size, unsigned int *num_points)
+{
+    if (readFrame() != 0) {
+        return -1;
+    }
+    peeked_ = false;
+    if (decode_frame(buffer_.data(), frame_bytes_, dst, max_points, point_size, num_points) == 0) {
+        std::cerr << "Corrupt point codec frame." << std::endl;
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,498 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <string.h>
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+#include "point_io.h"
+#include "point_formats.h"
+
+namespace {
+
+const unsigned int kChunkPoints = 16384;
+
+struct NoField {};
+
+template <typename T>
+inline float load_field(const uint8_t *p)
+{
+    T v;
+    memcpy(&v, p, sizeof(v));
+    return (float)v;
+}
+
+template <>
+inline float load_field<NoField>(const uint8_t *)
+{
+    return 0.0f;
+}
+
+inline double load_any(FieldType type, const uint8_t *p)
+{
+    switch (type) {
+    case FieldType::kInt8: return load_field<int8_t>(p);
+    case FieldType::kUint8: return load_field<uint8_t>(p);
+    case FieldType::kInt16: return load_field<int16_t>(p);
+    case FieldType::kUint16: return load_field<uint16_t>(p);
+    case FieldType::kInt32: { int32_t v; memcpy(&v, p, 4); return v; }
+    case FieldType::kUint32: { uint32_t v; memcpy(&v, p, 4); return v; }
+    case FieldType::kFloat32: return load_field<float>(p);
+    case FieldType::kFloat64: { double v; memcpy(&v, p, 8); return v; }
+    default: return 0.0;
+    }
+}
+
+inline void zero_extra(float *d, unsigned int point_size)
+{
+    for (unsigned int c = 4; c < point_size; c++) {
+        d[c] = 0.0f;
+    }
+}
+
+// Unscaled xyz of type T, intensity of type I (NoField when absent).
+template <typename T, typename I>
+void copy_typed(const uint8_t *src, unsigned int num_points, const FieldLayout &layout,
+                float *dst, unsigned int point_size)
+{
+    const unsigned int stride = layout.stride;
+    const unsigned int ox = layout.offset[0], oy = layout.offset[1], oz = layout.offset[2];
+    const unsigned int oi = layout.offset[3];
+    const float is = (float)layout.scale[3];
+    for (unsigned int i = 0; i < num_points; i++, src += stride, dst += point_size) {
+        dst[0] = load_field<T>(src + ox);
+        dst[1] = load_field<T>(src + oy);
+        dst[2] = load_field<T>(src + oz);
+        dst[3] = load_field<I>(src + oi) * is;
+        zero_extra(dst, point_size);
+    }
+}
+
+// Scaled integer xyz (LAS): value = raw * scale + offset, in double so large
+// offsets do not lose the centimeters.
+template <typename I>
+void copy_scaled_int32(const uint8_t *src, unsigned int num_points, const FieldLayout &layout,
+                       float *dst, unsigned int point_size)
+{
+    const unsigned int stride = layout.stride;
+    const float is = (float)layout.scale[3];
+    for (unsigned int i = 0; i < num_points; i++, src += stride, dst += point_size) {
+        for (int c = 0; c < 3; c++) {
+            int32_t v;
+            memcpy(&v, src + layout.offset[c], 4);
+            dst[c] = (float)(v * layout.scale[c] + layout.bias[c]);
+        }
+        dst[3] = load_field<I>(src + layout.offset[3]) * is;
+        zero_extra(dst, point_size);
+    }
+}
+
+void copy_generic(const uint8_t *src, unsigned int num_points, const FieldLayout &layout,
+                  float *dst, unsigned int point_size)
+{
+    for (unsigned int i = 0; i < num_points; i++, src += layout.stride, dst += point_size) {
+        for (int c = 0; c < 4; c++) {
+            dst[c] = (float)(load_any(layout.type[c], src + layout.offset[c]) * layout.scale[c] + layout.bias[c]);
+        }
+        zero_extra(dst, point_size);
+    }
+}
+
+template <typename T>
+PointCopyFn select_intensity(FieldType intensity)
+{
+    switch (intensity) {
+    case FieldType::kNone: return copy_typed<T, NoField>;
+    case FieldType::kUint8: return copy_typed<T, uint8_t>;
+    case FieldType::kUint16: return copy_typed<T, uint16_t>;
+    case FieldType::kFloat32: return copy_typed<T, float>;
+    default: return nullptr;
+    }
+}
+
+unsigned int field_size(FieldType type)
+{
+    switch (type) {
+    case FieldType::kInt8: case FieldType::kUint8: return 1;
+    case FieldType::kInt16: case FieldType::kUint16: return 2;
+    case FieldType::kInt32: case FieldType::kUint32: case FieldType::kFloat32: return 4;
+    case FieldType::kFloat64: return 8;
+    default: return 0;
+    }
+}
+
+// Integer intensities are normalized to [0, 1], floats are kept.
+double intensity_scale(FieldType type)
+{
+    switch (type) {
+    case FieldType::kInt8: return 1.0 / 127;
+    case FieldType::kUint8: return 1.0 / 255;
+    case FieldType::kInt16: return 1.0 / 32767;
+    case FieldType::kUint16: return 1.0 / 65535;
+    case FieldType::kInt32: return 1.0 / 2147483647.0;
+    case FieldType::kUint32: return 1.0 / 4294967295.0;
+    default: return 1.0;
+    }
+}
+
+bool is_intensity_name(const std::string &name)
+{
+    return name == "intensity" || name == "i" || name == "reflectance" ||
+           name == "remission" || name == "scalar_intensity";
+}
+
+// Field index of x, y, z, intensity for a name, -1 for other fields.
+int channel_of(const std::string &name)
+{
+    if (name == "x") return 0;
+    if (name == "y") return 1;
+    if (name == "z") return 2;
+    if (is_intensity_name(name)) return 3;
+    return -1;
+}
+
+FieldType pcd_type(char type, unsigned int size)
+{
+    if (type == 'F') {
+        return size == 4 ? FieldType::kFloat32 : size == 8 ? FieldType::kFloat64 : FieldType::kNone;
+    }
+    if (type == 'I' || type == 'U') {
+        bool u = type == 'U';
+        switch (size) {
+        case 1: return u ? FieldType::kUint8 : FieldType::kInt8;
+        case 2: return u ? FieldType::kUint16 : FieldType::kInt16;
+        case 4: return u ? FieldType::kUint32 : FieldType::kInt32;
+        }
+    }
+    return FieldType::kNone;
+}
+
+FieldType ply_type(const std::string &type)
+{
+    if (type == "char" || type == "int8") return FieldType::kInt8;
+    if (type == "uchar" || type == "uint8") return FieldType::kUint8;
+    if (type == "short" || type == "int16") return FieldType::kInt16;
+    if (type == "ushort" || type == "uint16") return FieldType::kUint16;
+    if (type == "int" || type == "int32") return FieldType::kInt32;
+    if (type == "uint" || type == "uint32") return FieldType::kUint32;
+    if (type == "float" || type == "float32") return FieldType::kFloat32;
+    if (type == "double" || type == "float64") return FieldType::kFloat64;
+    return FieldType::kNone;
+}
+
+bool read_line(FILE *file, std::string &line)
+{
+    char buf[4096];
+    if (!fgets(buf, sizeof(buf), file)) {
+        return false;
+    }
+    line = buf;
+    while (!line.empty() && (line.back() == '\n' || line.back() == '\r')) {
+        line.pop_back();
+    }
+    return true;
+}
+
+bool has_xyz(const FieldLayout &layout)
+{
+    return layout.type[0] != FieldType::kNone && layout.type[1] != FieldType::kNone &&
+           layout.type[2] != FieldType::kNone;
+}
+
+} // namespace
+
+PointCopyFn select_point_copy(const FieldLayout &layout)
+{
+    const FieldType *t = layout.type;
+    bool same = t[0] == t[1] && t[1] == t[2];
+    bool unscaled = true;
+    for (int c = 0; c < 3; c++) {
+        unscaled = unscaled && layout.scale[c] == 1.0 && layout.bias[c] == 0.0;
+    }
+    PointCopyFn fn = nullptr;
+    if (same && unscaled && t[0] == FieldType::kFloat32) {
+        fn = select_intensity<float>(t[3]);
+    } else if (same && unscaled && t[0] == FieldType::kFloat64) {
+        fn = select_intensity<double>(t[3]);
+    } else if (same && t[0] == FieldType::kInt32 && t[3] == FieldType::kUint16) {
+        fn = copy_scaled_int32<uint16_t>;
+    }
+    return fn ? fn : copy_generic;
+}
+
+bool is_point_file(const std::string &path)
+{
+    return has_extension(path, ".pcd") || has_extension(path, ".ply") || has_extension(path, ".las");
+}
+
+PointFileReader::PointFileReader(const std::string &path)
+{
+    file_ = fopen(path.c_str(), "rb");
+    if (!file_) {
+        std::cout << "Can't open files: " << path << std::endl;
+        return;
+    }
+    int ret = -1;
+    if (has_extension(path, ".pcd")) {
+        ret = openPcd(path);
+    } else if (has_extension(path, ".ply")) {
+        ret = openPly(path);
+    } else if (has_extension(path, ".las")) {
+        ret = openLas(path);
+    }
+    if (ret == 0 && !has_xyz(layout_)) {
+        std::cerr << "No x, y, z fields in " << path << std::endl;
+        ret = -1;
+    }
+    if (ret != 0) {
+        fclose(file_);
+        file_ = nullptr;
+        return;
+    }
+    copy_ = select_point_copy(layout_);
+    raw_xyzi_ = layout_.stride == 4 * sizeof(float);
+    for (int c = 0; c < 4; c++) {
+        raw_xyzi_ = raw_xyzi_ && layout_.type[c] == FieldType::kFloat32 && layout_.offset[c] == c * sizeof(float);
+    }
+    remaining_ = num_points_;
+}
+
+PointFileReader::~PointFileReader(void)
+{
+    if (file_) {
+        fclose(file_);
+    }
+}
+
+int PointFileReader::openPcd(const std::string &path)
+{
+    std::vector<std::string> names;
+    std::vector<unsigned int> sizes, counts;
+    std::vector<char> types;
+    unsigned int width = 0, height = 1, points = 0;
+    bool have_points = false;
+    std::string line;
+    while (read_line(file_, line)) {
+        std::istringstream ss(line);
+        std::string key;
+        ss >> key;
+        if (key.empty() || key[0] == '#') {
+            continue;
+        }
+        if (key == "FIELDS") {
+            std::string name;
+            while (ss >> name) names.push_back(name);
+        } else if (key == "SIZE") {
+            unsigned int v;
+            while (ss >> v) sizes.push_back(v);
+        } else if (key == "TYPE") {
+            char v;
+            while (ss >> v) types.push_back(v);
+        } else if (key == "COUNT") {
+            unsigned int v;
+            while (ss >> v) counts.push_back(v);
+        } else if (key == "WIDTH") {
+            ss >> width;
+        } else if (key == "HEIGHT") {
+            ss >> height;
+        } else if (key == "POINTS") {
+            ss >> points;
+            have_points = true;
+        } else if (key == "DATA") {
+            std::string data;
+            ss >> data;
+            if (data != "binary") {
+                std::cerr << "Only DATA binary PCD files are supported, got " << data << ": " << path << std::endl;
+                return -1;
+            }
+            break;
+        }
+    }
+    if (counts.empty()) {
+        counts.assign(names.size(), 1);
+    }
+    if (names.empty() || sizes.size() != names.size() || types.size() != names.size() ||
+        counts.size() != names.size()) {
+        std::cerr << "Malformed PCD header: " << path << std::endl;
+        return -1;
+    }
+    unsigned int offset = 0;
+    for (size_t f = 0; f < names.size(); f++) {
+        int c = channel_of(names[f]);
+        if (c >= 0 && layout_.type[c] == FieldType::kNone) {
+            layout_.type[c] = pcd_type(types[f], sizes[f]);
+            layout_.offset[c] = offset;
+        }
+        offset += sizes[f] * counts[f];
+    }
+    layout_.stride = offset;
+    layout_.scale[3] = intensity_scale(layout_.type[3]);
+    num_points_ = have_points ? points : width * height;
+    return 0;
+}
+
+int PointFileReader::openPly(const std::string &path)
+{
+    std::string line;
+    if (!read_line(file_, line) || line != "ply") {
+        std::cerr << "Not a PLY file: " << path << std::endl;
+        return -1;
+    }
+    // bytes of fixed-size elements stored before the vertex element
+    unsigned long long skip = 0;
+    std::string element;
+    unsigned int element_count = 0;
+    unsigned int element_stride = 0;
+    bool fixed_size = true;
+    bool have_vertex = false;
+    while (read_line(file_, line)) {
+        std::istringstream ss(line);
+        std::string key;
+        ss >> key;
+        if (key == "format") {
+            std::string format;
+            ss >> format;
+            if (format != "binary_little_endian") {
+                std::cerr << "Only binary_little_endian PLY files are supported, got " << format << ": " << path << std::endl;
+                return -1;
+            }
+        } else if (key == "element" || key == "end_header") {
+            if (!have_vertex && !element.empty()) {
+                if (element == "vertex") {
+                    if (!fixed_size) {
+                        std::cerr << "PLY vertex element with list properties: " << path << std::endl;
+                        return -1;
+                    }
+                    have_vertex = true;
+                    num_points_ = element_count;
+                    layout_.stride = element_stride;
+                } else if (fixed_size) {
+                    skip += (unsigned long long)element_count * element_stride;
+                } else {
+                    std::cerr << "PLY element with list properties before vertex: " << path << std::endl;
+                    return -1;
+                }
+            }
+            if (key == "end_header") {
+                break;
+            }
+            ss >> element >> element_count;
+            element_stride = 0;
+            fixed_size = true;
+        } else if (key == "property") {
+            std::string type, name;
+            ss >> type >> name;
+            if (type == "list") {
+                fixed_size = false;
+                continue;
+            }
+            FieldType ft = ply_type(type);
+            if (ft == FieldType::kNone) {
+                std::cerr << "Unknown PLY property type " << type << ": " << path << std::endl;
+                return -1;
+            }
+            int c = channel_of(name);
+            if (element == "vertex" && c >= 0 && layout_.type[c] == FieldType::kNone) {
+                layout_.type[c] = ft;
+                layout_.offset[c] = element_stride;
+            }
+            element_stride += field_size(ft);
+        }
+    }
+    if (!have_vertex || line != "end_header") {
+        std::cerr << "Malformed PLY header: " << path << std::endl;
+        return -1;
+    }
+    if (skip && fseek(file_, (long)skip, SEEK_CUR) != 0) {
+        return -1;
+    }
+    layout_.scale[3] = intensity_scale(layout_.type[3]);
+    return 0;
+}
+
+int PointFileReader::openLas(const std::string &path)
+{
+    uint8_t header[375];
+    size_t got = fread(header, 1, sizeof(header), file_);
+    if (got < 227 || memcmp(header, "LASF", 4) != 0) {
+        std::cerr << "Not a LAS file: " << path << std::endl;
+        return -1;
+    }
+    uint8_t minor = header[25];
+    uint32_t data_offset, legacy_count;
+    uint16_t record_length;
+    memcpy(&data_offset, header + 96, 4);
+    uint8_t format = header[104];
+    memcpy(&record_length, header + 105, 2);
+    memcpy(&legacy_count, header + 107, 4);
+    if (format & 0xc0) {
+        std::cerr << "Compressed LAZ point data is not supported: " << path << std::endl;
+        return -1;
+    }
+    if (format > 10 || record_length < 14) {
+        std::cerr << "Unsupported LAS point format " << (int)format << ": " << path << std::endl;
+        return -1;
+    }
+    uint64_t count = legacy_count;
+    if (minor >= 4 && got >= 255 && legacy_count == 0) {
+        memcpy(&count, header + 247, 8);
+    }
+    for (int c = 0; c < 3; c++) {
+        memcpy(&layout_.scale[c], header + 131 + 8 * c, 8);
+        memcpy(&layout_.bias[c], header + 155 + 8 * c, 8);
+        layout_.type[c] = FieldType::kInt32;
+        layout_.offset[c] = 4 * c;
+    }
+    // every point format starts with int32 X, Y, Z and uint16 intensity
+    layout_.type[3] = FieldType::kUint16;
+    layout_.offset[3] = 12;
+    layout_.scale[3] = intensity_scale(FieldType::kUint16);
+    layout_.stride = record_length;
+    num_points_ = (unsigned int)std::min<uint64_t>(count, 0xffffffffu);
+    return fseek(file_, data_offset, SEEK_SET) == 0 ? 0 : -1;
+}
+
+int PointFileReader::read(float *dst, unsigned int max_points, unsigned int point_size, unsigned int *num_points)
+{
+    *num_points = 0;
+    if (!file_) {
+        return -1;
+    }
+    unsigned int want = std::min(max_points, remaining_);
+    if (raw_xyzi_ && point_size == 4) {
+        // records are already the model layout
+        size_t got = fread(dst, 4 * sizeof(float), want, file_);
+        remaining_ -= got;
+        *num_points = got;
+        return got == want ? 0 : -1;
+    }
+    chunk_.resize((size_t)kChunkPoints * layout_.stride);
+    while (*num_points < want) {
+        unsigned int n = std::min(kChunkPoints, want - *num_points);
+        size_t got = fread(chunk_.data(), layout_.stride, n, file_);
+        copy_(chunk_.data(), got, layout_, dst + (size_t)*num_points * point_size, point_size);
+        *num_points += got;
+        remaining_ -= got;
+        if (got != n) {
+            std::cerr << "Truncated point file." << std::endl;
+            remaining_ = 0;
+            return -1;
+        }
+    }
+    return 0;
+}
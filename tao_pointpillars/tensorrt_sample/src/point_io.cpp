@@ -0,0 +1,122 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <string.h>
+#include <strings.h>
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include "point_quant.h"
+#include "point_codec.h"
+#include "point_formats.h"
+#include "point_io.h"
+
+bool has_extension(const std::string &path, const char *ext)
+{
+  size_t n = strlen(ext);
+  return path.size() >= n && strcasecmp(path.c_str() + path.size() - n, ext) == 0;
+}
+
+static long file_length(std::ifstream &ifs)
+{
+  ifs.seekg(0, ifs.end);
+  long len = ifs.tellg();
+  ifs.seekg(0, ifs.beg);
+  return len;
+}
+
+int PointLoader::count(const std::string &path, unsigned int point_size, unsigned int *num_points)
+{
+  if (has_extension(path, ".ppc")) {
+    PointCodecReader reader(path);
+    if (!reader.isOpen() || reader.peekPoints(num_points) != 0) {
+      std::cerr << "Not a point codec archive: " << path << std::endl;
+      return -1;
+    }
+    return 0;
+  }
+  if (is_point_file(path)) {
+    PointFileReader reader(path);
+    if (!reader.isOpen()) {
+      return -1;
+    }
+    *num_points = reader.numPoints();
+    return 0;
+  }
+  std::ifstream ifs(path, std::ifstream::in | std::ifstream::binary);
+  if (!ifs.is_open()) {
+    std::cout << "Can't open files: " << path << std::endl;
+    return -1;
+  }
+  if (has_extension(path, ".ppq")) {
+    PointQuantHeader header;
+    if (!ifs.read((char *)&header, sizeof(header)) || memcmp(header.magic, "PPQ1", 4) != 0) {
+      std::cerr << "Not a quantized point file: " << path << std::endl;
+      return -1;
+    }
+    *num_points = header.num_points;
+    return 0;
+  }
+  *num_points = file_length(ifs) / sizeof(float) / point_size;
+  return 0;
+}
+
+int PointLoader::load(const std::string &path, float *dst, unsigned int max_points,
+                      unsigned int point_size, unsigned int *num_points)
+{
+  if (has_extension(path, ".ppc")) {
+    // first frame of the archive
+    PointCodecReader reader(path);
+    if (!reader.isOpen() || reader.next(dst, max_points, point_size, num_points) != 0) {
+      std::cerr << "Not a point codec archive: " << path << std::endl;
+      return -1;
+    }
+    return 0;
+  }
+  if (is_point_file(path)) {
+    // header parsed once, records converted chunk by chunk into dst
+    PointFileReader reader(path);
+    if (!reader.isOpen()) {
+      return -1;
+    }
+    return reader.read(dst, max_points, point_size, num_points);
+  }
+  std::ifstream ifs(path, std::ifstream::in | std::ifstream::binary);
+  if (!ifs.is_open()) {
+    std::cout << "Can't open files: " << path << std::endl;
+    return -1;
+  }
+  long len = file_length(ifs);
+
+  if (has_extension(path, ".ppq")) {
+    scratch_.resize(len);
+    ifs.read((char *)scratch_.data(), len);
+    if (check_quantized(scratch_.data(), len) != 0) {
+      std::cerr << "Not a quantized point file: " << path << std::endl;
+      return -1;
+    }
+    *num_points = dequantize_points(scratch_.data(), dst, max_points, point_size);
+    return 0;
+  }
+
+  // raw float32, read in place
+  unsigned int n = std::min((unsigned int)(len / sizeof(float) / point_size), max_points);
+  ifs.read((char *)dst, (size_t)n * point_size * sizeof(float));
+  *num_points = n;
+  return 0;
+}
@@ -0,0 +1,218 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <string.h>
+#include <math.h>
+#include <iostream>
+#include <algorithm>
+#include <thread>
+#include "point_order.h"
+
+// Run fn(begin, end, thread_index) over [0, n) split into num_threads chunks.
+template <typename Fn>
+static void parallel_for(unsigned int n, int num_threads, Fn fn)
+{
+  if (num_threads <= 1 || n < 4096) {
+    fn(0u, n, 0);
+    return;
+  }
+  std::vector<std::thread> workers;
+  unsigned int chunk = (n + num_threads - 1) / num_threads;
+  for (int t = 1; t < num_threads; t++) {
+    unsigned int begin = std::min(n, t * chunk), end = std::min(n, (t + 1) * chunk);
+    workers.emplace_back(fn, begin, end, t);
+  }
+  fn(0u, std::min(n, chunk), 0);
+  for (auto &w : workers) {
+    w.join();
+  }
+}
+
+static inline uint32_t part1by1(uint32_t x)
+{
+  x &= 0x0000ffff;
+  x = (x | (x << 8)) & 0x00ff00ff;
+  x = (x | (x << 4)) & 0x0f0f0f0f;
+  x = (x | (x << 2)) & 0x33333333;
+  x = (x | (x << 1)) & 0x55555555;
+  return x;
+}
+
+static inline uint32_t part1by2(uint32_t v)
+{
+  uint64_t x = v & 0x7ff;
+  x = (x | (x << 16)) & 0x1f0000ff0000ffULL;
+  x = (x | (x << 8)) & 0x100f00f00f00f00fULL;
+  x = (x | (x << 4)) & 0x10c30c30c30c30c3ULL;
+  x = (x | (x << 2)) & 0x1249249249249249ULL;
+  return (uint32_t)x;
+}
+
+static inline uint32_t quantize(float v, float lo, float inv_cell, uint32_t max_cell)
+{
+  float c = (v - lo) * inv_cell;
+  if (!(c > 0.0f)) {
+    return 0;
+  }
+  return std::min((uint32_t)c, max_cell);
+}
+
+MortonMode parse_morton_mode(const std::string &name)
+{
+  if (name == "2d") {
+    return MortonMode::k2D;
+  }
+  if (name == "3d") {
+    return MortonMode::k3D;
+  }
+  if (name != "none") {
+    std::cerr << "Unknown morton mode: " << name << ", using scan order." << std::endl;
+  }
+  return MortonMode::kNone;
+}
+
+MortonSorter::MortonSorter(MortonMode mode, const float *range, float cell_size, int num_threads)
+  : mode_(mode), auto_range_(range == nullptr), cell_size_(cell_size), num_threads_(num_threads)
+{
+  if (range) {
+    memcpy(range_, range, sizeof(range_));
+  }
+  if (num_threads_ <= 0) {
+    num_threads_ = std::max(1u, std::thread::hardware_concurrency());
+  }
+}
+
+void MortonSorter::computeKeys(const float *points, unsigned int num_points, unsigned int point_size)
+{
+  const float inv_cell = 1.0f / cell_size_;
+  const MortonMode mode = mode_;
+  const float *range = range_;
+  uint32_t *keys = keys_.data();
+  uint32_t *index = index_.data();
+  parallel_for(num_points, num_threads_, [=](unsigned int begin, unsigned int end, int) {
+    for (unsigned int i = begin; i < end; i++) {
+      const float *p = points + (size_t)i * point_size;
+      uint32_t key;
+      if (mode == MortonMode::k2D) {
+        key = part1by1(quantize(p[0], range[0], inv_cell, 0xffff)) |
+              (part1by1(quantize(p[1], range[1], inv_cell, 0xffff)) << 1);
+      } else {
+        key = part1by2(quantize(p[0], range[0], inv_cell, 0x7ff)) |
+              (part1by2(quantize(p[1], range[1], inv_cell, 0x7ff)) << 1) |
+              (part1by2(quantize(p[2], range[2], inv_cell, 0x3ff)) << 2);
+      }
+      keys[i] = key;
+      index[i] = i;
+    }
+  });
+}
+
+void MortonSorter::radixSort(unsigned int num_points)
+{
+  // byte positions that differ between keys; the others need no pass
+  uint32_t all_or = 0, all_and = 0xffffffff;
+  for (unsigned int i = 0; i < num_points; i++) {
+    all_or |= keys_[i];
+    all_and &= keys_[i];
+  }
+  const uint32_t varying = all_or ^ all_and;
+
+  std::vector<unsigned int> hist((size_t)num_threads_ * 256);
+  for (int shift = 0; shift < 32; shift += 8) {
+    if (((varying >> shift) & 0xff) == 0) {
+      continue;
+    }
+    std::fill(hist.begin(), hist.end(), 0);
+    const uint32_t *keys = keys_.data();
+    const uint32_t *index = index_.data();
+    uint32_t *keys_out = keys_tmp_.data();
+    uint32_t *index_out = index_tmp_.data();
+    unsigned int *h = hist.data();
+
+    parallel_for(num_points, num_threads_, [=](unsigned int begin, unsigned int end, int t) {
+      unsigned int *th = h + t * 256;
+      for (unsigned int i = begin; i < end; i++) {
+        th[(keys[i] >> shift) & 0xff]++;
+      }
+    });
+    // exclusive prefix over (digit, thread) keeps the sort stable
+    unsigned int sum = 0;
+    for (int d = 0; d < 256; d++) {
+      for (int t = 0; t < num_threads_; t++) {
+        unsigned int c = h[t * 256 + d];
+        h[t * 256 + d] = sum;
+        sum += c;
+      }
+    }
+    parallel_for(num_points, num_threads_, [=](unsigned int begin, unsigned int end, int t) {
+      unsigned int *th = h + t * 256;
+      for (unsigned int i = begin; i < end; i++) {
+        unsigned int pos = th[(keys[i] >> shift) & 0xff]++;
+        keys_out[pos] = keys[i];
+        index_out[pos] = index[i];
+      }
+    });
+    keys_.swap(keys_tmp_);
+    index_.swap(index_tmp_);
+  }
+}
+
+void MortonSorter::sort(const float *src, float *dst, unsigned int num_points, unsigned int point_size)
+{
+  // shrinking keeps the capacity, so steady-state calls do not allocate
+  keys_.resize(num_points);
+  keys_tmp_.resize(num_points);
+  index_.resize(num_points);
+  index_tmp_.resize(num_points);
+  if (mode_ == MortonMode::kNone) {
+    for (unsigned int i = 0; i < num_points; i++) {
+      index_[i] = i;
+    }
+    if (src != dst) {
+      memcpy(dst, src, (size_t)num_points * point_size * sizeof(float));
+    }
+    return;
+  }
+
+  if (auto_range_) {
+    range_[0] = range_[1] = range_[2] = INFINITY;
+    for (unsigned int i = 0; i < num_points; i++) {
+      const float *p = src + (size_t)i * point_size;
+      range_[0] = std::min(range_[0], p[0]);
+      range_[1] = std::min(range_[1], p[1]);
+      range_[2] = std::min(range_[2], p[2]);
+    }
+  }
+  computeKeys(src, num_points, point_size);
+  radixSort(num_points);
+
+  float *out = dst;
+  if (src == dst) {
+    scratch_.resize((size_t)num_points * point_size);
+    out = scratch_.data();
+  }
+  const uint32_t *index = index_.data();
+  parallel_for(num_points, num_threads_, [=](unsigned int begin, unsigned int end, int) {
+    for (unsigned int i = begin; i < end; i++) {
+      memcpy(out + (size_t)i * point_size, src + (size_t)index[i] * point_size, point_size * sizeof(float));
+    }
+  });
+  if (src == dst) {
+    memcpy(dst, out, (size_t)num_points * point_size * sizeof(float));
+  }
+}
@@ -0,0 +1,187 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+#include "point_quant.h"
+
+static const float kMinScale = 1e-6f;
+
+size_t quantized_size(unsigned int num_points)
+{
+  return sizeof(PointQuantHeader) + (size_t)num_points * (3 * sizeof(int16_t) + sizeof(uint8_t));
+}
+
+void quantize_points(
+  const float *points, unsigned int num_points, unsigned int point_size,
+  std::vector<uint8_t> &out, float *max_error)
+{
+  float lo[4] = {0.0f, 0.0f, 0.0f, 0.0f}, hi[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+  if (num_points > 0) {
+    for (int c = 0; c < 4; c++) {
+      lo[c] = hi[c] = points[c];
+    }
+  }
+  for (unsigned int i = 0; i < num_points; i++) {
+    const float *p = points + (size_t)i * point_size;
+    for (int c = 0; c < 4; c++) {
+      lo[c] = std::min(lo[c], p[c]);
+      hi[c] = std::max(hi[c], p[c]);
+    }
+  }
+
+  PointQuantHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, "PPQ1", 4);
+  header.num_points = num_points;
+  for (int c = 0; c < 3; c++) {
+    header.offset[c] = 0.5f * (lo[c] + hi[c]);
+    header.scale[c] = std::max((hi[c] - lo[c]) / 65534.0f, kMinScale);
+  }
+  header.offset[3] = lo[3];
+  header.scale[3] = std::max((hi[3] - lo[3]) / 255.0f, kMinScale);
+
+  out.resize(quantized_size(num_points));
+  memcpy(out.data(), &header, sizeof(header));
+  int16_t *q[3];
+  for (int c = 0; c < 3; c++) {
+    q[c] = (int16_t *)(out.data() + sizeof(header)) + (size_t)c * num_points;
+  }
+  uint8_t *qi = (uint8_t *)(q[2] + num_points);
+
+  float err = 0.0f;
+  for (unsigned int i = 0; i < num_points; i++) {
+    const float *p = points + (size_t)i * point_size;
+    for (int c = 0; c < 3; c++) {
+      float v = roundf((p[c] - header.offset[c]) / header.scale[c]);
+      int16_t s = (int16_t)std::max(-32767.0f, std::min(32767.0f, v));
+      q[c][i] = s;
+      err = std::max(err, fabsf(header.offset[c] + header.scale[c] * s - p[c]));
+    }
+    float v = roundf((p[3] - header.offset[3]) / header.scale[3]);
+    qi[i] = (uint8_t)std::max(0.0f, std::min(255.0f, v));
+    err = std::max(err, fabsf(header.offset[3] + header.scale[3] * qi[i] - p[3]));
+  }
+  if (max_error) {
+    *max_error = err;
+  }
+}
+
+int check_quantized(const uint8_t *data, size_t size)
+{
+  if (size < sizeof(PointQuantHeader) || memcmp(data, "PPQ1", 4) != 0) {
+    return -1;
+  }
+  const PointQuantHeader *header = (const PointQuantHeader *)data;
+  if (size < quantized_size(header->num_points)) {
+    return -1;
+  }
+  return 0;
+}
+
+unsigned int dequantize_points(const uint8_t *data, float *dst, unsigned int max_points, unsigned int point_size)
+{
+  PointQuantHeader header;
+  memcpy(&header, data, sizeof(header));
+  const int16_t *qx = (const int16_t *)(data + sizeof(header));
+  const int16_t *qy = qx + header.num_points;
+  const int16_t *qz = qy + header.num_points;
+  const uint8_t *qi = (const uint8_t *)(qz + header.num_points);
+  const unsigned int n = std::min(header.num_points, max_points);
+  const float *s = header.scale, *o = header.offset;
+
+  unsigned int i = 0;
+#if defined(__SSE2__)
+  const __m128 sx = _mm_set1_ps(s[0]), sy = _mm_set1_ps(s[1]), sz = _mm_set1_ps(s[2]), si = _mm_set1_ps(s[3]);
+  const __m128 ox = _mm_set1_ps(o[0]), oy = _mm_set1_ps(o[1]), oz = _mm_set1_ps(o[2]), oi = _mm_set1_ps(o[3]);
+  const __m128i zero = _mm_setzero_si128();
+  for (; i + 8 <= n; i += 8) {
+    __m128i x16 = _mm_loadu_si128((const __m128i *)(qx + i));
+    __m128i y16 = _mm_loadu_si128((const __m128i *)(qy + i));
+    __m128i z16 = _mm_loadu_si128((const __m128i *)(qz + i));
+    __m128i i16 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(qi + i)), zero);
+    for (int half = 0; half < 2; half++) {
+      // sign-extend int16 -> int32 by moving each value to the high half and shifting back
+      __m128i x32 = half ? _mm_unpackhi_epi16(x16, x16) : _mm_unpacklo_epi16(x16, x16);
+      __m128i y32 = half ? _mm_unpackhi_epi16(y16, y16) : _mm_unpacklo_epi16(y16, y16);
+      __m128i z32 = half ? _mm_unpackhi_epi16(z16, z16) : _mm_unpacklo_epi16(z16, z16);
+      __m128i w32 = half ? _mm_unpackhi_epi16(i16, zero) : _mm_unpacklo_epi16(i16, zero);
+      __m128 fx = _mm_add_ps(ox, _mm_mul_ps(sx, _mm_cvtepi32_ps(_mm_srai_epi32(x32, 16))));
+      __m128 fy = _mm_add_ps(oy, _mm_mul_ps(sy, _mm_cvtepi32_ps(_mm_srai_epi32(y32, 16))));
+      __m128 fz = _mm_add_ps(oz, _mm_mul_ps(sz, _mm_cvtepi32_ps(_mm_srai_epi32(z32, 16))));
+      __m128 fi = _mm_add_ps(oi, _mm_mul_ps(si, _mm_cvtepi32_ps(w32)));
+      // columns (x, y, z, i) -> rows (one point each)
+      _MM_TRANSPOSE4_PS(fx, fy, fz, fi);
+      float *p = dst + (size_t)(i + half * 4) * point_size;
+      _mm_storeu_ps(p, fx);
+      _mm_storeu_ps(p + point_size, fy);
+      _mm_storeu_ps(p + 2 * point_size, fz);
+      _mm_storeu_ps(p + 3 * point_size, fi);
+    }
+  }
+#elif defined(__ARM_NEON)
+  const float32x4_t sx = vdupq_n_f32(s[0]), sy = vdupq_n_f32(s[1]), sz = vdupq_n_f32(s[2]), si = vdupq_n_f32(s[3]);
+  const float32x4_t ox = vdupq_n_f32(o[0]), oy = vdupq_n_f32(o[1]), oz = vdupq_n_f32(o[2]), oi = vdupq_n_f32(o[3]);
+  for (; i + 8 <= n; i += 8) {
+    int16x8_t x16 = vld1q_s16(qx + i);
+    int16x8_t y16 = vld1q_s16(qy + i);
+    int16x8_t z16 = vld1q_s16(qz + i);
+    uint16x8_t i16 = vmovl_u8(vld1_u8(qi + i));
+    for (int half = 0; half < 2; half++) {
+      int16x4_t x4 = half ? vget_high_s16(x16) : vget_low_s16(x16);
+      int16x4_t y4 = half ? vget_high_s16(y16) : vget_low_s16(y16);
+      int16x4_t z4 = half ? vget_high_s16(z16) : vget_low_s16(z16);
+      uint16x4_t i4 = half ? vget_high_u16(i16) : vget_low_u16(i16);
+      float32x4x4_t v;
+      v.val[0] = vmlaq_f32(ox, sx, vcvtq_f32_s32(vmovl_s16(x4)));
+      v.val[1] = vmlaq_f32(oy, sy, vcvtq_f32_s32(vmovl_s16(y4)));
+      v.val[2] = vmlaq_f32(oz, sz, vcvtq_f32_s32(vmovl_s16(z4)));
+      v.val[3] = vmlaq_f32(oi, si, vcvtq_f32_u32(vmovl_u16(i4)));
+      float *p = dst + (size_t)(i + half * 4) * point_size;
+      if (point_size == 4) {
+        vst4q_f32(p, v);
+      } else {
+        float tmp[16];
+        vst4q_f32(tmp, v);
+        for (int k = 0; k < 4; k++) {
+          memcpy(p + k * point_size, tmp + k * 4, 4 * sizeof(float));
+        }
+      }
+    }
+  }
+#endif
+  for (; i < n; i++) {
+    float *p = dst + (size_t)i * point_size;
+    p[0] = o[0] + s[0] * qx[i];
+    p[1] = o[1] + s[1] * qy[i];
+    p[2] = o[2] + s[2] * qz[i];
+    p[3] = o[3] + s[3] * qi[i];
+  }
+  if (point_size > 4) {
+    for (unsigned int k = 0; k < n; k++) {
+      memset(dst + (size_t)k * point_size + 4, 0, (point_size - 4) * sizeof(float));
+    }
+  }
+  return n;
+}
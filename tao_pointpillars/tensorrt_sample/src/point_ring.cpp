@@ -0,0 +1,301 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <new>
+#include <thread>
+#include "point_ring.h"
+
+#if ATOMIC_LLONG_LOCK_FREE != 2
+#error "point ring needs lock-free 64-bit atomics"
+#endif
+
+struct PointRingHeader {
+    char magic[8];
+    uint32_t num_slots;
+    uint32_t max_points;
+    uint32_t point_size;
+    uint32_t header_bytes;
+    uint64_t slot_bytes;
+    uint64_t data_bytes;        // points part of a slot, the slot header follows
+    alignas(64) std::atomic<uint64_t> head;     // newest published frame
+    std::atomic<uint32_t> closed;
+};
+
+struct PointRingSlot {
+    std::atomic<uint64_t> seq;
+    std::atomic<uint32_t> num_points;
+    std::atomic<uint64_t> timestamp_ns;
+};
+
+namespace {
+
+const char kRingMagic[8] = "PPRING1";
+
+size_t round_up(size_t value, size_t align)
+{
+    return (value + align - 1) / align * align;
+}
+
+std::string shm_path(const std::string &name)
+{
+    return name.empty() || name[0] == '/' ? name : "/" + name;
+}
+
+inline float *slot_points(PointRingHeader *header, uint64_t seq)
+{
+    uint64_t index = (seq - 1) % header->num_slots;
+    return (float *)((char *)header + header->header_bytes + index * header->slot_bytes);
+}
+
+inline PointRingSlot *slot_of(PointRingHeader *header, uint64_t seq)
+{
+    return (PointRingSlot *)((char *)slot_points(header, seq) + header->data_bytes);
+}
+
+// Seqlock read of the frame metadata of slot seq.
+bool read_frame(PointRingHeader *header, uint64_t seq, PointRingFrame *frame)
+{
+    PointRingSlot *slot = slot_of(header, seq);
+    uint64_t s1 = slot->seq.load(std::memory_order_acquire);
+    unsigned int num_points = slot->num_points.load(std::memory_order_relaxed);
+    uint64_t timestamp_ns = slot->timestamp_ns.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint64_t s2 = slot->seq.load(std::memory_order_relaxed);
+    if (s1 != 2 * seq || s2 != s1) {
+        return false;
+    }
+    frame->seq = seq;
+    frame->points = slot_points(header, seq);
+    frame->num_points = num_points;
+    frame->timestamp_ns = timestamp_ns;
+    frame->slot = slot;
+    return true;
+}
+
+} // namespace
+
+PointRingWriter::PointRingWriter(const std::string &name, unsigned int num_slots, unsigned int max_points,
+                                 unsigned int point_size)
+    : name_(shm_path(name))
+{
+    if (num_slots < 2 || max_points == 0 || point_size == 0) {
+        std::cerr << "Point ring needs at least 2 slots and a non-empty slot size." << std::endl;
+        return;
+    }
+    size_t page = sysconf(_SC_PAGESIZE);
+    size_t header_bytes = round_up(sizeof(PointRingHeader), page);
+    size_t data_bytes = round_up((size_t)max_points * point_size * sizeof(float), 64);
+    size_t slot_bytes = round_up(data_bytes + sizeof(PointRingSlot), page);
+    bytes_ = header_bytes + slot_bytes * num_slots;
+
+    // a stale ring of a previous run is replaced; its readers keep their mapping
+    shm_unlink(name_.c_str());
+    int fd = shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) {
+        std::cerr << "Can't create shared memory " << name_ << ": " << strerror(errno) << std::endl;
+        return;
+    }
+    void *mem = MAP_FAILED;
+    if (ftruncate(fd, bytes_) == 0) {
+        mem = mmap(nullptr, bytes_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (mem == MAP_FAILED) {
+        std::cerr << "Can't map shared memory " << name_ << ": " << strerror(errno) << std::endl;
+        shm_unlink(name_.c_str());
+        return;
+    }
+
+    PointRingHeader *header = new (mem) PointRingHeader;
+    header->num_slots = num_slots;
+    header->max_points = max_points;
+    header->point_size = point_size;
+    header->header_bytes = header_bytes;
+    header->slot_bytes = slot_bytes;
+    header->data_bytes = data_bytes;
+    header->head.store(0, std::memory_order_relaxed);
+    header->closed.store(0, std::memory_order_relaxed);
+    for (unsigned int i = 1; i <= num_slots; i++) {
+        PointRingSlot *slot = new (slot_of(header, i)) PointRingSlot;
+        slot->seq.store(0, std::memory_order_relaxed);
+    }
+    // readers check the magic last
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(header->magic, kRingMagic, sizeof(kRingMagic));
+    header_ = header;
+}
+
+PointRingWriter::~PointRingWriter(void)
+{
+    if (header_) {
+        header_->closed.store(1, std::memory_order_release);
+        munmap(header_, bytes_);
+        shm_unlink(name_.c_str());
+    }
+}
+
+unsigned int PointRingWriter::maxPoints() const
+{
+    return header_->max_points;
+}
+
+unsigned int PointRingWriter::pointSize() const
+{
+    return header_->point_size;
+}
+
+float *PointRingWriter::beginWrite()
+{
+    writing_ = header_->head.load(std::memory_order_relaxed) + 1;
+    PointRingSlot *slot = slot_of(header_, writing_);
+    slot->seq.store(2 * writing_ - 1, std::memory_order_relaxed);
+    // the odd sequence is visible before any point is overwritten
+    std::atomic_thread_fence(std::memory_order_release);
+    return slot_points(header_, writing_);
+}
+
+uint64_t PointRingWriter::commit(unsigned int num_points, uint64_t timestamp_ns)
+{
+    PointRingSlot *slot = slot_of(header_, writing_);
+    slot->num_points.store(std::min(num_points, header_->max_points), std::memory_order_relaxed);
+    slot->timestamp_ns.store(timestamp_ns, std::memory_order_relaxed);
+    slot->seq.store(2 * writing_, std::memory_order_release);
+    header_->head.store(writing_, std::memory_order_release);
+    return writing_;
+}
+
+PointRingReader::PointRingReader(const std::string &name)
+{
+    std::string path = shm_path(name);
+    int fd = shm_open(path.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        std::cerr << "Can't open shared memory " << path << ": " << strerror(errno) << std::endl;
+        return;
+    }
+    struct stat st;
+    void *mem = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(PointRingHeader)) {
+        bytes_ = st.st_size;
+        mem = mmap(nullptr, bytes_, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (mem == MAP_FAILED) {
+        std::cerr << "Can't map shared memory " << path << std::endl;
+        return;
+    }
+    PointRingHeader *header = (PointRingHeader *)mem;
+    bool valid = memcmp(header->magic, kRingMagic, sizeof(kRingMagic)) == 0;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    valid = valid && header->num_slots >= 2 &&
+            header->header_bytes + header->slot_bytes * header->num_slots <= bytes_;
+    if (!valid) {
+        std::cerr << "Not a point ring: " << path << std::endl;
+        munmap(mem, bytes_);
+        return;
+    }
+    header_ = header;
+}
+
+PointRingReader::~PointRingReader(void)
+{
+    if (header_) {
+        munmap(header_, bytes_);
+    }
+}
+
+unsigned int PointRingReader::numSlots() const
+{
+    return header_->num_slots;
+}
+
+unsigned int PointRingReader::maxPoints() const
+{
+    return header_->max_points;
+}
+
+unsigned int PointRingReader::pointSize() const
+{
+    return header_->point_size;
+}
+
+bool PointRingReader::closed(uint64_t seq) const
+{
+    return header_->closed.load(std::memory_order_acquire) &&
+           header_->head.load(std::memory_order_acquire) <= seq;
+}
+
+int PointRingReader::acquire(uint64_t after_seq, int timeout_ms, PointRingFrame *frame)
+{
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    unsigned int spins = 0;
+    while (true) {
+        uint64_t seq = header_->head.load(std::memory_order_acquire);
+        if (seq > after_seq) {
+            if (read_frame(header_, seq, frame)) {
+                return 0;
+            }
+            // lapped between reading head and the slot, take the newer head
+            continue;
+        }
+        if (header_->closed.load(std::memory_order_acquire)) {
+            return -1;
+        }
+        if (timeout_ms >= 0 && std::chrono::steady_clock::now() >= deadline) {
+            return -1;
+        }
+        if (++spins < 64) {
+            sched_yield();
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    }
+}
+
+int PointRingReader::frame(uint64_t seq, PointRingFrame *frame)
+{
+    while (seq == 0) {
+        uint64_t head = header_->head.load(std::memory_order_acquire);
+        if (head == 0) {
+            return -1;
+        }
+        if (read_frame(header_, head, frame)) {
+            return 0;
+        }
+    }
+    if (seq > header_->head.load(std::memory_order_acquire)) {
+        return -1;
+    }
+    return read_frame(header_, seq, frame) ? 0 : -1;
+}
+
+bool PointRingReader::release(const PointRingFrame &frame) const
+{
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return frame.slot && frame.slot->seq.load(std::memory_order_relaxed) == 2 * frame.seq;
+}
@@ -0,0 +1,120 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <string.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+#include "point_transform.h"
+
+void pose_identity(float *out)
+{
+  memset(out, 0, 16 * sizeof(float));
+  out[0] = out[5] = out[10] = out[15] = 1.0f;
+}
+
+void pose_multiply(const float *a, const float *b, float *out)
+{
+  float tmp[16];
+  for (int r = 0; r < 4; r++) {
+    for (int c = 0; c < 4; c++) {
+      tmp[r * 4 + c] = a[r * 4 + 0] * b[0 * 4 + c] + a[r * 4 + 1] * b[1 * 4 + c] +
+                       a[r * 4 + 2] * b[2 * 4 + c] + a[r * 4 + 3] * b[3 * 4 + c];
+    }
+  }
+  memcpy(out, tmp, sizeof(tmp));
+}
+
+void pose_inverse_rigid(const float *pose, float *out)
+{
+  float tmp[16];
+  // R^T
+  for (int r = 0; r < 3; r++) {
+    for (int c = 0; c < 3; c++) {
+      tmp[r * 4 + c] = pose[c * 4 + r];
+    }
+  }
+  // -R^T * t
+  for (int r = 0; r < 3; r++) {
+    tmp[r * 4 + 3] = -(tmp[r * 4 + 0] * pose[3] + tmp[r * 4 + 1] * pose[7] + tmp[r * 4 + 2] * pose[11]);
+  }
+  tmp[12] = tmp[13] = tmp[14] = 0.0f;
+  tmp[15] = 1.0f;
+  memcpy(out, tmp, sizeof(tmp));
+}
+
+// Each point is handled as one 4-lane vector p = (x, y, z, i):
+//   p' = x * c0 + y * c1 + z * c2 + c3 + i * e3
+// where c0..c2 are the rotation columns and c3 the translation, all with a 0 in
+// lane 3, and e3 = (0, 0, 0, 1) carries the intensity through.
+// Every path loads a point before it stores it and walks forward, which the
+// overlap allowed in point_transform.h relies on; processing several points
+// at once would have to load all of them before the first store.
+void transform_points(
+  const float *src, unsigned int src_stride,
+  float *dst, unsigned int dst_stride,
+  unsigned int num_points,
+  const float *T)
+{
+#if defined(__SSE2__)
+  const __m128 c0 = _mm_setr_ps(T[0], T[4], T[8], 0.0f);
+  const __m128 c1 = _mm_setr_ps(T[1], T[5], T[9], 0.0f);
+  const __m128 c2 = _mm_setr_ps(T[2], T[6], T[10], 0.0f);
+  const __m128 c3 = _mm_setr_ps(T[3], T[7], T[11], 0.0f);
+  const __m128 e3 = _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+  for (unsigned int i = 0; i < num_points; i++) {
+    __m128 p = _mm_loadu_ps(src + (size_t)i * src_stride);
+    __m128 r = _mm_add_ps(c3, _mm_mul_ps(p, e3));
+    r = _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(p, p, _MM_SHUFFLE(0, 0, 0, 0)), c0));
+    r = _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(p, p, _MM_SHUFFLE(1, 1, 1, 1)), c1));
+    r = _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(p, p, _MM_SHUFFLE(2, 2, 2, 2)), c2));
+    _mm_storeu_ps(dst + (size_t)i * dst_stride, r);
+  }
+#elif defined(__ARM_NEON)
+  const float c0_[4] = {T[0], T[4], T[8], 0.0f};
+  const float c1_[4] = {T[1], T[5], T[9], 0.0f};
+  const float c2_[4] = {T[2], T[6], T[10], 0.0f};
+  const float c3_[4] = {T[3], T[7], T[11], 0.0f};
+  const float e3_[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+  const float32x4_t c0 = vld1q_f32(c0_);
+  const float32x4_t c1 = vld1q_f32(c1_);
+  const float32x4_t c2 = vld1q_f32(c2_);
+  const float32x4_t c3 = vld1q_f32(c3_);
+  const float32x4_t e3 = vld1q_f32(e3_);
+  for (unsigned int i = 0; i < num_points; i++) {
+    float32x4_t p = vld1q_f32(src + (size_t)i * src_stride);
+    float32x4_t r = vmlaq_f32(c3, p, e3);
+    r = vmlaq_n_f32(r, c0, vgetq_lane_f32(p, 0));
+    r = vmlaq_n_f32(r, c1, vgetq_lane_f32(p, 1));
+    r = vmlaq_n_f32(r, c2, vgetq_lane_f32(p, 2));
+    vst1q_f32(dst + (size_t)i * dst_stride, r);
+  }
+#else
+  for (unsigned int i = 0; i < num_points; i++) {
+    const float *p = src + (size_t)i * src_stride;
+    float *q = dst + (size_t)i * dst_stride;
+    float x = p[0], y = p[1], z = p[2], intensity = p[3];
+    q[0] = T[0] * x + T[1] * y + T[2] * z + T[3];
+    q[1] = T[4] * x + T[5] * y + T[6] * z + T[7];
+    q[2] = T[8] * x + T[9] * y + T[10] * z + T[11];
+    q[3] = intensity;
+  }
+#endif
+}
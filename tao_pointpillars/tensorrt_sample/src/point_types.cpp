@@ -0,0 +1,379 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <iostream>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define POINT_TYPES_F16C 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+#include "point_io.h"
+#include "point_transform.h"
+#include "point_types.h"
+
+namespace {
+
+// points per block of the fp16 kernels: 5 KB of floats, which stays in L1
+const unsigned int kBlock = 256;
+
+void halves_to_floats_scalar(const uint16_t *src, float *dst, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        dst[i] = half_to_float(src[i]);
+    }
+}
+
+void floats_to_halves_scalar(const float *src, uint16_t *dst, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        dst[i] = float_to_half(src[i]);
+    }
+}
+
+#if defined(POINT_TYPES_F16C)
+__attribute__((target("avx,f16c"))) void halves_to_floats_f16c(const uint16_t *src, float *dst, size_t n)
+{
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *)(src + i))));
+    }
+    halves_to_floats_scalar(src + i, dst + i, n - i);
+}
+
+__attribute__((target("avx,f16c"))) void floats_to_halves_f16c(const float *src, uint16_t *dst, size_t n)
+{
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT);
+        _mm_storeu_si128((__m128i *)(dst + i), h);
+    }
+    floats_to_halves_scalar(src + i, dst + i, n - i);
+}
+#elif defined(__aarch64__)
+void halves_to_floats_neon(const uint16_t *src, float *dst, size_t n)
+{
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        vst1q_f32(dst + i, vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(src + i))));
+    }
+    halves_to_floats_scalar(src + i, dst + i, n - i);
+}
+
+void floats_to_halves_neon(const float *src, uint16_t *dst, size_t n)
+{
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        vst1_u16(dst + i, vreinterpret_u16_f16(vcvt_f16_f32(vld1q_f32(src + i))));
+    }
+    floats_to_halves_scalar(src + i, dst + i, n - i);
+}
+#endif
+
+// The conversions of this CPU, resolved on first use.
+struct HalfConversions {
+    void (*to_floats)(const uint16_t *src, float *dst, size_t n);
+    void (*to_halves)(const float *src, uint16_t *dst, size_t n);
+
+    HalfConversions() : to_floats(halves_to_floats_scalar), to_halves(floats_to_halves_scalar)
+    {
+#if defined(POINT_TYPES_F16C)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx") && __builtin_cpu_supports("f16c")) {
+            to_floats = halves_to_floats_f16c;
+            to_halves = floats_to_halves_f16c;
+        }
+#elif defined(__aarch64__)
+        to_floats = halves_to_floats_neon;
+        to_halves = floats_to_halves_neon;
+#endif
+    }
+};
+
+const HalfConversions &half_conversions()
+{
+    static const HalfConversions conversions;
+    return conversions;
+}
+
+// Channels of n points to and from floats; fp32 channels are copied.
+inline void channels_to_floats(const float *src, float *dst, size_t n)
+{
+    memcpy(dst, src, n * sizeof(float));
+}
+
+inline void channels_to_floats(const uint16_t *src, float *dst, size_t n)
+{
+    half_conversions().to_floats(src, dst, n);
+}
+
+inline void floats_to_channels(const float *src, float *dst, size_t n)
+{
+    memcpy(dst, src, n * sizeof(float));
+}
+
+inline void floats_to_channels(const float *src, uint16_t *dst, size_t n)
+{
+    half_conversions().to_halves(src, dst, n);
+}
+
+// Copies n points of src_channels floats into dst_channels floats each,
+// zero filling or dropping channels at the end.
+void copy_channels(const float *src, unsigned int src_channels, float *dst, unsigned int dst_channels, size_t n)
+{
+    const unsigned int common = std::min(src_channels, dst_channels);
+    for (size_t i = 0; i < n; i++) {
+        const float *p = src + i * src_channels;
+        float *q = dst + i * dst_channels;
+        for (unsigned int c = 0; c < dst_channels; c++) {
+            q[c] = c < common ? p[c] : 0.0f;
+        }
+    }
+}
+
+template <typename P>
+bool is_fp32()
+{
+    return sizeof(typename PointTraits<P>::Channel) == sizeof(float);
+}
+
+} // namespace
+
+template <typename P>
+int load_points(const std::string &path, unsigned int file_channels, P *dst, unsigned int max_points)
+{
+    typedef PointTraits<P> Traits;
+    typedef typename Traits::Channel Channel;
+    const unsigned int kChannels = Traits::kChannels;
+    static_assert(sizeof(P) == kChannels * sizeof(Channel), "point layouts are packed channels");
+    if (file_channels == 0) {
+        std::cerr << "Can't open files: " << path << std::endl;
+        return -1;
+    }
+    // the file's own layout: PointLoader reads it straight into dst
+    if (is_fp32<P>() && file_channels == kChannels) {
+        PointLoader loader;
+        unsigned int num_points = 0;
+        if (loader.load(path, (float *)dst, max_points, kChannels, &num_points) != 0) {
+            return -1;
+        }
+        return num_points;
+    }
+
+    FILE *fp = fopen(path.c_str(), "rb");
+    struct stat st;
+    if (!fp || fstat(fileno(fp), &st) != 0) {
+        std::cerr << "Can't open files: " << path << std::endl;
+        if (fp) {
+            fclose(fp);
+        }
+        return -1;
+    }
+    size_t num_points = std::min((size_t)st.st_size / (file_channels * sizeof(float)), (size_t)max_points);
+    // convert in blocks that stay in cache
+    std::vector<float> block((size_t)kBlock * std::max(file_channels, kChannels));
+    std::vector<float> wide((size_t)kBlock * kChannels);
+    Channel *out = (Channel *)dst;
+    for (size_t done = 0; done < num_points;) {
+        size_t n = std::min((size_t)kBlock, num_points - done);
+        if (fread(block.data(), file_channels * sizeof(float), n, fp) != n) {
+            std::cerr << "Short read: " << path << std::endl;
+            fclose(fp);
+            return -1;
+        }
+        if (is_fp32<P>()) {
+            copy_channels(block.data(), file_channels, (float *)(out + done * kChannels), kChannels, n);
+        } else {
+            const float *v = block.data();
+            if (file_channels != kChannels) {
+                copy_channels(block.data(), file_channels, wide.data(), kChannels, n);
+                v = wide.data();
+            }
+            floats_to_channels(v, out + done * kChannels, n * kChannels);
+        }
+        done += n;
+    }
+    fclose(fp);
+    return num_points;
+}
+
+template <typename P>
+unsigned int crop_points(const P *src, unsigned int num_points, const float *range, P *dst)
+{
+    typedef PointTraits<P> Traits;
+    const unsigned int kChannels = Traits::kChannels;
+    const float x_min = range[0], y_min = range[1], z_min = range[2];
+    const float x_max = range[3], y_max = range[4], z_max = range[5];
+    float block[kBlock * kChannels];
+    unsigned int kept = 0;
+    for (unsigned int begin = 0; begin < num_points; begin += kBlock) {
+        unsigned int n = std::min(kBlock, num_points - begin);
+        const float *v = (const float *)(src + begin);
+        if (!is_fp32<P>()) {
+            channels_to_floats((const typename Traits::Channel *)(src + begin), block, (size_t)n * kChannels);
+            v = block;
+        }
+        for (unsigned int i = 0; i < n; i++) {
+            const float *p = v + (size_t)i * kChannels;
+            bool inside = (p[0] >= x_min) & (p[0] < x_max) & (p[1] >= y_min) & (p[1] < y_max) &
+                          (p[2] >= z_min) & (p[2] < z_max);
+            // scan order keeps long runs in or out of range, so this branch predicts well
+            if (inside) {
+                dst[kept++] = src[begin + i];
+            }
+        }
+    }
+    return kept;
+}
+
+template <typename P>
+void transform_points(const P *src, unsigned int num_points, const float *T, P *dst)
+{
+    typedef PointTraits<P> Traits;
+    const unsigned int kChannels = Traits::kChannels;
+    if (is_fp32<P>()) {
+        // x, y, z and the intensity; a fifth channel is left untouched in dst
+        ::transform_points((const float *)src, kChannels, (float *)dst, kChannels, num_points, T);
+        if (kChannels > 4 && (const void *)src != (void *)dst) {
+            for (unsigned int i = 0; i < num_points; i++) {
+                memcpy((float *)(dst + i) + 4, (const float *)(src + i) + 4, (kChannels - 4) * sizeof(float));
+            }
+        }
+        return;
+    }
+    float block[kBlock * kChannels];
+    typedef typename Traits::Channel Channel;
+    for (unsigned int begin = 0; begin < num_points; begin += kBlock) {
+        unsigned int n = std::min(kBlock, num_points - begin);
+        channels_to_floats((const Channel *)(src + begin), block, (size_t)n * kChannels);
+        ::transform_points(block, kChannels, block, kChannels, n, T);
+        floats_to_channels(block, (Channel *)(dst + begin), (size_t)n * kChannels);
+    }
+}
+
+template <typename P>
+void expand_points(const P *src, unsigned int num_points, float *dst, unsigned int dst_channels)
+{
+    typedef PointTraits<P> Traits;
+    typedef typename Traits::Channel Channel;
+    const unsigned int kChannels = Traits::kChannels;
+    if (dst_channels == kChannels) {
+        channels_to_floats((const Channel *)src, dst, (size_t)num_points * kChannels);
+        return;
+    }
+    float block[kBlock * kChannels];
+    for (unsigned int begin = 0; begin < num_points; begin += kBlock) {
+        unsigned int n = std::min(kBlock, num_points - begin);
+        const float *v = (const float *)(src + begin);
+        if (!is_fp32<P>()) {
+            channels_to_floats((const Channel *)(src + begin), block, (size_t)n * kChannels);
+            v = block;
+        }
+        copy_channels(v, kChannels, dst + (size_t)begin * dst_channels, dst_channels, n);
+    }
+}
+
+#define INSTANTIATE_POINT_KERNELS(P)                                                                 \
+    template int load_points<P>(const std::string &, unsigned int, P *, unsigned int);              \
+    template unsigned int crop_points<P>(const P *, unsigned int, const float *, P *);             \
+    template void transform_points<P>(const P *, unsigned int, const float *, P *);                \
+    template void expand_points<P>(const P *, unsigned int, float *, unsigned int);
+
+INSTANTIATE_POINT_KERNELS(PointXYZI)
+INSTANTIATE_POINT_KERNELS(PointXYZIT)
+INSTANTIATE_POINT_KERNELS(PointXYZIHalf)
+INSTANTIATE_POINT_KERNELS(PointXYZITHalf)
+
+namespace {
+
+template <typename P>
+int load_any(const std::string &path, unsigned int file_channels, void *dst, unsigned int max_points)
+{
+    return load_points<P>(path, file_channels, (P *)dst, max_points);
+}
+
+template <typename P>
+unsigned int crop_any(const void *src, unsigned int num_points, const float *range, void *dst)
+{
+    return crop_points<P>((const P *)src, num_points, range, (P *)dst);
+}
+
+template <typename P>
+void transform_any(const void *src, unsigned int num_points, const float *T, void *dst)
+{
+    transform_points<P>((const P *)src, num_points, T, (P *)dst);
+}
+
+template <typename P>
+void expand_any(const void *src, unsigned int num_points, float *dst, unsigned int dst_channels)
+{
+    expand_points<P>((const P *)src, num_points, dst, dst_channels);
+}
+
+template <typename P>
+PointKernels make_kernels(PointFormat format)
+{
+    PointKernels k;
+    k.format = format;
+    k.point_bytes = sizeof(P);
+    k.channels = PointTraits<P>::kChannels;
+    k.load = load_any<P>;
+    k.crop = crop_any<P>;
+    k.transform = transform_any<P>;
+    k.expand = expand_any<P>;
+    return k;
+}
+
+const char *kFormatNames[] = {"xyzi", "xyzit", "xyzi16", "xyzit16"};
+
+} // namespace
+
+bool parse_point_format(const char *name, PointFormat *format)
+{
+    for (int f = 0; f < 4; f++) {
+        if (std::string(name) == kFormatNames[f]) {
+            *format = (PointFormat)f;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char *point_format_name(PointFormat format)
+{
+    return kFormatNames[(int)format];
+}
+
+PointFormat point_format_for_channels(unsigned int channels)
+{
+    return channels >= 5 ? PointFormat::kXYZIT : PointFormat::kXYZI;
+}
+
+const PointKernels &point_kernels(PointFormat format)
+{
+    static const PointKernels table[] = {
+        make_kernels<PointXYZI>(PointFormat::kXYZI),
+        make_kernels<PointXYZIT>(PointFormat::kXYZIT),
+        make_kernels<PointXYZIHalf>(PointFormat::kXYZIHalf),
+        make_kernels<PointXYZITHalf>(PointFormat::kXYZITHalf),
+    };
+    return table[(int)format];
+}
@@ -21,6 +21,8 @@
 #include <iomanip>
 #include<map>
 #include<algorithm>
+#include <chrono>
+#include <thread>
 #include "cuda_runtime.h"
 #include "NvInfer.h"
 #include "NvOnnxConfig.h"
@@ -140,26 +142,22 @@ private:
 
 TRT::~TRT(void)
 {
-  context->destroy();
-  engine->destroy();
-  checkCudaErrors(cudaEventDestroy(start));
-  checkCudaErrors(cudaEventDestroy(stop));
+  if (engine) {
+    engine->destroy();
+  }
 }
 
 TRT::TRT(
   std::string modelFile,
   std::string modelCache,
-  cudaStream_t stream,
   const std::string& data_type
-):stream_(stream)
+)
 {
   initLibNvInferPlugins(&gLogger_, "");
 //   检查是否已经有缓存的TensorRT engine文件。
 // 如果有,则直接反序列化加载该engine文件,更快。
 // 如果没有,则从原始ONNX模型文件中加载并创建engine。
   std::fstream trtCache(modelCache, std::ifstream::in);
-  checkCudaErrors(cudaEventCreate(&start));
-  checkCudaErrors(cudaEventCreate(&stop));
   if (!trtCache.is_open())
   {
     std::cout << "Loading Model: " << modelFile << std::endl;
@@ -177,7 +175,10 @@ TRT::TRT(
     {
         std::cerr << ": Failed to parse onnx model file, please check the onnx version and trt support op!"
                   << std::endl;
-        exit(-1);
+        parser->destroy();
+        network->destroy();
+        builder->destroy();
+        return;
     }
     // dynamic shape 创建optimization profile来支持动态shape
     nvinfer1::IOptimizationProfile* profile = builder->createOptimizationProfile();
@@ -207,29 +208,31 @@ TRT::TRT(
     // 使用buildEngineWithConfig生成优化后的engine。
     engine = (builder->buildEngineWithConfig(*network, *networkConfig));
 
+    networkConfig->destroy();
+    parser->destroy();
+    network->destroy();
+    builder->destroy();
     if (engine == nullptr)
     {
       std::cerr << ": engine init null!" << std::endl;
-      exit(-1);
+      return;
     }
 
-    // serialize the engine, then close everything down
+    // serialize the engine to the cache
     auto trtModelStream = (engine->serialize());
     std::string modelCacheSave = modelFile + ".cache";
     std::fstream trtOut(modelCacheSave, std::ifstream::out);
     if (!trtOut.is_open())
     {
        std::cout << "Can't store trt cache.\n";
-       exit(-1);
+       trtModelStream->destroy();
+       engine->destroy();
+       engine = nullptr;
+       return;
     }
     trtOut.write((char*)trtModelStream->data(), trtModelStream->size());
     trtOut.close();
     trtModelStream->destroy();
-
-    networkConfig->destroy();
-    parser->destroy();
-    network->destroy();
-    builder->destroy();
   } else {
     std::cout << "Loading existing TRT Engine: "
               << modelCache
@@ -243,38 +246,52 @@ TRT::TRT(
     data = (char *)malloc(length);
     if (data == NULL ) {
        std::cout << "Can't malloc data.\n";
-       exit(-1);
+       return;
     }
     trtCache.read(data, length);
     // create context
     auto runtime = nvinfer1::createInferRuntime(gLogger_);
     if (runtime == nullptr) {
         std::cerr << ": runtime null!" << std::endl;
-        exit(-1);
+        free(data);
+        return;
     }
     engine = (runtime->deserializeCudaEngine(data, length, 0));
+    free(data);
+    trtCache.close();
     if (engine == nullptr) {
         std::cerr << ": engine null!" << std::endl;
-        exit(-1);
+        return;
     }
-    free(data);
-    trtCache.close();
   }
-  // 创建Execution Context
-  context = engine->createExecutionContext();
+}
 
+// Execution contexts hold the per-request activation state; the engine itself
+// is only read, so any number of contexts may run concurrently. Returns
+// nullptr when the context can't be created.
+nvinfer1::IExecutionContext *TRT::createContext()
+{
+  nvinfer1::IExecutionContext *context = engine->createExecutionContext();
+  if (context == nullptr) {
+    std::cerr << ": context null!" << std::endl;
+  }
+  return context;
 }
 
-int TRT::doinfer(void**buffers, bool do_profile)
+int TRT::doinfer(nvinfer1::IExecutionContext *context, void**buffers, cudaStream_t stream,
+                 cudaEvent_t input_consumed, bool do_profile)
 {
   int status;
   SimpleProfiler profiler("perf"); //创建profiler,用于推理性能分析。
   // 如果需要profile,将profiler设置到context中。
   if(do_profile) 
       context->setProfiler(&profiler);
-  status = context->enqueueV2(buffers, stream_, &start); // 调用context的enqueueV2函数执行推理。
-  if(do_profile)
+  status = context->enqueueV2(buffers, stream, &input_consumed); // 调用context的enqueueV2函数执行推理。
+  if(do_profile) {
+      cudaStreamSynchronize(stream);
       std::cout << profiler;
+      context->setProfiler(nullptr);
+  }
   if (!status)
   {
       return false;
@@ -284,73 +301,214 @@ int TRT::doinfer(void**buffers, bool do_profile)
 
 nvinfer1::Dims TRT::get_binding_shape(int index)
 {
-  return context->getBindingDimensions(index);
+  return engine->getBindingDimensions(index);
+}
+
+int TRT::getNbBindings()
+{
+  return engine->getNbBindings();
+}
+
+int TRT::getBindingIndex(const char *name)
+{
+  return engine->getBindingIndex(name);
 }
 
 int TRT::getPointSize() {
-    return context->getBindingDimensions(0).d[2];
+    return engine->getBindingDimensions(0).d[2];
+}
+
+int TRT::getMaxPoints() {
+    return engine->getBindingDimensions(0).d[1];
 }
 //PointPillar类构造函数:使用TensorRT加载ONNX模型到engine
 PointPillar::PointPillar(
   std::string modelFile,
   std::string engineFile,
   cudaStream_t stream,
-  const std::string& data_type
-):stream_(stream)
+  const std::string& data_type,
+  unsigned int num_contexts
+)
 {
+  num_contexts_ = std::max(num_contexts, 1u);
+  trt_.reset(new TRT(modelFile, engineFile, data_type));
+  if (!trt_->isLoaded()) {
+    return;
+  }
+  point_size_ = trt_->getPointSize();
+  max_points_ = trt_->getMaxPoints();
+  if (trt_->getNbBindings() == 5) {
+    // raw heads instead of box_output and box_num: find them by name, else
+    // take them in the order the exporter writes them
+    const char *names[3] = {"cls_preds", "box_preds", "dir_cls_preds"};
+    for (int h = 0; h < 3; h++) {
+      int index = trt_->getBindingIndex(names[h]);
+      head_bindings_[h] = index >= 2 ? index : 2 + h;
+    }
+    if (setDecoderConfig(BoxDecoderConfig()) != 0) {
+      return;
+    }
+  } else {
+    max_boxes_ = trt_->get_binding_shape(2).d[1];
+  }
 
-  checkCudaErrors(cudaEventCreate(&start));
-  checkCudaErrors(cudaEventCreate(&stop));
-
-  trt_.reset(new TRT(modelFile, engineFile, stream_, data_type));
-
-  //output of TRT
-  box_size = (trt_->get_binding_shape(2).d[1]) * 9 * sizeof(float);
-  checkCudaErrors(cudaMallocManaged((void **)&box_output, box_size));
-  checkCudaErrors(cudaMallocManaged((void **)&box_num, sizeof(int)));
-  res.reserve(100);
+  // all per-request state is allocated here, none per call
+  for (unsigned int i = 0; i < num_contexts_; i++) {
+    std::unique_ptr<PointPillarContext> ctx(new PointPillarContext());
+    ctx->context = trt_->createContext();
+    if (ctx->context == nullptr) {
+      return;
+    }
+    if (i == 0) {
+      ctx->stream = stream;
+    } else {
+      checkCudaErrors(cudaStreamCreate(&ctx->stream));
+      ctx->own_stream = true;
+    }
+    checkCudaErrors(cudaEventCreate(&ctx->start));
+    checkCudaErrors(cudaEventCreate(&ctx->stop));
+    checkCudaErrors(cudaEventCreateWithFlags(&ctx->input_consumed, cudaEventDisableTiming));
+    checkCudaErrors(cudaMalloc((void **)&ctx->points_dev, (size_t)max_points_ * point_size_ * sizeof(float)));
+    checkCudaErrors(cudaMalloc((void **)&ctx->points_num_dev, sizeof(unsigned int)));
+    if (decoder_) {
+      for (int h = 0; h < 3; h++) {
+        checkCudaErrors(cudaMalloc((void **)&ctx->heads[h], head_sizes_[h] * sizeof(float)));
+        checkCudaErrors(cudaMallocHost((void **)&ctx->heads_host[h], head_sizes_[h] * sizeof(float)));
+      }
+    } else {
+      checkCudaErrors(cudaMalloc((void **)&ctx->box_output, (size_t)max_boxes_ * 9 * sizeof(float)));
+      checkCudaErrors(cudaMalloc((void **)&ctx->box_num, sizeof(int)));
+      checkCudaErrors(cudaMallocHost((void **)&ctx->box_output_host, (size_t)max_boxes_ * 9 * sizeof(float)));
+      checkCudaErrors(cudaMallocHost((void **)&ctx->box_num_host, sizeof(int)));
+    }
+    ctx->res.reserve(100);
+    contexts_.add(std::move(ctx));
+  }
+  loaded_ = true;
 }
 
 PointPillar::~PointPillar(void)
 {
+  for (size_t i = 0; i < contexts_.size(); i++) {
+    PointPillarContext &ctx = contexts_.at(i);
+    ctx.context->destroy();
+    checkCudaErrors(cudaFree(ctx.points_dev));
+    checkCudaErrors(cudaFree(ctx.points_num_dev));
+    checkCudaErrors(cudaFree(ctx.box_output));
+    checkCudaErrors(cudaFree(ctx.box_num));
+    checkCudaErrors(cudaFreeHost(ctx.box_output_host));
+    checkCudaErrors(cudaFreeHost(ctx.box_num_host));
+    for (int h = 0; h < 3; h++) {
+      checkCudaErrors(cudaFree(ctx.heads[h]));
+      checkCudaErrors(cudaFreeHost(ctx.heads_host[h]));
+    }
+    checkCudaErrors(cudaEventDestroy(ctx.start));
+    checkCudaErrors(cudaEventDestroy(ctx.stop));
+    checkCudaErrors(cudaEventDestroy(ctx.input_consumed));
+    if (ctx.own_stream) {
+      checkCudaErrors(cudaStreamDestroy(ctx.stream));
+    }
+  }
   trt_.reset();
-
-  checkCudaErrors(cudaFree(box_output));
-  checkCudaErrors(cudaFree(box_num));
-  checkCudaErrors(cudaEventDestroy(start));
-  checkCudaErrors(cudaEventDestroy(stop));
 }
 // getPointSize
 int PointPillar::getPointSize() {
-  return trt_->getPointSize();
+  return point_size_;
 }
-//doinfer函数:执行TensorRT推理,获取预测框结果
-int PointPillar::doinfer(
+
+int PointPillar::getMaxPoints() {
+  return max_points_;
+}
+
+int PointPillar::setDecoderConfig(const BoxDecoderConfig &config)
+{
+  if (trt_->getNbBindings() != 5) {
+    std::cerr << "The engine outputs decoded boxes, it has no heads to decode." << std::endl;
+    return -1;
+  }
+  // NHWC heads: [1, grid_y, grid_x, channels]
+  nvinfer1::Dims cls = trt_->get_binding_shape(head_bindings_[0]);
+  BoxDecoderConfig c = config;
+  c.grid_y = cls.d[1];
+  c.grid_x = cls.d[2];
+  // every context decodes on its own helpers, so the cores are split between them
+  if (c.num_threads <= 0) {
+    c.num_threads = std::max(1u, std::thread::hardware_concurrency() / num_contexts_);
+  }
+  std::unique_ptr<BoxDecoder> decoder(new BoxDecoder(c));
+  const char *names[3] = {"cls", "box", "dir"};
+  int channels[3] = {decoder->clsChannels(), decoder->boxChannels(), decoder->dirChannels()};
+  for (int h = 0; h < 3; h++) {
+    nvinfer1::Dims d = trt_->get_binding_shape(head_bindings_[h]);
+    if (d.nbDims != 4 || d.d[1] != c.grid_y || d.d[2] != c.grid_x || d.d[3] != channels[h]) {
+      std::cerr << "The " << names[h] << " head of the engine doesn't match the anchors: expected "
+                << c.grid_y << "x" << c.grid_x << "x" << channels[h] << " values per frame." << std::endl;
+      return -1;
+    }
+    head_sizes_[h] = (size_t)c.grid_y * c.grid_x * channels[h];
+  }
+  decoder_ = std::move(decoder);
+  max_boxes_ = decoder_->maxCandidates();
+  return 0;
+}
+// Raw (pre-NMS) boxes of the engine for one cloud in device memory, on the
+// context's stream. Only that stream is synchronized, so contexts checked out
+// by other threads keep running.
+int PointPillar::infer(
+  PointPillarContext &ctx,
   void*points_data,
   unsigned int* points_size,
-  std::vector<Bndbox> &nms_pred,
-  float nms_iou_thresh,
-  int pre_nms_top_n,
-  std::vector<std::string>& class_names,
-  bool do_profile
+  std::vector<Bndbox> &boxes,
+  bool do_profile,
+  int top_k
 )
 {
 #if PERFORMANCE_LOG
   float doinferTime = 0.0f;
-  cudaEventRecord(start, stream_);
+  cudaEventRecord(ctx.start, ctx.stream);
 #endif
-  void *buffers[] = {points_data, points_size, box_output, box_num};
+  void *buffers[5] = {points_data, points_size, ctx.box_output, ctx.box_num, nullptr};
+  if (decoder_) {
+    for (int h = 0; h < 3; h++) {
+      buffers[head_bindings_[h]] = ctx.heads[h];
+    }
+  }
 
-  trt_->doinfer(buffers, do_profile);
+  trt_->doinfer(ctx.context, buffers, ctx.stream, ctx.input_consumed, do_profile);
 
 #if PERFORMANCE_LOG
-  checkCudaErrors(cudaEventRecord(stop, stream_));
-  checkCudaErrors(cudaEventSynchronize(stop));
-  checkCudaErrors(cudaEventElapsedTime(&doinferTime, start, stop));
+  checkCudaErrors(cudaEventRecord(ctx.stop, ctx.stream));
+  checkCudaErrors(cudaEventSynchronize(ctx.stop));
+  checkCudaErrors(cudaEventElapsedTime(&doinferTime, ctx.start, ctx.stop));
   std::cout<<"TIME: doinfer: "<< doinferTime <<" ms." <<std::endl;
 #endif
-  cudaDeviceSynchronize();
-  int num_obj = box_num[0];
+  if (decoder_) {
+    for (int h = 0; h < 3; h++) {
+      checkCudaErrors(cudaMemcpyAsync(ctx.heads_host[h], ctx.heads[h], head_sizes_[h] * sizeof(float),
+                                      cudaMemcpyDeviceToHost, ctx.stream));
+    }
+    checkCudaErrors(cudaStreamSynchronize(ctx.stream));
+#if PERFORMANCE_LOG
+    auto t0 = std::chrono::steady_clock::now();
+#endif
+    int num_obj = decoder_->decode(ctx.heads_host[0], ctx.heads_host[1], ctx.heads_host[2],
+                                   boxes, ctx.decode_scratch, top_k);
+#if PERFORMANCE_LOG
+    std::cout << "TIME: decode: "
+              << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count()
+              << " ms, " << num_obj << " candidates." << std::endl;
+#endif
+    (void)num_obj;
+    return 0;
+  }
+  // copy the box count, then only as many boxes as were produced
+  checkCudaErrors(cudaMemcpyAsync(ctx.box_num_host, ctx.box_num, sizeof(int), cudaMemcpyDeviceToHost, ctx.stream));
+  checkCudaErrors(cudaStreamSynchronize(ctx.stream));
+  int num_obj = std::min(ctx.box_num_host[0], (int)max_boxes_);
+  checkCudaErrors(cudaMemcpyAsync(ctx.box_output_host, ctx.box_output, (size_t)num_obj * 9 * sizeof(float),
+                                  cudaMemcpyDeviceToHost, ctx.stream));
+  checkCudaErrors(cudaStreamSynchronize(ctx.stream));
+  const float *box_output = ctx.box_output_host;
   for (int i = 0; i < num_obj; i++) {
     auto Bb = Bndbox(
       box_output[i * 9],
@@ -363,8 +521,55 @@ int PointPillar::doinfer(
       box_output[i * 9 + 7],
       box_output[i * 9 + 8]
     );
-    res.push_back(Bb);
+    boxes.push_back(Bb);
   }
+  return 0;
+}
+
+int PointPillar::infer(
+  void*points_data,
+  unsigned int* points_size,
+  std::vector<Bndbox> &boxes,
+  bool do_profile
+)
+{
+  ContextPool<PointPillarContext>::Lease ctx = contexts_.acquire();
+  // the caller's buffers may have been written on another stream or by the host
+  checkCudaErrors(cudaDeviceSynchronize());
+  return infer(*ctx, points_data, points_size, boxes, do_profile);
+}
+
+int PointPillar::inferHost(
+  const float *points,
+  unsigned int num_points,
+  std::vector<Bndbox> &boxes,
+  bool do_profile
+)
+{
+  ContextPool<PointPillarContext>::Lease ctx = contexts_.acquire();
+  num_points = std::min(num_points, max_points_);
+  checkCudaErrors(cudaMemcpyAsync(ctx->points_dev, points, (size_t)num_points * point_size_ * sizeof(float),
+                                  cudaMemcpyHostToDevice, ctx->stream));
+  checkCudaErrors(cudaMemcpyAsync(ctx->points_num_dev, &num_points, sizeof(unsigned int),
+                                  cudaMemcpyHostToDevice, ctx->stream));
+  return infer(*ctx, ctx->points_dev, ctx->points_num_dev, boxes, do_profile);
+}
+
+//doinfer函数:执行TensorRT推理,获取预测框结果
+int PointPillar::doinfer(
+  void*points_data,
+  unsigned int* points_size,
+  std::vector<Bndbox> &nms_pred,
+  float nms_iou_thresh,
+  int pre_nms_top_n,
+  const std::vector<std::string>& class_names,
+  bool do_profile
+)
+{
+  ContextPool<PointPillarContext>::Lease ctx = contexts_.acquire();
+  std::vector<Bndbox> &res = ctx->res;
+  checkCudaErrors(cudaDeviceSynchronize());
+  infer(*ctx, points_data, points_size, res, do_profile, pre_nms_top_n);
   nms_cpu(res, nms_iou_thresh, nms_pred, pre_nms_top_n);
   for(int i=0; i<nms_pred.size(); i++) {
     printf("%s, %f, %f, %f, %f, %f, %f, %f, %f\n",
@@ -375,4 +580,3 @@ int PointPillar::doinfer(
   res.clear();
 return 0;
 }
-
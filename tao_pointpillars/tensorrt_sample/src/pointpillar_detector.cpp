@@ -0,0 +1,62 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <iostream>
+#include "pointpillar_detector.h"
+
+#define checkCudaErrors(status)                                   \
+{                                                                 \
+  if (status != 0)                                                \
+  {                                                               \
+    std::cout << "Cuda failure: " << cudaGetErrorString(status)   \
+              << " at line " << __LINE__                          \
+              << " in file " << __FILE__                          \
+              << " error status: " << status                      \
+              << std::endl;                                       \
+              abort();                                            \
+    }                                                             \
+}
+
+PointPillarDetector::PointPillarDetector(const std::string &model_file, const std::string &engine_file,
+                                         const std::string &data_type)
+{
+    checkCudaErrors(cudaStreamCreate(&stream_));
+    pointpillar_.reset(new PointPillar(model_file, engine_file, stream_, data_type));
+    point_size_ = pointpillar_->getPointSize();
+    max_points_ = pointpillar_->getMaxPoints();
+}
+
+PointPillarDetector::PointPillarDetector(std::shared_ptr<PointPillar> pointpillar)
+    : pointpillar_(pointpillar)
+{
+    point_size_ = pointpillar_->getPointSize();
+    max_points_ = pointpillar_->getMaxPoints();
+}
+
+PointPillarDetector::~PointPillarDetector(void)
+{
+    pointpillar_.reset();
+    if (stream_) {
+        checkCudaErrors(cudaStreamDestroy(stream_));
+    }
+}
+
+int PointPillarDetector::infer(const float *points, unsigned int num_points, std::vector<Bndbox> &boxes)
+{
+    return pointpillar_->inferHost(points, num_points, boxes, false);
+}
@@ -0,0 +1,274 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stddef.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "pointpillars_c.h"
+#include "context_pool.h"
+#include "detector.h"
+#ifndef POINTPILLARS_CPU_ONLY
+#include "pointpillar_detector.h"
+#endif
+
+namespace {
+
+// per-context host scratch of one pp_infer() call
+struct Scratch {
+    std::vector<Bndbox> raw;
+    std::vector<Bndbox> kept;
+    std::vector<int> suppressed;
+};
+
+const unsigned int kStubMaxPoints = 204800;
+const unsigned int kStubMinPoints = 20;
+
+// the fields of the first ABI version; callers built against it pass this size
+const size_t kConfigV1Size = offsetof(pp_config, stub_latency_ms) + sizeof(float);
+
+} // namespace
+
+struct pp_detector {
+    std::unique_ptr<DetectorPool> detector;
+    ContextPool<Scratch> scratch;
+    float nms_iou_thresh = 0.01f;
+    int pre_nms_top_n = 4096;
+    std::mutex stats_mutex;
+    pp_stats stats;
+    double total_ms = 0.0;
+#ifndef POINTPILLARS_CPU_ONLY
+    cudaStream_t stream = NULL;
+
+    // the engine goes first, then the stream its first context runs on; this
+    // also cleans up after a pp_create() that failed half way
+    ~pp_detector()
+    {
+        detector.reset();
+        if (stream) {
+            cudaStreamDestroy(stream);
+        }
+    }
+#endif
+};
+
+extern "C" {
+
+void pp_config_init(pp_config *config)
+{
+    if (!config) {
+        return;
+    }
+    memset(config, 0, sizeof(*config));
+    config->struct_size = sizeof(*config);
+    config->model_path = "";
+    config->engine_path = "";
+    config->data_type = "fp32";
+    config->nms_iou_thresh = 0.01f;
+    config->pre_nms_top_n = 4096;
+    config->num_contexts = 1;
+    config->use_stub = 0;
+    config->stub_latency_ms = 0.0f;
+}
+
+pp_detector *pp_create(const pp_config *config)
+{
+    pp_detector *detector;
+    pp_create_ex(config, &detector);
+    return detector;
+}
+
+int pp_create_ex(const pp_config *caller_config, pp_detector **detector)
+{
+    if (!detector) {
+        return PP_ERROR_INVALID_ARGUMENT;
+    }
+    *detector = nullptr;
+    if (!caller_config || caller_config->struct_size < kConfigV1Size) {
+        std::cerr << "pp_create: invalid config" << std::endl;
+        return PP_ERROR_INVALID_ARGUMENT;
+    }
+    // fields the caller's version of pp_config doesn't have keep their defaults
+    pp_config defaults;
+    pp_config_init(&defaults);
+    memcpy(&defaults, caller_config, std::min(caller_config->struct_size, sizeof(defaults)));
+    const pp_config *config = &defaults;
+    if (config->num_contexts == 0 || config->pre_nms_top_n <= 0) {
+        std::cerr << "pp_create: invalid config" << std::endl;
+        return PP_ERROR_INVALID_ARGUMENT;
+    }
+    try {
+        std::unique_ptr<pp_detector> det(new pp_detector());
+        memset(&det->stats, 0, sizeof(det->stats));
+        det->nms_iou_thresh = config->nms_iou_thresh;
+        det->pre_nms_top_n = config->pre_nms_top_n;
+
+        std::vector<std::unique_ptr<Detector>> detectors;
+        size_t max_raw_boxes = 0;
+        bool stub = config->use_stub != 0;
+#ifdef POINTPILLARS_CPU_ONLY
+        if (!stub) {
+            std::cerr << "pp_create: CPU-only build, using the stub detector" << std::endl;
+        }
+        stub = true;
+#else
+        if (!stub) {
+            if (!config->engine_path || !config->model_path || !config->data_type) {
+                std::cerr << "pp_create: model, engine and data type are required" << std::endl;
+                return PP_ERROR_INVALID_ARGUMENT;
+            }
+            if (cudaStreamCreate(&det->stream) != 0) {
+                return PP_ERROR_INIT;
+            }
+            std::shared_ptr<PointPillar> pointpillar(new PointPillar(
+                config->model_path, config->engine_path, det->stream, config->data_type, config->num_contexts));
+            if (!pointpillar->isLoaded()) {
+                std::cerr << "pp_create: the engine failed to load" << std::endl;
+                return PP_ERROR_INIT;
+            }
+            max_raw_boxes = pointpillar->getMaxBoxes();
+            for (uint32_t i = 0; i < config->num_contexts; i++) {
+                detectors.emplace_back(new PointPillarDetector(pointpillar));
+            }
+        }
+#endif
+        if (stub) {
+            // two grids, each cell a box at most
+            max_raw_boxes = 2 * kStubMaxPoints / kStubMinPoints;
+            for (uint32_t i = 0; i < config->num_contexts; i++) {
+                detectors.emplace_back(new StubDetector(4, kStubMaxPoints, config->stub_latency_ms, 0.0f,
+                                                        4.0f, kStubMinPoints));
+            }
+        }
+        det->detector.reset(new DetectorPool(std::move(detectors)));
+
+        for (uint32_t i = 0; i < config->num_contexts; i++) {
+            std::unique_ptr<Scratch> scratch(new Scratch());
+            scratch->raw.reserve(max_raw_boxes);
+            scratch->kept.reserve(config->pre_nms_top_n);
+            scratch->suppressed.reserve(config->pre_nms_top_n);
+            det->scratch.add(std::move(scratch));
+        }
+        *detector = det.release();
+        return PP_OK;
+    } catch (const std::exception &e) {
+        std::cerr << "pp_create: " << e.what() << std::endl;
+        return PP_ERROR_INIT;
+    }
+}
+
+uint32_t pp_point_size(const pp_detector *detector)
+{
+    return detector ? detector->detector->pointSize() : 0;
+}
+
+uint32_t pp_max_points(const pp_detector *detector)
+{
+    return detector ? detector->detector->maxPoints() : 0;
+}
+
+int pp_infer(pp_detector *detector, const float *points, uint32_t num_points,
+             pp_box *boxes, uint32_t max_boxes, uint32_t *num_boxes)
+{
+    if (!detector || (!points && num_points) || (!boxes && max_boxes) || !num_boxes) {
+        return PP_ERROR_INVALID_ARGUMENT;
+    }
+    *num_boxes = 0;
+    try {
+        auto t0 = std::chrono::steady_clock::now();
+        // scratch and detector pools are the same size, so only this can wait
+        ContextPool<Scratch>::Lease scratch = detector->scratch.acquire();
+        uint32_t max_points = detector->detector->maxPoints();
+        uint32_t clipped = num_points > max_points ? num_points - max_points : 0;
+        scratch->raw.clear();
+        scratch->kept.clear();
+        if (detector->detector->infer(points, num_points - clipped, scratch->raw) != 0) {
+            return PP_ERROR_INFER;
+        }
+        nms_cpu_inplace(scratch->raw, detector->nms_iou_thresh, scratch->kept, detector->pre_nms_top_n,
+                        scratch->suppressed);
+        uint32_t n = (uint32_t)std::min<size_t>(scratch->kept.size(), max_boxes);
+        for (uint32_t i = 0; i < n; i++) {
+            const Bndbox &b = scratch->kept[i];
+            pp_box &out = boxes[i];
+            out.x = b.x;
+            out.y = b.y;
+            out.z = b.z;
+            out.w = b.w;
+            out.l = b.l;
+            out.h = b.h;
+            out.rt = b.rt;
+            out.id = b.id;
+            out.score = b.score;
+        }
+        *num_boxes = n;
+        bool truncated = scratch->kept.size() > n;
+        scratch.reset();
+
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        std::lock_guard<std::mutex> lock(detector->stats_mutex);
+        pp_stats &stats = detector->stats;
+        stats.frames++;
+        stats.boxes += n;
+        stats.truncated_frames += truncated ? 1 : 0;
+        stats.clipped_points += clipped;
+        stats.last_ms = ms;
+        stats.max_ms = std::max(stats.max_ms, ms);
+        detector->total_ms += ms;
+        stats.mean_ms = detector->total_ms / stats.frames;
+        return truncated ? PP_TRUNCATED : PP_OK;
+    } catch (const std::exception &e) {
+        std::cerr << "pp_infer: " << e.what() << std::endl;
+        return PP_ERROR_INFER;
+    }
+}
+
+int pp_get_stats(pp_detector *detector, pp_stats *stats)
+{
+    if (!detector || !stats) {
+        return PP_ERROR_INVALID_ARGUMENT;
+    }
+    unsigned long long waits = detector->scratch.waits();
+    std::lock_guard<std::mutex> lock(detector->stats_mutex);
+    *stats = detector->stats;
+    stats->context_waits = waits;
+    return PP_OK;
+}
+
+void pp_destroy(pp_detector *detector)
+{
+    delete detector;
+}
+
+const char *pp_status_string(int status)
+{
+    switch (status) {
+        case PP_OK: return "ok";
+        case PP_TRUNCATED: return "output truncated to max_boxes";
+        case PP_ERROR_INVALID_ARGUMENT: return "invalid argument";
+        case PP_ERROR_INIT: return "initialization failed";
+        case PP_ERROR_INFER: return "inference failed";
+        default: return "unknown status";
+    }
+}
+
+} // extern "C"
@@ -18,8 +18,16 @@
 #include <iostream>
 #include <vector>
 #include <algorithm>
+#include <unordered_map>
 #include <math.h>
+#include <stdint.h>
+#ifdef POINTPILLARS_CPU_ONLY
+struct float2 {
+    float x, y;
+};
+#else
 #include <cuda_runtime_api.h>
+#endif
 #include "postprocess.h"
 
 #define checkCudaErrors(status)                                   \
@@ -209,17 +217,31 @@ int nms_cpu(
     std::vector<Bndbox> bndboxes,
     const float nms_thresh,
     std::vector<Bndbox> &nms_pred,
-    const int pre_nms_top_n)
+    const int pre_nms_top_n,
+    size_t *iou_count)
+{
+    std::vector<int> suppressed;
+    return nms_cpu_inplace(bndboxes, nms_thresh, nms_pred, pre_nms_top_n, suppressed, iou_count);
+}
+
+int nms_cpu_inplace(
+    std::vector<Bndbox> &bndboxes,
+    const float nms_thresh,
+    std::vector<Bndbox> &nms_pred,
+    const int pre_nms_top_n,
+    std::vector<int> &suppressed,
+    size_t *iou_count)
 {
     std::sort(bndboxes.begin(), bndboxes.end(),
               [](Bndbox boxes1, Bndbox boxes2) { return boxes1.score > boxes2.score; });
-    std::vector<int> suppressed(std::min(int(bndboxes.size()), pre_nms_top_n), 0);
-    for (size_t i = 0; i < std::min(int(bndboxes.size()), pre_nms_top_n); i++) {
+    const size_t n = std::min(bndboxes.size(), (size_t)std::max(pre_nms_top_n, 0));
+    suppressed.assign(n, 0);
+    for (size_t i = 0; i < n; i++) {
         if (suppressed[i] == 1) {
             continue;
         }
         nms_pred.emplace_back(bndboxes[i]);
-        for (size_t j = i + 1; j < std::min(int(bndboxes.size()), pre_nms_top_n); j++) {
+        for (size_t j = i + 1; j < n; j++) {
             if (suppressed[j] == 1) {
                 continue;
             }
@@ -231,7 +253,115 @@ int nms_cpu(
             if (iou >= nms_thresh) {
                 suppressed[j] = 1;
             }
+            if (iou_count) {
+                (*iou_count)++;
+            }
+        }
+    }
+    return 0;
+}
+
+int nms_cpu_rows(
+    const float *rows,
+    size_t num_rows,
+    size_t row_stride,
+    const float nms_thresh,
+    const int pre_nms_top_n,
+    std::vector<int> &keep,
+    NmsScratch &scratch)
+{
+    std::vector<int> &order = scratch.order;
+    order.resize(num_rows);
+    for (size_t i = 0; i < num_rows; i++) {
+        order[i] = (int)i;
+    }
+    std::sort(order.begin(), order.end(),
+              [rows, row_stride](int a, int b) { return rows[a * row_stride + 8] > rows[b * row_stride + 8]; });
+    size_t num = std::min(num_rows, (size_t)std::max(pre_nms_top_n, 0));
+    scratch.sorted.resize(num);
+    for (size_t i = 0; i < num; i++) {
+        scratch.sorted[i] = bndbox_from_row(rows + order[i] * row_stride);
+    }
+    std::vector<int> &suppressed = scratch.suppressed;
+    suppressed.assign(num, 0);
+    const std::vector<Bndbox> &boxes = scratch.sorted;
+    for (size_t i = 0; i < num; i++) {
+        if (suppressed[i] == 1) {
+            continue;
+        }
+        keep.push_back(order[i]);
+        for (size_t j = i + 1; j < num; j++) {
+            if (suppressed[j] == 1) {
+                continue;
+            }
+            if (box_iou_bev(boxes[i], boxes[j]) >= nms_thresh) {
+                suppressed[j] = 1;
+            }
+        }
+    }
+    return 0;
+}
+
+float box_iou_bev(const Bndbox &box_a, const Bndbox &box_b)
+{
+    float sa = box_a.l * box_a.w;
+    float sb = box_b.l * box_b.w;
+    float s_overlap = box_overlap(box_a, box_b);
+    return s_overlap / fmaxf(sa + sb - s_overlap, ThresHold);
+}
+
+static inline uint64_t grid_key(int cx, int cy)
+{
+    return (uint64_t)(uint32_t)cx << 32 | (uint32_t)cy;
+}
+
+int nms_cpu_spatial(
+    std::vector<Bndbox> bndboxes,
+    const float nms_thresh,
+    std::vector<Bndbox> &nms_pred,
+    const float cell_size)
+{
+    std::sort(bndboxes.begin(), bndboxes.end(),
+              [](const Bndbox &boxes1, const Bndbox &boxes2) { return boxes1.score > boxes2.score; });
+    // cell -> indices into nms_pred of the kept boxes whose center is in that cell
+    std::unordered_map<uint64_t, std::vector<int>> grid;
+    float max_radius = 0.0f;
+
+    for (size_t i = 0; i < bndboxes.size(); i++) {
+        const Bndbox &box = bndboxes[i];
+        float radius = 0.5f * sqrtf(box.l * box.l + box.w * box.w);
+        // two boxes can only overlap if their centers are closer than the sum of the radii
+        float reach = radius + max_radius;
+        int cx0 = (int)floorf((box.x - reach) / cell_size), cx1 = (int)floorf((box.x + reach) / cell_size);
+        int cy0 = (int)floorf((box.y - reach) / cell_size), cy1 = (int)floorf((box.y + reach) / cell_size);
+        bool suppressed = false;
+        for (int cx = cx0; cx <= cx1 && !suppressed; cx++) {
+            for (int cy = cy0; cy <= cy1 && !suppressed; cy++) {
+                auto it = grid.find(grid_key(cx, cy));
+                if (it == grid.end()) {
+                    continue;
+                }
+                for (int k : it->second) {
+                    const Bndbox &kept = nms_pred[k];
+                    float dx = kept.x - box.x, dy = kept.y - box.y;
+                    float kept_radius = 0.5f * sqrtf(kept.l * kept.l + kept.w * kept.w);
+                    if (dx * dx + dy * dy >= (radius + kept_radius) * (radius + kept_radius)) {
+                        continue;
+                    }
+                    if (box_iou_bev(kept, box) >= nms_thresh) {
+                        suppressed = true;
+                        break;
+                    }
+                }
+            }
+        }
+        if (suppressed) {
+            continue;
         }
+        int cx = (int)floorf(box.x / cell_size), cy = (int)floorf(box.y / cell_size);
+        grid[grid_key(cx, cy)].push_back(int(nms_pred.size()));
+        nms_pred.emplace_back(box);
+        max_radius = std::max(max_radius, radius);
     }
     return 0;
 }
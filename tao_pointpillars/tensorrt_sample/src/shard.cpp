@@ -0,0 +1,190 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <queue>
+#include <sstream>
+#include <unordered_map>
+#include "shard.h"
+
+int load_file_list(const std::string &list_file, std::vector<ShardFile> &files)
+{
+    std::ifstream ifs(list_file);
+    if (!ifs.is_open()) {
+        std::cerr << "Can't open files: " << list_file << std::endl;
+        return -1;
+    }
+    std::string line;
+    while (std::getline(ifs, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        std::istringstream iss(line);
+        ShardFile file;
+        if (!(iss >> file.path)) {
+            continue;
+        }
+        if (!(iss >> file.bytes)) {
+            struct stat st;
+            if (stat(file.path.c_str(), &st) != 0) {
+                std::cerr << "Can't stat " << file.path << std::endl;
+                return -1;
+            }
+            file.bytes = st.st_size;
+        }
+        files.push_back(file);
+    }
+    return 0;
+}
+
+void partition_shards(const std::vector<ShardFile> &files, unsigned int num_shards,
+                      std::vector<unsigned int> &shard_of)
+{
+    num_shards = std::max(1u, num_shards);
+    std::vector<size_t> order(files.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(),
+                     [&](size_t a, size_t b) { return files[a].bytes > files[b].bytes; });
+    // (bytes, shard), lightest and then lowest shard on top
+    typedef std::pair<uint64_t, unsigned int> Load;
+    std::priority_queue<Load, std::vector<Load>, std::greater<Load>> loads;
+    for (unsigned int s = 0; s < num_shards; s++) {
+        loads.push(Load(0, s));
+    }
+    shard_of.assign(files.size(), 0);
+    for (size_t i : order) {
+        Load load = loads.top();
+        loads.pop();
+        shard_of[i] = load.second;
+        load.first += files[i].bytes;
+        loads.push(load);
+    }
+}
+
+size_t find_duplicate_stems(const std::vector<ShardFile> &files)
+{
+    std::unordered_map<std::string, size_t> first;
+    first.reserve(files.size());
+    size_t duplicates = 0;
+    for (size_t i = 0; i < files.size(); i++) {
+        const std::string &path = files[i].path;
+        std::string stem = path.substr(path.find_last_of('/') + 1);
+        stem = stem.substr(0, stem.find_last_of('.'));
+        auto inserted = first.emplace(stem, i);
+        if (!inserted.second) {
+            std::cerr << "Result " << stem << ".txt of " << path << " (line " << i + 1
+                      << ") would overwrite that of " << files[inserted.first->second].path << std::endl;
+            duplicates++;
+        }
+    }
+    return duplicates;
+}
+
+uint64_t shard_fingerprint(const std::vector<ShardFile> &files, unsigned int num_shards)
+{
+    // FNV-1a over the shard count and every path and size
+    uint64_t h = 1469598103934665603ull;
+    auto mix = [&](const void *data, size_t size) {
+        const unsigned char *p = (const unsigned char *)data;
+        for (size_t i = 0; i < size; i++) {
+            h = (h ^ p[i]) * 1099511628211ull;
+        }
+    };
+    mix(&num_shards, sizeof(num_shards));
+    for (const auto &file : files) {
+        mix(file.path.c_str(), file.path.size() + 1);
+        mix(&file.bytes, sizeof(file.bytes));
+    }
+    return h;
+}
+
+int write_shard_manifest(const std::string &path, const ShardManifest &manifest)
+{
+    std::string tmp = path + ".tmp";
+    FILE *fp = fopen(tmp.c_str(), "w");
+    if (!fp) {
+        std::cerr << "Can't create manifest " << path << std::endl;
+        return -1;
+    }
+    fprintf(fp, "# pointpillars shard manifest\n");
+    fprintf(fp, "shard %u %u\n", manifest.shard, manifest.num_shards);
+    fprintf(fp, "list %016" PRIx64 " %zu\n", manifest.fingerprint, manifest.list_size);
+    fprintf(fp, "# index status bytes points boxes input output\n");
+    for (const auto &e : manifest.entries) {
+        fprintf(fp, "%zu %d %" PRIu64 " %u %zu %s %s\n", e.index, e.status, e.bytes, e.num_points,
+                e.num_boxes, e.input.c_str(), e.output.empty() ? "-" : e.output.c_str());
+    }
+    bool ok = fclose(fp) == 0;
+    if (!ok || rename(tmp.c_str(), path.c_str()) != 0) {
+        std::cerr << "Can't write manifest " << path << std::endl;
+        remove(tmp.c_str());
+        return -1;
+    }
+    return 0;
+}
+
+int read_shard_manifest(const std::string &path, ShardManifest &manifest)
+{
+    std::ifstream ifs(path);
+    if (!ifs.is_open()) {
+        std::cerr << "Can't open manifest " << path << std::endl;
+        return -1;
+    }
+    manifest = ShardManifest();
+    bool have_shard = false, have_list = false;
+    std::string line;
+    while (std::getline(ifs, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        std::istringstream iss(line);
+        bool ok;
+        if (line.compare(0, 6, "shard ") == 0) {
+            std::string key;
+            ok = (bool)(iss >> key >> manifest.shard >> manifest.num_shards);
+            have_shard = true;
+        } else if (line.compare(0, 5, "list ") == 0) {
+            std::string key;
+            ok = (bool)(iss >> key >> std::hex >> manifest.fingerprint >> std::dec >> manifest.list_size);
+            have_list = true;
+        } else {
+            ShardEntry e;
+            ok = (bool)(iss >> e.index >> e.status >> e.bytes >> e.num_points >> e.num_boxes >> e.input >> e.output);
+            if (e.output == "-") {
+                e.output.clear();
+            }
+            manifest.entries.push_back(e);
+        }
+        if (!ok) {
+            std::cerr << "Bad manifest line in " << path << ": " << line << std::endl;
+            return -1;
+        }
+    }
+    if (!have_shard || !have_list) {
+        std::cerr << "Incomplete manifest: " << path << std::endl;
+        return -1;
+    }
+    return 0;
+}
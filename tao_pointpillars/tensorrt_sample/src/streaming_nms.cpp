@@ -0,0 +1,123 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <math.h>
+#include <algorithm>
+#include "streaming_nms.h"
+
+static inline float circumradius(const Bndbox &box)
+{
+    // a little larger so that rounding can't skip an overlapping pair
+    return 0.5f * sqrtf(box.l * box.l + box.w * box.w) + 1e-3f;
+}
+
+namespace {
+
+// heap order: higher score first, then lower input index
+struct ScoreOrder {
+    const Bndbox *b;
+    bool operator()(int x, int y) const
+    {
+        return b[x].score < b[y].score || (b[x].score == b[y].score && x > y);
+    }
+};
+
+} // namespace
+
+void StreamingNms::begin(const std::vector<Bndbox> &boxes, float nms_thresh, int pre_nms_top_n)
+{
+    boxes_ = &boxes;
+    nms_thresh_ = nms_thresh;
+    remaining_ = std::min(boxes.size(), (size_t)std::max(pre_nms_top_n, 0));
+    heap_.resize(boxes.size());
+    for (size_t i = 0; i < boxes.size(); i++) {
+        heap_[i] = i;
+    }
+    std::make_heap(heap_.begin(), heap_.end(), ScoreOrder{boxes.data()});
+    kept_.clear();
+    kept_radius_.clear();
+    result_ = StreamingNmsResult();
+}
+
+bool StreamingNms::next(Bndbox *box)
+{
+    const Bndbox *b = boxes_->data();
+    while (remaining_ > 0) {
+        std::pop_heap(heap_.begin(), heap_.end(), ScoreOrder{b});
+        const Bndbox &candidate = b[heap_.back()];
+        heap_.pop_back();
+        remaining_--;
+        result_.examined++;
+
+        bool suppressed = false;
+        if (!kept_.empty() && nms_thresh_ <= 0.0f) {
+            // every IoU, 0 included, reaches the threshold
+            suppressed = true;
+        }
+        float r = circumradius(candidate);
+        for (size_t k = 0; !suppressed && k < kept_.size(); k++) {
+            const Bndbox &keeper = kept_[k];
+            float dx = keeper.x - candidate.x, dy = keeper.y - candidate.y;
+            float reach = kept_radius_[k] + r;
+            if (dx * dx + dy * dy > reach * reach) {
+                continue;
+            }
+            suppressed = box_iou_bev(keeper, candidate) >= nms_thresh_;
+        }
+        if (suppressed) {
+            continue;
+        }
+        kept_.push_back(candidate);
+        kept_radius_.push_back(r);
+        result_.emitted++;
+        *box = candidate;
+        return true;
+    }
+    return false;
+}
+
+void StreamingNms::stop()
+{
+    if (remaining_ > 0) {
+        result_.truncated = true;
+        remaining_ = 0;
+    }
+}
+
+StreamingNmsResult StreamingNms::run(const std::vector<Bndbox> &boxes, float nms_thresh, int pre_nms_top_n,
+                                     const Callback &callback, size_t max_results,
+                                     Clock::time_point deadline)
+{
+    begin(boxes, nms_thresh, pre_nms_top_n);
+    bool timed = deadline != Clock::time_point::max();
+    Bndbox box;
+    while (!done()) {
+        if ((max_results && result_.emitted >= max_results) || (timed && Clock::now() >= deadline)) {
+            stop();
+            break;
+        }
+        if (!next(&box)) {
+            break;
+        }
+        if (!callback(box, result_.emitted - 1)) {
+            stop();
+            break;
+        }
+    }
+    return result_;
+}
@@ -0,0 +1,94 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <string.h>
+#include <algorithm>
+#include "point_transform.h"
+#include "sweep_accumulator.h"
+
+SweepAccumulator::SweepAccumulator(unsigned int max_sweeps, unsigned int max_points_per_sweep)
+  : max_sweeps_(std::max(max_sweeps, 1u)), max_points_(max_points_per_sweep)
+{
+  storage_.resize((size_t)max_sweeps_ * max_points_ * 4);
+  sweeps_.resize(max_sweeps_);
+}
+
+float *SweepAccumulator::beginSweep()
+{
+  unsigned int next = count_ == 0 ? head_ : (head_ + 1) % max_sweeps_;
+  return slot(next);
+}
+
+void SweepAccumulator::commitSweep(unsigned int num_points, const float *pose, double timestamp)
+{
+  if (count_ != 0) {
+    head_ = (head_ + 1) % max_sweeps_;
+  }
+  count_ = std::min(count_ + 1, max_sweeps_);
+
+  Sweep &s = sweeps_[head_];
+  s.num_points = std::min(num_points, max_points_);
+  s.timestamp = timestamp;
+  memcpy(s.pose, pose, sizeof(s.pose));
+  pose_inverse_rigid(s.pose, s.inv_pose);
+}
+
+void SweepAccumulator::reset()
+{
+  head_ = 0;
+  count_ = 0;
+}
+
+unsigned int SweepAccumulator::fill(float *dst, unsigned int max_points, unsigned int point_size) const
+{
+  if (count_ == 0 || point_size < 4) {
+    return 0;
+  }
+  const Sweep &cur = sweeps_[head_];
+  unsigned int written = 0;
+
+  for (unsigned int k = 0; k < count_ && written < max_points; k++) {
+    unsigned int index = (head_ + max_sweeps_ - k) % max_sweeps_;
+    const Sweep &s = sweeps_[index];
+    const float *src = storage_.data() + (size_t)index * max_points_ * 4;
+    unsigned int n = std::min(s.num_points, max_points - written);
+    float *out = dst + (size_t)written * point_size;
+
+    // newest-from-older: inverse(current pose) * older pose
+    float T[16];
+    if (k == 0) {
+      pose_identity(T);
+    } else {
+      pose_multiply(cur.inv_pose, s.pose, T);
+    }
+    transform_points(src, 4, out, point_size, n, T);
+
+    if (point_size > 4) {
+      float lag = (float)(cur.timestamp - s.timestamp);
+      for (unsigned int i = 0; i < n; i++) {
+        float *p = out + (size_t)i * point_size;
+        p[4] = lag;
+        for (unsigned int c = 5; c < point_size; c++) {
+          p[c] = 0.0f;
+        }
+      }
+    }
+    written += n;
+  }
+  return written;
+}
@@ -0,0 +1,248 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <math.h>
+#include <algorithm>
+#include "temporal_nms.h"
+
+namespace {
+
+// slack on the circumradius test and on the lower bound, so rounding in
+// box_overlap can not turn a skipped pair into a different decision
+const float kRadiusSlack = 0.05f;
+const float kBoundSlack = 1e-4f;
+
+inline int32_t cell_of(float v, float cell)
+{
+    return (int32_t)floorf(v / cell);
+}
+
+inline uint64_t cell_key(int32_t cx, int32_t cy)
+{
+    return (uint64_t)(uint32_t)cx << 32 | (uint32_t)cy;
+}
+
+inline float circumradius(const Bndbox &box)
+{
+    return 0.5f * sqrtf(box.l * box.l + box.w * box.w);
+}
+
+} // namespace
+
+void TemporalNmsStats::add(const TemporalNmsStats &other)
+{
+    candidates += other.candidates;
+    kept += other.kept;
+    linked += other.linked;
+    seeded += other.seeded;
+    exact_ious += other.exact_ious;
+    bound_skips += other.bound_skips;
+    distance_skips += other.distance_skips;
+    reference_ious += other.reference_ious;
+    mismatches += other.mismatches;
+}
+
+float box_iou_bev_lower_bound(const Bndbox &box_a, const Bndbox &box_b)
+{
+    // b's center and heading in the frame of a, where a is axis aligned
+    float ca = cosf(box_a.rt), sa = sinf(box_a.rt);
+    float dx = box_b.x - box_a.x, dy = box_b.y - box_a.y;
+    float bx = dx * ca + dy * sa;
+    float by = -dx * sa + dy * ca;
+    float c = fabsf(cosf(box_b.rt - box_a.rt)), s = fabsf(sinf(box_b.rt - box_a.rt));
+    float det = c * c - s * s;
+    if (det < 0.5f) {
+        return 0.0f;
+    }
+    // the largest axis-aligned rectangle of this form inside b: its corners
+    // rotated into b's frame land on b's edges
+    float hl = 0.5f * box_b.l, hw = 0.5f * box_b.w;
+    float u = (hl * c - hw * s) / det;
+    float v = (hw * c - hl * s) / det;
+    if (u <= 0.0f || v <= 0.0f) {
+        return 0.0f;
+    }
+    float al = 0.5f * box_a.l, aw = 0.5f * box_a.w;
+    float ix = std::min(al, bx + u) - std::max(-al, bx - u);
+    float iy = std::min(aw, by + v) - std::max(-aw, by - v);
+    if (ix <= 0.0f || iy <= 0.0f) {
+        return 0.0f;
+    }
+    float inter = ix * iy;
+    // IoU grows with the intersection, so the bound carries over
+    return inter / (box_a.l * box_a.w + box_b.l * box_b.w - inter);
+}
+
+TemporalNms::TemporalNms(const TemporalNmsConfig &config)
+    : config_(config)
+{
+}
+
+void TemporalNms::reset()
+{
+    previous_.clear();
+    has_previous_ = false;
+}
+
+int TemporalNms::link(const Bndbox &box) const
+{
+    const float cell = config_.match_distance;
+    int32_t cx = cell_of(box.x, cell), cy = cell_of(box.y, cell);
+    float best = cell * cell;
+    int best_index = -1;
+    for (int32_t gx = cx - 1; gx <= cx + 1; gx++) {
+        for (int32_t gy = cy - 1; gy <= cy + 1; gy++) {
+            auto it = grid_.find(cell_key(gx, gy));
+            if (it == grid_.end()) {
+                continue;
+            }
+            for (uint32_t p : it->second) {
+                const Bndbox &prev = projected_[p];
+                if (prev.id != box.id) {
+                    continue;
+                }
+                float dx = prev.x - box.x, dy = prev.y - box.y;
+                float d2 = dx * dx + dy * dy;
+                if (d2 <= best) {
+                    best = d2;
+                    best_index = (int)p;
+                }
+            }
+        }
+    }
+    return best_index;
+}
+
+int TemporalNms::run(
+    std::vector<Bndbox> bndboxes,
+    float nms_thresh,
+    std::vector<Bndbox> &nms_pred,
+    int pre_nms_top_n,
+    const float *motion)
+{
+    stats_ = TemporalNmsStats();
+    if (config_.verify) {
+        reference_.clear();
+        nms_cpu(bndboxes, nms_thresh, reference_, pre_nms_top_n, &stats_.reference_ious);
+    }
+    if (nms_thresh <= 0.0f) {
+        // every pair suppresses, nothing to gain over the plain loop
+        size_t before = nms_pred.size();
+        nms_cpu(bndboxes, nms_thresh, nms_pred, pre_nms_top_n, &stats_.exact_ious);
+        stats_.candidates = std::min(bndboxes.size(), (size_t)std::max(pre_nms_top_n, 0));
+        stats_.kept = nms_pred.size() - before;
+        previous_.assign(nms_pred.begin() + before, nms_pred.end());
+        has_previous_ = true;
+        return 0;
+    }
+
+    // same ordering as nms_cpu, so ties resolve identically
+    std::sort(bndboxes.begin(), bndboxes.end(),
+              [](Bndbox boxes1, Bndbox boxes2) { return boxes1.score > boxes2.score; });
+    size_t num = std::min(bndboxes.size(), (size_t)std::max(pre_nms_top_n, 0));
+    stats_.candidates = num;
+
+    // previous survivors in the current sensor frame
+    projected_.clear();
+    if (grid_.size() > 4 * previous_.size() + 64) {
+        grid_.clear();
+    }
+    for (auto &it : grid_) {
+        it.second.clear();
+    }
+    if (has_previous_) {
+        float yaw = motion ? atan2f(motion[4], motion[0]) : 0.0f;
+        for (const Bndbox &prev : previous_) {
+            Bndbox p = prev;
+            if (motion) {
+                p.x = motion[0] * prev.x + motion[1] * prev.y + motion[2] * prev.z + motion[3];
+                p.y = motion[4] * prev.x + motion[5] * prev.y + motion[6] * prev.z + motion[7];
+                p.z = motion[8] * prev.x + motion[9] * prev.y + motion[10] * prev.z + motion[11];
+                p.rt = prev.rt + yaw;
+            }
+            grid_[cell_key(cell_of(p.x, config_.match_distance), cell_of(p.y, config_.match_distance))]
+                .push_back((uint32_t)projected_.size());
+            projected_.push_back(p);
+        }
+    }
+    owner_.assign(projected_.size(), -1);
+
+    size_t base = nms_pred.size();
+    kept_radius_.clear();
+    for (size_t j = 0; j < num; j++) {
+        const Bndbox &box = bndboxes[j];
+        float radius = circumradius(box);
+        int p = projected_.empty() ? -1 : link(box);
+        int seed = -1;
+        bool suppressed = false;
+        if (p >= 0) {
+            stats_.linked++;
+            seed = owner_[p];
+        }
+        if (seed >= 0) {
+            // the kept box continuing the same survivor is the likely suppressor
+            const Bndbox &kept = nms_pred[base + seed];
+            if (box_iou_bev_lower_bound(kept, box) >= nms_thresh + kBoundSlack) {
+                suppressed = true;
+                stats_.bound_skips++;
+            } else {
+                stats_.exact_ious++;
+                suppressed = box_iou_bev(kept, box) >= nms_thresh;
+            }
+            if (suppressed) {
+                stats_.seeded++;
+            }
+        }
+        for (size_t k = 0; k < kept_radius_.size() && !suppressed; k++) {
+            if ((int)k == seed) {
+                continue;
+            }
+            const Bndbox &kept = nms_pred[base + k];
+            float dx = kept.x - box.x, dy = kept.y - box.y;
+            float reach = radius + kept_radius_[k] + kRadiusSlack;
+            if (dx * dx + dy * dy >= reach * reach) {
+                stats_.distance_skips++;
+                continue;
+            }
+            stats_.exact_ious++;
+            suppressed = box_iou_bev(kept, box) >= nms_thresh;
+        }
+        if (suppressed) {
+            continue;
+        }
+        if (p >= 0 && owner_[p] < 0) {
+            owner_[p] = (int)kept_radius_.size();
+        }
+        kept_radius_.push_back(radius);
+        nms_pred.emplace_back(box);
+    }
+    stats_.kept = kept_radius_.size();
+
+    previous_.assign(nms_pred.begin() + base, nms_pred.end());
+    has_previous_ = true;
+    if (config_.verify) {
+        bool same = reference_.size() == stats_.kept;
+        for (size_t i = 0; same && i < reference_.size(); i++) {
+            const Bndbox &a = reference_[i], &b = nms_pred[base + i];
+            same = a.x == b.x && a.y == b.y && a.z == b.z && a.w == b.w && a.l == b.l &&
+                   a.h == b.h && a.rt == b.rt && a.id == b.id && a.score == b.score;
+        }
+        stats_.mismatches = same ? 0 : 1;
+    }
+    return 0;
+}
@@ -0,0 +1,262 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <iostream>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include "tiled_detector.h"
+
+#define checkCudaErrors(status)                                   \
+{                                                                 \
+  if (status != 0)                                                \
+  {                                                               \
+    std::cout << "Cuda failure: " << cudaGetErrorString(status)   \
+              << " at line " << __LINE__                          \
+              << " in file " << __FILE__                          \
+              << " error status: " << status                      \
+              << std::endl;                                       \
+              abort();                                            \
+    }                                                             \
+}
+
+int check_tile_config(const TileConfig &config)
+{
+  const float width = config.range[2] - config.range[0];
+  const float height = config.range[3] - config.range[1];
+  if (!(width > 0.0f && height > 0.0f)) {
+    std::cerr << "The tile range must have x_max > x_min and y_max > y_min." << std::endl;
+    return -1;
+  }
+  if (!(config.overlap >= 0.0f && config.overlap < width && config.overlap < height)) {
+    std::cerr << "The tile overlap must be at least 0 and less than the tile size ("
+              << width << " x " << height << " m), not " << config.overlap << "." << std::endl;
+    return -1;
+  }
+  if (!(config.merge_cell > 0.0f)) {
+    std::cerr << "The merge cell of the tiles must be positive, not " << config.merge_cell << "." << std::endl;
+    return -1;
+  }
+  return 0;
+}
+
+TiledDetector::TiledDetector(PointPillar &pointpillar, cudaStream_t stream, const TileConfig &config)
+  : pointpillar_(pointpillar), stream_(stream), config_(config)
+{
+  valid_ = check_tile_config(config_) == 0;
+  point_size_ = pointpillar_.getPointSize();
+  max_points_ = pointpillar_.getMaxPoints();
+  size_t bytes = (size_t)max_points_ * point_size_ * sizeof(float);
+  checkCudaErrors(cudaMallocHost((void **)&staging_[0], bytes));
+  checkCudaErrors(cudaMallocHost((void **)&staging_[1], bytes));
+  checkCudaErrors(cudaMallocHost((void **)&staging_num_, 2 * sizeof(unsigned int)));
+  checkCudaErrors(cudaMalloc((void **)&points_dev_, bytes));
+  checkCudaErrors(cudaMalloc((void **)&points_num_dev_, sizeof(unsigned int)));
+  tile_pred_.reserve(100);
+  stager_ = std::thread(&TiledDetector::stageLoop, this);
+}
+
+TiledDetector::~TiledDetector(void)
+{
+  {
+    std::lock_guard<std::mutex> lock(stage_mutex_);
+    stop_ = true;
+  }
+  stage_cv_.notify_all();
+  stager_.join();
+  checkCudaErrors(cudaFreeHost(staging_[0]));
+  checkCudaErrors(cudaFreeHost(staging_[1]));
+  checkCudaErrors(cudaFreeHost(staging_num_));
+  checkCudaErrors(cudaFree(points_dev_));
+  checkCudaErrors(cudaFree(points_num_dev_));
+}
+
+// Tile (i, j) covers [x0 + i * stride, x0 + i * stride + width) in x and the
+// same in y, so with overlap < stride every point lands in 1 to 4 tiles.
+void TiledDetector::bucket(const float *points, unsigned int num_points)
+{
+  const float width = config_.range[2] - config_.range[0];
+  const float height = config_.range[3] - config_.range[1];
+  const float stride_x = width - config_.overlap;
+  const float stride_y = height - config_.overlap;
+
+  float min_x = INFINITY, min_y = INFINITY, max_x = -INFINITY, max_y = -INFINITY;
+  for (unsigned int i = 0; i < num_points; i++) {
+    const float *p = points + (size_t)i * point_size_;
+    min_x = std::min(min_x, p[0]); max_x = std::max(max_x, p[0]);
+    min_y = std::min(min_y, p[1]); max_y = std::max(max_y, p[1]);
+  }
+  int nx = std::max(1, (int)ceilf((max_x - min_x - config_.overlap) / stride_x));
+  int ny = std::max(1, (int)ceilf((max_y - min_y - config_.overlap) / stride_y));
+
+  // keep the per-tile vectors (and their capacity) from the previous call
+  if (tiles_.size() < (size_t)nx * ny) {
+    tiles_.resize((size_t)nx * ny);
+  }
+  for (int j = 0; j < ny; j++) {
+    for (int i = 0; i < nx; i++) {
+      Tile &tile = tiles_[j * nx + i];
+      tile.origin_x = min_x + i * stride_x;
+      tile.origin_y = min_y + j * stride_y;
+      tile.inner[0] = i > 0;
+      tile.inner[1] = i < nx - 1;
+      tile.inner[2] = j > 0;
+      tile.inner[3] = j < ny - 1;
+      tile.points.clear();
+    }
+  }
+
+  for (unsigned int n = 0; n < num_points; n++) {
+    const float *p = points + (size_t)n * point_size_;
+    float fx = p[0] - min_x, fy = p[1] - min_y;
+    int i0 = std::max(0, (int)floorf((fx - width) / stride_x) + 1);
+    int i1 = std::min(nx - 1, (int)floorf(fx / stride_x));
+    int j0 = std::max(0, (int)floorf((fy - height) / stride_y) + 1);
+    int j1 = std::min(ny - 1, (int)floorf(fy / stride_y));
+    for (int j = j0; j <= j1; j++) {
+      for (int i = i0; i <= i1; i++) {
+        Tile &tile = tiles_[j * nx + i];
+        if (tile.points.size() >= (size_t)max_points_ * point_size_) {
+          dropped_points_++;
+          continue;
+        }
+        // move into the model's frame
+        tile.points.insert(tile.points.end(), p, p + point_size_);
+        float *q = &tile.points[tile.points.size() - point_size_];
+        q[0] += config_.range[0] - tile.origin_x;
+        q[1] += config_.range[1] - tile.origin_y;
+      }
+    }
+  }
+
+  active_.clear();
+  for (int t = 0; t < nx * ny; t++) {
+    if (!tiles_[t].points.empty()) {
+      active_.push_back(t);
+    }
+  }
+}
+
+void TiledDetector::stage(int slot, const Tile &tile)
+{
+  memcpy(staging_[slot], tile.points.data(), tile.points.size() * sizeof(float));
+  staging_num_[slot] = tile.points.size() / point_size_;
+}
+
+void TiledDetector::stageLoop()
+{
+  std::unique_lock<std::mutex> lock(stage_mutex_);
+  for (;;) {
+    stage_cv_.wait(lock, [&] { return stop_ || stage_tile_ != nullptr; });
+    if (stop_) {
+      return;
+    }
+    const Tile *tile = stage_tile_;
+    int slot = stage_slot_;
+    lock.unlock();
+    stage(slot, *tile);
+    lock.lock();
+    stage_tile_ = nullptr;
+    stage_cv_.notify_all();
+  }
+}
+
+void TiledDetector::startStage(int slot, const Tile &tile)
+{
+  {
+    std::lock_guard<std::mutex> lock(stage_mutex_);
+    stage_tile_ = &tile;
+    stage_slot_ = slot;
+  }
+  stage_cv_.notify_all();
+}
+
+void TiledDetector::waitStage()
+{
+  std::unique_lock<std::mutex> lock(stage_mutex_);
+  stage_cv_.wait(lock, [&] { return stage_tile_ == nullptr; });
+}
+
+int TiledDetector::detect(
+  const float *points,
+  unsigned int num_points,
+  std::vector<Bndbox> &nms_pred,
+  float nms_iou_thresh,
+  int pre_nms_top_n,
+  const std::vector<std::string>& class_names,
+  bool do_profile)
+{
+  dropped_points_ = 0;
+  if (!valid_) {
+    return -1;
+  }
+  bucket(points, num_points);
+  candidates_.clear();
+  if (active_.empty()) {
+    return 0;
+  }
+
+  const float half_overlap = config_.overlap / 2;
+  stage(0, tiles_[active_[0]]);
+  for (size_t k = 0; k < active_.size(); k++) {
+    const Tile &tile = tiles_[active_[k]];
+    int slot = k % 2;
+    checkCudaErrors(cudaMemcpyAsync(points_dev_, staging_[slot],
+                                    (size_t)staging_num_[slot] * point_size_ * sizeof(float),
+                                    cudaMemcpyHostToDevice, stream_));
+    checkCudaErrors(cudaMemcpyAsync(points_num_dev_, &staging_num_[slot], sizeof(unsigned int),
+                                    cudaMemcpyHostToDevice, stream_));
+
+    // stage the next tile while this one is inferred; doinfer() synchronizes
+    // the device, so the other staging buffer is free by then
+    const bool next = k + 1 < active_.size();
+    if (next) {
+      startStage(1 - slot, tiles_[active_[k + 1]]);
+    }
+
+    tile_pred_.clear();
+    pointpillar_.doinfer(
+      points_dev_, points_num_dev_, tile_pred_,
+      nms_iou_thresh,
+      pre_nms_top_n,
+      class_names,
+      do_profile
+    );
+
+    const float x_min = config_.range[0], y_min = config_.range[1];
+    const float x_max = config_.range[2], y_max = config_.range[3];
+    for (auto box : tile_pred_) {
+      // a box centered in an overlap band belongs to the neighbouring tile
+      if ((tile.inner[0] && box.x < x_min + half_overlap) ||
+          (tile.inner[1] && box.x >= x_max - half_overlap) ||
+          (tile.inner[2] && box.y < y_min + half_overlap) ||
+          (tile.inner[3] && box.y >= y_max - half_overlap)) {
+        continue;
+      }
+      box.x += tile.origin_x - x_min;
+      box.y += tile.origin_y - y_min;
+      candidates_.push_back(box);
+    }
+    if (next) {
+      waitStage();
+    }
+  }
+
+  nms_cpu_spatial(candidates_, nms_iou_thresh, nms_pred, config_.merge_cell);
+  return 0;
+}
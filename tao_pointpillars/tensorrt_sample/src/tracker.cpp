@@ -0,0 +1,372 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <math.h>
+#include <algorithm>
+#include "tracker.h"
+
+namespace {
+
+const double kNoEdge = 1e6;
+
+inline float wrap_angle(float a)
+{
+    while (a > M_PI) a -= 2 * M_PI;
+    while (a < -M_PI) a += 2 * M_PI;
+    return a;
+}
+
+inline int32_t cell_of(float v, float cell)
+{
+    return (int32_t)floorf(v / cell);
+}
+
+inline uint64_t cell_key(int32_t cx, int32_t cy)
+{
+    return (uint64_t)(uint32_t)cx << 32 | (uint32_t)cy;
+}
+
+uint32_t find_root(std::vector<uint32_t> &parent, uint32_t i)
+{
+    while (parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+} // namespace
+
+void solve_assignment(const double *cost, int rows, int cols, std::vector<int> &assignment)
+{
+    // Hungarian algorithm with potentials, O(rows^2 * cols); 1-based inside
+    std::vector<double> u(rows + 1, 0.0), v(cols + 1, 0.0), minv(cols + 1);
+    std::vector<int> p(cols + 1, 0), way(cols + 1, 0);
+    std::vector<char> used(cols + 1);
+    for (int i = 1; i <= rows; i++) {
+        p[0] = i;
+        int j0 = 0;
+        std::fill(minv.begin(), minv.end(), INFINITY);
+        std::fill(used.begin(), used.end(), 0);
+        do {
+            used[j0] = 1;
+            int i0 = p[j0], j1 = 0;
+            double delta = INFINITY;
+            const double *row = cost + (size_t)(i0 - 1) * cols;
+            for (int j = 1; j <= cols; j++) {
+                if (used[j]) {
+                    continue;
+                }
+                double cur = row[j - 1] - u[i0] - v[j];
+                if (cur < minv[j]) {
+                    minv[j] = cur;
+                    way[j] = j0;
+                }
+                if (minv[j] < delta) {
+                    delta = minv[j];
+                    j1 = j;
+                }
+            }
+            for (int j = 0; j <= cols; j++) {
+                if (used[j]) {
+                    u[p[j]] += delta;
+                    v[j] -= delta;
+                } else {
+                    minv[j] -= delta;
+                }
+            }
+            j0 = j1;
+        } while (p[j0] != 0);
+        do {
+            int j1 = way[j0];
+            p[j0] = p[j1];
+            j0 = j1;
+        } while (j0);
+    }
+    assignment.assign(rows, -1);
+    for (int j = 1; j <= cols; j++) {
+        if (p[j]) {
+            assignment[p[j] - 1] = j - 1;
+        }
+    }
+}
+
+Tracker::Tracker(const TrackerConfig &config) : config_(config)
+{
+}
+
+void Tracker::reset()
+{
+    tracks_.clear();
+    next_id_ = 1;
+    has_time_ = false;
+}
+
+void Tracker::predict(float dt)
+{
+    const float q = config_.process_noise;
+    const float dt2 = dt * dt;
+    for (Track &t : tracks_) {
+        for (int a = 0; a < 2; a++) {
+            float *p = t.p[a];
+            t.x[a] += t.v[a] * dt;
+            p[0] += 2 * dt * p[1] + dt2 * p[2] + q * dt2 * dt2 * 0.25f;
+            p[1] += dt * p[2] + q * dt2 * dt * 0.5f;
+            p[2] += q * dt2;
+        }
+        t.box.x = t.x[0];
+        t.box.y = t.x[1];
+    }
+}
+
+void Tracker::associate(float dt)
+{
+    const uint32_t num_tracks = tracks_.size();
+    const uint32_t num_dets = dets_.size();
+    const float cell = config_.max_distance;
+    const float gate2 = cell * cell;
+    const float new_gate = cell + config_.max_speed * dt;
+    const float cells[2] = {cell, new_gate};
+    const float gates2[2] = {gate2, new_gate * new_gate};
+    const bool by_iou = config_.min_iou > 0.0f;
+
+    // grids over predicted track centers
+    for (int g = 0; g < 2; g++) {
+        if (grid_[g].size() > 4 * num_tracks + 64) {
+            grid_[g].clear();
+        }
+        for (auto &it : grid_[g]) {
+            it.second.clear();
+        }
+    }
+    for (uint32_t t = 0; t < num_tracks; t++) {
+        int g = tracks_[t].hits > 1 ? 0 : 1;
+        grid_[g][cell_key(cell_of(tracks_[t].box.x, cells[g]), cell_of(tracks_[t].box.y, cells[g]))].push_back(t);
+    }
+
+    candidates_.clear();
+    for (uint32_t d = 0; d < num_dets; d++) {
+        const Bndbox &det = dets_[d];
+        for (int g = 0; g < 2; g++) {
+            int32_t cx = cell_of(det.x, cells[g]), cy = cell_of(det.y, cells[g]);
+            for (int32_t gx = cx - 1; gx <= cx + 1; gx++) {
+                for (int32_t gy = cy - 1; gy <= cy + 1; gy++) {
+                    auto it = grid_[g].find(cell_key(gx, gy));
+                    if (it == grid_[g].end()) {
+                        continue;
+                    }
+                    for (uint32_t t : it->second) {
+                        const Bndbox &box = tracks_[t].box;
+                        if (config_.class_aware && box.id != det.id) {
+                            continue;
+                        }
+                        float dx = box.x - det.x, dy = box.y - det.y;
+                        float d2 = dx * dx + dy * dy;
+                        if (d2 > gates2[g]) {
+                            continue;
+                        }
+                        float cost = sqrtf(d2);
+                        if (by_iou) {
+                            // no velocity yet: gate by distance, cost scaled to [0, 1]
+                            float iou = g == 0 ? box_iou_bev(box, det) : 1.0f - cost / new_gate;
+                            if (iou < config_.min_iou) {
+                                continue;
+                            }
+                            cost = 1.0f - iou;
+                        }
+                        candidates_.push_back({t, d, cost});
+                    }
+                }
+            }
+        }
+    }
+
+    track_det_.assign(num_tracks, -1);
+    det_track_.assign(num_dets, -1);
+    if (candidates_.empty()) {
+        return;
+    }
+
+    // connected components of the candidate graph, solved one by one
+    parent_.resize(num_tracks + num_dets);
+    for (uint32_t i = 0; i < parent_.size(); i++) {
+        parent_[i] = i;
+    }
+    for (const Candidate &c : candidates_) {
+        uint32_t a = find_root(parent_, c.track), b = find_root(parent_, num_tracks + c.det);
+        if (a != b) {
+            parent_[a] = b;
+        }
+    }
+    std::vector<std::pair<uint32_t, uint32_t>> &order = order_;
+    std::vector<const Candidate *> &edges = edges_;
+    order.resize(candidates_.size());
+    for (uint32_t i = 0; i < candidates_.size(); i++) {
+        order[i] = std::make_pair(find_root(parent_, candidates_[i].track), i);
+    }
+    std::sort(order.begin(), order.end());
+    for (size_t begin = 0; begin < order.size();) {
+        size_t end = begin;
+        edges.clear();
+        while (end < order.size() && order[end].first == order[begin].first) {
+            edges.push_back(&candidates_[order[end].second]);
+            end++;
+        }
+        if (edges.size() == 1) {
+            track_det_[edges[0]->track] = edges[0]->det;
+            det_track_[edges[0]->det] = edges[0]->track;
+        } else {
+            solveComponent(edges);
+        }
+        begin = end;
+    }
+}
+
+void Tracker::solveComponent(const std::vector<const Candidate *> &edges)
+{
+    comp_tracks_.clear();
+    comp_dets_.clear();
+    for (const Candidate *c : edges) {
+        comp_tracks_.push_back(c->track);
+        comp_dets_.push_back(c->det);
+    }
+    std::sort(comp_tracks_.begin(), comp_tracks_.end());
+    comp_tracks_.erase(std::unique(comp_tracks_.begin(), comp_tracks_.end()), comp_tracks_.end());
+    std::sort(comp_dets_.begin(), comp_dets_.end());
+    comp_dets_.erase(std::unique(comp_dets_.begin(), comp_dets_.end()), comp_dets_.end());
+
+    // rows are the smaller side
+    bool tracks_rows = comp_tracks_.size() <= comp_dets_.size();
+    const std::vector<uint32_t> &rows = tracks_rows ? comp_tracks_ : comp_dets_;
+    const std::vector<uint32_t> &cols = tracks_rows ? comp_dets_ : comp_tracks_;
+    cost_.assign(rows.size() * cols.size(), kNoEdge);
+    for (const Candidate *c : edges) {
+        uint32_t r = tracks_rows ? c->track : c->det;
+        uint32_t k = tracks_rows ? c->det : c->track;
+        size_t ri = std::lower_bound(rows.begin(), rows.end(), r) - rows.begin();
+        size_t ki = std::lower_bound(cols.begin(), cols.end(), k) - cols.begin();
+        cost_[ri * cols.size() + ki] = c->cost;
+    }
+    solve_assignment(cost_.data(), rows.size(), cols.size(), assignment_);
+    for (size_t r = 0; r < rows.size(); r++) {
+        int k = assignment_[r];
+        if (k < 0 || cost_[r * cols.size() + k] >= kNoEdge) {
+            continue;
+        }
+        uint32_t t = tracks_rows ? rows[r] : cols[k];
+        uint32_t d = tracks_rows ? cols[k] : rows[r];
+        track_det_[t] = d;
+        det_track_[d] = t;
+    }
+}
+
+void Tracker::update(const std::vector<Bndbox> &detections, double time, std::vector<TrackedBox> &out,
+                     const float *pose)
+{
+    // detections into the tracking frame
+    float yaw = 0.0f, c = 1.0f, s = 0.0f;
+    dets_ = detections;
+    if (pose) {
+        yaw = atan2f(pose[4], pose[0]);
+        c = cosf(yaw);
+        s = sinf(yaw);
+        for (Bndbox &d : dets_) {
+            float x = d.x, y = d.y, z = d.z;
+            d.x = pose[0] * x + pose[1] * y + pose[2] * z + pose[3];
+            d.y = pose[4] * x + pose[5] * y + pose[6] * z + pose[7];
+            d.z = pose[8] * x + pose[9] * y + pose[10] * z + pose[11];
+            d.rt = wrap_angle(d.rt + yaw);
+        }
+    }
+
+    float dt = has_time_ ? std::max(0.0, time - last_time_) : 0.0f;
+    last_time_ = time;
+    has_time_ = true;
+    predict(dt);
+    associate(dt);
+
+    const float r = config_.measurement_noise;
+    const float alpha = config_.shape_alpha;
+    out.resize(dets_.size());
+    for (uint32_t d = 0; d < dets_.size(); d++) {
+        const Bndbox &det = dets_[d];
+        int t = det_track_[d];
+        if (t < 0) {
+            // new track
+            Track track;
+            track.id = next_id_++;
+            track.box = det;
+            track.x[0] = det.x;
+            track.x[1] = det.y;
+            for (int a = 0; a < 2; a++) {
+                track.v[a] = 0.0f;
+                track.p[a][0] = r;
+                track.p[a][1] = 0.0f;
+                track.p[a][2] = 100.0f;
+            }
+            track.hits = 1;
+            track.misses = 0;
+            t = tracks_.size();
+            tracks_.push_back(track);
+            track_det_.push_back(d);
+        } else {
+            Track &track = tracks_[t];
+            const float z[2] = {det.x, det.y};
+            for (int a = 0; a < 2; a++) {
+                float *p = track.p[a];
+                float inv = 1.0f / (p[0] + r);
+                float k0 = p[0] * inv, k1 = p[1] * inv;
+                float y = z[a] - track.x[a];
+                track.x[a] += k0 * y;
+                track.v[a] += k1 * y;
+                p[2] -= k1 * p[1];
+                p[1] *= 1.0f - k0;
+                p[0] *= 1.0f - k0;
+            }
+            Bndbox &box = track.box;
+            box.x = track.x[0];
+            box.y = track.x[1];
+            box.z += alpha * (det.z - box.z);
+            box.w += alpha * (det.w - box.w);
+            box.l += alpha * (det.l - box.l);
+            box.h += alpha * (det.h - box.h);
+            box.rt = wrap_angle(box.rt + alpha * wrap_angle(det.rt - box.rt));
+            box.score = det.score;
+            track.hits++;
+            track.misses = 0;
+        }
+        const Track &track = tracks_[t];
+        TrackedBox &o = out[d];
+        o.box = detections[d];
+        o.track_id = track.id;
+        // velocity back into the frame the detections came in
+        o.vx = c * track.v[0] + s * track.v[1];
+        o.vy = -s * track.v[0] + c * track.v[1];
+        o.hits = track.hits;
+    }
+
+    // age out unmatched tracks
+    size_t kept = 0;
+    for (size_t t = 0; t < tracks_.size(); t++) {
+        if (track_det_[t] < 0 && ++tracks_[t].misses > config_.max_misses) {
+            continue;
+        }
+        tracks_[kept++] = tracks_[t];
+    }
+    tracks_.resize(kept);
+}
@@ -0,0 +1,202 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// CPU box decoder benchmark on synthetic raw heads of the KITTI model: mostly
+// background logits plus clusters of confident anchors around objects. The
+// decoder runs with 1 and with all hardware threads and is checked against a
+// plain decode that takes the sigmoid of every logit first.
+//   ./box_decoder_bench [-n <objects>] [-s <score_thresh>] [-k <pre_nms_top_n>]
+//                       [-r <reps>] [-t <nms_thresh>]
+
+#include <unistd.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+#include "box_decoder.h"
+
+typedef std::chrono::steady_clock Clock;
+
+static double ms_since(Clock::time_point t0)
+{
+  return std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+}
+
+// straightforward decode: sigmoid of every logit, box math for every anchor
+static void decode_reference(const BoxDecoderConfig &c, const float *cls, const float *box,
+                             const float *dir, std::vector<Bndbox> &out)
+{
+  int num_classes = c.classes.size(), num_rot = c.rotations.size();
+  int num_anchors = num_classes * num_rot;
+  float sx = (c.range[3] - c.range[0]) / (c.grid_x - 1), sy = (c.range[4] - c.range[1]) / (c.grid_y - 1);
+  float period = 2.0f * (float)M_PI / c.num_dir_bins;
+  for (int y = 0; y < c.grid_y; y++) {
+    for (int x = 0; x < c.grid_x; x++) {
+      for (int a = 0; a < num_anchors; a++) {
+        size_t index = ((size_t)y * c.grid_x + x) * num_anchors + a;
+        const AnchorClass &ac = c.classes[a / num_rot];
+        int label = 0;
+        float score = 0.0f;
+        for (int k = 0; k < num_classes; k++) {
+          float s = 1.0f / (1.0f + expf(-cls[index * num_classes + k]));
+          if (s > score) {
+            score = s;
+            label = k;
+          }
+        }
+        const float *b = box + index * 7;
+        const float *d = dir + index * c.num_dir_bins;
+        float l = ac.size[0], w = ac.size[1], h = ac.size[2];
+        float diagonal = sqrtf(l * l + w * w);
+        int dir_label = d[1] > d[0] ? 1 : 0;
+        float rot = b[6] + c.rotations[a % num_rot] - c.dir_offset;
+        rot -= floorf(rot / period + c.dir_limit_offset) * period;
+        rot += c.dir_offset + period * dir_label;
+        Bndbox bb(b[0] * diagonal + c.range[0] + x * sx, b[1] * diagonal + c.range[1] + y * sy,
+                  b[2] * h + ac.bottom_z + h / 2, expf(b[3]) * l, expf(b[4]) * w, expf(b[5]) * h,
+                  rot, label, score);
+        if (score >= c.score_thresh) {
+          out.push_back(bb);
+        }
+      }
+    }
+  }
+}
+
+static bool same_box(const Bndbox &a, const Bndbox &b)
+{
+  return a.id == b.id && fabsf(a.x - b.x) < 1e-4f && fabsf(a.y - b.y) < 1e-4f && fabsf(a.z - b.z) < 1e-4f &&
+         fabsf(a.l - b.l) < 1e-4f && fabsf(a.w - b.w) < 1e-4f && fabsf(a.h - b.h) < 1e-4f &&
+         fabsf(a.rt - b.rt) < 1e-4f && fabsf(a.score - b.score) < 1e-6f;
+}
+
+int main(int argc, char **argv)
+{
+  int num_objects = 60, top_n = 4096, reps = 20;
+  float score_thresh = 0.1f, nms_thresh = 0.01f;
+  int c;
+  while ((c = getopt(argc, argv, "n:s:k:r:t:h")) != -1) {
+    switch (c) {
+      case 'n': num_objects = atoi(optarg); break;
+      case 's': score_thresh = atof(optarg); break;
+      case 'k': top_n = atoi(optarg); break;
+      case 'r': reps = atoi(optarg); break;
+      case 't': nms_thresh = atof(optarg); break;
+      default:
+        std::cerr << "Usage: " << argv[0] << " [-n <objects>] [-s <score_thresh>] [-k <pre_nms_top_n>]"
+                  << " [-r <reps>] [-t <nms_thresh>]" << std::endl;
+        return 1;
+    }
+  }
+
+  BoxDecoderConfig config;
+  config.score_thresh = score_thresh;
+  BoxDecoder probe(config);
+  size_t cells = (size_t)config.grid_x * config.grid_y;
+  std::vector<float> cls(cells * probe.clsChannels()), box(cells * probe.boxChannels()),
+      dir(cells * probe.dirChannels());
+  std::mt19937 rng(7);
+  std::normal_distribution<float> background(-6.0f, 1.2f), residual(0.0f, 0.1f), dir_logit(0.0f, 1.0f);
+  for (float &v : cls) v = background(rng);
+  for (float &v : box) v = residual(rng);
+  for (float &v : dir) v = dir_logit(rng);
+  // objects: a 3x3 patch of cells whose anchors of one class are confident
+  int num_classes = config.classes.size(), num_anchors = probe.anchorsPerCell();
+  for (int o = 0; o < num_objects; o++) {
+    int ox = rng() % (config.grid_x - 2) + 1, oy = rng() % (config.grid_y - 2) + 1;
+    int cls_id = rng() % num_classes;
+    for (int dy = -1; dy <= 1; dy++) {
+      for (int dx = -1; dx <= 1; dx++) {
+        size_t cell = (size_t)(oy + dy) * config.grid_x + ox + dx;
+        for (int a = 0; a < num_anchors; a++) {
+          cls[(cell * num_anchors + a) * num_classes + cls_id] = 3.0f - 1.5f * (abs(dx) + abs(dy)) + residual(rng);
+        }
+      }
+    }
+  }
+
+  std::vector<Bndbox> ref;
+  auto t0 = Clock::now();
+  decode_reference(config, cls.data(), box.data(), dir.data(), ref);
+  double ref_ms = ms_since(t0);
+  std::cout << cells << " cells, " << num_anchors << " anchors per cell, " << ref.size()
+            << " candidates at score >= " << score_thresh << std::endl;
+  std::cout << "reference decode:      " << ref_ms << " ms" << std::endl;
+
+  int failed = 0;
+  unsigned int hw = std::max(1u, std::thread::hardware_concurrency());
+  std::vector<unsigned int> thread_counts{1};
+  if (hw > 1) {
+    thread_counts.push_back(hw);
+  }
+  std::vector<Bndbox> boxes, kept;
+  for (unsigned int threads : thread_counts) {
+    config.num_threads = threads;
+    BoxDecoder decoder(config);
+    BoxDecoderScratch scratch;
+    double total = 0.0;
+    for (int r = 0; r < reps; r++) {
+      boxes.clear();
+      t0 = Clock::now();
+      decoder.decode(cls.data(), box.data(), dir.data(), boxes, scratch);
+      total += ms_since(t0);
+    }
+    bool same = boxes.size() == ref.size();
+    for (size_t i = 0; same && i < boxes.size(); i++) {
+      same = same_box(boxes[i], ref[i]);
+    }
+    if (!same) {
+      failed++;
+    }
+    std::cout << "decoder, " << threads << " thread" << (threads > 1 ? "s: " : ":  ") << std::string(threads > 9 ? 0 : 1, ' ')
+              << total / reps << " ms" << (same ? "" : "  MISMATCH") << std::endl;
+
+    // pre-NMS top-K in the decoder: NMS only sorts what it will look at
+    double full_ms = 0.0, topk_ms = 0.0;
+    std::vector<int> suppressed;
+    for (int r = 0; r < reps; r++) {
+      boxes.clear();
+      kept.clear();
+      t0 = Clock::now();
+      decoder.decode(cls.data(), box.data(), dir.data(), boxes, scratch);
+      nms_cpu_inplace(boxes, nms_thresh, kept, top_n, suppressed);
+      full_ms += ms_since(t0);
+      size_t full_kept = kept.size();
+      boxes.clear();
+      kept.clear();
+      t0 = Clock::now();
+      decoder.decode(cls.data(), box.data(), dir.data(), boxes, scratch, top_n);
+      nms_cpu_inplace(boxes, nms_thresh, kept, top_n, suppressed);
+      topk_ms += ms_since(t0);
+      if (kept.size() != full_kept) {
+        failed++;
+        break;
+      }
+    }
+    std::cout << "  decode + nms, all candidates: " << full_ms / reps << " ms, top " << top_n << ": "
+              << topk_ms / reps << " ms, " << kept.size() << " kept" << std::endl;
+  }
+  if (failed) {
+    std::cerr << "decoder output differs from the reference decode" << std::endl;
+    return 1;
+  }
+  return 0;
+}
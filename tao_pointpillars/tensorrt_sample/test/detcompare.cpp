@@ -0,0 +1,262 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Golden-output regression comparator for SaveBoxPred results.
+//   ./detcompare [-j <threads>] [-u <min_iou>] [-c <center_m>] [-s <size_m>] [-y <yaw_rad>]
+//                [-p <score>] [-a] [-n <frames>] [-r <report.csv>] <golden_dir> <test_dir>
+// Every .txt file of the golden directory is compared with the file of the
+// same name in the test directory. Boxes are matched by rotated BEV IoU
+// (at least -u, same class unless -a) and a matched pair must agree within
+// the center, size, yaw and score tolerances. Byte-identical files are not
+// parsed. The first -n mismatched frames are listed, -r writes one CSV line
+// per frame. Exits with 0 when every frame matches.
+
+#include <dirent.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include "box_compare.h"
+#include "box_io.h"
+#include "point_io.h"
+
+enum FrameStatus { kByteIdentical, kEqual, kMismatch, kMissingFile, kBadFile };
+
+struct FrameResult {
+  FrameStatus status = kBadFile;
+  FrameDiff diff;
+};
+
+static void usage(const char *argv0)
+{
+  std::cout << "Usage: " << argv0 << " [-j <threads>] [-u <min_iou>] [-c <center_m>] [-s <size_m>]"
+            << " [-y <yaw_rad>] [-p <score>] [-a] [-n <frames>] [-r <report.csv>] <golden_dir> <test_dir>"
+            << std::endl;
+}
+
+static int list_results(const std::string &dir, std::vector<std::string> &names)
+{
+  DIR *d = opendir(dir.c_str());
+  if (!d) {
+    std::cerr << "Can't open directory: " << dir << std::endl;
+    return -1;
+  }
+  while (dirent *entry = readdir(d)) {
+    if (has_extension(entry->d_name, ".txt")) {
+      names.push_back(entry->d_name);
+    }
+  }
+  closedir(d);
+  std::sort(names.begin(), names.end());
+  return 0;
+}
+
+static bool file_exists(const std::string &path)
+{
+  return access(path.c_str(), R_OK) == 0;
+}
+
+// boxes of a result file: its lines with any content
+static size_t count_boxes(const std::string &text)
+{
+  size_t count = 0;
+  bool content = false;
+  for (char c : text) {
+    if (c == '\n') {
+      count += content;
+      content = false;
+    } else if (c != ' ' && c != '\t' && c != '\r') {
+      content = true;
+    }
+  }
+  return count + content;
+}
+
+static void compare_frame(const std::string &golden, const std::string &test, const BoxTolerance &tolerance,
+                          std::string &golden_text, std::string &test_text, std::vector<Bndbox> &golden_boxes,
+                          std::vector<Bndbox> &test_boxes, std::vector<int> &track_ids,
+                          BoxCompareScratch &scratch, FrameResult &result)
+{
+  if (!file_exists(test)) {
+    result.status = kMissingFile;
+    if (load_box_pred(golden, golden_boxes, track_ids, golden_text) == 0) {
+      result.diff.ref_boxes = result.diff.missing = golden_boxes.size();
+    }
+    return;
+  }
+  if (read_text_file(golden, golden_text) != 0 || read_text_file(test, test_text) != 0) {
+    return;
+  }
+  if (golden_text == test_text) {
+    result.status = kByteIdentical;
+    size_t n = count_boxes(golden_text);
+    result.diff.ref_boxes = result.diff.test_boxes = n;
+    result.diff.matched = result.diff.identical = n;
+    return;
+  }
+  if (parse_box_pred(golden_text, golden, golden_boxes, track_ids) != 0 ||
+      parse_box_pred(test_text, test, test_boxes, track_ids) != 0) {
+    return;
+  }
+  compare_boxes(golden_boxes, test_boxes, tolerance, result.diff, scratch);
+  result.status = result.diff.equal() ? kEqual : kMismatch;
+}
+
+int main(int argc, char **argv)
+{
+  BoxTolerance tolerance;
+  unsigned int num_threads = std::max(1u, std::thread::hardware_concurrency());
+  long max_listed = 20;
+  std::string report;
+  int c;
+  while ((c = getopt(argc, argv, "j:u:c:s:y:p:an:r:h")) != -1) {
+    switch (c) {
+      case 'j': num_threads = std::max(1, atoi(optarg)); break;
+      case 'u': tolerance.min_iou = atof(optarg); break;
+      case 'c': tolerance.center = atof(optarg); break;
+      case 's': tolerance.size = atof(optarg); break;
+      case 'y': tolerance.yaw = atof(optarg); break;
+      case 'p': tolerance.score = atof(optarg); break;
+      case 'a': tolerance.class_aware = false; break;
+      case 'n': max_listed = atol(optarg); break;
+      case 'r': report = optarg; break;
+      default: usage(argv[0]); return 1;
+    }
+  }
+  if (optind + 2 != argc) {
+    usage(argv[0]);
+    return 1;
+  }
+  std::string golden_dir = argv[optind], test_dir = argv[optind + 1];
+  std::vector<std::string> names, test_names;
+  if (list_results(golden_dir, names) != 0 || list_results(test_dir, test_names) != 0) {
+    return 1;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<FrameResult> results(names.size());
+  std::atomic<size_t> next(0);
+  auto worker = [&]() {
+    std::string golden_text, test_text;
+    std::vector<Bndbox> golden_boxes, test_boxes;
+    std::vector<int> track_ids;
+    BoxCompareScratch scratch;
+    for (size_t i = next++; i < names.size(); i = next++) {
+      compare_frame(golden_dir + "/" + names[i], test_dir + "/" + names[i], tolerance, golden_text,
+                    test_text, golden_boxes, test_boxes, track_ids, scratch, results[i]);
+    }
+  };
+  std::vector<std::thread> threads;
+  for (unsigned int t = 1; t < num_threads; t++) {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (auto &t : threads) {
+    t.join();
+  }
+  double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+  // frames only in the test directory
+  std::set<std::string> golden_set(names.begin(), names.end());
+  size_t extra_files = 0;
+  for (const auto &name : test_names) {
+    if (!golden_set.count(name)) {
+      if ((long)extra_files < max_listed) {
+        std::cout << name << ": not in " << golden_dir << std::endl;
+      }
+      extra_files++;
+    }
+  }
+
+  static const char *field_names[kNumBoxFields] = {"center", "size", "yaw", "score"};
+  size_t counts[kBadFile + 1] = {0};
+  FrameDiff total;
+  long listed = 0;
+  for (size_t i = 0; i < names.size(); i++) {
+    const FrameResult &r = results[i];
+    counts[r.status]++;
+    total.add(r.diff);
+    if (r.status == kByteIdentical || r.status == kEqual || listed >= max_listed) {
+      continue;
+    }
+    listed++;
+    std::cout << names[i] << ": ";
+    if (r.status == kMissingFile) {
+      std::cout << "missing from " << test_dir << std::endl;
+      continue;
+    } else if (r.status == kBadFile) {
+      std::cout << "unreadable" << std::endl;
+      continue;
+    }
+    const FrameDiff &d = r.diff;
+    std::cout << d.ref_boxes << " vs " << d.test_boxes << " boxes, " << d.missing << " missing, "
+              << d.extra << " extra, " << d.out_of_tolerance << " out of tolerance; max error";
+    for (int f = 0; f < kNumBoxFields; f++) {
+      std::cout << " " << field_names[f] << " " << d.max_error[f];
+    }
+    std::cout << ", min IoU " << d.min_iou << std::endl;
+  }
+
+  if (!report.empty()) {
+    std::ofstream ofs(report);
+    if (!ofs.is_open()) {
+      std::cerr << "Output file cannot be opened!" << std::endl;
+      return 1;
+    }
+    static const char *status_names[] = {"identical", "equal", "mismatch", "missing", "unreadable"};
+    ofs << "frame,status,golden_boxes,test_boxes,matched,missing,extra,out_of_tolerance,min_iou";
+    for (int f = 0; f < kNumBoxFields; f++) {
+      ofs << "," << field_names[f] << "_error";
+    }
+    ofs << "\n";
+    for (size_t i = 0; i < names.size(); i++) {
+      const FrameDiff &d = results[i].diff;
+      ofs << names[i] << "," << status_names[results[i].status] << "," << d.ref_boxes << ","
+          << d.test_boxes << "," << d.matched << "," << d.missing << "," << d.extra << ","
+          << d.out_of_tolerance << "," << d.min_iou;
+      for (int f = 0; f < kNumBoxFields; f++) {
+        ofs << "," << d.max_error[f];
+      }
+      ofs << "\n";
+    }
+  }
+
+  size_t mismatched = names.size() - counts[kByteIdentical] - counts[kEqual];
+  std::cout << "Frames: " << names.size() << " compared, " << counts[kByteIdentical] << " identical, "
+            << counts[kEqual] << " equal within tolerance, " << mismatched << " mismatched ("
+            << counts[kMissingFile] << " missing, " << counts[kBadFile] << " unreadable), "
+            << extra_files << " extra" << std::endl;
+  std::cout << "Boxes: " << total.ref_boxes << " golden, " << total.test_boxes << " test, "
+            << total.matched << " matched (" << total.identical << " identical), " << total.missing
+            << " missing, " << total.extra << " extra, " << total.out_of_tolerance << " out of tolerance"
+            << std::endl;
+  std::cout << "Max error:";
+  for (int f = 0; f < kNumBoxFields; f++) {
+    std::cout << " " << field_names[f] << " " << total.max_error[f];
+  }
+  std::cout << ", min IoU " << total.min_iou << std::endl;
+  std::cout << "Compared in " << ms << " ms on " << num_threads << " threads ("
+            << (ms > 0 ? names.size() * 1000.0 / ms : 0.0) << " frames/s)" << std::endl;
+  return mismatched == 0 && extra_files == 0 ? 0 : 1;
+}
@@ -0,0 +1,357 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Spatio-temporal index over SaveBoxPred outputs.
+//   ./detindex build -o <index> (-l <list> [-r <result_dir>] | -i <result_dir> -f <hz>)
+//                    [-b <bucket_seconds>] [-g <cell_m>]
+//   ./detindex query [-t <t1>,<t2>] [-c <x>,<y>,<radius> | -a <x1>,<y1>,<x2>,<y2>]
+//                    [-k <class_id>,...] [-s <min_score>] [-n <rows>] [-o <out.txt>] [-v] <index>
+//   ./detindex info <index>
+// The list has one line per frame in the --sweeps format: a path, the
+// timestamp in seconds and optionally the 12 values of the 3x4 world-from-
+// lidar pose. With -r the path names the sweep and its result is
+// <result_dir>/<sweep file stem>.txt as written by pointpillars; without -r
+// the path is the result file itself. Frames with a pose are indexed in world
+// coordinates. -i indexes every .txt file of a directory in name order at a
+// fixed rate. Query rows are: frame name, time, the SaveBoxPred columns and
+// the track id. -v checks the result against a scan of all records.
+
+#include <dirent.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "box_io.h"
+#include "detection_index.h"
+#include "point_io.h"
+
+struct FrameEntry {
+  std::string path;
+  double timestamp;
+  bool has_pose;
+  float pose[16];
+};
+
+static void usage(const char *argv0)
+{
+  std::cout << "Usage: " << std::endl
+            << argv0 << " build -o <index> (-l <list> [-r <result_dir>] | -i <result_dir> -f <hz>)"
+            << " [-b <bucket_seconds>] [-g <cell_m>]" << std::endl
+            << argv0 << " query [-t <t1>,<t2>] [-c <x>,<y>,<radius> | -a <x1>,<y1>,<x2>,<y2>]"
+            << " [-k <class_id>,...] [-s <min_score>] [-n <rows>] [-o <out.txt>] [-v] <index>" << std::endl
+            << argv0 << " info <index>" << std::endl;
+}
+
+static int parse_values(const char *arg, double *values, int count)
+{
+  std::istringstream iss(arg);
+  for (int i = 0; i < count; i++) {
+    char sep;
+    if (!(iss >> values[i]) || (i + 1 < count && !(iss >> sep && sep == ','))) {
+      return -1;
+    }
+  }
+  return iss.rdbuf()->in_avail() == 0 ? 0 : -1;
+}
+
+static int load_list(const std::string &list_file, const std::string &result_dir,
+                     std::vector<FrameEntry> &frames)
+{
+  std::ifstream ifs(list_file);
+  if (!ifs.is_open()) {
+    std::cerr << "Can't open files: " << list_file << std::endl;
+    return -1;
+  }
+  std::string line;
+  while (std::getline(ifs, line)) {
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+    std::istringstream iss(line);
+    FrameEntry e;
+    iss >> e.path >> e.timestamp;
+    int n = 0;
+    while (n < 12 && iss >> e.pose[n]) {
+      n++;
+    }
+    if (e.path.empty() || (n != 0 && n != 12) || (n == 0 && !iss.eof())) {
+      std::cerr << "Bad list line: " << line << std::endl;
+      return -1;
+    }
+    e.has_pose = n == 12;
+    e.pose[12] = e.pose[13] = e.pose[14] = 0.0f;
+    e.pose[15] = 1.0f;
+    if (!result_dir.empty()) {
+      std::string name = e.path.substr(e.path.find_last_of('/') + 1);
+      e.path = result_dir + "/" + name.substr(0, name.find_last_of('.')) + ".txt";
+    }
+    frames.push_back(e);
+  }
+  return 0;
+}
+
+static int list_results(const std::string &dir, double hz, std::vector<FrameEntry> &frames)
+{
+  DIR *d = opendir(dir.c_str());
+  if (!d) {
+    std::cerr << "Can't open directory: " << dir << std::endl;
+    return -1;
+  }
+  std::vector<std::string> names;
+  while (dirent *entry = readdir(d)) {
+    if (has_extension(entry->d_name, ".txt")) {
+      names.push_back(entry->d_name);
+    }
+  }
+  closedir(d);
+  std::sort(names.begin(), names.end());
+  for (size_t i = 0; i < names.size(); i++) {
+    FrameEntry e;
+    e.path = dir + "/" + names[i];
+    e.timestamp = i / hz;
+    e.has_pose = false;
+    frames.push_back(e);
+  }
+  return 0;
+}
+
+static int build(const std::string &index_file, const std::vector<FrameEntry> &frames,
+                 double bucket_seconds, float cell_size)
+{
+  auto start = std::chrono::steady_clock::now();
+  DetectionIndexWriter writer(bucket_seconds, cell_size);
+  std::vector<Bndbox> boxes;
+  std::vector<int> track_ids;
+  std::string buffer;
+  for (const auto &frame : frames) {
+    if (load_box_pred(frame.path, boxes, track_ids, buffer) != 0 ||
+        writer.addFrame(frame.path, frame.timestamp, boxes, track_ids.data(),
+                        frame.has_pose ? frame.pose : nullptr) != 0) {
+      return 1;
+    }
+  }
+  if (writer.write(index_file) != 0) {
+    return 1;
+  }
+  double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  std::cout << "Indexed " << writer.numRecords() << " detections of " << writer.numFrames()
+            << " frames into " << index_file << " in " << ms << " ms" << std::endl;
+  return 0;
+}
+
+// the query evaluated on every record, for -v
+static void scan_all(const DetectionIndex &index, const DetectionQuery &q, std::vector<uint32_t> &records)
+{
+  for (uint32_t r = 0; r < index.numRecords(); r++) {
+    Bndbox b = index.box(r);
+    double t = index.frameTime(index.frame(r));
+    bool in_region = true;
+    if (q.region == DetectionQuery::kCircle) {
+      float dx = b.x - q.x, dy = b.y - q.y;
+      in_region = dx * dx + dy * dy <= q.radius * q.radius;
+    } else if (q.region == DetectionQuery::kBox) {
+      in_region = b.x >= q.box[0] && b.y >= q.box[1] && b.x <= q.box[2] && b.y <= q.box[3];
+    }
+    if (in_region && t >= q.t_begin && t <= q.t_end && b.score >= q.min_score &&
+        (q.class_mask >> b.id & 1)) {
+      records.push_back(r);
+    }
+  }
+}
+
+static void print_record(std::ostream &os, const DetectionIndex &index, uint32_t r)
+{
+  Bndbox b = index.box(r);
+  uint32_t frame = index.frame(r);
+  os << index.frameName(frame) << " " << std::setprecision(17) << index.frameTime(frame)
+     << std::setprecision(6) << " " << b.x << " " << b.y << " " << b.z << " " << b.w << " "
+     << b.l << " " << b.h << " " << b.rt << " " << b.id << " " << b.score << " "
+     << index.trackId(r) << "\n";
+}
+
+static int query(const std::string &index_file, const DetectionQuery &q, long rows,
+                 const std::string &output, bool verify)
+{
+  DetectionIndex index(index_file);
+  if (!index.isOpen()) {
+    return 1;
+  }
+  std::vector<uint32_t> records;
+  DetectionQueryStats stats;
+  auto start = std::chrono::steady_clock::now();
+  index.query(q, records, &stats);
+  double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  // output in time order
+  std::sort(records.begin(), records.end(), [&](uint32_t a, uint32_t b) {
+    double ta = index.frameTime(index.frame(a)), tb = index.frameTime(index.frame(b));
+    return ta != tb ? ta < tb : a < b;
+  });
+  if (!output.empty()) {
+    std::ofstream ofs(output);
+    if (!ofs.is_open()) {
+      std::cerr << "Output file cannot be opened!" << std::endl;
+      return 1;
+    }
+    for (uint32_t r : records) {
+      print_record(ofs, index, r);
+    }
+  } else {
+    for (size_t i = 0; i < records.size() && (long)i < rows; i++) {
+      print_record(std::cout, index, records[i]);
+    }
+  }
+  std::cout << stats.hits << " detections; visited " << stats.buckets << " buckets, "
+            << stats.cells << " of " << index.numCells() << " cells, scanned " << stats.scanned
+            << " of " << index.numRecords() << " records in " << ms << " ms" << std::endl;
+  if (verify) {
+    std::vector<uint32_t> expected;
+    start = std::chrono::steady_clock::now();
+    scan_all(index, q, expected);
+    ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::sort(records.begin(), records.end());
+    bool same = records == expected;
+    std::cout << "Full scan: " << expected.size() << " detections in " << ms << " ms, "
+              << (same ? "same result" : "MISMATCH") << std::endl;
+    return same ? 0 : 1;
+  }
+  return 0;
+}
+
+static int info(const std::string &index_file)
+{
+  DetectionIndex index(index_file);
+  if (!index.isOpen()) {
+    return 1;
+  }
+  double t_min = 0, t_max = 0;
+  for (uint32_t f = 0; f < index.numFrames(); f++) {
+    double t = index.frameTime(f);
+    t_min = f == 0 ? t : std::min(t_min, t);
+    t_max = f == 0 ? t : std::max(t_max, t);
+  }
+  std::cout << index.numFrames() << " frames, " << index.numRecords() << " detections, "
+            << index.numCells() << " cells" << std::endl
+            << std::setprecision(17) << "time " << t_min << " .. " << t_max << std::setprecision(6)
+            << " s, bucket " << index.bucketSeconds() << " s, cell " << index.cellSize() << " m" << std::endl;
+  return 0;
+}
+
+int main(int argc, char **argv)
+{
+  if (argc < 2) {
+    usage(argv[0]);
+    return 1;
+  }
+  std::string command = argv[1];
+  std::string output, list_file, result_dir, input_dir;
+  double hz = 0.0, bucket_seconds = 10.0, cell_size = 8.0;
+  DetectionQuery q;
+  long rows = 20;
+  bool verify = false;
+  double v[4];
+  optind = 2;
+  int c;
+  while ((c = getopt(argc, argv, "o:l:r:i:f:b:g:t:c:a:k:s:n:vh")) != -1) {
+    switch (c) {
+      case 'o': output = optarg; break;
+      case 'l': list_file = optarg; break;
+      case 'r': result_dir = optarg; break;
+      case 'i': input_dir = optarg; break;
+      case 'f': hz = atof(optarg); break;
+      case 'b': bucket_seconds = atof(optarg); break;
+      case 'g': cell_size = atof(optarg); break;
+      case 't':
+        if (parse_values(optarg, v, 2) != 0) {
+          usage(argv[0]);
+          return 1;
+        }
+        q.t_begin = v[0];
+        q.t_end = v[1];
+        break;
+      case 'c':
+        if (parse_values(optarg, v, 3) != 0) {
+          usage(argv[0]);
+          return 1;
+        }
+        q.region = DetectionQuery::kCircle;
+        q.x = v[0];
+        q.y = v[1];
+        q.radius = v[2];
+        break;
+      case 'a':
+        if (parse_values(optarg, v, 4) != 0) {
+          usage(argv[0]);
+          return 1;
+        }
+        q.region = DetectionQuery::kBox;
+        q.box[0] = std::min(v[0], v[2]);
+        q.box[1] = std::min(v[1], v[3]);
+        q.box[2] = std::max(v[0], v[2]);
+        q.box[3] = std::max(v[1], v[3]);
+        break;
+      case 'k': {
+        q.class_mask = 0;
+        std::istringstream iss(optarg);
+        std::string id;
+        while (std::getline(iss, id, ',')) {
+          int k = atoi(id.c_str());
+          if (k < 0 || k > 63) {
+            std::cerr << "Class id out of range: " << id << std::endl;
+            return 1;
+          }
+          q.class_mask |= 1ull << k;
+        }
+        break;
+      }
+      case 's': q.min_score = atof(optarg); break;
+      case 'n': rows = atol(optarg); break;
+      case 'v': verify = true; break;
+      default: usage(argv[0]); return 1;
+    }
+  }
+  if (command == "build") {
+    std::vector<FrameEntry> frames;
+    if (output.empty() || (list_file.empty() == input_dir.empty()) ||
+        (!input_dir.empty() && hz <= 0)) {
+      usage(argv[0]);
+      return 1;
+    }
+    int ret = list_file.empty() ? list_results(input_dir, hz, frames)
+                                : load_list(list_file, result_dir, frames);
+    if (ret != 0) {
+      return 1;
+    }
+    return build(output, frames, bucket_seconds, cell_size);
+  }
+  if (optind + 1 != argc) {
+    usage(argv[0]);
+    return 1;
+  }
+  if (command == "query") {
+    return query(argv[optind], q, rows, output, verify);
+  } else if (command == "info") {
+    return info(argv[optind]);
+  }
+  usage(argv[0]);
+  return 1;
+}
@@ -0,0 +1,200 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Fusion of several LiDAR sweeps per timestamp into one inference buffer:
+// LidarFusion (a worker thread per sensor, read and transform in place)
+// against merging in one thread through per-sensor vectors and a merged
+// cloud, then copying into the buffer. Sweeps are synthetic and written to
+// <dir> first. The two fused clouds must agree.
+//   ./lidar_fusion_bench [-s <sensors>] [-p <points_per_sweep>] [-f <frames>]
+//                        [-c <point_size>] [-b] [-d <dir>]
+// -b drops points inside the default vehicle body box.
+
+#include <unistd.h>
+#include <math.h>
+#include <sys/stat.h>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "lidar_fusion.h"
+#include "point_io.h"
+
+typedef std::chrono::steady_clock Clock;
+
+static double ms_since(Clock::time_point t0)
+{
+  return std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+}
+
+// sensors around the roof and the bumpers, each yawed outwards
+static void make_rig(int num_sensors, std::vector<LidarSensor> &sensors)
+{
+  for (int s = 0; s < num_sensors; s++) {
+    LidarSensor sensor;
+    sensor.name = "lidar" + std::to_string(s);
+    float yaw = 2.0f * (float)M_PI * s / num_sensors;
+    float c = cosf(yaw), sn = sinf(yaw);
+    const float e[16] = {c, -sn, 0.0f, 1.5f + 2.0f * c,
+                         sn, c, 0.0f, 1.0f * sn,
+                         0.0f, 0.0f, 1.0f, s == 0 ? 1.8f : 0.6f,
+                         0.0f, 0.0f, 0.0f, 1.0f};
+    std::copy(e, e + 16, sensor.extrinsic);
+    sensors.push_back(sensor);
+  }
+}
+
+// x, y, z, intensity; some returns hit the vehicle itself
+static int write_sweep(const std::string &path, std::mt19937 &rng, int num_points)
+{
+  std::uniform_real_distribution<float> u(0.0f, 1.0f);
+  std::vector<float> points((size_t)num_points * 4);
+  for (int i = 0; i < num_points; i++) {
+    float r = u(rng) < 0.05f ? 0.5f + u(rng) : 2.0f + 60.0f * u(rng);
+    float a = 2.0f * (float)M_PI * u(rng);
+    points[i * 4 + 0] = r * cosf(a);
+    points[i * 4 + 1] = r * sinf(a);
+    points[i * 4 + 2] = -1.5f + 2.0f * u(rng);
+    points[i * 4 + 3] = u(rng);
+  }
+  std::ofstream ofs(path, std::ios::binary);
+  ofs.write((const char *)points.data(), points.size() * sizeof(float));
+  return ofs.good() ? 0 : -1;
+}
+
+// the separate merge step: every sweep into its own vector, transformed into
+// a merged cloud, then copied into the inference buffer
+static unsigned int merge_copy(const std::vector<LidarSensor> &sensors, const std::vector<std::string> &paths,
+                               const FusionConfig &config, unsigned int point_size, float *dst)
+{
+  PointLoader loader;
+  std::vector<float> sweep, merged;
+  for (size_t s = 0; s < sensors.size(); s++) {
+    unsigned int n = 0;
+    loader.count(paths[s], 4, &n);
+    sweep.resize((size_t)n * 4);
+    loader.load(paths[s], sweep.data(), n, 4, &n);
+    const float *T = sensors[s].extrinsic;
+    const float *box = config.body_box;
+    for (unsigned int i = 0; i < n; i++) {
+      const float *p = &sweep[(size_t)i * 4];
+      float x = T[0] * p[0] + T[1] * p[1] + T[2] * p[2] + T[3];
+      float y = T[4] * p[0] + T[5] * p[1] + T[6] * p[2] + T[7];
+      float z = T[8] * p[0] + T[9] * p[1] + T[10] * p[2] + T[11];
+      if (config.exclude_body && x >= box[0] && x <= box[3] && y >= box[1] && y <= box[4] &&
+          z >= box[2] && z <= box[5]) {
+        continue;
+      }
+      merged.push_back(x);
+      merged.push_back(y);
+      merged.push_back(z);
+      merged.push_back(p[3]);
+      for (unsigned int c = 4; c < point_size; c++) {
+        merged.push_back(0.0f);
+      }
+    }
+  }
+  std::copy(merged.begin(), merged.end(), dst);
+  return merged.size() / point_size;
+}
+
+static void usage(const char *argv0)
+{
+  std::cerr << "Usage: " << argv0 << " [-s <sensors>] [-p <points_per_sweep>] [-f <frames>]"
+            << " [-c <point_size>] [-b] [-d <dir>]" << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+  int num_sensors = 4, num_points = 60000, num_frames = 20;
+  unsigned int point_size = 4;
+  std::string dir = "/tmp/lidar_fusion_bench";
+  FusionConfig config;
+  int c;
+  while ((c = getopt(argc, argv, "s:p:f:c:bd:h")) != -1) {
+    switch (c) {
+      case 's': num_sensors = atoi(optarg); break;
+      case 'p': num_points = atoi(optarg); break;
+      case 'f': num_frames = atoi(optarg); break;
+      case 'c': point_size = atoi(optarg); break;
+      case 'b': config.exclude_body = true; break;
+      case 'd': dir = optarg; break;
+      default: usage(argv[0]); return 1;
+    }
+  }
+  if (point_size < 4 || num_sensors < 1) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  std::vector<LidarSensor> sensors;
+  make_rig(num_sensors, sensors);
+  mkdir(dir.c_str(), 0755);
+  std::mt19937 rng(3);
+  std::vector<std::vector<std::string>> frames(num_frames);
+  for (int f = 0; f < num_frames; f++) {
+    for (int s = 0; s < num_sensors; s++) {
+      std::string path = dir + "/" + sensors[s].name + "_" + std::to_string(f) + ".bin";
+      if (write_sweep(path, rng, num_points) != 0) {
+        std::cerr << "Can't write " << path << std::endl;
+        return 1;
+      }
+      frames[f].push_back(path);
+    }
+  }
+
+  unsigned int max_points = num_sensors * num_points;
+  std::vector<float> expected((size_t)max_points * point_size), fused((size_t)max_points * point_size);
+  LidarFusion fusion(sensors, config);
+  double copy_ms = 0.0, fuse_ms = 0.0;
+  int mismatches = 0;
+  unsigned long long total = 0;
+  for (int f = 0; f < num_frames; f++) {
+    Clock::time_point t0 = Clock::now();
+    unsigned int n_expected = merge_copy(sensors, frames[f], config, point_size, expected.data());
+    copy_ms += ms_since(t0);
+
+    unsigned int n = 0;
+    t0 = Clock::now();
+    if (fusion.fuse(frames[f], fused.data(), max_points, point_size, &n) != 0) {
+      return 1;
+    }
+    fuse_ms += ms_since(t0);
+    total += n;
+
+    bool same = n == n_expected;
+    for (size_t i = 0; same && i < (size_t)n * point_size; i++) {
+      same = fabsf(fused[i] - expected[i]) <= 1e-4f * (1.0f + fabsf(expected[i]));
+    }
+    mismatches += !same;
+  }
+
+  std::cout << num_frames << " frames, " << num_sensors << " sensors x " << num_points << " points, "
+            << point_size << " values per point, " << total / num_frames << " fused per frame";
+  if (config.exclude_body) {
+    std::cout << ", " << fusion.excludedPoints() << " in the body box (last frame)";
+  }
+  std::cout << std::endl << std::fixed << std::setprecision(3)
+            << "merge + copy: " << copy_ms / num_frames << " ms/frame" << std::endl
+            << "LidarFusion:  " << fuse_ms / num_frames << " ms/frame" << std::endl
+            << mismatches << " frames differ" << std::endl;
+  return mismatches ? 1 : 0;
+}
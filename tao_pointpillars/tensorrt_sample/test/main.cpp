@@ -20,9 +20,28 @@
 #include <sstream>
 #include <fstream>
 #include <unistd.h>
+#include <getopt.h>
 #include <string>
+#include <vector>
+#include <chrono>
+#include <atomic>
+#include <thread>
+#include <algorithm>
 #include "cuda_runtime.h"
 #include "./pointpillar.h"
+#include "./sweep_accumulator.h"
+#include "./tiled_detector.h"
+#include "./point_order.h"
+#include "./point_io.h"
+#include "./point_ring.h"
+#include "./frame_scheduler.h"
+#include "./tracker.h"
+#include "./temporal_nms.h"
+#include "./point_transform.h"
+#include "./point_types.h"
+#include "./box_io.h"
+#include "./nms_budget.h"
+#include "./lidar_fusion.h"
 
 #include <boost/filesystem/convenience.hpp>
 
@@ -38,47 +57,75 @@
               abort();                                            \
     }                                                             \
 }
-// 加载二进制文件到内存
-/*
-这样通过二进制方式打开文件,一次性读取整个文件,避免多次小范围读取文件内容。
-并将文件内容加载到一段连续的内存buffer中,方便后续直接访问处理。
-
-data和length作为输出参数,返回加载的内存buffer指针和长度,供调用者使用。
+// One line of the sweep list: <bin_path> <timestamp_sec> <3x4 world-from-lidar pose, row-major>
+struct SweepEntry {
+  std::string path;
+  double timestamp;
+  float pose[16];
+};
 
-这是一个常见的加载二进制文件到内存的实现方法。这里加载的是点云数据二进制文件,后面可以直接在内存中对点云数据进行处理。
-*/
-int loadData(const char *file, void **data, unsigned int *length)
+int loadSweepList(const std::string &list_file, std::vector<SweepEntry> &sweeps)
 {
-  //打开二进制文件文件流dataFile,读取模式。
-  std::fstream dataFile(file, std::ifstream::in);
-
-  if (!dataFile.is_open())
-  {
-    std::cout << "Can't open files: "<< file<<std::endl;
+  std::ifstream ifs(list_file);
+  if (!ifs.is_open()) {
+    std::cout << "Can't open files: " << list_file << std::endl;
     return -1;
   }
-
-  //get length of file:获取文件长度len:先定位到文件末尾,tellg()获取当前位置就是文件长度;然后重新定位到文件开头。
-  unsigned int len = 0;
-  dataFile.seekg (0, dataFile.end);
-  len = dataFile.tellg();
-  dataFile.seekg (0, dataFile.beg);
-
-  //allocate memory:分配大小为len的buffer。
-  char *buffer = new char[len];
-  if(buffer==NULL) {
-    std::cout << "Can't malloc buffer."<<std::endl;
-    dataFile.close();
-    exit(-1);
+  std::string line;
+  while (std::getline(ifs, line)) {
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+    std::istringstream iss(line);
+    SweepEntry e;
+    iss >> e.path >> e.timestamp;
+    for (int i = 0; i < 12; i++) {
+      iss >> e.pose[i];
+    }
+    if (iss.fail()) {
+      std::cerr << "Bad sweep list line: " << line << std::endl;
+      return -1;
+    }
+    e.pose[12] = e.pose[13] = e.pose[14] = 0.0f;
+    e.pose[15] = 1.0f;
+    sweeps.push_back(e);
   }
+  return 0;
+}
+
+// One line of the fusion list: <timestamp_sec> <sweep of every rig sensor, in
+// rig order>, with "-" for a sensor that has no sweep at that time.
+struct FusionEntry {
+  double timestamp;
+  std::vector<std::string> paths;
+};
 
-  //read data as a block: 一次性读取整个文件到buffer中,read函数将文件内容读取到buffer。
-  dataFile.read(buffer, len);
-  dataFile.close();
-//   将buffer的地址和长度赋值给输出参数data和length。
-  *data = (void*)buffer;
-  *length = len;
-  return 0;  
+int loadFusionList(const std::string &list_file, size_t num_sensors, std::vector<FusionEntry> &frames)
+{
+  std::ifstream ifs(list_file);
+  if (!ifs.is_open()) {
+    std::cout << "Can't open files: " << list_file << std::endl;
+    return -1;
+  }
+  std::string line;
+  while (std::getline(ifs, line)) {
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+    std::istringstream iss(line);
+    FusionEntry e;
+    iss >> e.timestamp;
+    std::string path;
+    while (iss >> path) {
+      e.paths.push_back(path == "-" ? std::string() : path);
+    }
+    if (iss.bad() || e.paths.size() != num_sensors) {
+      std::cerr << "Bad fusion list line (" << num_sensors << " sweeps expected): " << line << std::endl;
+      return -1;
+    }
+    frames.push_back(e);
+  }
+  return 0;
 }
 
 void split_str(
@@ -97,65 +144,295 @@ void split_str(
         ret.push_back(std::string(s + idx));
     }
 }
+// Command line options, filled by parse_args() and passed along to the run modes.
+struct Options {
+  std::vector<std::string> class_names;
+  float nms_iou_thresh = 0.0f;
+  int pre_nms_top_n = 0;
+  bool do_profile = false;
+  std::string model_path;
+  std::string engine_path;
+  std::string data_path;
+  std::string data_type = "fp32";
+  std::string output_path;
+  std::string sweep_list;
+  int num_sweeps = 10;
+  bool tiled = false;
+  TileConfig tile_config;
+  MortonMode morton_mode = MortonMode::kNone;
+  float morton_cell = 0.16f;
+  std::string shm_name;
+  int shm_frames = 0;
+  SchedulePolicy schedule_policy = SchedulePolicy::kLatest;
+  float deadline_ms = 100.0f;
+  bool track = false;
+  TrackerConfig tracker_config;
+  bool temporal_nms = false;
+  TemporalNmsConfig temporal_nms_config;
+  bool typed_points = false;
+  PointFormat point_format = PointFormat::kXYZI;
+  std::vector<float> crop_range;
+  std::string raw_cache;
+  bool nms_budget = false;
+  TopNControllerConfig nms_budget_config;
+  std::string rig_file;
+  std::string fusion_list;
+  FusionConfig fusion_config;
+};
+
 //解析命令行参数,获取模型、数据、输出等路径参数
-void parse_args(
-  int argc, char**argv,
-  std::vector<std::string>& class_names,
-  float& nms_iou_thresh,
-  int& pre_nms_top_n,
-  bool& do_profile,
-  std::string& model_path,
-  std::string& engine_path,
-  std::string& data_path,
-  std::string& data_type,
-  std::string& output_path
-  ) {
+void parse_args(int argc, char **argv, Options &options) {
+    enum {
+      OPT_SWEEPS = 256,
+      OPT_NUM_SWEEPS,
+      OPT_TILED,
+      OPT_TILE_RANGE,
+      OPT_TILE_OVERLAP,
+      OPT_MORTON,
+      OPT_MORTON_CELL,
+      OPT_SHM,
+      OPT_SHM_FRAMES,
+      OPT_SCHEDULE,
+      OPT_DEADLINE,
+      OPT_TRACK,
+      OPT_TRACK_DISTANCE,
+      OPT_TRACK_IOU,
+      OPT_TEMPORAL_NMS,
+      OPT_TEMPORAL_NMS_VERIFY,
+      OPT_POINT_FORMAT,
+      OPT_CROP,
+      OPT_CACHE_RAW,
+      OPT_NMS_BUDGET,
+      OPT_NMS_MIN_TOP_N,
+      OPT_RIG,
+      OPT_FUSE,
+      OPT_BODY_BOX,
+    };
+    static const struct option long_options[] = {
+      {"sweeps", required_argument, 0, OPT_SWEEPS},
+      {"num-sweeps", required_argument, 0, OPT_NUM_SWEEPS},
+      {"tiled", no_argument, 0, OPT_TILED},
+      {"tile-range", required_argument, 0, OPT_TILE_RANGE},
+      {"tile-overlap", required_argument, 0, OPT_TILE_OVERLAP},
+      {"morton", required_argument, 0, OPT_MORTON},
+      {"morton-cell", required_argument, 0, OPT_MORTON_CELL},
+      {"shm", required_argument, 0, OPT_SHM},
+      {"shm-frames", required_argument, 0, OPT_SHM_FRAMES},
+      {"schedule", required_argument, 0, OPT_SCHEDULE},
+      {"deadline", required_argument, 0, OPT_DEADLINE},
+      {"track", no_argument, 0, OPT_TRACK},
+      {"track-distance", required_argument, 0, OPT_TRACK_DISTANCE},
+      {"track-iou", required_argument, 0, OPT_TRACK_IOU},
+      {"temporal-nms", no_argument, 0, OPT_TEMPORAL_NMS},
+      {"temporal-nms-verify", no_argument, 0, OPT_TEMPORAL_NMS_VERIFY},
+      {"point-format", required_argument, 0, OPT_POINT_FORMAT},
+      {"crop", required_argument, 0, OPT_CROP},
+      {"cache-raw", required_argument, 0, OPT_CACHE_RAW},
+      {"nms-budget", required_argument, 0, OPT_NMS_BUDGET},
+      {"nms-min-top-n", required_argument, 0, OPT_NMS_MIN_TOP_N},
+      {"rig", required_argument, 0, OPT_RIG},
+      {"fuse", required_argument, 0, OPT_FUSE},
+      {"body-box", required_argument, 0, OPT_BODY_BOX},
+      {0, 0, 0, 0}
+    };
     int c;
-    while ((c = getopt(argc, argv, "c:n:t:m:l:d:e:o:ph")) != -1) {
+    while ((c = getopt_long(argc, argv, "c:n:t:m:l:d:e:o:ph", long_options, NULL)) != -1) {
         switch (c) {
             case 't':
                 {
-                    nms_iou_thresh = atof(optarg);
+                    options.nms_iou_thresh = atof(optarg);
                     break;
                 }
             case 'n':
                 {
-                    pre_nms_top_n = atoi(optarg);
+                    options.pre_nms_top_n = atoi(optarg);
                     break;
                 }
             case 'c':
                 {
-                    split_str(optarg, class_names);
+                    split_str(optarg, options.class_names);
                     break;
                 }
             case 'm':
                 {
-                    model_path = std::string(optarg);
+                    options.model_path = std::string(optarg);
                     break;
                 }
             case 'e':
                 {
-                    engine_path = std::string(optarg);
+                    options.engine_path = std::string(optarg);
                     break;
                 }
             case 'l':
                 {
-                    data_path = std::string(optarg);
+                    options.data_path = std::string(optarg);
                     break;
                 }
             case 'o':
                 {
-                    output_path = std::string(optarg);
+                    options.output_path = std::string(optarg);
                     break;
                 }
             case 'd':
                 {
-                    data_type = std::string(optarg);
+                    options.data_type = std::string(optarg);
                     break;
                 }
             case 'p':
                 {
-                    do_profile = true;
+                    options.do_profile = true;
+                    break;
+                }
+            case OPT_SWEEPS:
+                {
+                    options.sweep_list = std::string(optarg);
+                    break;
+                }
+            case OPT_NUM_SWEEPS:
+                {
+                    options.num_sweeps = atoi(optarg);
+                    break;
+                }
+            case OPT_TILED:
+                {
+                    options.tiled = true;
+                    break;
+                }
+            case OPT_TILE_RANGE:
+                {
+                    std::vector<std::string> range;
+                    split_str(optarg, range);
+                    if (range.size() != 4) {
+                        std::cerr << "--tile-range takes x_min,y_min,x_max,y_max" << std::endl;
+                        abort();
+                    }
+                    for (int i = 0; i < 4; i++) {
+                        options.tile_config.range[i] = atof(range[i].c_str());
+                    }
+                    break;
+                }
+            case OPT_TILE_OVERLAP:
+                {
+                    options.tile_config.overlap = atof(optarg);
+                    break;
+                }
+            case OPT_MORTON:
+                {
+                    options.morton_mode = parse_morton_mode(optarg);
+                    break;
+                }
+            case OPT_MORTON_CELL:
+                {
+                    options.morton_cell = atof(optarg);
+                    break;
+                }
+            case OPT_SHM:
+                {
+                    options.shm_name = std::string(optarg);
+                    break;
+                }
+            case OPT_SHM_FRAMES:
+                {
+                    options.shm_frames = atoi(optarg);
+                    break;
+                }
+            case OPT_SCHEDULE:
+                {
+                    options.schedule_policy = parse_schedule_policy(optarg);
+                    break;
+                }
+            case OPT_DEADLINE:
+                {
+                    options.deadline_ms = atof(optarg);
+                    break;
+                }
+            case OPT_TRACK:
+                {
+                    options.track = true;
+                    break;
+                }
+            case OPT_TRACK_DISTANCE:
+                {
+                    options.tracker_config.max_distance = atof(optarg);
+                    break;
+                }
+            case OPT_TRACK_IOU:
+                {
+                    options.tracker_config.min_iou = atof(optarg);
+                    break;
+                }
+            case OPT_TEMPORAL_NMS:
+                {
+                    options.temporal_nms = true;
+                    break;
+                }
+            case OPT_TEMPORAL_NMS_VERIFY:
+                {
+                    options.temporal_nms = true;
+                    options.temporal_nms_config.verify = true;
+                    break;
+                }
+            case OPT_POINT_FORMAT:
+                {
+                    if (!parse_point_format(optarg, &options.point_format)) {
+                        std::cerr << "--point-format takes xyzi, xyzit, xyzi16 or xyzit16" << std::endl;
+                        abort();
+                    }
+                    options.typed_points = true;
+                    break;
+                }
+            case OPT_CROP:
+                {
+                    std::vector<std::string> range;
+                    split_str(optarg, range);
+                    if (range.size() != 6) {
+                        std::cerr << "--crop takes x_min,y_min,z_min,x_max,y_max,z_max" << std::endl;
+                        abort();
+                    }
+                    options.crop_range.clear();
+                    for (int i = 0; i < 6; i++) {
+                        options.crop_range.push_back(atof(range[i].c_str()));
+                    }
+                    break;
+                }
+            case OPT_CACHE_RAW:
+                {
+                    options.raw_cache = optarg;
+                    break;
+                }
+            case OPT_NMS_BUDGET:
+                {
+                    options.nms_budget = true;
+                    options.nms_budget_config.budget_ms = atof(optarg);
+                    break;
+                }
+            case OPT_NMS_MIN_TOP_N:
+                {
+                    options.nms_budget_config.min_top_n = atoi(optarg);
+                    break;
+                }
+            case OPT_RIG:
+                {
+                    options.rig_file = optarg;
+                    break;
+                }
+            case OPT_FUSE:
+                {
+                    options.fusion_list = optarg;
+                    break;
+                }
+            case OPT_BODY_BOX:
+                {
+                    std::vector<std::string> box;
+                    split_str(optarg, box);
+                    if (box.size() != 6) {
+                        std::cerr << "--body-box takes x_min,y_min,z_min,x_max,y_max,z_max" << std::endl;
+                        abort();
+                    }
+                    for (int i = 0; i < 6; i++) {
+                        options.fusion_config.body_box[i] = atof(box[i].c_str());
+                    }
+                    options.fusion_config.exclude_body = true;
                     break;
                 }
             case 'h':
@@ -165,6 +442,16 @@ void parse_args(
                    " -c <class_names> -n <pre_nms_top_n>" <<
                    " -l <LIDAR_data_path> -m <model_path>" <<
                    " -e <engine_path> -d <data_type> -o <output_path> -p -h" <<
+                   " [--sweeps <sweep_list> --num-sweeps <N>]" <<
+                   " [--tiled --tile-range <x_min,y_min,x_max,y_max> --tile-overlap <m>]" <<
+                   " [--morton <none|2d|3d> --morton-cell <m>]" <<
+                   " [--shm <ring_name> --shm-frames <N> --schedule <fifo|latest> --deadline <ms>]" <<
+                   " [--track --track-distance <m> --track-iou <min_iou>]" <<
+                   " [--temporal-nms | --temporal-nms-verify]" <<
+                   " [--point-format <xyzi|xyzit|xyzi16|xyzit16> --crop <x_min,y_min,z_min,x_max,y_max,z_max>]" <<
+                   " [--cache-raw <raw_box_prefix>]" <<
+                   " [--nms-budget <ms> --nms-min-top-n <N>]" <<
+                   " [--rig <rig_file> --fuse <fusion_list> --body-box <x_min,y_min,z_min,x_max,y_max,z_max>]" <<
                    std::endl;
                   exit(1);
                 }
@@ -175,18 +462,11 @@ void parse_args(
                 }
         }
     }
+    if (options.tiled && check_tile_config(options.tile_config) != 0) {
+        abort();
+    }
 }
 
-std::vector<std::string> class_names;
-float nms_iou_thresh;
-int pre_nms_top_n;
-bool do_profile{false};
-std::string model_path;
-std::string engine_path;
-std::string data_path;
-std::string data_type{"fp32"};
-std::string output_path;
-
 //调用SaveBoxPred保存结果到文件
 void SaveBoxPred(std::vector<Bndbox> boxes, std::string file_name)
 {
@@ -214,23 +494,503 @@ void SaveBoxPred(std::vector<Bndbox> boxes, std::string file_name)
     return;
 };
 
+// Tracked outputs: the SaveBoxPred columns plus track id and BEV velocity.
+void SaveTrackedPred(const std::vector<TrackedBox> &tracked, const std::string &file_name)
+{
+    std::ofstream ofs(file_name, std::ios::out);
+    if (!ofs.is_open()) {
+      std::cerr << "Output file cannot be opened!" << std::endl;
+      return;
+    }
+    for (const auto &t : tracked) {
+      const Bndbox &box = t.box;
+      ofs << box.x << " " << box.y << " " << box.z << " "
+          << box.w << " " << box.l << " " << box.h << " "
+          << box.rt << " " << box.id << " " << box.score << " "
+          << t.track_id << " " << t.vx << " " << t.vy << " \n";
+    }
+    std::cout << "Saved tracked prediction in: " << file_name << std::endl;
+}
 
-int main(int argc, char **argv)
+// The --nms-budget controller config, bounded above by pre_nms_top_n.
+TopNControllerConfig nmsBudgetConfig(const Options &options)
+{
+  TopNControllerConfig config = options.nms_budget_config;
+  config.max_top_n = options.pre_nms_top_n;
+  return config;
+}
+
+// What the run modes keep from frame to frame; main() owns it for the whole run.
+struct RunState {
+  explicit RunState(const Options &options)
+    : nms_controller(nmsBudgetConfig(options)),
+      sorter(options.morton_mode, nullptr, options.morton_cell) {}
+
+  TopNController nms_controller;
+  MortonSorter sorter;
+  std::vector<Bndbox> raw;          // boxes of the frame before NMS
+  std::vector<TrackedBox> tracked;  // tracker output of the frame
+};
+
+// Writes the boxes of one frame of a sequence, through the tracker if enabled.
+void SaveSequencePred(const Options &options, RunState &state, Tracker &tracker,
+                      const std::vector<Bndbox> &boxes, double time,
+                      const float *pose, const std::string &file_name)
+{
+  if (!options.track) {
+    SaveBoxPred(boxes, file_name);
+    return;
+  }
+  auto t0 = std::chrono::steady_clock::now();
+  tracker.update(boxes, time, state.tracked, pose);
+  auto t1 = std::chrono::steady_clock::now();
+  std::cout << "TIME: tracker: "
+            << std::chrono::duration<double, std::milli>(t1 - t0).count() << " ms, "
+            << tracker.numTracks() << " tracks." << std::endl;
+  SaveTrackedPred(state.tracked, file_name);
+}
+
+// NMS with the top-N picked by the budget controller; adjustments are logged.
+void budgetedNms(const Options &options, RunState &state, std::vector<Bndbox> &nms_pred)
+{
+  TopNController &controller = state.nms_controller;
+  controller.nms(state.raw, options.nms_iou_thresh, nms_pred);
+  const TopNControllerStats &stats = controller.stats();
+  std::cout << "TIME: nms: " << stats.last_ms << " ms, top-N " << controller.previousTopN()
+            << ", " << controller.lastTruncated() << " candidates truncated." << std::endl;
+  if (controller.topN() != controller.previousTopN()) {
+    std::cout << "NMS top-N " << controller.previousTopN() << " -> " << controller.topN()
+              << " for a " << options.nms_budget_config.budget_ms << " ms budget" << std::endl;
+  }
+}
+
+void printNmsBudgetStats(const Options &options, const RunState &state)
+{
+  if (!options.nms_budget) {
+    return;
+  }
+  const TopNControllerStats &stats = state.nms_controller.stats();
+  std::cout << "NMS budget: " << stats.frames << " frames, " << stats.over_budget << " over "
+            << options.nms_budget_config.budget_ms << " ms (max " << stats.max_ms << " ms), "
+            << stats.decreases << " top-N decreases, " << stats.increases << " increases, "
+            << stats.truncated_candidates << " candidates truncated in " << stats.truncated_frames
+            << " frames, top-N now " << state.nms_controller.topN() << std::endl;
+}
+
+// Inference and NMS of one frame. With --temporal-nms the raw boxes go through
+// the warm-started NMS; motion is the current-from-previous sensor transform,
+// or nullptr for a static sensor. With --cache-raw the raw boxes are also
+// saved as <raw_cache><stem>.boxes for nms_sweep.
+void inferFrame(const Options &options, RunState &state, PointPillar &pointpillar,
+                TemporalNms &temporal, void *points_data,
+                unsigned int *points_num, std::vector<Bndbox> &nms_pred, const float *motion,
+                const std::string &stem)
+{
+  if (!options.temporal_nms && options.raw_cache.empty() && !options.nms_budget) {
+    pointpillar.doinfer(
+      points_data, points_num, nms_pred,
+      options.nms_iou_thresh,
+      options.pre_nms_top_n,
+      options.class_names,
+      options.do_profile
+    );
+    return;
+  }
+  std::vector<Bndbox> &raw = state.raw;
+  raw.clear();
+  pointpillar.infer(points_data, points_num, raw, options.do_profile);
+  if (!options.raw_cache.empty()) {
+    save_box_raw(raw, options.raw_cache + stem + ".boxes");
+  }
+  if (!options.temporal_nms) {
+    if (options.nms_budget) {
+      budgetedNms(options, state, nms_pred);
+    } else {
+      nms_cpu(raw, options.nms_iou_thresh, nms_pred, options.pre_nms_top_n);
+    }
+    return;
+  }
+  auto t0 = std::chrono::steady_clock::now();
+  temporal.run(raw, options.nms_iou_thresh, nms_pred, options.pre_nms_top_n, motion);
+  auto t1 = std::chrono::steady_clock::now();
+  const TemporalNmsStats &stats = temporal.lastStats();
+  std::cout << "TIME: temporal nms: "
+            << std::chrono::duration<double, std::milli>(t1 - t0).count() << " ms, "
+            << stats.exact_ious << " exact IoUs, " << stats.avoided() << " avoided, "
+            << stats.seeded << "/" << stats.candidates << " suppressed by the previous frame" << std::endl;
+  if (options.temporal_nms_config.verify) {
+    std::cout << "Temporal NMS check: " << (stats.mismatches ? "MISMATCH" : "same as nms_cpu")
+              << ", nms_cpu computed " << stats.reference_ious << " exact IoUs" << std::endl;
+  }
+}
+
+// Optional Morton reordering of a loaded cloud, in place.
+void reorderPoints(const Options &options, RunState &state, float *points, unsigned int num_points,
+                   unsigned int point_size)
+{
+  if (options.morton_mode == MortonMode::kNone) {
+    return;
+  }
+  auto t0 = std::chrono::steady_clock::now();
+  state.sorter.sort(points, points, num_points, point_size);
+  auto t1 = std::chrono::steady_clock::now();
+  std::cout << "TIME: morton reorder: "
+            << std::chrono::duration<double, std::milli>(t1 - t0).count() << " ms." << std::endl;
+}
+
+// Typed load of a .bin cloud with the kernels of one point format: load,
+// optional crop, then widen into the model's float layout in a managed buffer.
+int loadTypedPoints(const Options &options, const PointKernels &kernels, const std::string &path,
+                    unsigned int point_size, float **points_data, unsigned int *points_size)
+{
+  if (!has_extension(path, ".bin")) {
+    std::cerr << "--point-format and --crop take .bin files: " << path << std::endl;
+    return -1;
+  }
+  PointLoader loader;
+  unsigned int num_points = 0;
+  if (loader.count(path, point_size, &num_points) != 0) {
+    return -1;
+  }
+  std::vector<uint8_t> staging((size_t)num_points * kernels.point_bytes);
+  int loaded = kernels.load(path, point_size, staging.data(), num_points);
+  if (loaded < 0) {
+    return -1;
+  }
+  auto t0 = std::chrono::steady_clock::now();
+  unsigned int kept = loaded;
+  if (!options.crop_range.empty()) {
+    kept = kernels.crop(staging.data(), loaded, options.crop_range.data(), staging.data());
+  }
+  checkCudaErrors(cudaMallocManaged((void **)points_data, std::max(kept, 1u) * point_size * sizeof(float)));
+  kernels.expand(staging.data(), kept, *points_data, point_size);
+  auto t1 = std::chrono::steady_clock::now();
+  std::cout << "TIME: " << point_format_name(kernels.format) << " crop+expand: "
+            << std::chrono::duration<double, std::milli>(t1 - t0).count() << " ms, "
+            << kept << "/" << loaded << " points kept." << std::endl;
+  *points_size = kept;
+  return 0;
+}
+
+std::string fileStem(const std::string &input_path)
 {
-  parse_args(
-    argc, argv,
-    class_names,
-    nms_iou_thresh,
-    pre_nms_top_n,
-    do_profile,
-    model_path,
-    engine_path,
-    data_path,
-    data_type,
-    output_path
+    std::string bin_file_name = input_path.substr(0, input_path.find_last_of('.'));
+    return bin_file_name.substr(bin_file_name.find_last_of('/') + 1);
+}
+
+std::string outputFileName(const Options &options, const std::string &input_path)
+{
+    return options.output_path + fileStem(input_path) + ".txt";
+}
+
+// Multi-sweep mode: every line of the sweep list is one frame. The sweep is
+// loaded into the accumulator ring, the last num_sweeps sweeps are merged into
+// its frame and written straight into the managed inference buffer.
+int runSweeps(const Options &options, RunState &state, PointPillar &pointpillar, cudaStream_t stream)
+{
+  std::vector<SweepEntry> sweeps;
+  if (loadSweepList(options.sweep_list, sweeps) != 0) {
+    return -1;
+  }
+  unsigned int num_point_values = pointpillar.getPointSize();
+  unsigned int max_points = pointpillar.getMaxPoints();
+  if (num_point_values < 5) {
+    std::cout << "Model takes " << num_point_values
+              << " values per point, no time-lag channel will be written." << std::endl;
+  }
+
+  SweepAccumulator accumulator(options.num_sweeps, max_points);
+  PointLoader loader;
+  float *points_data = nullptr;
+  unsigned int *points_num = nullptr;
+  checkCudaErrors(cudaMallocManaged((void **)&points_data, (size_t)max_points * num_point_values * sizeof(float)));
+  checkCudaErrors(cudaMallocManaged((void **)&points_num, sizeof(unsigned int)));
+
+  cudaEvent_t start, stop;
+  float elapsedTime = 0.0f;
+  checkCudaErrors(cudaEventCreate(&start));
+  checkCudaErrors(cudaEventCreate(&stop));
+
+  Tracker tracker(options.tracker_config);
+  TemporalNms temporal(options.temporal_nms_config);
+  const SweepEntry *previous = nullptr;
+  float inv_pose[16], motion[16];
+  std::vector<Bndbox> nms_pred;
+  nms_pred.reserve(100);
+  for (const auto &sweep : sweeps) {
+    std::cout << "Loading Data: " << sweep.path << std::endl;
+    unsigned int sweep_points = 0;
+    if (loader.load(sweep.path, accumulator.beginSweep(), accumulator.maxPointsPerSweep(), 4, &sweep_points) != 0) {
+      continue;
+    }
+    accumulator.commitSweep(sweep_points, sweep.pose, sweep.timestamp);
+    // the previous doinfer() synchronized the device, so the host may write here
+    points_num[0] = accumulator.fill(points_data, max_points, num_point_values);
+    std::cout << "Accumulated " << accumulator.numSweeps() << " sweeps, "
+              << points_num[0] << " points." << std::endl;
+
+    // boxes of the previous sweep move into this one by inverse(pose) * previous pose
+    if (previous) {
+      pose_inverse_rigid(sweep.pose, inv_pose);
+      pose_multiply(inv_pose, previous->pose, motion);
+    }
+
+    cudaEventRecord(start, stream);
+    inferFrame(options, state, pointpillar, temporal, points_data, points_num, nms_pred,
+               previous ? motion : nullptr, fileStem(sweep.path));
+    previous = &sweep;
+    cudaEventRecord(stop, stream);
+    cudaEventSynchronize(stop);
+    cudaEventElapsedTime(&elapsedTime, start, stop);
+    std::cout<<"TIME: pointpillar: "<< elapsedTime <<" ms." <<std::endl;
+    std::cout<<"Bndbox objs: "<< nms_pred.size()<<std::endl;
+
+    SaveSequencePred(options, state, tracker, nms_pred, sweep.timestamp, sweep.pose,
+                     outputFileName(options, sweep.path));
+    nms_pred.clear();
+    std::cout << ">>>>>>>>>>>" <<std::endl;
+  }
+  printNmsBudgetStats(options, state);
+
+  checkCudaErrors(cudaFree(points_data));
+  checkCudaErrors(cudaFree(points_num));
+  checkCudaErrors(cudaEventDestroy(start));
+  checkCudaErrors(cudaEventDestroy(stop));
+  return 0;
+}
+
+// Multi-LiDAR mode: every line of the fusion list is one timestamp. The
+// sweeps of the rig sensors are moved into the vehicle frame and fused by one
+// worker thread per sensor straight into the managed inference buffer.
+int runFused(const Options &options, RunState &state, PointPillar &pointpillar, cudaStream_t stream)
+{
+  std::vector<LidarSensor> sensors;
+  std::vector<FusionEntry> frames;
+  if (options.rig_file.empty()) {
+    std::cerr << "--fuse needs the sensor extrinsics of --rig" << std::endl;
+    return -1;
+  }
+  if (load_lidar_rig(options.rig_file, sensors) != 0 ||
+      loadFusionList(options.fusion_list, sensors.size(), frames) != 0) {
+    return -1;
+  }
+  unsigned int num_point_values = pointpillar.getPointSize();
+  unsigned int max_points = pointpillar.getMaxPoints();
+  float *points_data = nullptr;
+  unsigned int *points_num = nullptr;
+  checkCudaErrors(cudaMallocManaged((void **)&points_data, (size_t)max_points * num_point_values * sizeof(float)));
+  checkCudaErrors(cudaMallocManaged((void **)&points_num, sizeof(unsigned int)));
+
+  cudaEvent_t start, stop;
+  float elapsedTime = 0.0f;
+  checkCudaErrors(cudaEventCreate(&start));
+  checkCudaErrors(cudaEventCreate(&stop));
+
+  LidarFusion fusion(sensors, options.fusion_config);
+  Tracker tracker(options.tracker_config);
+  TemporalNms temporal(options.temporal_nms_config);
+  std::vector<Bndbox> nms_pred;
+  nms_pred.reserve(100);
+  for (const auto &frame : frames) {
+    // outputs are named after the first sweep of the frame
+    auto first = std::find_if(frame.paths.begin(), frame.paths.end(),
+                              [](const std::string &p) { return !p.empty(); });
+    if (first == frame.paths.end()) {
+      continue;
+    }
+    std::cout << "Fusing Data: " << *first << " and " << sensors.size() - 1 << " more sensors" << std::endl;
+    // the previous doinfer() synchronized the device, so the host may write here
+    auto t0 = std::chrono::steady_clock::now();
+    fusion.fuse(frame.paths, points_data, max_points, num_point_values, &points_num[0]);
+    auto t1 = std::chrono::steady_clock::now();
+    std::cout << "TIME: fusion: " << std::chrono::duration<double, std::milli>(t1 - t0).count() << " ms, "
+              << points_num[0] << " points";
+    for (size_t i = 0; i < sensors.size(); i++) {
+      std::cout << (i ? ", " : " (") << sensors[i].name << " " << fusion.sensorPoints(i);
+    }
+    std::cout << ")." << std::endl;
+    if (fusion.excludedPoints() || fusion.droppedPoints()) {
+      std::cout << "Points in the body box: " << fusion.excludedPoints()
+                << ", over the engine input: " << fusion.droppedPoints() << std::endl;
+    }
+
+    cudaEventRecord(start, stream);
+    inferFrame(options, state, pointpillar, temporal, points_data, points_num, nms_pred, nullptr, fileStem(*first));
+    cudaEventRecord(stop, stream);
+    cudaEventSynchronize(stop);
+    cudaEventElapsedTime(&elapsedTime, start, stop);
+    std::cout<<"TIME: pointpillar: "<< elapsedTime <<" ms." <<std::endl;
+    std::cout<<"Bndbox objs: "<< nms_pred.size()<<std::endl;
+
+    SaveSequencePred(options, state, tracker, nms_pred, frame.timestamp, nullptr,
+                     outputFileName(options, *first));
+    nms_pred.clear();
+    std::cout << ">>>>>>>>>>>" <<std::endl;
+  }
+  printNmsBudgetStats(options, state);
+
+  checkCudaErrors(cudaFree(points_data));
+  checkCudaErrors(cudaFree(points_num));
+  checkCudaErrors(cudaEventDestroy(start));
+  checkCudaErrors(cudaEventDestroy(stop));
+  return 0;
+}
+
+// Tiled mode: the cloud may be any size, e.g. an aggregated map. It is cut into
+// overlapping tiles of the model's point range and the boxes are merged back.
+int runTiled(const Options &options, RunState &state, PointPillar &pointpillar, cudaStream_t stream)
+{
+  std::cout << "Loading Data: " << options.data_path << std::endl;
+  PointLoader loader;
+  unsigned int num_point_values = pointpillar.getPointSize();
+  unsigned int points_size = 0;
+  if (loader.count(options.data_path, num_point_values, &points_size) != 0) {
+    return -1;
+  }
+  std::vector<float> points((size_t)points_size * num_point_values);
+  loader.load(options.data_path, points.data(), points_size, num_point_values, &points_size);
+  reorderPoints(options, state, points.data(), points_size, num_point_values);
+
+  TiledDetector detector(pointpillar, stream, options.tile_config);
+  std::vector<Bndbox> nms_pred;
+  auto t0 = std::chrono::steady_clock::now();
+  detector.detect(
+    points.data(), points_size, nms_pred,
+    options.nms_iou_thresh,
+    options.pre_nms_top_n,
+    options.class_names,
+    options.do_profile
   );
-  assert(data_type == "fp32" || data_type == "fp16");
-  std::cout << "Loading Data: " << data_path << std::endl;
+  auto t1 = std::chrono::steady_clock::now();
+  std::cout << "TIME: tiled pointpillar: "
+            << std::chrono::duration<double, std::milli>(t1 - t0).count() << " ms, "
+            << detector.numTiles() << " tiles." << std::endl;
+  if (detector.droppedPoints()) {
+    std::cout << "Points over tile capacity: " << detector.droppedPoints() << std::endl;
+  }
+  std::cout<<"Bndbox objs: "<< nms_pred.size()<<std::endl;
+  SaveBoxPred(nms_pred, outputFileName(options, options.data_path));
+  std::cout << ">>>>>>>>>>>" <<std::endl;
+  return 0;
+}
+
+// Shared-memory mode: sweeps published by the driver process into a point
+// ring are bound in place as the engine input. A sensor thread feeds the
+// frame scheduler, which decides which frame is inferred next (newest first
+// by default) and drops frames past the deadline. Frames the driver
+// overwrote before or during inference are dropped too.
+int runShm(const Options &options, RunState &state, PointPillar &pointpillar, cudaStream_t stream)
+{
+  PointRingReader ring(options.shm_name);
+  if (!ring.isOpen()) {
+    return -1;
+  }
+  unsigned int num_point_values = pointpillar.getPointSize();
+  if (ring.pointSize() != num_point_values || ring.maxPoints() < (unsigned int)pointpillar.getMaxPoints()) {
+    std::cerr << "Ring slots of " << ring.maxPoints() << " x " << ring.pointSize()
+              << " do not fit the engine input of " << pointpillar.getMaxPoints() << " x "
+              << num_point_values << std::endl;
+    return -1;
+  }
+  // map the whole ring into the device address space once
+  checkCudaErrors(cudaHostRegister(ring.base(), ring.mappedBytes(),
+                                   cudaHostRegisterMapped | cudaHostRegisterReadOnly));
+  char *device_base = nullptr;
+  checkCudaErrors(cudaHostGetDevicePointer((void **)&device_base, ring.base(), 0));
+  unsigned int *points_num = nullptr;
+  checkCudaErrors(cudaMallocManaged((void **)&points_num, sizeof(unsigned int)));
+
+  cudaEvent_t start, stop;
+  float elapsedTime = 0.0f;
+  checkCudaErrors(cudaEventCreate(&start));
+  checkCudaErrors(cudaEventCreate(&stop));
+  std::vector<Bndbox> nms_pred;
+  nms_pred.reserve(100);
+  FrameScheduler scheduler(options.schedule_policy, options.deadline_ms);
+  Tracker tracker(options.tracker_config);
+  TemporalNms temporal(options.temporal_nms_config);
+  std::atomic<bool> done{false};
+  unsigned long long skipped = 0;
+  std::thread sensor([&] {
+    uint64_t last = 0;
+    PointRingFrame published;
+    while (!done) {
+      if (ring.acquire(last, 100, &published) != 0) {
+        if (ring.closed(last)) {
+          break;
+        }
+        continue;
+      }
+      if (last && published.seq > last + 1) {
+        skipped += published.seq - last - 1;
+      }
+      last = published.seq;
+      ScheduledFrame next;
+      next.seq = published.seq;
+      next.capture_ns = published.timestamp_ns;
+      scheduler.push(next);
+    }
+    scheduler.close();
+  });
+
+  unsigned long long frames = 0, overwritten = 0;
+  PointRingFrame frame;
+  ScheduledFrame scheduled;
+  std::string stem = options.shm_name.substr(options.shm_name.find_last_of('/') + 1);
+  while ((options.shm_frames <= 0 || frames < (unsigned long long)options.shm_frames) && scheduler.pop(&scheduled)) {
+    uint64_t seq = scheduled.seq;
+    if (ring.frame(seq, &frame) != 0) {
+      std::cout << "Frame " << seq << " overwritten before inference, dropped" << std::endl;
+      overwritten++;
+      scheduler.complete(scheduled, false);
+      continue;
+    }
+    points_num[0] = frame.num_points;
+    void *points_data = device_base + ((const char *)frame.points - (const char *)ring.base());
+
+    cudaEventRecord(start, stream);
+    inferFrame(options, state, pointpillar, temporal, points_data, points_num, nms_pred, nullptr,
+               stem + "_" + std::to_string(seq));
+    cudaEventRecord(stop, stream);
+    cudaEventSynchronize(stop);
+    cudaEventElapsedTime(&elapsedTime, start, stop);
+    if (!ring.release(frame)) {
+      std::cout << "Frame " << seq << " overwritten during inference, dropped" << std::endl;
+      overwritten++;
+      scheduler.complete(scheduled, false);
+      nms_pred.clear();
+      continue;
+    }
+    scheduler.complete(scheduled);
+    frames++;
+    std::cout << "Frame " << seq << ": " << frame.num_points << " points" << std::endl;
+    std::cout << "TIME: pointpillar: " << elapsedTime << " ms." << std::endl;
+    std::cout << "Bndbox objs: " << nms_pred.size() << std::endl;
+    SaveSequencePred(options, state, tracker, nms_pred, scheduled.capture_ns * 1e-9, nullptr,
+                     options.output_path + stem + "_" + std::to_string(seq) + ".txt");
+    nms_pred.clear();
+    std::cout << ">>>>>>>>>>>" << std::endl;
+  }
+  done = true;
+  sensor.join();
+  std::cout << "Ring frames: " << frames << " processed, " << skipped << " skipped, "
+            << overwritten << " overwritten" << std::endl;
+  scheduler.printStats();
+  printNmsBudgetStats(options, state);
+
+  checkCudaErrors(cudaFree(points_num));
+  checkCudaErrors(cudaHostUnregister(ring.base()));
+  checkCudaErrors(cudaEventDestroy(start));
+  checkCudaErrors(cudaEventDestroy(stop));
+  return 0;
+}
+
+int main(int argc, char **argv)
+{
+  Options options;
+  parse_args(argc, argv, options);
+  RunState state(options);
+  assert(options.data_type == "fp32" || options.data_type == "fp16");
   cudaEvent_t start, stop;
   float elapsedTime = 0.0f;
   cudaStream_t stream = NULL;
@@ -242,40 +1002,52 @@ int main(int argc, char **argv)
   std::vector<Bndbox> nms_pred;
   nms_pred.reserve(100);
     // 创建PointPillar模型实例进行推理
-  PointPillar pointpillar(model_path, engine_path, stream, data_type);
-
-  
-    std::string dataFile = data_path;
-    //load points cloud
-    unsigned int length = 0;
-    void *data = NULL;
-    std::shared_ptr<char> buffer((char *)data, std::default_delete<char[]>());
-    loadData(dataFile.data(), &data, &length);
-    buffer.reset((char *)data);
-
-    float* points = (float*)buffer.get();
-    unsigned int num_point_values = pointpillar.getPointSize();
-    unsigned int points_size = length/sizeof(float)/num_point_values;
+  PointPillar pointpillar(options.model_path, options.engine_path, stream, options.data_type);
+  if (!pointpillar.isLoaded()) {
+    return -1;
+  }
 
+  if (!options.shm_name.empty()) {
+    runShm(options, state, pointpillar, stream);
+  } else if (!options.fusion_list.empty()) {
+    runFused(options, state, pointpillar, stream);
+  } else if (!options.sweep_list.empty()) {
+    runSweeps(options, state, pointpillar, stream);
+  } else if (options.tiled) {
+    runTiled(options, state, pointpillar, stream);
+  } else {
+    std::cout << "Loading Data: " << options.data_path << std::endl;
+    //load points cloud straight into the managed inference buffer
+    PointLoader loader;
+    unsigned int num_point_values = pointpillar.getPointSize();
+    unsigned int points_size = 0;
     float *points_data = nullptr;
     unsigned int *points_num = nullptr;
-    unsigned int points_data_size = points_size * num_point_values * sizeof(float);
-    
-    checkCudaErrors(cudaMallocManaged((void **)&points_data, points_data_size));
+    if (options.typed_points || !options.crop_range.empty()) {
+      // the point format is picked once here; its kernels run with fixed strides
+      const PointKernels &kernels =
+          point_kernels(options.typed_points ? options.point_format : point_format_for_channels(num_point_values));
+      if (loadTypedPoints(options, kernels, options.data_path, num_point_values, &points_data, &points_size) != 0) {
+        return -1;
+      }
+    } else {
+      if (loader.count(options.data_path, num_point_values, &points_size) != 0) {
+        return -1;
+      }
+      unsigned int points_data_size = points_size * num_point_values * sizeof(float);
+      checkCudaErrors(cudaMallocManaged((void **)&points_data, points_data_size));
+      loader.load(options.data_path, points_data, points_size, num_point_values, &points_size);
+    }
     checkCudaErrors(cudaMallocManaged((void **)&points_num, sizeof(unsigned int)));
-    checkCudaErrors(cudaMemcpy(points_data, points, points_data_size, cudaMemcpyDefault));
-    checkCudaErrors(cudaMemcpy(points_num, &points_size, sizeof(unsigned int), cudaMemcpyDefault));
+    reorderPoints(options, state, points_data, points_size, num_point_values);
+    points_num[0] = points_size;
     checkCudaErrors(cudaDeviceSynchronize());
 
     cudaEventRecord(start, stream);
 
-    pointpillar.doinfer(
-      points_data, points_num, nms_pred,
-      nms_iou_thresh,
-      pre_nms_top_n,
-      class_names,
-      do_profile
-    );
+    TemporalNms temporal(options.temporal_nms_config);
+    inferFrame(options, state, pointpillar, temporal, points_data, points_num, nms_pred, nullptr,
+               fileStem(options.data_path));
     cudaEventRecord(stop, stream);
     cudaEventSynchronize(stop);
     cudaEventElapsedTime(&elapsedTime, start, stop);
@@ -286,13 +1058,10 @@ int main(int argc, char **argv)
     std::cout<<"Bndbox objs: "<< nms_pred.size()<<std::endl;
     
     
-    std::string bin_file_name = data_path.substr(0, data_path.find_last_of('.'));
-    std::string save_file_name = output_path + bin_file_name.substr(bin_file_name.find_last_of('/') + 1) + ".txt";
-
-    SaveBoxPred(nms_pred, save_file_name);
+    SaveBoxPred(nms_pred, outputFileName(options, options.data_path));
     nms_pred.clear();
     std::cout << ">>>>>>>>>>>" <<std::endl;
-  
+  }
 
   checkCudaErrors(cudaEventDestroy(start));
   checkCudaErrors(cudaEventDestroy(stop));
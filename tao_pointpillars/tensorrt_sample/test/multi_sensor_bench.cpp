@@ -0,0 +1,195 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Runs several sensors through one process: every sensor thread feeds its own
+// cloud into one shared DetectorPool (a single engine with -c contexts, or -c
+// stub detectors) and checks each result against a result computed alone
+// beforehand, so state shared between contexts shows up as corrupted frames.
+//   ./multi_sensor_bench [-s <sensors>] [-c <contexts>] [-n <frames>] [-f <hz>]
+//                        -m <model_path> -e <engine_path> [-d <data_type>] [<cloud> ...]
+//   ./multi_sensor_bench ... --stub [--stub-latency <ms>] [--stub-jitter <ms>]
+// Sensor k infers its cloud shifted by 1 m per k in x, so sensors differ.
+
+#include <unistd.h>
+#include <getopt.h>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "detector.h"
+#include "latency_histogram.h"
+#include "point_io.h"
+#ifndef POINTPILLARS_CPU_ONLY
+#include "pointpillar_detector.h"
+#endif
+
+static bool same_boxes(const std::vector<Bndbox> &a, const std::vector<Bndbox> &b)
+{
+  if (a.size() != b.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < a.size(); i++) {
+    if (a[i].x != b[i].x || a[i].y != b[i].y || a[i].z != b[i].z || a[i].l != b[i].l ||
+        a[i].w != b[i].w || a[i].h != b[i].h || a[i].rt != b[i].rt || a[i].id != b[i].id ||
+        a[i].score != b[i].score) {
+      return false;
+    }
+  }
+  return true;
+}
+
+int main(int argc, char **argv)
+{
+  enum {
+    OPT_STUB = 256,
+    OPT_STUB_LATENCY,
+    OPT_STUB_JITTER,
+  };
+  static struct option long_options[] = {
+    {"stub", no_argument, 0, OPT_STUB},
+    {"stub-latency", required_argument, 0, OPT_STUB_LATENCY},
+    {"stub-jitter", required_argument, 0, OPT_STUB_JITTER},
+    {0, 0, 0, 0}
+  };
+  int num_sensors = 4, num_contexts = 2, num_frames = 50;
+  double hz = 0.0;
+  std::string model_path, engine_path, data_type = "fp32";
+  bool stub = false;
+  float stub_latency = 20.0f, stub_jitter = 0.0f;
+  int c;
+  while ((c = getopt_long(argc, argv, "s:c:n:f:m:e:d:h", long_options, NULL)) != -1) {
+    switch (c) {
+      case 's': num_sensors = atoi(optarg); break;
+      case 'c': num_contexts = atoi(optarg); break;
+      case 'n': num_frames = atoi(optarg); break;
+      case 'f': hz = atof(optarg); break;
+      case 'm': model_path = optarg; break;
+      case 'e': engine_path = optarg; break;
+      case 'd': data_type = optarg; break;
+      case OPT_STUB: stub = true; break;
+      case OPT_STUB_LATENCY: stub_latency = atof(optarg); break;
+      case OPT_STUB_JITTER: stub_jitter = atof(optarg); break;
+      default:
+        std::cout << "Usage: " << argv[0] << " [-s <sensors>] [-c <contexts>] [-n <frames>] [-f <hz>]"
+                  << " -m <model_path> -e <engine_path> [-d <data_type>]"
+                  << " | --stub [--stub-latency <ms>] [--stub-jitter <ms>] [<cloud> ...]" << std::endl;
+        return 1;
+    }
+  }
+  std::vector<std::string> files;
+  for (int i = optind; i < argc; i++) {
+    files.push_back(argv[i]);
+  }
+  if (files.empty()) {
+    files.push_back("../../data/000101.bin");
+  }
+
+  std::vector<std::unique_ptr<Detector>> detectors;
+#ifdef POINTPILLARS_CPU_ONLY
+  if (!stub) {
+    std::cout << "CPU-only build, using the stub detector" << std::endl;
+  }
+  stub = true;
+#else
+  if (!stub) {
+    // one engine, num_contexts execution contexts
+    std::shared_ptr<PointPillar> pointpillar(
+        new PointPillar(model_path, engine_path, NULL, data_type, num_contexts));
+    if (!pointpillar->isLoaded()) {
+      return 1;
+    }
+    for (int i = 0; i < num_contexts; i++) {
+      detectors.emplace_back(new PointPillarDetector(pointpillar));
+    }
+  }
+#endif
+  if (stub) {
+    for (int i = 0; i < num_contexts; i++) {
+      detectors.emplace_back(new StubDetector(4, 204800, stub_latency, stub_jitter));
+    }
+  }
+  DetectorPool pool(std::move(detectors));
+  unsigned int point_size = pool.pointSize();
+
+  // per-sensor clouds and their reference results, inferred one at a time
+  std::vector<std::vector<float>> clouds(num_sensors);
+  std::vector<unsigned int> cloud_points(num_sensors);
+  std::vector<std::vector<Bndbox>> reference(num_sensors);
+  PointLoader loader;
+  for (int s = 0; s < num_sensors; s++) {
+    const std::string &file = files[s % files.size()];
+    unsigned int n = 0;
+    if (loader.count(file, point_size, &n) != 0) {
+      return 1;
+    }
+    n = std::min(n, pool.maxPoints());
+    clouds[s].resize((size_t)n * point_size);
+    loader.load(file, clouds[s].data(), n, point_size, &n);
+    for (unsigned int i = 0; i < n; i++) {
+      clouds[s][(size_t)i * point_size] += (float)s;
+    }
+    cloud_points[s] = n;
+    pool.infer(clouds[s].data(), n, reference[s]);
+  }
+
+  std::atomic<unsigned long long> corrupted{0};
+  std::mutex stats_mutex;
+  LatencyHistogram latency;
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> sensors;
+  for (int s = 0; s < num_sensors; s++) {
+    sensors.emplace_back([&, s] {
+      std::vector<Bndbox> boxes;
+      auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+          std::chrono::duration<double>(hz > 0 ? 1.0 / hz : 0.0));
+      for (int i = 0; i < num_frames; i++) {
+        if (hz > 0) {
+          std::this_thread::sleep_until(start + i * period);
+        }
+        auto t0 = std::chrono::steady_clock::now();
+        boxes.clear();
+        pool.infer(clouds[s].data(), cloud_points[s], boxes);
+        auto t1 = std::chrono::steady_clock::now();
+        if (!same_boxes(boxes, reference[s])) {
+          corrupted++;
+        }
+        std::lock_guard<std::mutex> lock(stats_mutex);
+        latency.add(std::chrono::duration<float, std::milli>(t1 - t0).count());
+      }
+    });
+  }
+  for (auto &sensor : sensors) {
+    sensor.join();
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  unsigned long long frames = (unsigned long long)num_sensors * num_frames;
+  std::cout << num_sensors << " sensors x " << num_frames << " frames through " << pool.size()
+            << (stub ? " stub" : " engine") << " contexts" << std::endl;
+  std::cout << "throughput: " << frames / seconds << " frames/s in " << seconds << " s" << std::endl;
+  std::cout << "request ms (incl. waiting for a context): mean " << latency.mean() << ", p50 " << latency.percentile(50)
+            << ", p99 " << latency.percentile(99) << ", max " << latency.max() << std::endl;
+  std::cout << "context checkouts: " << pool.acquires() << ", waited for a context: " << pool.waits()
+            << std::endl;
+  std::cout << "corrupted frames: " << corrupted << std::endl;
+  return corrupted ? 1 : 0;
+}
@@ -0,0 +1,139 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Adaptive pre-NMS top-N on a synthetic drive that passes through a crowded
+// scene: the candidate count ramps from a sparse road to a dense parking lot
+// and back. Every frame runs NMS with the fixed top-N and with a
+// TopNController under the budget, and both NMS time distributions are
+// reported.
+//   ./nms_budget_sim [-b <budget_ms>] [-n <max_top_n>] [-m <min_top_n>] [-f <frames>]
+//                    [-c <peak_candidates>] [-t <nms_thresh>] [-v]
+// -v logs every top-N adjustment.
+
+#include <unistd.h>
+#include <math.h>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+#include "latency_histogram.h"
+#include "nms_budget.h"
+
+// clusters of overlapping candidates around objects plus low-score clutter
+static void make_frame(std::mt19937 &rng, int num_candidates, std::vector<Bndbox> &boxes)
+{
+  std::uniform_real_distribution<float> u(0.0f, 1.0f);
+  std::normal_distribution<float> jitter(0.0f, 0.25f);
+  boxes.clear();
+  int clutter = num_candidates / 4;
+  while ((int)boxes.size() < num_candidates - clutter) {
+    Bndbox obj(u(rng) * 69.0f, u(rng) * 79.0f - 39.5f, -1.0f, 3.9f, 1.6f, 1.56f, u(rng) * 6.28f, 0, 0.0f);
+    float base = 0.3f + 0.7f * u(rng);
+    for (int d = 0; d < 20; d++) {
+      Bndbox b = obj;
+      b.x += jitter(rng);
+      b.y += jitter(rng);
+      b.score = base * (0.3f + 0.7f * u(rng));
+      boxes.push_back(b);
+    }
+  }
+  while ((int)boxes.size() < num_candidates) {
+    boxes.push_back(Bndbox(u(rng) * 69.0f, u(rng) * 79.0f - 39.5f, -1.0f, 0.8f, 0.6f, 1.73f,
+                           u(rng) * 6.28f, 1, 0.2f * u(rng)));
+  }
+}
+
+static void report(const char *name, const LatencyHistogram &h, unsigned long long over, double kept,
+                   unsigned long long truncated)
+{
+  std::cout << std::setw(10) << name << std::fixed << std::setprecision(2)
+            << std::setw(9) << h.percentile(50) << std::setw(9) << h.percentile(99)
+            << std::setw(9) << h.max() << std::setw(7) << over << std::setw(10) << kept
+            << std::setw(12) << truncated << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+  TopNControllerConfig config;
+  int num_frames = 300, peak = 8000;
+  float nms_thresh = 0.01f;
+  bool verbose = false;
+  int c;
+  while ((c = getopt(argc, argv, "b:n:m:f:c:t:vh")) != -1) {
+    switch (c) {
+      case 'b': config.budget_ms = atof(optarg); break;
+      case 'n': config.max_top_n = atoi(optarg); break;
+      case 'm': config.min_top_n = atoi(optarg); break;
+      case 'f': num_frames = atoi(optarg); break;
+      case 'c': peak = atoi(optarg); break;
+      case 't': nms_thresh = atof(optarg); break;
+      case 'v': verbose = true; break;
+      default:
+        std::cerr << "Usage: " << argv[0] << " [-b <budget_ms>] [-n <max_top_n>] [-m <min_top_n>]"
+                  << " [-f <frames>] [-c <peak_candidates>] [-t <nms_thresh>] [-v]" << std::endl;
+        return 1;
+    }
+  }
+
+  TopNController controller(config);
+  LatencyHistogram fixed_ms(1000.0f, 0.01f), adaptive_ms(1000.0f, 0.01f);
+  unsigned long long fixed_over = 0;
+  double fixed_kept = 0.0, adaptive_kept = 0.0;
+  std::vector<Bndbox> frame, boxes, kept;
+  std::vector<int> suppressed;
+  std::mt19937 rng(11);
+  for (int f = 0; f < num_frames; f++) {
+    // sparse, a ramp up to the crowded scene, and back down
+    float phase = (float)f / std::max(num_frames - 1, 1);
+    float density = phase < 0.3f || phase > 0.7f ? 0.0f : sinf((phase - 0.3f) / 0.4f * (float)M_PI);
+    make_frame(rng, 400 + (int)((peak - 400) * density), frame);
+
+    boxes = frame;
+    kept.clear();
+    auto t0 = std::chrono::steady_clock::now();
+    nms_cpu_inplace(boxes, nms_thresh, kept, config.max_top_n, suppressed);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    fixed_ms.add(ms);
+    fixed_over += ms > config.budget_ms;
+    fixed_kept += kept.size();
+
+    boxes = frame;
+    kept.clear();
+    controller.nms(boxes, nms_thresh, kept);
+    adaptive_ms.add(controller.stats().last_ms);
+    adaptive_kept += kept.size();
+    if (verbose && controller.topN() != controller.previousTopN()) {
+      std::cout << "frame " << f << ": " << frame.size() << " candidates, nms "
+                << controller.stats().last_ms << " ms, top-N " << controller.previousTopN() << " -> "
+                << controller.topN() << ", " << controller.lastTruncated() << " truncated" << std::endl;
+    }
+  }
+
+  const TopNControllerStats &s = controller.stats();
+  std::cout << num_frames << " frames, 400 to " << peak << " candidates, budget " << config.budget_ms
+            << " ms, top-N " << config.min_top_n << ".." << config.max_top_n << std::endl;
+  std::cout << std::setw(10) << "top-N" << std::setw(9) << "p50 ms" << std::setw(9) << "p99 ms"
+            << std::setw(9) << "max ms" << std::setw(7) << "over" << std::setw(10) << "kept/fr"
+            << std::setw(12) << "truncated" << std::endl;
+  report("fixed", fixed_ms, fixed_over, fixed_kept / num_frames, 0);
+  report("adaptive", adaptive_ms, s.over_budget, adaptive_kept / num_frames, s.truncated_candidates);
+  std::cout << s.decreases << " decreases, " << s.increases << " increases, " << s.truncated_frames
+            << " frames truncated, final top-N " << controller.topN() << std::endl;
+  return 0;
+}
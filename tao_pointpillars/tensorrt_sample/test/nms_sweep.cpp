@@ -0,0 +1,353 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// NMS hyperparameter sweep over raw boxes cached with --cache-raw.
+//   ./nms_sweep [-t <iou_thresholds>] [-n <pre_nms_top_ns>] [-s <score_cutoffs>]
+//               [-g <ground_truth_dir> [-u <min_iou>]] [-o <out_dir>] [-j <threads>] [-v] [-b]
+//               <frame.boxes>...
+// Lists are comma separated; every combination is one setting. Each frame is
+// sorted and its overlapping pairs' IoUs computed once, then all settings run
+// from that (see nms_sweep.h). -g matches the kept boxes of every setting with
+// <ground_truth_dir>/<stem>.txt by rotated IoU (-u, same class) and reports
+// precision and recall. -o writes the kept boxes of a setting to
+// <out_dir>/t<thresh>_n<top_n>_s<cutoff>/<stem>.txt for an external evaluator.
+// -v checks every setting against a plain greedy NMS over the same score
+// order, -b times one nms_cpu pass per frame for comparison.
+
+#include <errno.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <math.h>
+#include <stdio.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "box_compare.h"
+#include "box_io.h"
+#include "nms_sweep.h"
+
+struct Setting {
+  float nms_thresh;
+  int top_n;
+  float score_cutoff;
+  std::string tag;
+};
+
+struct SettingStats {
+  size_t kept = 0;
+  size_t matched = 0;
+  size_t ground_truth = 0;
+  size_t mismatches = 0;
+};
+
+struct ThreadStats {
+  std::vector<SettingStats> settings;
+  size_t frames = 0, failed = 0, raw_boxes = 0, pairs = 0;
+  double prepare_ms = 0.0, sweep_ms = 0.0, nms_ms = 0.0;
+};
+
+typedef std::chrono::steady_clock Clock;
+
+static double ms_since(Clock::time_point t0)
+{
+  return std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+}
+
+static void usage(const char *argv0)
+{
+  std::cout << "Usage: " << argv0 << " [-t <iou_thresholds>] [-n <pre_nms_top_ns>] [-s <score_cutoffs>]"
+            << " [-g <ground_truth_dir> [-u <min_iou>]] [-o <out_dir>] [-j <threads>] [-v] [-b] <frame.boxes>..."
+            << std::endl;
+}
+
+static bool parse_list(const char *text, std::vector<float> &values)
+{
+  values.clear();
+  std::string s(text);
+  size_t begin = 0;
+  while (begin <= s.size()) {
+    size_t end = s.find(',', begin);
+    if (end == std::string::npos) {
+      end = s.size();
+    }
+    std::string item = s.substr(begin, end - begin);
+    char *next;
+    float v = strtof(item.c_str(), &next);
+    if (item.empty() || *next != 0) {
+      return false;
+    }
+    values.push_back(v);
+    begin = end + 1;
+  }
+  return !values.empty();
+}
+
+static std::string file_stem(const std::string &path)
+{
+  std::string name = path.substr(path.find_last_of('/') + 1);
+  return name.substr(0, name.find_last_of('.'));
+}
+
+// Greedy NMS over the first n boxes of ordered, which are sorted by score
+// already, with nms_cpu's IoU test; the reference of -v.
+static void greedy_nms(const std::vector<Bndbox> &ordered, size_t n, float nms_thresh,
+                       std::vector<Bndbox> &kept, std::vector<char> &suppressed)
+{
+  suppressed.assign(n, 0);
+  for (size_t i = 0; i < n; i++) {
+    if (suppressed[i]) {
+      continue;
+    }
+    kept.push_back(ordered[i]);
+    for (size_t j = i + 1; j < n; j++) {
+      if (!suppressed[j] && box_iou_bev(ordered[i], ordered[j]) >= nms_thresh) {
+        suppressed[j] = 1;
+      }
+    }
+  }
+}
+
+static bool same_boxes(const std::vector<Bndbox> &a, const std::vector<Bndbox> &b)
+{
+  if (a.size() != b.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < a.size(); i++) {
+    if (a[i].x != b[i].x || a[i].y != b[i].y || a[i].score != b[i].score || a[i].id != b[i].id) {
+      return false;
+    }
+  }
+  return true;
+}
+
+int main(int argc, char **argv)
+{
+  std::vector<float> thresholds{0.01f}, top_ns{4096}, cutoffs{0.0f};
+  std::string gt_dir, out_dir;
+  float min_iou = 0.5f;
+  unsigned int num_threads = std::max(1u, std::thread::hardware_concurrency());
+  bool verify = false, baseline = false;
+  int c;
+  while ((c = getopt(argc, argv, "t:n:s:g:u:o:j:vbh")) != -1) {
+    switch (c) {
+      case 't':
+      case 'n':
+      case 's':
+        if (!parse_list(optarg, c == 't' ? thresholds : c == 'n' ? top_ns : cutoffs)) {
+          std::cerr << "-" << (char)c << " takes a comma separated list of numbers" << std::endl;
+          return 1;
+        }
+        break;
+      case 'g': gt_dir = optarg; break;
+      case 'u': min_iou = atof(optarg); break;
+      case 'o': out_dir = optarg; break;
+      case 'j': num_threads = std::max(1, atoi(optarg)); break;
+      case 'v': verify = true; break;
+      case 'b': baseline = true; break;
+      default: usage(argv[0]); return 1;
+    }
+  }
+  std::vector<std::string> files(argv + optind, argv + argc);
+  if (files.empty()) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  std::vector<Setting> settings;
+  int max_top_n = 0;
+  for (float t : thresholds) {
+    for (float n : top_ns) {
+      for (float s : cutoffs) {
+        Setting setting;
+        setting.nms_thresh = t;
+        setting.top_n = (int)n;
+        setting.score_cutoff = s;
+        char tag[96];
+        snprintf(tag, sizeof(tag), "t%g_n%d_s%g", t, setting.top_n, s);
+        setting.tag = tag;
+        settings.push_back(setting);
+        max_top_n = std::max(max_top_n, setting.top_n);
+      }
+    }
+  }
+  if (!out_dir.empty()) {
+    mkdir(out_dir.c_str(), 0755);
+    for (const Setting &setting : settings) {
+      std::string dir = out_dir + "/" + setting.tag;
+      if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) {
+        std::cerr << "Can't create " << dir << std::endl;
+        return 1;
+      }
+    }
+  }
+
+  BoxTolerance tolerance;
+  tolerance.min_iou = min_iou;
+  // an evaluation: pairs only need to overlap, field errors are not limits
+  tolerance.center = tolerance.size = tolerance.yaw = tolerance.score = INFINITY;
+
+  std::atomic<size_t> next{0};
+  std::vector<ThreadStats> stats(num_threads);
+  auto worker = [&](unsigned int t) {
+    ThreadStats &ts = stats[t];
+    ts.settings.resize(settings.size());
+    NmsSweepFrame frame;
+    std::vector<Bndbox> raw, kept, ordered, reference, truth;
+    std::vector<char> suppressed;
+    std::vector<int> track_ids;
+    std::string buffer;
+    FrameDiff diff;
+    BoxCompareScratch scratch;
+    for (size_t f; (f = next++) < files.size();) {
+      if (load_box_raw(files[f], raw) != 0) {
+        ts.failed++;
+        continue;
+      }
+      std::string stem = file_stem(files[f]);
+      bool have_truth = false;
+      if (!gt_dir.empty()) {
+        if (load_box_pred(gt_dir + "/" + stem + ".txt", truth, track_ids, buffer) != 0) {
+          ts.failed++;
+          continue;
+        }
+        have_truth = true;
+      }
+      ts.frames++;
+      ts.raw_boxes += raw.size();
+
+      auto t0 = Clock::now();
+      if (baseline) {
+        // what one nms_cpu pass costs, for scale
+        kept.clear();
+        nms_cpu(raw, settings[0].nms_thresh, kept, max_top_n);
+        ts.nms_ms += ms_since(t0);
+        t0 = Clock::now();
+      }
+      frame.prepare(raw, max_top_n);
+      ts.prepare_ms += ms_since(t0);
+      if (verify) {
+        // the sweep's order: by score, equal scores in file order
+        ordered = raw;
+        std::stable_sort(ordered.begin(), ordered.end(),
+                         [](const Bndbox &a, const Bndbox &b) { return a.score > b.score; });
+      }
+      ts.pairs += frame.numPairs();
+      for (size_t k = 0; k < settings.size(); k++) {
+        const Setting &setting = settings[k];
+        SettingStats &ss = ts.settings[k];
+        kept.clear();
+        t0 = Clock::now();
+        frame.run(setting.nms_thresh, setting.top_n, setting.score_cutoff, kept);
+        ts.sweep_ms += ms_since(t0);
+        ss.kept += kept.size();
+        if (have_truth) {
+          diff = FrameDiff();
+          compare_boxes(truth, kept, tolerance, diff, scratch);
+          ss.matched += diff.matched;
+          ss.ground_truth += truth.size();
+        }
+        if (verify) {
+          // boxes over the cutoff are a prefix of the order
+          size_t n = 0;
+          while (n < ordered.size() && n < (size_t)std::max(setting.top_n, 0) &&
+                 ordered[n].score >= setting.score_cutoff) {
+            n++;
+          }
+          reference.clear();
+          greedy_nms(ordered, n, setting.nms_thresh, reference, suppressed);
+          if (!same_boxes(kept, reference)) {
+            ss.mismatches++;
+          }
+        }
+        if (!out_dir.empty()) {
+          save_box_pred(kept, out_dir + "/" + setting.tag + "/" + stem + ".txt");
+        }
+      }
+    }
+  };
+  auto t0 = Clock::now();
+  std::vector<std::thread> threads;
+  for (unsigned int t = 1; t < num_threads; t++) {
+    threads.emplace_back(worker, t);
+  }
+  worker(0);
+  for (auto &th : threads) {
+    th.join();
+  }
+  double wall_ms = ms_since(t0);
+
+  ThreadStats total;
+  total.settings.resize(settings.size());
+  for (const ThreadStats &ts : stats) {
+    total.frames += ts.frames;
+    total.failed += ts.failed;
+    total.raw_boxes += ts.raw_boxes;
+    total.pairs += ts.pairs;
+    total.prepare_ms += ts.prepare_ms;
+    total.sweep_ms += ts.sweep_ms;
+    total.nms_ms += ts.nms_ms;
+    for (size_t k = 0; k < settings.size() && k < ts.settings.size(); k++) {
+      total.settings[k].kept += ts.settings[k].kept;
+      total.settings[k].matched += ts.settings[k].matched;
+      total.settings[k].ground_truth += ts.settings[k].ground_truth;
+      total.settings[k].mismatches += ts.settings[k].mismatches;
+    }
+  }
+
+  size_t frames = std::max<size_t>(total.frames, 1);
+  std::cout << std::fixed << std::setprecision(4);
+  std::cout << std::setw(10) << "iou" << std::setw(8) << "top_n" << std::setw(10) << "score"
+            << std::setw(12) << "kept/frame";
+  if (!gt_dir.empty()) {
+    std::cout << std::setw(11) << "precision" << std::setw(10) << "recall";
+  }
+  if (verify) {
+    std::cout << std::setw(12) << "mismatches";
+  }
+  std::cout << std::endl;
+  size_t mismatches = 0;
+  for (size_t k = 0; k < settings.size(); k++) {
+    const SettingStats &ss = total.settings[k];
+    std::cout << std::setw(10) << settings[k].nms_thresh << std::setw(8) << settings[k].top_n
+              << std::setw(10) << settings[k].score_cutoff << std::setw(12) << (double)ss.kept / frames;
+    if (!gt_dir.empty()) {
+      std::cout << std::setw(11) << (ss.kept ? (double)ss.matched / ss.kept : 0.0)
+                << std::setw(10) << (ss.ground_truth ? (double)ss.matched / ss.ground_truth : 0.0);
+    }
+    if (verify) {
+      std::cout << std::setw(12) << ss.mismatches;
+    }
+    std::cout << std::endl;
+    mismatches += ss.mismatches;
+  }
+  std::cout << std::setprecision(3) << total.frames << " frames (" << total.failed << " failed), "
+            << (double)total.raw_boxes / frames << " raw boxes and " << (double)total.pairs / frames
+            << " overlapping pairs per frame" << std::endl;
+  std::cout << "per frame: prepare " << total.prepare_ms / frames << " ms, " << settings.size()
+            << " settings " << total.sweep_ms / frames << " ms";
+  if (baseline) {
+    std::cout << ", one nms_cpu pass " << total.nms_ms / frames << " ms";
+  }
+  std::cout << "; wall " << wall_ms << " ms on " << num_threads << " threads" << std::endl;
+  return total.failed || mismatches ? 1 : 0;
+}
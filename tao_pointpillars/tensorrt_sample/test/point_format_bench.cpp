@@ -0,0 +1,188 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Runtime-stride point passes against the fixed-layout point format kernels.
+//   ./point_format_bench [-r reps] [-c file_channels] [cloud.bin]
+// Loads the cloud (default ../../data/000101.bin), crops it to the model
+// range and applies a rigid transform, once with loops over a runtime point
+// size and once per point format through point_kernels(). The fp32 formats
+// must give the same points; the fp16 formats report their rounding error.
+
+#include <getopt.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include "point_transform.h"
+#include "point_types.h"
+
+static const float kRange[6] = {0.0f, -39.68f, -3.0f, 69.12f, 39.68f, 1.0f};
+
+typedef std::chrono::steady_clock Clock;
+
+template <typename Fn>
+static double median_ms(int reps, Fn fn)
+{
+  std::vector<double> t;
+  for (int r = 0; r < reps; r++) {
+    auto t0 = Clock::now();
+    fn();
+    t.push_back(std::chrono::duration<double, std::milli>(Clock::now() - t0).count());
+  }
+  std::sort(t.begin(), t.end());
+  return t[t.size() / 2];
+}
+
+static void usage(const char *argv0)
+{
+  std::cerr << "Usage: " << argv0 << " [-r reps] [-c file_channels] [cloud.bin]" << std::endl;
+}
+
+// the untyped passes: floats with a runtime stride, transformed by the same
+// transform_points() the fp32 formats use
+static int load_generic(const std::string &path, unsigned int ps, std::vector<float> &dst)
+{
+  FILE *fp = fopen(path.c_str(), "rb");
+  if (!fp) {
+    std::cerr << "Can't open files: " << path << std::endl;
+    return -1;
+  }
+  fseek(fp, 0, SEEK_END);
+  size_t n = ftell(fp) / (ps * sizeof(float));
+  rewind(fp);
+  dst.resize(n * ps);
+  size_t got = fread(dst.data(), ps * sizeof(float), n, fp);
+  fclose(fp);
+  dst.resize(got * ps);
+  return got;
+}
+
+static unsigned int crop_generic(const float *src, unsigned int n, unsigned int ps, float *dst)
+{
+  unsigned int kept = 0;
+  for (unsigned int i = 0; i < n; i++) {
+    const float *p = src + (size_t)i * ps;
+    if (p[0] >= kRange[0] && p[0] < kRange[3] && p[1] >= kRange[1] && p[1] < kRange[4] &&
+        p[2] >= kRange[2] && p[2] < kRange[5]) {
+      memmove(dst + (size_t)kept * ps, p, ps * sizeof(float));
+      kept++;
+    }
+  }
+  return kept;
+}
+
+
+int main(int argc, char **argv)
+{
+  int reps = 21;
+  unsigned int file_channels = 4;
+  int opt;
+  while ((opt = getopt(argc, argv, "r:c:h")) != -1) {
+    switch (opt) {
+      case 'r': reps = atoi(optarg); break;
+      case 'c': file_channels = atoi(optarg); break;
+      default: usage(argv[0]); return 1;
+    }
+  }
+  std::string file = optind < argc ? argv[optind] : "../../data/000101.bin";
+  if (reps < 1 || file_channels < 4) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  // a small yaw and a lever arm, like a LiDAR-to-body extrinsic
+  const float yaw = 0.05f;
+  const float T[12] = {cosf(yaw), -sinf(yaw), 0.0f, 1.2f,
+                       sinf(yaw), cosf(yaw), 0.0f, -0.1f,
+                       0.0f, 0.0f, 1.0f, 1.8f};
+
+  std::vector<float> raw, generic;
+  int loaded = load_generic(file, file_channels, raw);
+  if (loaded < 0) {
+    return 1;
+  }
+  unsigned int n = loaded;
+  generic.resize(raw.size());
+  unsigned int kept = 0;
+  double load_ms = median_ms(reps, [&]() { load_generic(file, file_channels, raw); });
+  double crop_ms = median_ms(reps, [&]() { kept = crop_generic(raw.data(), n, file_channels, generic.data()); });
+  double xform_ms = median_ms(reps, [&]() {
+    kept = crop_generic(raw.data(), n, file_channels, generic.data());
+    transform_points(generic.data(), file_channels, generic.data(), file_channels, kept, T);
+  }) - crop_ms;
+
+  std::cout << file << ": " << n << " points, " << file_channels << " channels, "
+            << kept << " in range" << std::endl;
+  std::cout << std::setw(10) << "format" << std::setw(8) << "bytes" << std::setw(10) << "load ms"
+            << std::setw(10) << "crop ms" << std::setw(12) << "xform ms" << std::setw(12) << "expand ms"
+            << std::setw(12) << "max error" << std::endl;
+  std::cout << std::fixed << std::setprecision(3)
+            << std::setw(10) << "runtime" << std::setw(8) << file_channels * 4 << std::setw(10) << load_ms
+            << std::setw(10) << crop_ms << std::setw(12) << xform_ms << std::setw(12) << 0.0
+            << std::setw(12) << 0.0 << std::endl;
+
+  int failed = 0;
+  const PointFormat formats[] = {PointFormat::kXYZI, PointFormat::kXYZIT,
+                                 PointFormat::kXYZIHalf, PointFormat::kXYZITHalf};
+  for (int f = 0; f < 4; f++) {
+    const PointKernels &k = point_kernels(formats[f]);
+    std::vector<uint8_t> points((size_t)n * k.point_bytes), cropped(points.size());
+    std::vector<float> expanded((size_t)n * file_channels);
+    unsigned int typed_kept = 0;
+    double t_load = median_ms(reps, [&]() { k.load(file, file_channels, points.data(), n); });
+    double t_crop = median_ms(reps, [&]() {
+      typed_kept = k.crop(points.data(), n, kRange, cropped.data());
+    });
+    double t_xform = median_ms(reps, [&]() {
+      typed_kept = k.crop(points.data(), n, kRange, cropped.data());
+      k.transform(cropped.data(), typed_kept, T, cropped.data());
+    }) - t_crop;
+    double t_expand = median_ms(reps, [&]() {
+      k.expand(cropped.data(), typed_kept, expanded.data(), file_channels);
+    });
+
+    // compare the channels the format carries; the rest must come out zero
+    float max_err = 0.0f;
+    bool same = typed_kept == kept;
+    for (size_t i = 0; same && i < (size_t)kept * file_channels; i++) {
+      unsigned int c = i % file_channels;
+      float want = c < k.channels ? generic[i] : 0.0f;
+      max_err = std::max(max_err, fabsf(expanded[i] - want));
+    }
+    bool half = formats[f] == PointFormat::kXYZIHalf || formats[f] == PointFormat::kXYZITHalf;
+    // fp16 rounds the input and the transformed point, half a 0.0625 m step
+    // each beyond 64 m
+    if (!same || (!half && max_err != 0.0f) || (half && max_err > 0.07f)) {
+      failed++;
+    }
+    std::cout << std::setw(10) << point_format_name(formats[f]) << std::setw(8) << k.point_bytes
+              << std::setw(10) << t_load << std::setw(10) << t_crop << std::setw(12) << t_xform
+              << std::setw(12) << t_expand << std::setw(12) << max_err
+              << (same ? "" : "  point count differs") << std::endl;
+  }
+  if (failed) {
+    std::cerr << failed << " formats differ from the runtime-stride passes" << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,158 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Compares CPU passes over points in sensor scan order and in Morton order.
+//   ./point_order_bench [cloud.bin] [point_size]
+// Runs on the given KITTI-style cloud (default ../../data/000101.bin) and on a
+// synthetic 128-beam spinning LiDAR sweep.
+
+#include <math.h>
+#include <string.h>
+#include <stdlib.h>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include "point_order.h"
+
+static const float kRange[6] = {0.0f, -39.68f, -3.0f, 69.12f, 39.68f, 1.0f};
+static const float kPillar = 0.16f;
+static const int kGridX = 432, kGridY = 496, kMaxPerPillar = 32;
+
+typedef std::chrono::steady_clock Clock;
+
+template <typename Fn>
+static double median_ms(int reps, Fn fn)
+{
+  std::vector<double> t;
+  for (int r = 0; r < reps; r++) {
+    auto t0 = Clock::now();
+    fn();
+    t.push_back(std::chrono::duration<double, std::milli>(Clock::now() - t0).count());
+  }
+  std::sort(t.begin(), t.end());
+  return t[t.size() / 2];
+}
+
+// crop to the model range, writing the survivors out
+static unsigned int crop(const float *points, unsigned int n, unsigned int ps, float *out)
+{
+  unsigned int kept = 0;
+  for (unsigned int i = 0; i < n; i++) {
+    const float *p = points + (size_t)i * ps;
+    if (p[0] >= kRange[0] && p[0] < kRange[3] && p[1] >= kRange[1] && p[1] < kRange[4] &&
+        p[2] >= kRange[2] && p[2] < kRange[5]) {
+      memcpy(out + (size_t)kept * ps, p, ps * sizeof(float));
+      kept++;
+    }
+  }
+  return kept;
+}
+
+// scatter points into pillars the way the voxelizer does
+static void voxelize(const float *points, unsigned int n, unsigned int ps,
+                     std::vector<int> &count, std::vector<float> &pillars)
+{
+  std::fill(count.begin(), count.end(), 0);
+  for (unsigned int i = 0; i < n; i++) {
+    const float *p = points + (size_t)i * ps;
+    int gx = (int)floorf((p[0] - kRange[0]) / kPillar);
+    int gy = (int)floorf((p[1] - kRange[1]) / kPillar);
+    if (gx < 0 || gx >= kGridX || gy < 0 || gy >= kGridY) {
+      continue;
+    }
+    int cell = gy * kGridX + gx;
+    int k = count[cell]++;
+    if (k < kMaxPerPillar) {
+      memcpy(&pillars[((size_t)cell * kMaxPerPillar + k) * 4], p, 4 * sizeof(float));
+    }
+  }
+}
+
+static std::vector<float> synthetic_128_beam(unsigned int ps)
+{
+  const int beams = 128, columns = 2048;
+  std::vector<float> cloud((size_t)beams * columns * ps, 0.0f);
+  srand(101);
+  size_t i = 0;
+  // column-major like the sensor emits it: all beams of one azimuth, then the next
+  for (int c = 0; c < columns; c++) {
+    float az = 2.0f * (float)M_PI * c / columns;
+    for (int b = 0; b < beams; b++) {
+      float el = (-22.5f + 45.0f * b / (beams - 1)) * (float)M_PI / 180.0f;
+      float r = 2.0f + (rand() % 10000) / 10000.0f * 78.0f;
+      if (el < 0) {
+        r = std::min(r, 1.8f / -sinf(el));    // ground hit
+      }
+      float *p = &cloud[i++ * ps];
+      p[0] = r * cosf(el) * cosf(az);
+      p[1] = r * cosf(el) * sinf(az);
+      p[2] = r * sinf(el);
+      p[3] = (rand() % 256) / 255.0f;
+    }
+  }
+  return cloud;
+}
+
+static void run(const std::string &name, const std::vector<float> &cloud, unsigned int ps)
+{
+  const int reps = 21;
+  unsigned int n = cloud.size() / ps;
+  std::vector<float> sorted(cloud.size()), cropped(cloud.size());
+  std::vector<int> count(kGridX * kGridY);
+  std::vector<float> pillars((size_t)kGridX * kGridY * kMaxPerPillar * 4);
+
+  std::cout << "== " << name << ": " << n << " points" << std::endl;
+  std::cout << std::setw(10) << "order" << std::setw(12) << "sort ms"
+            << std::setw(12) << "crop ms" << std::setw(14) << "voxelize ms" << std::endl;
+
+  const char *names[] = {"scan", "morton2d", "morton3d"};
+  const MortonMode modes[] = {MortonMode::kNone, MortonMode::k2D, MortonMode::k3D};
+  for (int m = 0; m < 3; m++) {
+    // the sort covers a wider range than the crop so that no point is clamped
+    const float sort_range[6] = {-80.0f, -80.0f, -10.0f, 80.0f, 80.0f, 10.0f};
+    MortonSorter sorter(modes[m], sort_range, m == 1 ? kPillar : 0.2f);
+    double sort_ms = median_ms(reps, [&]() { sorter.sort(cloud.data(), sorted.data(), n, ps); });
+    double crop_ms = median_ms(reps, [&]() { crop(sorted.data(), n, ps, cropped.data()); });
+    double vox_ms = median_ms(reps, [&]() { voxelize(sorted.data(), n, ps, count, pillars); });
+    std::cout << std::setw(10) << names[m] << std::fixed << std::setprecision(3)
+              << std::setw(12) << sort_ms << std::setw(12) << crop_ms
+              << std::setw(14) << vox_ms << std::endl;
+  }
+}
+
+int main(int argc, char **argv)
+{
+  std::string file = argc > 1 ? argv[1] : "../../data/000101.bin";
+  unsigned int ps = argc > 2 ? atoi(argv[2]) : 4;
+
+  std::ifstream ifs(file, std::ios::binary | std::ios::ate);
+  if (ifs.is_open()) {
+    size_t len = ifs.tellg();
+    ifs.seekg(0);
+    std::vector<float> cloud(len / sizeof(float) / ps * ps);
+    ifs.read((char *)cloud.data(), cloud.size() * sizeof(float));
+    run(file, cloud, ps);
+  } else {
+    std::cerr << "Can't open files: " << file << std::endl;
+  }
+  run("synthetic 128-beam", synthetic_128_beam(ps), ps);
+  return 0;
+}
@@ -0,0 +1,200 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Point cloud codec command line tool.
+//   ./pointcodec encode [-q <xyz_step>] [-i <intensity_step>] [-p <point_size>] [-a <archive.ppc> | -o <output_dir>] <file.bin> ...
+//   ./pointcodec decode [-p <point_size>] -o <output_dir> <archive.ppc> ...
+//   ./pointcodec bench  [-q <xyz_step>] [-i <intensity_step>] [-p <point_size>] <file.bin>
+// A step of 0 keeps the channel lossless. encode writes one .ppc per input
+// unless -a packs all of them as frames of a single archive.
+
+#include <unistd.h>
+#include <math.h>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <memory>
+#include <algorithm>
+#include "point_codec.h"
+#include "point_io.h"
+
+static std::string stem(const std::string &path)
+{
+  std::string name = path.substr(path.find_last_of('/') + 1);
+  return name.substr(0, name.find_last_of('.'));
+}
+
+static void usage(const char *argv0)
+{
+  std::cout << "Usage: " << std::endl
+            << argv0 << " encode [-q <xyz_step>] [-i <intensity_step>] [-p <point_size>]"
+            << " [-a <archive.ppc> | -o <output_dir>] <file.bin> ..." << std::endl
+            << argv0 << " decode [-p <point_size>] -o <output_dir> <archive.ppc> ..." << std::endl
+            << argv0 << " bench [-q <xyz_step>] [-i <intensity_step>] [-p <point_size>] <file.bin>" << std::endl;
+}
+
+static int encode(const std::vector<std::string> &inputs, unsigned int point_size,
+                  const PointCodecOptions &options, const std::string &archive, const std::string &output_dir)
+{
+  PointLoader loader;
+  std::vector<float> points;
+  std::unique_ptr<PointCodecWriter> writer;
+  if (!archive.empty()) {
+    writer.reset(new PointCodecWriter(archive, options));
+    if (!writer->isOpen()) {
+      return 1;
+    }
+  }
+  unsigned long long in_bytes = 0, out_bytes = 0;
+  for (const auto &input : inputs) {
+    unsigned int n = 0;
+    if (loader.count(input, point_size, &n) != 0) {
+      continue;
+    }
+    points.resize((size_t)n * point_size);
+    loader.load(input, points.data(), n, point_size, &n);
+    if (archive.empty()) {
+      writer.reset(new PointCodecWriter(output_dir + "/" + stem(input) + ".ppc", options));
+    }
+    size_t bytes = writer->write(points.data(), n, point_size);
+    in_bytes += points.size() * sizeof(float);
+    out_bytes += bytes;
+    std::cout << input << ": " << n << " points, " << bytes << " bytes" << std::endl;
+  }
+  if (in_bytes) {
+    std::cout << "Encoded " << in_bytes << " -> " << out_bytes << " bytes, ratio "
+              << (double)in_bytes / out_bytes << std::endl;
+  }
+  return 0;
+}
+
+static int decode(const std::vector<std::string> &inputs, unsigned int point_size, const std::string &output_dir)
+{
+  std::vector<float> points;
+  for (const auto &input : inputs) {
+    PointCodecReader reader(input);
+    if (!reader.isOpen()) {
+      return 1;
+    }
+    unsigned int n = 0;
+    for (int frame = 0; reader.peekPoints(&n) == 0; frame++) {
+      points.resize((size_t)n * point_size);
+      if (reader.next(points.data(), n, point_size, &n) != 0) {
+        return 1;
+      }
+      std::string output = output_dir + "/" + stem(input);
+      if (frame > 0) {
+        output += "_" + std::to_string(frame);
+      }
+      output += ".bin";
+      std::ofstream ofs(output, std::ios::out | std::ios::binary);
+      ofs.write((const char *)points.data(), points.size() * sizeof(float));
+      std::cout << "Saved " << n << " points in: " << output << std::endl;
+    }
+  }
+  return 0;
+}
+
+static int bench(const std::string &input, unsigned int point_size, const PointCodecOptions &options)
+{
+  PointLoader loader;
+  unsigned int n = 0;
+  if (loader.count(input, point_size, &n) != 0) {
+    return 1;
+  }
+  std::vector<float> points((size_t)n * point_size), decoded(points.size());
+  loader.load(input, points.data(), n, point_size, &n);
+
+  typedef std::chrono::steady_clock Clock;
+  const int reps = 50;
+  std::vector<uint8_t> frame;
+  auto t0 = Clock::now();
+  for (int r = 0; r < reps; r++) {
+    frame.clear();
+    encode_frame(points.data(), n, point_size, options, frame);
+  }
+  double enc_s = std::chrono::duration<double>(Clock::now() - t0).count() / reps;
+
+  unsigned int m = 0;
+  std::vector<double> times;
+  for (int r = 0; r < reps; r++) {
+    auto t1 = Clock::now();
+    decode_frame(frame.data(), frame.size(), decoded.data(), n, point_size, &m);
+    times.push_back(std::chrono::duration<double>(Clock::now() - t1).count());
+  }
+  std::sort(times.begin(), times.end());
+  double dec_s = times[times.size() / 2];
+
+  float err[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+  for (unsigned int i = 0; i < m; i++) {
+    for (int c = 0; c < 4; c++) {
+      err[c] = std::max(err[c], fabsf(decoded[(size_t)i * point_size + c] - points[(size_t)i * point_size + c]));
+    }
+  }
+  double raw = points.size() * sizeof(float);
+  std::cout << input << ": " << n << " points, xyz step " << options.step[0]
+            << ", intensity step " << options.step[3] << std::endl;
+  std::cout << "  size:   " << (size_t)raw << " -> " << frame.size() << " bytes, ratio "
+            << std::fixed << std::setprecision(2) << raw / frame.size() << std::endl;
+  std::cout << "  encode: " << enc_s * 1e3 << " ms, " << raw / enc_s / 1e6 << " MB/s" << std::endl;
+  std::cout << "  decode: " << dec_s * 1e3 << " ms, " << raw / dec_s / 1e6 << " MB/s (output floats)" << std::endl;
+  std::cout << "  max error x/y/z/i: " << std::setprecision(6) << err[0] << " " << err[1] << " "
+            << err[2] << " " << err[3] << std::endl;
+  return 0;
+}
+
+int main(int argc, char **argv)
+{
+  if (argc < 2) {
+    usage(argv[0]);
+    return 1;
+  }
+  std::string command = argv[1];
+  PointCodecOptions options;
+  unsigned int point_size = 4;
+  std::string archive, output_dir = ".";
+  optind = 2;
+  int c;
+  while ((c = getopt(argc, argv, "q:i:p:a:o:h")) != -1) {
+    switch (c) {
+      case 'q': options.step[0] = options.step[1] = options.step[2] = atof(optarg); break;
+      case 'i': options.step[3] = atof(optarg); break;
+      case 'p': point_size = atoi(optarg); break;
+      case 'a': archive = optarg; break;
+      case 'o': output_dir = optarg; break;
+      default: usage(argv[0]); return 1;
+    }
+  }
+  std::vector<std::string> inputs(argv + optind, argv + argc);
+  if (inputs.empty() || point_size < 4) {
+    usage(argv[0]);
+    return 1;
+  }
+  if (command == "encode") {
+    return encode(inputs, point_size, options, archive, output_dir);
+  } else if (command == "decode") {
+    return decode(inputs, point_size, output_dir);
+  } else if (command == "bench") {
+    return bench(inputs[0], point_size, options);
+  }
+  usage(argv[0]);
+  return 1;
+}
@@ -0,0 +1,154 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+ * Embeds libpointpillars from C: loads a KITTI .bin cloud, runs it through
+ * pp_infer() a number of times and prints the boxes and statistics. On glibc
+ * the heap allocations made during the steady-state calls are counted, which
+ * should be zero.
+ *   ./pointpillars_c_example -e <engine_path> [-m <model_path>] [-d fp16]
+ *                            [-n <runs>] [-c <contexts>] [-s] <cloud.bin>
+ * -s uses the CPU stub detector.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "pointpillars_c.h"
+
+#ifdef __GLIBC__
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t num, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+static volatile int counting = 0;
+static volatile unsigned long allocations = 0;
+
+void *malloc(size_t size)
+{
+    if (counting) {
+        __sync_fetch_and_add(&allocations, 1);
+    }
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t num, size_t size)
+{
+    if (counting) {
+        __sync_fetch_and_add(&allocations, 1);
+    }
+    return __libc_calloc(num, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    if (counting) {
+        __sync_fetch_and_add(&allocations, 1);
+    }
+    return __libc_realloc(ptr, size);
+}
+#endif
+
+int main(int argc, char **argv)
+{
+    pp_config config;
+    pp_config_init(&config);
+    int runs = 10;
+    int c;
+    while ((c = getopt(argc, argv, "m:e:d:n:c:sh")) != -1) {
+        switch (c) {
+            case 'm': config.model_path = optarg; break;
+            case 'e': config.engine_path = optarg; break;
+            case 'd': config.data_type = optarg; break;
+            case 'n': runs = atoi(optarg); break;
+            case 'c': config.num_contexts = atoi(optarg); break;
+            case 's': config.use_stub = 1; break;
+            default:
+                printf("Usage: %s -e <engine_path> [-m <model_path>] [-d fp16] [-n <runs>] [-c <contexts>] [-s]"
+                       " <cloud.bin>\n", argv[0]);
+                return 1;
+        }
+    }
+    if (optind >= argc) {
+        printf("No input cloud\n");
+        return 1;
+    }
+
+    pp_detector *detector;
+    int status = pp_create_ex(&config, &detector);
+    if (status != PP_OK) {
+        printf("pp_create failed: %s\n", pp_status_string(status));
+        return 1;
+    }
+    uint32_t point_size = pp_point_size(detector);
+
+    FILE *f = fopen(argv[optind], "rb");
+    if (!f) {
+        printf("Can't open %s\n", argv[optind]);
+        pp_destroy(detector);
+        return 1;
+    }
+    fseek(f, 0, SEEK_END);
+    uint32_t num_points = (uint32_t)(ftell(f) / (4 * sizeof(float)));
+    fseek(f, 0, SEEK_SET);
+    float *points = (float *)calloc((size_t)num_points * point_size, sizeof(float));
+    for (uint32_t i = 0; i < num_points; i++) {
+        if (fread(points + (size_t)i * point_size, sizeof(float), 4, f) != 4) {
+            num_points = i;
+            break;
+        }
+    }
+    fclose(f);
+
+    uint32_t max_boxes = 256, num_boxes = 0;
+    pp_box *boxes = (pp_box *)malloc(max_boxes * sizeof(pp_box));
+    status = PP_OK;
+    for (int r = 0; r < runs; r++) {
+        /* the first call warms up lazily initialized runtime state */
+#ifdef __GLIBC__
+        counting = r > 0;
+#endif
+        status = pp_infer(detector, points, num_points, boxes, max_boxes, &num_boxes);
+#ifdef __GLIBC__
+        counting = 0;
+#endif
+        if (status < 0) {
+            printf("pp_infer: %s\n", pp_status_string(status));
+            break;
+        }
+    }
+
+    printf("%u points, %u boxes (%s)\n", num_points, num_boxes, pp_status_string(status));
+    for (uint32_t i = 0; i < num_boxes && i < 10; i++) {
+        const pp_box *b = &boxes[i];
+        printf("  %d %.2f %.2f %.2f %.2f %.2f %.2f %.2f %.3f\n", b->id, b->x, b->y, b->z, b->l, b->w, b->h,
+               b->rt, b->score);
+    }
+    pp_stats stats;
+    pp_get_stats(detector, &stats);
+    printf("frames %llu, mean %.3f ms, max %.3f ms, truncated %llu, clipped points %llu\n",
+           (unsigned long long)stats.frames, stats.mean_ms, stats.max_ms,
+           (unsigned long long)stats.truncated_frames, (unsigned long long)stats.clipped_points);
+#ifdef __GLIBC__
+    printf("heap allocations in %d steady-state calls: %lu\n", runs > 1 ? runs - 1 : 0, allocations);
+#endif
+    free(boxes);
+    free(points);
+    pp_destroy(detector);
+    return status < 0 ? 1 : 0;
+}
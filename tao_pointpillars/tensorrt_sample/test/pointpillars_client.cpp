@@ -0,0 +1,125 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Client of pointpillars_server.
+//   ./pointpillars_client [-s <socket>] [-t <nms_iou_thresh>] [-n <pre_nms_top_n>]
+//                         [-j <connections>] [-k <repeat>] [-o <output_dir>] <file> [<file> ...]
+//   ./pointpillars_client [-s <socket>] ... -r <ring_name> [-q <seq>]
+// Every connection sends every request once per repeat, so -j > 1 exercises
+// queueing and coalescing. Boxes are written in the pointpillars output format
+// when -o is given.
+
+#include <unistd.h>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "detection_server.h"
+
+static std::string stem(const std::string &path)
+{
+  std::string name = path.substr(path.find_last_of('/') + 1);
+  return name.substr(0, name.find_last_of('.'));
+}
+
+static void save_boxes(const std::vector<Bndbox> &boxes, const std::string &file_name)
+{
+  std::ofstream ofs(file_name, std::ios::out);
+  for (const auto &box : boxes) {
+    ofs << box.x << " " << box.y << " " << box.z << " " << box.w << " " << box.l << " "
+        << box.h << " " << box.rt << " " << box.id << " " << box.score << " \n";
+  }
+}
+
+int main(int argc, char **argv)
+{
+  std::string socket_path = "/tmp/pointpillars.sock";
+  std::string ring_name, output_dir;
+  float nms_iou_thresh = 0.01f;
+  int pre_nms_top_n = 4096;
+  int connections = 1, repeat = 1;
+  uint64_t seq = 0;
+  int c;
+  while ((c = getopt(argc, argv, "s:t:n:j:k:o:r:q:h")) != -1) {
+    switch (c) {
+      case 's': socket_path = optarg; break;
+      case 't': nms_iou_thresh = atof(optarg); break;
+      case 'n': pre_nms_top_n = atoi(optarg); break;
+      case 'j': connections = atoi(optarg); break;
+      case 'k': repeat = atoi(optarg); break;
+      case 'o': output_dir = optarg; break;
+      case 'r': ring_name = optarg; break;
+      case 'q': seq = strtoull(optarg, nullptr, 10); break;
+      default:
+        std::cout << "Usage: " << argv[0] << " [-s <socket>] [-t <nms_iou_thresh>] [-n <pre_nms_top_n>]"
+                  << " [-j <connections>] [-k <repeat>] [-o <output_dir>]"
+                  << " <file> ... | -r <ring_name> [-q <seq>]" << std::endl;
+        return 1;
+    }
+  }
+  std::vector<std::string> inputs(argv + optind, argv + argc);
+  ServeSource source = kServeFile;
+  if (!ring_name.empty()) {
+    source = kServeRing;
+    inputs.assign(1, ring_name);
+  }
+  if (inputs.empty()) {
+    std::cerr << "No input files" << std::endl;
+    return 1;
+  }
+
+  std::mutex print_mutex;
+  int failures = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (int t = 0; t < connections; t++) {
+    threads.emplace_back([&, t] {
+      DetectionClient client(socket_path);
+      ServeReply reply;
+      std::vector<Bndbox> boxes;
+      for (int r = 0; r < repeat; r++) {
+        for (const std::string &input : inputs) {
+          int status = client.request(source, input, seq, nms_iou_thresh, pre_nms_top_n, &reply, boxes);
+          std::lock_guard<std::mutex> lock(print_mutex);
+          if (status != kServeOk) {
+            std::cout << "[" << t << "] " << input << ": error " << status << std::endl;
+            failures++;
+            continue;
+          }
+          std::cout << "[" << t << "] " << input << (source == kServeRing ? " #" + std::to_string(reply.seq) : "")
+                    << ": " << boxes.size() << " boxes, queue " << reply.queue_ms << " ms, infer "
+                    << reply.infer_ms << " ms, coalesced " << reply.coalesced << std::endl;
+          if (!output_dir.empty()) {
+            std::string name = source == kServeRing ? stem(input) + "_" + std::to_string(reply.seq) : stem(input);
+            save_boxes(boxes, output_dir + "/" + name + ".txt");
+          }
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  std::cout << "TIME: " << std::chrono::duration<double, std::milli>(t1 - t0).count() << " ms for "
+            << connections * repeat * inputs.size() << " requests, " << failures << " failed" << std::endl;
+  return failures ? 1 : 0;
+}
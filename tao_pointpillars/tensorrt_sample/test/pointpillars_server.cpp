@@ -0,0 +1,116 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Detection daemon: keeps the engine resident and serves requests over a
+// Unix socket, see detection_server.h for the protocol.
+//   ./pointpillars_server -s <socket> -m <model_path> -e <engine_path> [-d fp16]
+//   ./pointpillars_server -s <socket> --stub [--stub-latency <ms>] [--stub-jitter <ms>] [--max-points <N>]
+// --stub serves from the CPU stand-in detector, so the serving path can be
+// exercised without a GPU (it is the only detector of CPU-only builds).
+
+#include <getopt.h>
+#include <signal.h>
+#include <iostream>
+#include <memory>
+#include <string>
+#include "detection_server.h"
+#ifndef POINTPILLARS_CPU_ONLY
+#include "pointpillar_detector.h"
+#endif
+
+static DetectionServer *g_server = nullptr;
+
+static void on_signal(int)
+{
+  if (g_server) {
+    g_server->stop();
+  }
+}
+
+int main(int argc, char **argv)
+{
+  enum {
+    OPT_STUB = 256,
+    OPT_STUB_LATENCY,
+    OPT_STUB_JITTER,
+    OPT_MAX_POINTS,
+  };
+  static struct option long_options[] = {
+    {"stub", no_argument, 0, OPT_STUB},
+    {"stub-latency", required_argument, 0, OPT_STUB_LATENCY},
+    {"stub-jitter", required_argument, 0, OPT_STUB_JITTER},
+    {"max-points", required_argument, 0, OPT_MAX_POINTS},
+    {0, 0, 0, 0}
+  };
+  std::string socket_path = "/tmp/pointpillars.sock";
+  std::string model_path, engine_path, data_type = "fp32";
+  bool stub = false;
+  float stub_latency = 0.0f;
+  float stub_jitter = 0.0f;
+  unsigned int max_points = 204800;
+  int c;
+  while ((c = getopt_long(argc, argv, "s:m:e:d:h", long_options, NULL)) != -1) {
+    switch (c) {
+      case 's': socket_path = optarg; break;
+      case 'm': model_path = optarg; break;
+      case 'e': engine_path = optarg; break;
+      case 'd': data_type = optarg; break;
+      case OPT_STUB: stub = true; break;
+      case OPT_STUB_LATENCY: stub_latency = atof(optarg); break;
+      case OPT_STUB_JITTER: stub_jitter = atof(optarg); break;
+      case OPT_MAX_POINTS: max_points = atoi(optarg); break;
+      default:
+        std::cout << "Usage: " << argv[0] << " -s <socket> -m <model_path> -e <engine_path> [-d <data_type>]"
+                  << " | --stub [--stub-latency <ms>] [--stub-jitter <ms>] [--max-points <N>]" << std::endl;
+        return 1;
+    }
+  }
+
+  std::unique_ptr<Detector> detector;
+#ifdef POINTPILLARS_CPU_ONLY
+  if (!stub) {
+    std::cout << "CPU-only build, serving the stub detector" << std::endl;
+  }
+  stub = true;
+#else
+  if (!stub) {
+    std::unique_ptr<PointPillarDetector> engine(new PointPillarDetector(model_path, engine_path, data_type));
+    if (!engine->isLoaded()) {
+      return 1;
+    }
+    detector = std::move(engine);
+  }
+#endif
+  if (stub) {
+    detector.reset(new StubDetector(4, max_points, stub_latency, stub_jitter));
+  }
+
+  DetectionServer server(*detector, socket_path);
+  if (!server.isOpen()) {
+    return 1;
+  }
+  g_server = &server;
+  signal(SIGINT, on_signal);
+  signal(SIGTERM, on_signal);
+  std::cout << "Serving on " << socket_path << std::endl;
+  server.run();
+  g_server = nullptr;
+  std::cout << "Served " << server.requests() << " requests with " << server.inferences()
+            << " inferences" << std::endl;
+  return 0;
+}
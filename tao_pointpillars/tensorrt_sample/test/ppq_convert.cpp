@@ -0,0 +1,104 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Converts raw float32 .bin point clouds to the quantized .ppq format and back.
+//   ./ppq_convert [-p <point_size>] [-x] -o <output_dir> <file> [<file> ...]
+// -x expands .ppq files back to .bin with point_size values per point.
+
+#include <unistd.h>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "point_quant.h"
+#include "point_io.h"
+
+static std::string stem(const std::string &path)
+{
+  std::string name = path.substr(path.find_last_of('/') + 1);
+  return name.substr(0, name.find_last_of('.'));
+}
+
+int main(int argc, char **argv)
+{
+  unsigned int point_size = 4;
+  bool expand = false;
+  std::string output_dir = ".";
+  int c;
+  while ((c = getopt(argc, argv, "p:xo:h")) != -1) {
+    switch (c) {
+      case 'p': point_size = atoi(optarg); break;
+      case 'x': expand = true; break;
+      case 'o': output_dir = optarg; break;
+      default:
+        std::cout << "Usage: " << argv[0]
+                  << " [-p <point_size>] [-x] -o <output_dir> <file> [<file> ...]" << std::endl;
+        return 1;
+    }
+  }
+  if (point_size < 4) {
+    std::cerr << "point_size must be at least 4 (x, y, z, intensity)" << std::endl;
+    return 1;
+  }
+
+  PointLoader loader;
+  std::vector<float> points;
+  std::vector<uint8_t> packed;
+  unsigned long long in_bytes = 0, out_bytes = 0;
+  float worst = 0.0f;
+  for (int i = optind; i < argc; i++) {
+    std::string input = argv[i];
+    unsigned int n = 0;
+    if (loader.count(input, point_size, &n) != 0) {
+      continue;
+    }
+    points.resize((size_t)n * point_size);
+    loader.load(input, points.data(), n, point_size, &n);
+
+    std::string output = output_dir + "/" + stem(input) + (expand ? ".bin" : ".ppq");
+    std::ofstream ofs(output, std::ios::out | std::ios::binary);
+    if (!ofs.is_open()) {
+      std::cerr << "Output file cannot be opened: " << output << std::endl;
+      return 1;
+    }
+    size_t written;
+    if (expand) {
+      written = points.size() * sizeof(float);
+      ofs.write((const char *)points.data(), written);
+    } else {
+      float max_error = 0.0f;
+      quantize_points(points.data(), n, point_size, packed, &max_error);
+      written = packed.size();
+      ofs.write((const char *)packed.data(), written);
+      worst = std::max(worst, max_error);
+      std::cout << input << ": " << n << " points, max error " << max_error << std::endl;
+    }
+    std::ifstream in(input, std::ios::binary | std::ios::ate);
+    in_bytes += in.tellg();
+    out_bytes += written;
+  }
+  std::cout << "Converted " << in_bytes << " -> " << out_bytes << " bytes";
+  if (in_bytes) {
+    std::cout << " (" << 100.0 * out_bytes / in_bytes << "%)";
+  }
+  if (!expand) {
+    std::cout << ", max error " << worst;
+  }
+  std::cout << std::endl;
+  return 0;
+}
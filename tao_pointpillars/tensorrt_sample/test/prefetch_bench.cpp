@@ -0,0 +1,196 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Point cloud read throughput over a list of files: one synchronous fstream
+// read at a time (as the original loadData did), PointLoader, and the
+// prefetcher with its pread thread pool and io_uring backends.
+//   ./prefetch_bench [-d <depth>] [-r <repeat>] [-c] (-l <file_list> | <file.bin> ...)
+// -d is the number of reads in flight. -c evicts the files from the page
+// cache (posix_fadvise DONTNEED) before every pass, so that passes read from
+// the device. Every method checksums the data it reads, and the checksums
+// must agree.
+
+#include <fcntl.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "file_prefetcher.h"
+#include "point_io.h"
+
+static uint64_t checksum(const uint8_t *data, size_t size)
+{
+  uint64_t sum = size;
+  size_t words = size / 8;
+  const uint64_t *p = (const uint64_t *)data;
+  for (size_t i = 0; i < words; i++) {
+    sum += p[i];
+  }
+  for (size_t i = words * 8; i < size; i++) {
+    sum += data[i];
+  }
+  return sum;
+}
+
+static void evict(const std::vector<std::string> &files)
+{
+  for (const auto &file : files) {
+    int fd = open(file.c_str(), O_RDONLY);
+    if (fd >= 0) {
+      fdatasync(fd);
+      posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+      close(fd);
+    }
+  }
+}
+
+static uint64_t read_fstream(const std::vector<std::string> &files, size_t *bytes)
+{
+  std::vector<char> buffer;
+  uint64_t sum = 0;
+  for (const auto &file : files) {
+    std::fstream data_file(file, std::ifstream::in);
+    data_file.seekg(0, data_file.end);
+    size_t len = data_file.tellg();
+    data_file.seekg(0, data_file.beg);
+    buffer.resize(len);
+    data_file.read(buffer.data(), len);
+    sum += checksum((const uint8_t *)buffer.data(), len);
+    *bytes += len;
+  }
+  return sum;
+}
+
+static uint64_t read_loader(const std::vector<std::string> &files, size_t max_bytes, size_t *bytes)
+{
+  PointLoader loader;
+  std::vector<float> points(max_bytes / sizeof(float));
+  uint64_t sum = 0;
+  for (const auto &file : files) {
+    unsigned int n = 0;
+    loader.load(file, points.data(), points.size() / 4, 4, &n);
+    sum += checksum((const uint8_t *)points.data(), (size_t)n * 4 * sizeof(float));
+    *bytes += (size_t)n * 4 * sizeof(float);
+  }
+  return sum;
+}
+
+static uint64_t read_prefetch(const std::vector<std::string> &files, size_t max_bytes, unsigned int depth,
+                              PrefetchBackend backend, PrefetchBackend *used, size_t *bytes)
+{
+  FilePrefetcher prefetcher(files, depth, max_bytes, backend);
+  *used = prefetcher.backend();
+  uint64_t sum = 0;
+  PrefetchedFile file;
+  while (prefetcher.next(file)) {
+    if (file.error) {
+      std::cerr << "Read failed: " << files[file.index] << std::endl;
+    }
+    sum += checksum(file.data, file.size);
+    *bytes += file.size;
+    prefetcher.release(file.buffer);
+  }
+  return sum;
+}
+
+int main(int argc, char **argv)
+{
+  unsigned int depth = 8;
+  int repeat = 3;
+  bool cold = false;
+  std::string list_file;
+  int c;
+  while ((c = getopt(argc, argv, "d:r:cl:h")) != -1) {
+    switch (c) {
+      case 'd': depth = std::max(1, atoi(optarg)); break;
+      case 'r': repeat = std::max(1, atoi(optarg)); break;
+      case 'c': cold = true; break;
+      case 'l': list_file = optarg; break;
+      default:
+        std::cout << "Usage: " << argv[0] << " [-d <depth>] [-r <repeat>] [-c] (-l <file_list> | <file.bin> ...)"
+                  << std::endl;
+        return 1;
+    }
+  }
+  std::vector<std::string> files(argv + optind, argv + argc);
+  if (!list_file.empty()) {
+    std::ifstream ifs(list_file);
+    std::string line;
+    while (std::getline(ifs, line)) {
+      if (!line.empty() && line[0] != '#') {
+        files.push_back(line.substr(0, line.find(' ')));
+      }
+    }
+  }
+  if (files.empty()) {
+    std::cerr << "No input files" << std::endl;
+    return 1;
+  }
+  // buffers sized for the largest file
+  size_t max_bytes = 0;
+  for (const auto &file : files) {
+    std::ifstream ifs(file, std::ios::binary | std::ios::ate);
+    max_bytes = std::max(max_bytes, (size_t)std::max((std::streamoff)0, (std::streamoff)ifs.tellg()));
+  }
+
+  const char *names[] = {"fstream", "PointLoader", "prefetch threads", "prefetch io_uring"};
+  uint64_t reference = 0;
+  bool same = true;
+  std::cout << files.size() << " files, " << depth << " reads in flight"
+            << (cold ? ", page cache evicted before each pass" : "") << std::endl;
+  for (int method = 0; method < 4; method++) {
+    double best_ms = 0.0;
+    size_t bytes = 0;
+    PrefetchBackend used = PrefetchBackend::kAuto;
+    for (int r = 0; r < repeat; r++) {
+      if (cold) {
+        evict(files);
+      }
+      bytes = 0;
+      auto t0 = std::chrono::steady_clock::now();
+      uint64_t sum;
+      if (method == 0) {
+        sum = read_fstream(files, &bytes);
+      } else if (method == 1) {
+        sum = read_loader(files, max_bytes, &bytes);
+      } else {
+        sum = read_prefetch(files, max_bytes, depth,
+                            method == 2 ? PrefetchBackend::kThreads : PrefetchBackend::kIoUring, &used, &bytes);
+      }
+      double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+      best_ms = r == 0 ? ms : std::min(best_ms, ms);
+      if (method == 0 && r == 0) {
+        reference = sum;
+      }
+      same = same && sum == reference;
+    }
+    std::cout << std::left << std::setw(18) << names[method] << std::right << std::fixed << std::setprecision(1)
+              << std::setw(9) << best_ms << " ms " << std::setw(9) << bytes / best_ms / 1e3 << " MB/s "
+              << std::setw(9) << files.size() * 1e3 / best_ms << " files/s";
+    if (method == 3 && used != PrefetchBackend::kIoUring) {
+      std::cout << " (fell back to " << prefetch_backend_name(used) << ")";
+    }
+    std::cout << std::endl;
+  }
+  std::cout << (same ? "All methods read the same data" : "MISMATCH between methods") << std::endl;
+  return same ? 0 : 1;
+}
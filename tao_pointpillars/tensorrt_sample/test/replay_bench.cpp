@@ -0,0 +1,378 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Sensor-rate replay harness: feeds a directory of sweeps at their recorded
+// timestamps (or a fixed rate) through the frame scheduler into a detector
+// and reports the arrival-to-result latency distribution and deadline misses.
+//   ./pointpillars_replay -i <sweep_dir> [--index <index_file> | -f <hz>] [-x <speed>]
+//                         [--schedule <fifo|latest>] [--deadline <ms>] [-r <repeat>]
+//                         [-b <read_ahead>] [-t <nms_iou_thresh>] [-n <pre_nms_top_n>] [--csv <latency.csv>]
+//                         (-m <model_path> -e <engine_path> [-d fp16] | --stub [--stub-latency <ms>] [--stub-jitter <ms>])
+// Options shared with pointpillars have its letters and long names.
+// The index file has one line per sweep: a timestamp in seconds or in KITTI
+// "YYYY-MM-DD HH:MM:SS.nnnnnnnnn" form, optionally followed by the file name;
+// lines without a name pair with the sorted sweep files in order. -x 2 replays
+// twice as fast as recorded. Arrival time is the scheduled replay time, so
+// stalls of the loader count against latency.
+
+#include <dirent.h>
+#include <getopt.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "detector.h"
+#include "frame_scheduler.h"
+#include "point_io.h"
+#ifndef POINTPILLARS_CPU_ONLY
+#include "pointpillar_detector.h"
+#endif
+
+static bool is_sweep_file(const std::string &name)
+{
+  static const char *extensions[] = {".bin", ".ppq", ".ppc", ".pcd", ".ply", ".las"};
+  for (const char *ext : extensions) {
+    if (has_extension(name, ext)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static int list_sweeps(const std::string &dir, std::vector<std::string> &files)
+{
+  DIR *d = opendir(dir.c_str());
+  if (!d) {
+    std::cerr << "Can't open directory: " << dir << std::endl;
+    return -1;
+  }
+  while (dirent *entry = readdir(d)) {
+    if (is_sweep_file(entry->d_name)) {
+      files.push_back(dir + "/" + entry->d_name);
+    }
+  }
+  closedir(d);
+  std::sort(files.begin(), files.end());
+  return 0;
+}
+
+// Seconds from a plain number or a KITTI "date hh:mm:ss.fraction" stamp.
+static bool parse_timestamp(std::istringstream &ss, double *seconds)
+{
+  std::string token;
+  if (!(ss >> token)) {
+    return false;
+  }
+  if (token.find('-') != std::string::npos && token.find(':') == std::string::npos) {
+    ss >> token;    // date part, the time follows
+  }
+  if (token.find(':') != std::string::npos) {
+    int h = 0, m = 0;
+    double s = 0.0;
+    if (sscanf(token.c_str(), "%d:%d:%lf", &h, &m, &s) != 3) {
+      return false;
+    }
+    *seconds = h * 3600.0 + m * 60.0 + s;
+    return true;
+  }
+  char *end = nullptr;
+  *seconds = strtod(token.c_str(), &end);
+  return end && *end == 0;
+}
+
+static int load_index(const std::string &path, const std::string &dir, std::vector<std::string> &files,
+                      std::vector<double> &stamps)
+{
+  std::ifstream ifs(path);
+  if (!ifs.is_open()) {
+    std::cerr << "Can't open index: " << path << std::endl;
+    return -1;
+  }
+  std::vector<std::string> named;
+  std::string line;
+  while (std::getline(ifs, line)) {
+    std::istringstream ss(line);
+    double t;
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+    if (!parse_timestamp(ss, &t)) {
+      std::cerr << "Bad index line: " << line << std::endl;
+      return -1;
+    }
+    stamps.push_back(t);
+    std::string name;
+    if (ss >> name) {
+      named.push_back(name[0] == '/' ? name : dir + "/" + name);
+    }
+  }
+  if (!named.empty()) {
+    if (named.size() != stamps.size()) {
+      std::cerr << "Index lines must all or none name a file" << std::endl;
+      return -1;
+    }
+    files = named;
+  } else if (files.size() < stamps.size()) {
+    stamps.resize(files.size());
+  }
+  files.resize(stamps.size());
+  return 0;
+}
+
+// Frames loaded ahead of their arrival, handed to the inference thread by seq.
+// Point buffers go back to spare once inferred or skipped, so the loader
+// reuses them instead of allocating one per frame.
+struct LoadedFrame {
+  std::vector<float> points;
+  unsigned int num_points = 0;
+};
+
+struct FrameStore {
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::map<uint64_t, LoadedFrame> frames;
+  std::vector<std::vector<float>> spare;
+  bool stop = false;
+};
+
+int main(int argc, char **argv)
+{
+  enum {
+    OPT_STUB = 256,
+    OPT_STUB_LATENCY,
+    OPT_STUB_JITTER,
+    OPT_INDEX,
+    OPT_SCHEDULE,
+    OPT_DEADLINE,
+    OPT_CSV,
+  };
+  static struct option long_options[] = {
+    {"stub", no_argument, 0, OPT_STUB},
+    {"stub-latency", required_argument, 0, OPT_STUB_LATENCY},
+    {"stub-jitter", required_argument, 0, OPT_STUB_JITTER},
+    {"index", required_argument, 0, OPT_INDEX},
+    {"schedule", required_argument, 0, OPT_SCHEDULE},
+    {"deadline", required_argument, 0, OPT_DEADLINE},
+    {"csv", required_argument, 0, OPT_CSV},
+    {0, 0, 0, 0}
+  };
+  std::string sweep_dir, index_file, csv_file, model_path, engine_path, data_type = "fp32";
+  double hz = 10.0, speed = 1.0;
+  SchedulePolicy policy = SchedulePolicy::kFifo;
+  float deadline_ms = 100.0f, stub_latency = 0.0f, stub_jitter = 0.0f;
+  float nms_iou_thresh = 0.01f;
+  int pre_nms_top_n = 4096;
+  int repeat = 1;
+  unsigned int read_ahead = 16;
+  bool stub = false;
+  int c;
+  while ((c = getopt_long(argc, argv, "i:f:x:r:b:t:n:m:e:d:h", long_options, NULL)) != -1) {
+    switch (c) {
+      case 'i': sweep_dir = optarg; break;
+      case 'f': hz = atof(optarg); break;
+      case 'x': speed = atof(optarg); break;
+      case 'r': repeat = atoi(optarg); break;
+      case 'b': read_ahead = std::max(1, atoi(optarg)); break;
+      case 't': nms_iou_thresh = atof(optarg); break;
+      case 'n': pre_nms_top_n = atoi(optarg); break;
+      case 'm': model_path = optarg; break;
+      case 'e': engine_path = optarg; break;
+      case 'd': data_type = optarg; break;
+      case OPT_STUB: stub = true; break;
+      case OPT_STUB_LATENCY: stub_latency = atof(optarg); break;
+      case OPT_STUB_JITTER: stub_jitter = atof(optarg); break;
+      case OPT_INDEX: index_file = optarg; break;
+      case OPT_SCHEDULE: policy = parse_schedule_policy(optarg); break;
+      case OPT_DEADLINE: deadline_ms = atof(optarg); break;
+      case OPT_CSV: csv_file = optarg; break;
+      default:
+        std::cout << "Usage: " << argv[0] << " -i <sweep_dir> [--index <index_file> | -f <hz>] [-x <speed>]"
+                  << " [--schedule <fifo|latest>] [--deadline <ms>] [-r <repeat>] [-b <read_ahead>]"
+                  << " [-t <nms_iou_thresh>] [-n <pre_nms_top_n>] [--csv <latency.csv>]"
+                  << " (-m <model_path> -e <engine_path> [-d <data_type>]"
+                  << " | --stub [--stub-latency <ms>] [--stub-jitter <ms>])" << std::endl;
+        return 1;
+    }
+  }
+
+  std::vector<std::string> files;
+  std::vector<double> stamps;
+  if (sweep_dir.empty() || list_sweeps(sweep_dir, files) != 0) {
+    std::cerr << "A sweep directory is required" << std::endl;
+    return 1;
+  }
+  if (!index_file.empty()) {
+    if (load_index(index_file, sweep_dir, files, stamps) != 0) {
+      return 1;
+    }
+  } else {
+    for (size_t i = 0; i < files.size(); i++) {
+      stamps.push_back(i / hz);
+    }
+  }
+  if (files.empty()) {
+    std::cerr << "No sweeps in " << sweep_dir << std::endl;
+    return 1;
+  }
+
+  std::unique_ptr<Detector> detector;
+#ifdef POINTPILLARS_CPU_ONLY
+  stub = true;
+#else
+  if (!stub) {
+    std::unique_ptr<PointPillarDetector> engine(new PointPillarDetector(model_path, engine_path, data_type));
+    if (!engine->isLoaded()) {
+      return 1;
+    }
+    detector = std::move(engine);
+  }
+#endif
+  if (stub) {
+    detector.reset(new StubDetector(4, 204800, stub_latency, stub_jitter));
+  }
+  const unsigned int point_size = detector->pointSize();
+  const unsigned int max_points = detector->maxPoints();
+
+  // replay schedule: offsets from the first sweep, scaled by the speed
+  size_t num_frames = files.size() * repeat;
+  double span = stamps.back() - stamps.front() + (stamps.size() > 1 ? (stamps.back() - stamps.front()) / (stamps.size() - 1) : 1.0 / hz);
+  std::vector<double> offsets(num_frames);
+  for (size_t i = 0; i < num_frames; i++) {
+    size_t k = i % files.size();
+    offsets[i] = ((i / files.size()) * span + stamps[k] - stamps.front()) / speed;
+  }
+  std::cout << "Replaying " << num_frames << " sweeps over " << offsets.back() << " s ("
+            << speed << "x), deadline " << deadline_ms << " ms" << std::endl;
+
+  FrameStore store;
+  FrameScheduler scheduler(policy, deadline_ms);
+  unsigned long long load_stalls = 0;
+
+  if (pre_nms_top_n <= 0) {
+    std::cerr << "-n takes a positive top-N" << std::endl;
+    return 1;
+  }
+  std::thread loader([&] {
+    PointLoader point_loader;
+    for (size_t i = 0; i < num_frames; i++) {
+      LoadedFrame loaded;
+      {
+        std::unique_lock<std::mutex> lock(store.mutex);
+        store.cv.wait(lock, [&] { return store.stop || store.frames.size() < read_ahead; });
+        if (store.stop) {
+          return;
+        }
+        if (!store.spare.empty()) {
+          loaded.points.swap(store.spare.back());
+          store.spare.pop_back();
+        }
+      }
+      // sized once per buffer; later frames read into it as is
+      if (loaded.points.size() < (size_t)max_points * point_size) {
+        loaded.points.resize((size_t)max_points * point_size);
+      }
+      if (point_loader.load(files[i % files.size()], loaded.points.data(), max_points, point_size,
+                            &loaded.num_points) != 0) {
+        loaded.num_points = 0;
+      }
+      std::lock_guard<std::mutex> lock(store.mutex);
+      store.frames[i + 1] = std::move(loaded);
+      store.cv.notify_all();
+    }
+  });
+
+  // give the loader a head start
+  auto start = std::chrono::steady_clock::now() + std::chrono::milliseconds(100);
+  int64_t start_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(start.time_since_epoch()).count();
+  std::thread sensor([&] {
+    for (size_t i = 0; i < num_frames; i++) {
+      auto arrival = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                 std::chrono::duration<double>(offsets[i]));
+      std::this_thread::sleep_until(arrival);
+      {
+        std::unique_lock<std::mutex> lock(store.mutex);
+        if (!store.frames.count(i + 1)) {
+          load_stalls++;
+          store.cv.wait(lock, [&] { return store.frames.count(i + 1) > 0; });
+        }
+      }
+      ScheduledFrame frame;
+      frame.seq = i + 1;
+      frame.capture_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(arrival.time_since_epoch()).count();
+      scheduler.push(frame);
+    }
+    scheduler.close();
+  });
+
+  std::ofstream csv;
+  if (!csv_file.empty()) {
+    csv.open(csv_file);
+    csv << "seq,file,arrival_ms,age_ms,latency_ms,boxes\n";
+  }
+  LoadedFrame current;
+  std::vector<Bndbox> raw, nms_pred;
+  std::vector<int> suppressed;
+  ScheduledFrame frame;
+  while (scheduler.pop(&frame)) {
+    int64_t started = steady_now_ns();
+    {
+      // take the frame; the previous buffer and those of skipped frames are spare
+      std::lock_guard<std::mutex> lock(store.mutex);
+      if (!current.points.empty()) {
+        store.spare.push_back(std::move(current.points));
+      }
+      auto it = store.frames.find(frame.seq);
+      current = std::move(it->second);
+      for (auto skipped = store.frames.begin(); skipped != it; ++skipped) {
+        store.spare.push_back(std::move(skipped->second.points));
+      }
+      store.frames.erase(store.frames.begin(), ++it);
+      store.cv.notify_all();
+    }
+    raw.clear();
+    nms_pred.clear();
+    detector->infer(current.points.data(), current.num_points, raw);
+    nms_cpu_inplace(raw, nms_iou_thresh, nms_pred, pre_nms_top_n, suppressed);
+    scheduler.complete(frame);
+    if (csv.is_open()) {
+      csv << frame.seq << "," << files[(frame.seq - 1) % files.size()] << ","
+          << (frame.capture_ns - start_ns) * 1e-6 << "," << (started - frame.capture_ns) * 1e-6 << ","
+          << (steady_now_ns() - frame.capture_ns) * 1e-6 << "," << nms_pred.size() << "\n";
+    }
+  }
+  sensor.join();
+  {
+    std::lock_guard<std::mutex> lock(store.mutex);
+    store.stop = true;
+    store.cv.notify_all();
+  }
+  loader.join();
+
+  scheduler.printStats();
+  std::cout << "Loader stalls: " << load_stalls << std::endl;
+  return 0;
+}
@@ -0,0 +1,90 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Replays point cloud files into a shared-memory point ring, standing in for
+// the sensor driver process.
+//   ./ring_producer -r <ring_name> [-s <slots>] [-n <max_points>] [-p <point_size>]
+//                   [-f <hz>] [-l <loops>] <file> [<file> ...]
+// Files are loaded straight into the ring slots (any format PointLoader
+// reads) and published at the given rate, 0 for as fast as possible.
+
+#include <unistd.h>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include "point_io.h"
+#include "point_ring.h"
+
+int main(int argc, char **argv)
+{
+  std::string ring_name;
+  unsigned int num_slots = 4;
+  unsigned int max_points = 204800;
+  unsigned int point_size = 4;
+  double hz = 10.0;
+  int loops = 1;
+  int c;
+  while ((c = getopt(argc, argv, "r:s:n:p:f:l:h")) != -1) {
+    switch (c) {
+      case 'r': ring_name = optarg; break;
+      case 's': num_slots = atoi(optarg); break;
+      case 'n': max_points = atoi(optarg); break;
+      case 'p': point_size = atoi(optarg); break;
+      case 'f': hz = atof(optarg); break;
+      case 'l': loops = atoi(optarg); break;
+      default:
+        std::cout << "Usage: " << argv[0]
+                  << " -r <ring_name> [-s <slots>] [-n <max_points>] [-p <point_size>]"
+                  << " [-f <hz>] [-l <loops>] <file> [<file> ...]" << std::endl;
+        return 1;
+    }
+  }
+  if (ring_name.empty() || optind >= argc) {
+    std::cerr << "A ring name and at least one file are required" << std::endl;
+    return 1;
+  }
+
+  PointRingWriter ring(ring_name, num_slots, max_points, point_size);
+  if (!ring.isOpen()) {
+    return 1;
+  }
+  std::cout << "Ring " << ring_name << ": " << num_slots << " slots of " << max_points
+            << " points" << std::endl;
+
+  PointLoader loader;
+  auto period = std::chrono::duration<double>(hz > 0 ? 1.0 / hz : 0.0);
+  auto next = std::chrono::steady_clock::now();
+  uint64_t published = 0;
+  for (int loop = 0; loop < loops; loop++) {
+    for (int i = optind; i < argc; i++) {
+      float *slot = ring.beginWrite();
+      unsigned int n = 0;
+      if (loader.load(argv[i], slot, max_points, point_size, &n) != 0) {
+        continue;
+      }
+      std::this_thread::sleep_until(next);
+      auto now = std::chrono::steady_clock::now();
+      uint64_t stamp = std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count();
+      published = ring.commit(n, stamp);
+      next = std::max(next + std::chrono::duration_cast<std::chrono::steady_clock::duration>(period), now);
+    }
+  }
+  std::cout << "Published " << published << " frames" << std::endl;
+  return 0;
+}
@@ -0,0 +1,111 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Replays a sensor at a fixed rate into the frame scheduler, with the stub
+// detector as a simulated-latency inference backend, and reports drops, frame
+// age at inference start and deadline misses per policy.
+//   ./scheduler_sim [-f <hz>] [-n <frames>] [-d <deadline_ms>] [-l <latency_ms>]
+//                   [-j <jitter_ms>] [-s <fifo|latest|both>] [<cloud>]
+// Defaults: a 10 Hz sensor, 100 ms deadline and 120 +- 30 ms inference, i.e.
+// inference slower than the sensor.
+
+#include <unistd.h>
+#include <string.h>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "detector.h"
+#include "frame_scheduler.h"
+#include "point_io.h"
+
+static void simulate(SchedulePolicy policy, const std::vector<float> &points, unsigned int num_points,
+                     double hz, int num_frames, float deadline_ms, float latency_ms, float jitter_ms)
+{
+  StubDetector detector(4, num_points, latency_ms, jitter_ms);
+  FrameScheduler scheduler(policy, deadline_ms);
+  std::thread sensor([&] {
+    auto start = std::chrono::steady_clock::now();
+    auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(1.0 / hz));
+    for (int i = 0; i < num_frames; i++) {
+      std::this_thread::sleep_until(start + i * period);
+      ScheduledFrame frame;
+      frame.seq = i + 1;
+      frame.capture_ns = steady_now_ns();
+      scheduler.push(frame);
+    }
+    scheduler.close();
+  });
+
+  std::vector<Bndbox> raw, nms_pred;
+  ScheduledFrame frame;
+  while (scheduler.pop(&frame)) {
+    raw.clear();
+    nms_pred.clear();
+    detector.infer(points.data(), num_points, raw);
+    nms_cpu(raw, 0.01f, nms_pred, 4096);
+    scheduler.complete(frame);
+  }
+  sensor.join();
+  scheduler.printStats();
+}
+
+int main(int argc, char **argv)
+{
+  double hz = 10.0;
+  int num_frames = 100;
+  float deadline_ms = 100.0f;
+  float latency_ms = 120.0f;
+  float jitter_ms = 30.0f;
+  std::string policy = "both";
+  int c;
+  while ((c = getopt(argc, argv, "f:n:d:l:j:s:h")) != -1) {
+    switch (c) {
+      case 'f': hz = atof(optarg); break;
+      case 'n': num_frames = atoi(optarg); break;
+      case 'd': deadline_ms = atof(optarg); break;
+      case 'l': latency_ms = atof(optarg); break;
+      case 'j': jitter_ms = atof(optarg); break;
+      case 's': policy = optarg; break;
+      default:
+        std::cout << "Usage: " << argv[0] << " [-f <hz>] [-n <frames>] [-d <deadline_ms>] [-l <latency_ms>]"
+                  << " [-j <jitter_ms>] [-s <fifo|latest|both>] [<cloud>]" << std::endl;
+        return 1;
+    }
+  }
+  std::string file = optind < argc ? argv[optind] : "../../data/000101.bin";
+  PointLoader loader;
+  unsigned int num_points = 0;
+  if (loader.count(file, 4, &num_points) != 0) {
+    return 1;
+  }
+  std::vector<float> points((size_t)num_points * 4);
+  loader.load(file, points.data(), num_points, 4, &num_points);
+
+  std::cout << num_frames << " frames at " << hz << " Hz, inference " << latency_ms << " +- "
+            << jitter_ms << " ms" << std::endl;
+  if (policy == "fifo" || policy == "both") {
+    simulate(SchedulePolicy::kFifo, points, num_points, hz, num_frames, deadline_ms, latency_ms, jitter_ms);
+  }
+  if (policy == "latest" || policy == "both") {
+    simulate(SchedulePolicy::kLatest, points, num_points, hz, num_frames, deadline_ms, latency_ms, jitter_ms);
+  }
+  return 0;
+}
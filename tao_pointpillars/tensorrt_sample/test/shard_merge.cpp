@@ -0,0 +1,169 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Merges the manifests written by the shards of a pointpillars_shard job.
+//   ./shard_merge -o <merged_manifest> [-d <output_dir>] <shard_manifest> ...
+// Checks that the manifests come from one job (same list and shard count),
+// that every shard is present once and that every file of the list was
+// processed by exactly one shard, with a result file of its own. The merged
+// manifest lists all files in list order; it is the manifest a single-shard
+// run of the list would have written. -d gathers the result files into one directory (hard links,
+// copies across file systems). Exits with 0 when the job is complete and no
+// file failed.
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <string>
+#include <vector>
+#include "shard.h"
+
+static void usage(const char *argv0)
+{
+  std::cout << "Usage: " << argv0 << " -o <merged_manifest> [-d <output_dir>] <shard_manifest> ..." << std::endl;
+}
+
+static int gather(const std::string &from, const std::string &to)
+{
+  if (link(from.c_str(), to.c_str()) == 0) {
+    return 0;
+  }
+  if (errno != EXDEV && errno != EPERM) {
+    std::cerr << "Can't link " << from << " to " << to << ": " << strerror(errno) << std::endl;
+    return -1;
+  }
+  std::ifstream src(from, std::ios::binary);
+  std::ofstream dst(to, std::ios::binary);
+  dst << src.rdbuf();
+  if (!src.is_open() || !dst.good()) {
+    std::cerr << "Can't copy " << from << " to " << to << std::endl;
+    return -1;
+  }
+  return 0;
+}
+
+int main(int argc, char **argv)
+{
+  std::string merged_file, output_dir;
+  int c;
+  while ((c = getopt(argc, argv, "o:d:h")) != -1) {
+    switch (c) {
+      case 'o': merged_file = optarg; break;
+      case 'd': output_dir = optarg; break;
+      default: usage(argv[0]); return 1;
+    }
+  }
+  if (merged_file.empty() || optind >= argc) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  std::vector<ShardManifest> shards(argc - optind);
+  for (int i = optind; i < argc; i++) {
+    if (read_shard_manifest(argv[i], shards[i - optind]) != 0) {
+      return 1;
+    }
+  }
+  const ShardManifest &first = shards[0];
+  std::vector<int> seen_shard(first.num_shards, 0);
+  for (size_t i = 0; i < shards.size(); i++) {
+    const ShardManifest &m = shards[i];
+    if (m.fingerprint != first.fingerprint || m.num_shards != first.num_shards ||
+        m.list_size != first.list_size || m.shard >= m.num_shards) {
+      std::cerr << argv[optind + i] << " belongs to another job" << std::endl;
+      return 1;
+    }
+    if (seen_shard[m.shard]++) {
+      std::cerr << "Shard " << m.shard << " given twice" << std::endl;
+      return 1;
+    }
+  }
+  bool complete = true;
+  for (unsigned int s = 0; s < first.num_shards; s++) {
+    if (!seen_shard[s]) {
+      std::cerr << "Missing shard " << s << " of " << first.num_shards << std::endl;
+      complete = false;
+    }
+  }
+  if (!complete) {
+    return 1;
+  }
+
+  // every file of the list exactly once
+  std::vector<ShardEntry> entries(first.list_size);
+  std::vector<char> covered(first.list_size, 0);
+  for (const auto &m : shards) {
+    for (const auto &e : m.entries) {
+      if (e.index >= first.list_size || covered[e.index]++) {
+        std::cerr << "File " << e.index << " (" << e.input << ") listed "
+                  << (e.index >= first.list_size ? "out of range" : "twice") << std::endl;
+        return 1;
+      }
+      entries[e.index] = e;
+    }
+  }
+  size_t uncovered = std::count(covered.begin(), covered.end(), 0);
+  if (uncovered) {
+    std::cerr << uncovered << " files of the list were not processed by any shard" << std::endl;
+    return 1;
+  }
+
+  ShardManifest merged;
+  merged.shard = 0;
+  merged.num_shards = 1;
+  merged.list_size = first.list_size;
+  std::vector<ShardFile> files(entries.size());
+  size_t failed = 0, boxes = 0;
+  std::set<std::string> outputs, gathered;
+  for (size_t i = 0; i < entries.size(); i++) {
+    ShardEntry &e = entries[i];
+    // a result written twice lost the first file's boxes
+    if (!e.output.empty() && !outputs.insert(e.output).second) {
+      std::cerr << "File " << e.index << " (" << e.input << ") overwrote the result " << e.output
+                << " of another file" << std::endl;
+      return 1;
+    }
+    files[i].path = e.input;
+    files[i].bytes = e.bytes;
+    failed += e.status != 0;
+    boxes += e.num_boxes;
+    if (!output_dir.empty() && !e.output.empty()) {
+      std::string to = output_dir + "/" + e.output.substr(e.output.find_last_of('/') + 1);
+      if (!gathered.insert(to).second) {
+        std::cerr << "Two results named " << to << std::endl;
+        return 1;
+      }
+      if (gather(e.output, to) != 0) {
+        return 1;
+      }
+      e.output = to;
+    }
+  }
+  merged.fingerprint = shard_fingerprint(files, 1);
+  merged.entries.swap(entries);
+  if (write_shard_manifest(merged_file, merged) != 0) {
+    return 1;
+  }
+  std::cout << "Merged " << shards.size() << " shards: " << merged.list_size << " files, " << failed
+            << " failed, " << boxes << " boxes into " << merged_file << std::endl;
+  return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,207 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Offline inference over one shard of a file list.
+//   ./pointpillars_shard -l <file_list> -s <num_shards> -i <shard_index> -o <output_dir>
+//                        [-M <manifest>] [-b <read_ahead>] [-t <nms_iou_thresh>] [-n <pre_nms_top_n>]
+//                        [--prefetch <auto|uring|threads>]
+//                        (-m <model_path> -e <engine_path> [-p <data_type>] | --stub [--stub-latency <ms>])
+//   ./pointpillars_shard -l <file_list> -s <num_shards> --plan
+// Every shard of a job gets the same list and shard count and picks its own
+// files from a size-balanced partition, so shards can run on any number of
+// nodes without coordination. The shard runs its files through the
+// pipelined batch runner, writes <output_dir>/<stem>.txt per file and then
+// the manifest (default <output_dir>/shard-<i>-of-<n>.manifest) that
+// shard_merge combines. A list in which two files share a stem is refused,
+// as their results would overwrite each other. --plan prints the partition.
+// --prefetch reads .bin inputs with the io_uring (or pread thread pool)
+// prefetcher.
+
+#include <getopt.h>
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "batch_runner.h"
+#include "detector.h"
+#include "shard.h"
+#ifndef POINTPILLARS_CPU_ONLY
+#include "pointpillar_detector.h"
+#endif
+
+static void usage(const char *argv0)
+{
+  std::cout << "Usage: " << argv0 << " -l <file_list> -s <num_shards> -i <shard_index> -o <output_dir>"
+            << " [-M <manifest>] [-b <read_ahead>] [-t <nms_iou_thresh>] [-n <pre_nms_top_n>]"
+            << " [--prefetch <auto|uring|threads>]"
+            << " (-m <model_path> -e <engine_path> [-p <data_type>] | --stub [--stub-latency <ms>])" << std::endl
+            << "       " << argv0 << " -l <file_list> -s <num_shards> --plan" << std::endl;
+}
+
+static void print_plan(const std::vector<ShardFile> &files, const std::vector<unsigned int> &shard_of,
+                       unsigned int num_shards)
+{
+  std::vector<size_t> counts(num_shards, 0);
+  std::vector<unsigned long long> bytes(num_shards, 0);
+  for (size_t i = 0; i < files.size(); i++) {
+    counts[shard_of[i]]++;
+    bytes[shard_of[i]] += files[i].bytes;
+  }
+  for (unsigned int s = 0; s < num_shards; s++) {
+    std::cout << "shard " << s << ": " << counts[s] << " files, " << bytes[s] << " bytes" << std::endl;
+  }
+  auto range = std::minmax_element(bytes.begin(), bytes.end());
+  std::cout << "Largest shard exceeds the smallest by " << *range.second - *range.first << " bytes" << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+  enum {
+    OPT_STUB = 256,
+    OPT_STUB_LATENCY,
+    OPT_PLAN,
+    OPT_PREFETCH,
+  };
+  static struct option long_options[] = {
+    {"stub", no_argument, 0, OPT_STUB},
+    {"stub-latency", required_argument, 0, OPT_STUB_LATENCY},
+    {"plan", no_argument, 0, OPT_PLAN},
+    {"prefetch", required_argument, 0, OPT_PREFETCH},
+    {0, 0, 0, 0}
+  };
+  std::string list_file, manifest_file, model_path, engine_path, data_type = "fp32";
+  BatchConfig config;
+  config.output_dir.clear();
+  int num_shards = 1, shard_index = -1;
+  float stub_latency = 0.0f;
+  bool stub = false, plan = false;
+  int c;
+  while ((c = getopt_long(argc, argv, "l:s:i:o:M:b:t:n:m:e:p:h", long_options, NULL)) != -1) {
+    switch (c) {
+      case 'l': list_file = optarg; break;
+      case 's': num_shards = atoi(optarg); break;
+      case 'i': shard_index = atoi(optarg); break;
+      case 'o': config.output_dir = optarg; break;
+      case 'M': manifest_file = optarg; break;
+      case 'b': config.read_ahead = std::max(1, atoi(optarg)); break;
+      case 't': config.nms_thresh = atof(optarg); break;
+      case 'n': config.pre_nms_top_n = atoi(optarg); break;
+      case 'm': model_path = optarg; break;
+      case 'e': engine_path = optarg; break;
+      case 'p': data_type = optarg; break;
+      case OPT_STUB: stub = true; break;
+      case OPT_STUB_LATENCY: stub_latency = atof(optarg); break;
+      case OPT_PLAN: plan = true; break;
+      case OPT_PREFETCH:
+        config.prefetch = true;
+        config.prefetch_backend = parse_prefetch_backend(optarg);
+        break;
+      default: usage(argv[0]); return 1;
+    }
+  }
+  if (list_file.empty() || num_shards < 1 ||
+      (!plan && (shard_index < 0 || shard_index >= num_shards || config.output_dir.empty()))) {
+    usage(argv[0]);
+    return 1;
+  }
+  std::vector<ShardFile> files;
+  if (load_file_list(list_file, files) != 0) {
+    return 1;
+  }
+  if (size_t duplicates = find_duplicate_stems(files)) {
+    std::cerr << "The list has " << duplicates << " duplicate stems; "
+              << "give inputs unique file names" << std::endl;
+    return 1;
+  }
+  std::vector<unsigned int> shard_of;
+  partition_shards(files, num_shards, shard_of);
+  if (plan) {
+    print_plan(files, shard_of, num_shards);
+    return 0;
+  }
+
+  ShardManifest manifest;
+  manifest.shard = shard_index;
+  manifest.num_shards = num_shards;
+  manifest.fingerprint = shard_fingerprint(files, num_shards);
+  manifest.list_size = files.size();
+  std::vector<std::string> inputs;
+  unsigned long long shard_bytes = 0;
+  for (size_t i = 0; i < files.size(); i++) {
+    if (shard_of[i] == (unsigned int)shard_index) {
+      ShardEntry e;
+      e.index = i;
+      e.bytes = files[i].bytes;
+      e.input = files[i].path;
+      manifest.entries.push_back(e);
+      inputs.push_back(files[i].path);
+      shard_bytes += files[i].bytes;
+    }
+  }
+  std::cout << "Shard " << shard_index << " of " << num_shards << ": " << inputs.size() << " of "
+            << files.size() << " files, " << shard_bytes << " bytes" << std::endl;
+
+  std::unique_ptr<Detector> detector;
+#ifdef POINTPILLARS_CPU_ONLY
+  stub = true;
+#else
+  if (!stub) {
+    std::unique_ptr<PointPillarDetector> engine(new PointPillarDetector(model_path, engine_path, data_type));
+    if (!engine->isLoaded()) {
+      return 1;
+    }
+    detector = std::move(engine);
+  }
+#endif
+  if (stub) {
+    detector.reset(new StubDetector(4, 204800, stub_latency));
+  }
+
+  BatchRunner runner(*detector, config);
+  std::vector<BatchResult> results;
+  size_t failed = runner.run(inputs, results);
+  size_t total_boxes = 0;
+  for (size_t k = 0; k < results.size(); k++) {
+    ShardEntry &e = manifest.entries[k];
+    e.status = results[k].status;
+    e.num_points = results[k].num_points;
+    e.num_boxes = results[k].num_boxes;
+    e.output = results[k].status == kBatchOk ? results[k].output : std::string();
+    total_boxes += e.num_boxes;
+    if (results[k].status != kBatchOk) {
+      std::cerr << "Failed (" << results[k].status << "): " << e.input << std::endl;
+    }
+  }
+  if (manifest_file.empty()) {
+    manifest_file = config.output_dir + "/shard-" + std::to_string(shard_index) + "-of-" +
+                    std::to_string(num_shards) + ".manifest";
+  }
+  if (write_shard_manifest(manifest_file, manifest) != 0) {
+    return 1;
+  }
+  const BatchStats &stats = runner.stats();
+  std::cout << "Processed " << inputs.size() - failed << " files (" << failed << " failed), " << total_boxes
+            << " boxes in " << stats.total_ms << " ms: inference " << stats.infer_ms << " ms, waiting for loads "
+            << stats.load_wait_ms << " ms, NMS and writing " << stats.post_ms << " ms" << std::endl;
+  if (stats.prefetch != PrefetchBackend::kAuto) {
+    std::cout << "Read with the " << prefetch_backend_name(stats.prefetch) << " prefetcher" << std::endl;
+  }
+  std::cout << "Manifest: " << manifest_file << std::endl;
+  return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,224 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Time to the first kept boxes with StreamingNms against nms_cpu, which hands
+// out nothing until every candidate is sorted and suppressed. Frames are
+// synthetic clusters of overlapping candidates plus clutter. Every frame is
+// streamed to the end and checked against nms_cpu, then streamed again with
+// a deadline to count how many boxes it gets out in time.
+// Each frame is also streamed with its scores rounded to fp16, as an fp16
+// engine outputs them, so that many candidates tie. Those streams are checked
+// against greedy NMS over the stable score order. The frames on which
+// nms_cpu keeps other boxes, because std::sort orders the ties differently,
+// are only counted.
+//   ./streaming_nms_bench [-c <candidates>] [-f <frames>] [-n <pre_nms_top_n>]
+//                         [-t <nms_thresh>] [-k <first_k>] [-d <deadline_ms>]
+
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+#include "latency_histogram.h"
+#include "point_types.h"
+#include "streaming_nms.h"
+
+typedef std::chrono::steady_clock Clock;
+
+static double ms_since(Clock::time_point t0)
+{
+  return std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+}
+
+static void make_frame(std::mt19937 &rng, int num_candidates, std::vector<Bndbox> &boxes)
+{
+  std::uniform_real_distribution<float> u(0.0f, 1.0f);
+  std::normal_distribution<float> jitter(0.0f, 0.25f);
+  boxes.clear();
+  int clutter = num_candidates / 4;
+  while ((int)boxes.size() < num_candidates - clutter) {
+    Bndbox obj(u(rng) * 69.0f, u(rng) * 79.0f - 39.5f, -1.0f, 3.9f, 1.6f, 1.56f, u(rng) * 6.28f, 0, 0.0f);
+    float base = 0.3f + 0.7f * u(rng);
+    for (int d = 0; d < 20; d++) {
+      Bndbox b = obj;
+      b.x += jitter(rng);
+      b.y += jitter(rng);
+      b.score = base * (0.3f + 0.7f * u(rng));
+      boxes.push_back(b);
+    }
+  }
+  while ((int)boxes.size() < num_candidates) {
+    boxes.push_back(Bndbox(u(rng) * 69.0f, u(rng) * 79.0f - 39.5f, -1.0f, 0.8f, 0.6f, 1.73f,
+                           u(rng) * 6.28f, 1, 0.2f * u(rng)));
+  }
+}
+
+// same boxes, in any order among equal scores
+static bool same_boxes(std::vector<Bndbox> a, std::vector<Bndbox> b)
+{
+  if (a.size() != b.size()) {
+    return false;
+  }
+  auto order = [](const Bndbox &p, const Bndbox &q) {
+    return p.score != q.score ? p.score > q.score : p.x != q.x ? p.x < q.x : p.y < q.y;
+  };
+  std::sort(a.begin(), a.end(), order);
+  std::sort(b.begin(), b.end(), order);
+  for (size_t i = 0; i < a.size(); i++) {
+    if (a[i].score != b[i].score || a[i].x != b[i].x || a[i].y != b[i].y) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// greedy NMS in stable score order: ties are taken in input order
+static void stable_nms(const std::vector<Bndbox> &boxes, float nms_thresh, int top_n, std::vector<Bndbox> &kept)
+{
+  std::vector<size_t> order(boxes.size());
+  for (size_t i = 0; i < order.size(); i++) {
+    order[i] = i;
+  }
+  std::stable_sort(order.begin(), order.end(),
+                   [&](size_t a, size_t b) { return boxes[a].score > boxes[b].score; });
+  order.resize(std::min(order.size(), (size_t)std::max(top_n, 0)));
+  kept.clear();
+  for (size_t i : order) {
+    bool suppressed = false;
+    for (size_t k = 0; !suppressed && k < kept.size(); k++) {
+      suppressed = box_iou_bev(kept[k], boxes[i]) >= nms_thresh;
+    }
+    if (!suppressed) {
+      kept.push_back(boxes[i]);
+    }
+  }
+}
+
+static bool same_sequence(const std::vector<Bndbox> &a, const std::vector<Bndbox> &b)
+{
+  if (a.size() != b.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < a.size(); i++) {
+    if (a[i].score != b[i].score || a[i].x != b[i].x || a[i].y != b[i].y) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void report(const char *name, const LatencyHistogram &h)
+{
+  std::cout << std::setw(18) << name << std::fixed << std::setprecision(3) << std::setw(9) << h.mean()
+            << std::setw(9) << h.percentile(50) << std::setw(9) << h.percentile(99) << std::setw(9)
+            << h.max() << std::endl;
+}
+
+static void usage(const char *argv0)
+{
+  std::cerr << "Usage: " << argv0 << " [-c <candidates>] [-f <frames>] [-n <pre_nms_top_n>]"
+            << " [-t <nms_thresh>] [-k <first_k>] [-d <deadline_ms>]" << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+  int num_candidates = 4096, num_frames = 100, top_n = 4096;
+  size_t first_k = 10;
+  float nms_thresh = 0.01f, deadline_ms = 0.5f;
+  int c;
+  while ((c = getopt(argc, argv, "c:f:n:t:k:d:h")) != -1) {
+    switch (c) {
+      case 'c': num_candidates = atoi(optarg); break;
+      case 'f': num_frames = atoi(optarg); break;
+      case 'n': top_n = atoi(optarg); break;
+      case 't': nms_thresh = atof(optarg); break;
+      case 'k': first_k = atoi(optarg); break;
+      case 'd': deadline_ms = atof(optarg); break;
+      default: usage(argv[0]); return 1;
+    }
+  }
+
+  LatencyHistogram full_ms(1000.0f, 0.001f), first_ms(1000.0f, 0.001f), first_k_ms(1000.0f, 0.001f),
+      stream_ms(1000.0f, 0.001f);
+  StreamingNms stream;
+  std::vector<Bndbox> frame, kept, streamed, tied, reference;
+  std::mt19937 rng(5);
+  int mismatches = 0, truncated = 0, tied_mismatches = 0, tied_nms_cpu_differs = 0;
+  double kept_total = 0.0, in_time = 0.0;
+  for (int f = 0; f < num_frames; f++) {
+    make_frame(rng, num_candidates, frame);
+
+    kept.clear();
+    Clock::time_point t0 = Clock::now();
+    nms_cpu(frame, nms_thresh, kept, top_n);
+    full_ms.add(ms_since(t0));
+    kept_total += kept.size();
+
+    streamed.clear();
+    t0 = Clock::now();
+    stream.begin(frame, nms_thresh, top_n);
+    Bndbox box;
+    while (stream.next(&box)) {
+      if (streamed.empty()) {
+        first_ms.add(ms_since(t0));
+      }
+      streamed.push_back(box);
+      if (streamed.size() == first_k) {
+        first_k_ms.add(ms_since(t0));
+      }
+    }
+    stream_ms.add(ms_since(t0));
+    mismatches += !same_boxes(kept, streamed);
+
+    Clock::time_point deadline = Clock::now() + std::chrono::microseconds((long long)(deadline_ms * 1000.0f));
+    StreamingNmsResult r = stream.run(frame, nms_thresh, top_n, [](const Bndbox &, size_t) { return true; },
+                                      0, deadline);
+    in_time += r.emitted;
+    truncated += r.truncated;
+
+    tied = frame;
+    for (auto &b : tied) {
+      b.score = half_to_float(float_to_half(b.score));
+    }
+    stable_nms(tied, nms_thresh, top_n, reference);
+    streamed.clear();
+    stream.run(tied, nms_thresh, top_n, [&](const Bndbox &b, size_t) { streamed.push_back(b); return true; });
+    tied_mismatches += !same_sequence(reference, streamed);
+    kept.clear();
+    nms_cpu(tied, nms_thresh, kept, top_n);
+    tied_nms_cpu_differs += !same_boxes(kept, reference);
+  }
+
+  std::cout << num_frames << " frames, " << num_candidates << " candidates, top-N " << top_n
+            << ", " << kept_total / num_frames << " kept per frame" << std::endl;
+  std::cout << std::setw(18) << "ms" << std::setw(9) << "mean" << std::setw(9) << "p50"
+            << std::setw(9) << "p99" << std::setw(9) << "max" << std::endl;
+  report("nms_cpu", full_ms);
+  report("stream first", first_ms);
+  std::string k_name = "stream first " + std::to_string(first_k);
+  report(k_name.c_str(), first_k_ms);
+  report("stream all", stream_ms);
+  std::cout << "deadline " << deadline_ms << " ms: " << in_time / num_frames << " boxes per frame, "
+            << truncated << " frames truncated" << std::endl;
+  std::cout << mismatches << " frames differ from nms_cpu" << std::endl;
+  std::cout << "fp16 scores: " << tied_mismatches << " frames differ from stable-order NMS; nms_cpu keeps "
+            << "other boxes on " << tied_nms_cpu_differs << " frames" << std::endl;
+  return mismatches || tied_mismatches ? 1 : 0;
+}
@@ -0,0 +1,147 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Temporal NMS benchmark on a synthetic sequence: a moving ego vehicle sees
+// moving cars and pedestrians, each reported as a cluster of overlapping raw
+// candidates, plus scattered low-score clutter. Every frame runs nms_cpu and
+// TemporalNms on the same candidates and compares the outputs.
+//   ./temporal_nms_bench [-n <objects>] [-d <candidates_per_object>] [-f <frames>]
+//                        [-t <nms_thresh>] [-k <pre_nms_top_n>]
+
+#include <unistd.h>
+#include <math.h>
+#include <string.h>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+#include "point_transform.h"
+#include "temporal_nms.h"
+
+int main(int argc, char **argv)
+{
+  int num_objects = 60, dups = 20, num_frames = 100, top_n = 4096;
+  float nms_thresh = 0.01f;
+  int c;
+  while ((c = getopt(argc, argv, "n:d:f:t:k:h")) != -1) {
+    switch (c) {
+      case 'n': num_objects = atoi(optarg); break;
+      case 'd': dups = atoi(optarg); break;
+      case 'f': num_frames = atoi(optarg); break;
+      case 't': nms_thresh = atof(optarg); break;
+      case 'k': top_n = atoi(optarg); break;
+      default:
+        std::cout << "Usage: " << argv[0] << " [-n <objects>] [-d <candidates_per_object>] [-f <frames>]"
+                  << " [-t <nms_thresh>] [-k <pre_nms_top_n>]" << std::endl;
+        return 1;
+    }
+  }
+
+  std::mt19937 rng(11);
+  std::uniform_real_distribution<float> pos(-60.0f, 60.0f), unit(0.0f, 1.0f), heading(-3.14f, 3.14f);
+  std::normal_distribution<float> center(0.0f, 0.25f), size(1.0f, 0.05f), yaw_noise(0.0f, 0.05f);
+  struct Object { float x, y, vx, vy, rt, l, w, h; int id; };
+  std::vector<Object> objects(num_objects);
+  for (Object &o : objects) {
+    bool car = unit(rng) < 0.7f;
+    o.x = pos(rng);
+    o.y = pos(rng);
+    o.rt = heading(rng);
+    float speed = car ? 10.0f * unit(rng) : 1.5f * unit(rng);
+    o.vx = speed * cosf(o.rt);
+    o.vy = speed * sinf(o.rt);
+    o.l = car ? 4.5f : 0.8f;
+    o.w = car ? 1.9f : 0.6f;
+    o.h = car ? 1.6f : 1.7f;
+    o.id = car ? 0 : 1;
+  }
+
+  // ego drives forward at 10 m/s with a slow turn
+  const float dt = 0.1f;
+  float ego_x = 0.0f, ego_y = 0.0f, ego_yaw = 0.0f;
+  float pose[16], prev_pose[16], inv_pose[16], motion[16];
+  TemporalNmsConfig config;
+  TemporalNms temporal(config);
+  TemporalNmsStats total;
+  std::vector<Bndbox> raw, reference, result;
+  double reference_ms = 0.0, temporal_ms = 0.0;
+  size_t mismatches = 0, reference_ious = 0;
+  for (int f = 0; f < num_frames; f++) {
+    ego_x += 10.0f * dt * cosf(ego_yaw);
+    ego_y += 10.0f * dt * sinf(ego_yaw);
+    ego_yaw += 0.02f;
+    pose_identity(pose);
+    pose[0] = cosf(ego_yaw); pose[1] = -sinf(ego_yaw); pose[3] = ego_x;
+    pose[4] = sinf(ego_yaw); pose[5] = cosf(ego_yaw); pose[7] = ego_y;
+    pose_inverse_rigid(pose, inv_pose);
+
+    raw.clear();
+    for (Object &o : objects) {
+      o.x += o.vx * dt;
+      o.y += o.vy * dt;
+      // world to sensor frame
+      float sx = inv_pose[0] * (o.x + ego_x) + inv_pose[1] * (o.y + ego_y) + inv_pose[3];
+      float sy = inv_pose[4] * (o.x + ego_x) + inv_pose[5] * (o.y + ego_y) + inv_pose[7];
+      float srt = o.rt - ego_yaw;
+      for (int d = 0; d < dups; d++) {
+        raw.push_back(Bndbox(sx + center(rng), sy + center(rng), 0.0f, o.l * size(rng), o.w * size(rng),
+                             o.h, srt + yaw_noise(rng), o.id, 0.3f + 0.7f * unit(rng)));
+      }
+    }
+    for (int i = 0; i < num_objects * dups / 4; i++) {
+      raw.push_back(Bndbox(pos(rng), pos(rng), 0.0f, 1.0f + 3.0f * unit(rng), 0.6f + unit(rng), 1.5f,
+                           heading(rng), i % 3, 0.3f * unit(rng)));
+    }
+
+    reference.clear();
+    result.clear();
+    auto t0 = std::chrono::steady_clock::now();
+    nms_cpu(raw, nms_thresh, reference, top_n, &reference_ious);
+    auto t1 = std::chrono::steady_clock::now();
+    if (f > 0) {
+      pose_multiply(inv_pose, prev_pose, motion);
+    }
+    temporal.run(raw, nms_thresh, result, top_n, f > 0 ? motion : nullptr);
+    auto t2 = std::chrono::steady_clock::now();
+    memcpy(prev_pose, pose, sizeof(pose));
+    reference_ms += std::chrono::duration<double, std::milli>(t1 - t0).count();
+    temporal_ms += std::chrono::duration<double, std::milli>(t2 - t1).count();
+    total.add(temporal.lastStats());
+
+    bool same = reference.size() == result.size();
+    for (size_t i = 0; same && i < result.size(); i++) {
+      same = reference[i].x == result[i].x && reference[i].y == result[i].y &&
+             reference[i].score == result[i].score;
+    }
+    mismatches += same ? 0 : 1;
+  }
+
+  std::cout << num_frames << " frames, " << raw.size() << " candidates per frame, "
+            << total.kept / num_frames << " kept" << std::endl;
+  std::cout << "nms_cpu:      " << reference_ms / num_frames << " ms/frame, "
+            << reference_ious / num_frames << " exact IoUs per frame" << std::endl;
+  std::cout << "temporal nms: " << temporal_ms / num_frames << " ms/frame, "
+            << total.exact_ious / num_frames << " exact IoUs, "
+            << total.avoided() / num_frames << " avoided ("
+            << total.bound_skips / num_frames << " by the IoU bound, "
+            << total.distance_skips / num_frames << " by distance) per frame" << std::endl;
+  std::cout << "linked " << 100.0 * total.linked / total.candidates << "% of candidates, "
+            << 100.0 * total.seeded / total.candidates << "% suppressed by their link" << std::endl;
+  std::cout << "frames differing from nms_cpu: " << mismatches << std::endl;
+  return mismatches ? 1 : 0;
+}
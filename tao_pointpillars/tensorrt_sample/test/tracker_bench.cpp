@@ -0,0 +1,120 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Tracker benchmark on synthetic traffic: objects start spread over the area
+// with random velocities and small random accelerations, and are detected
+// with position noise and misses, plus clutter detections.
+//   ./tracker_bench [-n <objects>] [-f <frames>] [-a <area_m>] [-s <noise_m>]
+//                   [-p <detection_prob>] [-i <min_iou>]
+// Reports the update time per frame and identity switches per object.
+
+#include <unistd.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+#include "latency_histogram.h"
+#include "tracker.h"
+
+int main(int argc, char **argv)
+{
+  int num_objects = 300, num_frames = 200;
+  float area = 200.0f, noise = 0.1f, detect_prob = 0.9f;
+  TrackerConfig config;
+  int c;
+  while ((c = getopt(argc, argv, "n:f:a:s:p:i:h")) != -1) {
+    switch (c) {
+      case 'n': num_objects = atoi(optarg); break;
+      case 'f': num_frames = atoi(optarg); break;
+      case 'a': area = atof(optarg); break;
+      case 's': noise = atof(optarg); break;
+      case 'p': detect_prob = atof(optarg); break;
+      case 'i': config.min_iou = atof(optarg); break;
+      default:
+        std::cout << "Usage: " << argv[0] << " [-n <objects>] [-f <frames>] [-a <area_m>] [-s <noise_m>]"
+                  << " [-p <detection_prob>] [-i <min_iou>]" << std::endl;
+        return 1;
+    }
+  }
+
+  std::mt19937 rng(7);
+  std::uniform_real_distribution<float> pos(-area / 2, area / 2), vel(-15.0f, 15.0f), unit(0.0f, 1.0f);
+  std::normal_distribution<float> jitter(0.0f, noise), accel(0.0f, 2.0f);
+  struct Object { float x, y, vx, vy; };
+  std::vector<Object> objects(num_objects);
+  for (Object &o : objects) {
+    o = {pos(rng), pos(rng), vel(rng), vel(rng)};
+  }
+
+  Tracker tracker(config);
+  std::vector<Bndbox> detections;
+  std::vector<int> truth;
+  std::vector<TrackedBox> tracked;
+  std::vector<uint32_t> last_id(num_objects, 0);
+  unsigned long long switches = 0, matched = 0;
+  LatencyHistogram update_us(10000.0f, 1.0f);
+  const double dt = 0.1;
+  for (int f = 0; f < num_frames; f++) {
+    detections.clear();
+    truth.clear();
+    for (int i = 0; i < num_objects; i++) {
+      Object &o = objects[i];
+      o.x += o.vx * dt;
+      o.y += o.vy * dt;
+      // mild random acceleration
+      o.vx += accel(rng) * dt;
+      o.vy += accel(rng) * dt;
+      if (unit(rng) < detect_prob) {
+        float heading = atan2f(o.vy, o.vx);
+        detections.push_back(Bndbox(o.x + jitter(rng), o.y + jitter(rng), -1.0f, 4.5f, 1.9f, 1.6f, heading, 0, 0.9f));
+        truth.push_back(i);
+      }
+    }
+    for (int k = 0; k < num_objects / 20; k++) {
+      detections.push_back(Bndbox(pos(rng), pos(rng), -1.0f, 4.5f, 1.9f, 1.6f, 0.0f, 0, 0.3f));
+      truth.push_back(-1);
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    tracker.update(detections, f * dt, tracked);
+    auto t1 = std::chrono::steady_clock::now();
+    update_us.add(std::chrono::duration<float, std::micro>(t1 - t0).count());
+
+    for (size_t d = 0; d < tracked.size(); d++) {
+      int i = truth[d];
+      if (i < 0) {
+        continue;
+      }
+      if (last_id[i] && last_id[i] != tracked[d].track_id) {
+        switches++;
+      }
+      last_id[i] = tracked[d].track_id;
+      matched++;
+    }
+  }
+
+  std::cout << num_objects << " objects, " << num_frames << " frames, " << tracker.numTracks()
+            << " live tracks" << std::endl;
+  std::cout << "update us: mean " << update_us.mean() << ", p99 " << update_us.percentile(99)
+            << ", max " << update_us.max() << std::endl;
+  std::cout << "identity switches: " << switches << " in " << matched << " detections ("
+            << 100.0 * switches / std::max(1ULL, matched) << "%)" << std::endl;
+  return 0;
+}